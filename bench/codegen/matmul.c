@@ -0,0 +1,41 @@
+// Multiplies two pseudo-random N x N matrices, which are stored in row-major
+// order in flat arrays, ROUNDS times.
+
+#define N 200
+// The number of elements; the length of an array must be a literal.
+#define N2 40000
+#define ROUNDS 10
+
+unsigned Next(unsigned seed) {
+  return seed * 1103515245 + 12345;
+}
+
+int main() {
+  int a[N2];
+  int b[N2];
+  int c[N2];
+  unsigned seed = 1;
+  int checksum = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < N2; i++) {
+      seed = Next(seed);
+      a[i] = (seed >> 16) % 100 - 50;
+      seed = Next(seed);
+      b[i] = (seed >> 16) % 100 - 50;
+    }
+    for (int i = 0; i < N; i++) {
+      for (int j = 0; j < N; j++) {
+        int sum = 0;
+        for (int k = 0; k < N; k++) {
+          sum = sum + a[i * N + k] * b[k * N + j];
+        }
+        c[i * N + j] = sum;
+      }
+    }
+    for (int i = 0; i < N2; i = i + N + 1) {
+      checksum = checksum ^ (c[i] + i);
+    }
+  }
+  __builtin_print(checksum);
+  return 0;
+}
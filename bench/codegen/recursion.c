@@ -0,0 +1,34 @@
+// Calls recursive functions with small bodies, so that the cost is dominated
+// by the calls.
+
+int Fib(int n) {
+  if (n < 2) {
+    return n;
+  }
+  return Fib(n - 1) + Fib(n - 2);
+}
+
+int Ackermann(int m, int n) {
+  if (m == 0) {
+    return n + 1;
+  }
+  if (n == 0) {
+    return Ackermann(m - 1, 1);
+  }
+  return Ackermann(m - 1, Ackermann(m, n - 1));
+}
+
+// The number of moves to solve the Tower of Hanoi of n disks.
+int Hanoi(int n, int from, int to, int via) {
+  if (n == 0) {
+    return 0;
+  }
+  return Hanoi(n - 1, from, via, to) + 1 + Hanoi(n - 1, via, to, from);
+}
+
+int main() {
+  __builtin_print(Fib(34));
+  __builtin_print(Ackermann(2, 2000));
+  __builtin_print(Hanoi(22, 1, 3, 2));
+  return 0;
+}
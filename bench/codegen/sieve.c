@@ -0,0 +1,28 @@
+// Counts the primes below N with the sieve of Eratosthenes, ROUNDS times.
+
+#define N 1000000
+#define ROUNDS 30
+
+int main() {
+  char is_composite[N];
+  int sum = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    // Each round sieves a slightly different range.
+    int n = N - round;
+    for (int i = 0; i < n; i++) {
+      is_composite[i] = 0;
+    }
+    int count = 0;
+    for (int i = 2; i < n; i++) {
+      if (!is_composite[i]) {
+        count++;
+        for (int j = i + i; j < n; j = j + i) {
+          is_composite[j] = 1;
+        }
+      }
+    }
+    sum = sum + count;
+  }
+  __builtin_print(sum);
+  return 0;
+}
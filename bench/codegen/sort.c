@@ -0,0 +1,82 @@
+// Sorts N pseudo-random integers with quicksort, which switches to insertion
+// sort for short ranges, ROUNDS times. The ranges that are left to sort are
+// kept on an explicit stack.
+
+#define N 200000
+#define ROUNDS 10
+#define CUTOFF 16
+
+int main() {
+  int a[N];
+  // The shorter range is pushed, so the depth is at most log2(N).
+  int lows[64];
+  int highs[64];
+  unsigned seed = 1;
+  int checksum = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < N; i++) {
+      seed = seed * 1103515245 + 12345;
+      a[i] = seed >> 4;
+    }
+
+    int top = 0;
+    lows[0] = 0;
+    highs[0] = N - 1;
+    top++;
+    while (top > 0) {
+      top--;
+      int lo = lows[top];
+      int hi = highs[top];
+      while (hi - lo > CUTOFF) {
+        int pivot = a[lo + (hi - lo) / 2];
+        int i = lo;
+        int j = hi;
+        while (i <= j) {
+          while (a[i] < pivot) {
+            i++;
+          }
+          while (a[j] > pivot) {
+            j--;
+          }
+          if (i <= j) {
+            int tmp = a[i];
+            a[i] = a[j];
+            a[j] = tmp;
+            i++;
+            j--;
+          }
+        }
+        if (j - lo < hi - i) {
+          lows[top] = lo;
+          highs[top] = j;
+          lo = i;
+        } else {
+          lows[top] = i;
+          highs[top] = hi;
+          hi = j;
+        }
+        top++;
+      }
+      for (int i = lo + 1; i <= hi; i++) {
+        int val = a[i];
+        int j = i - 1;
+        while (j >= lo && a[j] > val) {
+          a[j + 1] = a[j];
+          j--;
+        }
+        a[j + 1] = val;
+      }
+    }
+
+    int is_sorted = 1;
+    for (int i = 1; i < N; i++) {
+      if (a[i - 1] > a[i]) {
+        is_sorted = 0;
+      }
+    }
+    __builtin_print(is_sorted);
+    checksum = checksum ^ a[N / 2] ^ a[N / 3];
+  }
+  __builtin_print(checksum);
+  return 0;
+}
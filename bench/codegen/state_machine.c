@@ -0,0 +1,122 @@
+// Runs a stack-based bytecode interpreter, whose dispatch is a switch in a
+// loop, on a program that sums the lengths of the Collatz sequences of the
+// integers below N.
+
+#define N 20000
+
+#define HALT 0
+#define PUSH 1
+#define LOAD 2
+#define STORE 3
+#define ADD 4
+#define MUL 5
+#define DIV 6
+#define MOD 7
+#define LT 8
+#define EQ 9
+#define JMP 10
+#define JZ 11
+#define JNZ 12
+
+// Every instruction is an opcode followed by an argument, and the jumps are
+// to the index of the instruction. The variables are i (0), x (1) and the
+// total length (2).
+int Run(int n) {
+  int code[76] = {
+      PUSH,  1,  STORE, 0,   // i = 1
+      LOAD,  0,  PUSH,  n,   // 2: while (i < n)
+      LT,    0,  JZ,    37,  //
+      LOAD,  0,  STORE, 1,   // x = i
+      LOAD,  1,  PUSH,  1,   // 8: while (x != 1)
+      EQ,    0,  JNZ,   32,  //
+      LOAD,  2,  PUSH,  1,   // total = total + 1
+      ADD,   0,  STORE, 2,   //
+      LOAD,  1,  PUSH,  2,   // if (x % 2 == 0)
+      MOD,   0,  JNZ,   25,  //
+      LOAD,  1,  PUSH,  2,   // x = x / 2
+      DIV,   0,  STORE, 1,   //
+      JMP,   8,              //
+      LOAD,  1,  PUSH,  3,   // 25: else x = x * 3 + 1
+      MUL,   0,  PUSH,  1,   //
+      ADD,   0,  STORE, 1,   //
+      JMP,   8,              //
+      LOAD,  0,  PUSH,  1,   // 32: i = i + 1
+      ADD,   0,  STORE, 0,   //
+      JMP,   2,              //
+      HALT,  0,              // 37
+  };
+  int vars[3] = {0, 0, 0};
+  int stack[16];
+  int sp = 0;
+  int pc = 0;
+  int steps = 0;
+  int is_running = 1;
+  while (is_running) {
+    int op = code[pc];
+    int arg = code[pc + 1];
+    pc = pc + 2;
+    steps++;
+    switch (op) {
+      case PUSH:
+        stack[sp] = arg;
+        sp++;
+        break;
+      case LOAD:
+        stack[sp] = vars[arg];
+        sp++;
+        break;
+      case STORE:
+        sp--;
+        vars[arg] = stack[sp];
+        break;
+      case ADD:
+        sp--;
+        stack[sp - 1] = stack[sp - 1] + stack[sp];
+        break;
+      case MUL:
+        sp--;
+        stack[sp - 1] = stack[sp - 1] * stack[sp];
+        break;
+      case DIV:
+        sp--;
+        stack[sp - 1] = stack[sp - 1] / stack[sp];
+        break;
+      case MOD:
+        sp--;
+        stack[sp - 1] = stack[sp - 1] % stack[sp];
+        break;
+      case LT:
+        sp--;
+        stack[sp - 1] = stack[sp - 1] < stack[sp];
+        break;
+      case EQ:
+        sp--;
+        stack[sp - 1] = stack[sp - 1] == stack[sp];
+        break;
+      case JMP:
+        pc = arg * 2;
+        break;
+      case JZ:
+        sp--;
+        if (stack[sp] == 0) {
+          pc = arg * 2;
+        }
+        break;
+      case JNZ:
+        sp--;
+        if (stack[sp] != 0) {
+          pc = arg * 2;
+        }
+        break;
+      default:
+        is_running = 0;
+    }
+  }
+  __builtin_print(vars[2]);
+  return steps;
+}
+
+int main() {
+  __builtin_print(Run(N));
+  return 0;
+}
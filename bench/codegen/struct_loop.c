@@ -0,0 +1,66 @@
+// Moves particles, which are records with nested records, in a box and
+// accumulates their energy; the records are passed to and returned from
+// functions by value.
+
+#define N 1000
+#define STEPS 10000
+#define SIZE 100000
+
+struct vec {
+  int x;
+  int y;
+};
+
+struct particle {
+  struct vec pos;
+  struct vec vel;
+  int mass;
+};
+
+struct vec Add(struct vec a, struct vec b) {
+  struct vec sum = {a.x + b.x, a.y + b.y};
+  return sum;
+}
+
+// Reflects the velocity of the particle off the walls of the box.
+struct particle Bounce(struct particle p) {
+  if (p.pos.x < 0 || p.pos.x > SIZE) {
+    p.vel.x = -p.vel.x;
+  }
+  if (p.pos.y < 0 || p.pos.y > SIZE) {
+    p.vel.y = -p.vel.y;
+  }
+  return p;
+}
+
+int Energy(struct particle p) {
+  return p.mass * (p.vel.x * p.vel.x + p.vel.y * p.vel.y) / 2;
+}
+
+int main() {
+  struct particle particles[N];
+  unsigned seed = 7;
+  for (int i = 0; i < N; i++) {
+    seed = seed * 1103515245 + 12345;
+    particles[i].pos.x = seed % SIZE;
+    particles[i].pos.y = (seed >> 8) % SIZE;
+    particles[i].vel.x = (seed >> 4) % 201 - 100;
+    particles[i].vel.y = (seed >> 12) % 201 - 100;
+    particles[i].mass = i % 5 + 1;
+  }
+  int energy = 0;
+  for (int step = 0; step < STEPS; step++) {
+    for (int i = 0; i < N; i++) {
+      particles[i].pos = Add(particles[i].pos, particles[i].vel);
+      particles[i] = Bounce(particles[i]);
+      energy = (energy + Energy(particles[i])) % 1000003;
+    }
+  }
+  int sum = 0;
+  for (int i = 0; i < N; i++) {
+    sum = sum + particles[i].pos.x + particles[i].pos.y;
+  }
+  __builtin_print(sum);
+  __builtin_print(energy);
+  return 0;
+}
@@ -0,0 +1,279 @@
+// Measures how fast the programs that vitaminc compiles run, on the CPU-bound
+// kernels under bench/codegen/, against gcc at -O0 and -O2.
+//
+// Usage: codegen_bench [runs]
+// Run from the root of the repository, after vitaminc and the runtime library
+// are built. Each kernel is compiled by each compiler and run <runs> times
+// (default: 5); the median time and a checksum of the output are reported.
+// The results are appended to bench/codegen_results.tsv with the commit they
+// are measured at, and compared with the latest results of an earlier commit.
+
+#include <fmt/core.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr auto kDefaultNumOfRuns = 5;
+constexpr auto kKernelDir = "bench/codegen";
+constexpr auto kResultsPath = "bench/codegen_results.tsv";
+
+struct Compiler {
+  const char* name;
+  /// @brief Formatted with the paths of the executable (0), the source (1) and
+  /// the repository (2); run in a directory of its own, to which the
+  /// intermediate files are written.
+  const char* command;
+};
+
+/// @note The output of gcc -O0 is the reference of the checksums, and gcc -O2
+/// is the baseline of the times. The builtin is replaced with the runtime
+/// function that vitaminc lowers it to, so that printing costs the same. The
+/// profile-guided build is trained on a run of the kernel itself.
+constexpr auto kCompilers = std::array<Compiler, 6>{{
+    {"gcc -O0",
+     "gcc -O0 -w -include {2}/runtime/runtime.h "
+     "-D__builtin_print=__vitaminc_print_int -o {0} {1} "
+     "{2}/runtime/runtime.o"},
+    {"gcc -O2",
+     "gcc -O2 -w -include {2}/runtime/runtime.h "
+     "-D__builtin_print=__vitaminc_print_int -o {0} {1} "
+     "{2}/runtime/runtime.o"},
+    {"vitaminc", "{2}/vitaminc -o {0} {1}"},
+    {"vitaminc pgo",
+     "{2}/vitaminc --profile-generate=profile -o {0} {1} && {0} && "
+     "{2}/vitaminc --profile-use=profile -o {0} {1}"},
+    {"vitaminc x86_64", "{2}/vitaminc --target=x86_64 -o {0} {1}"},
+    {"vitaminc llvm", "{2}/vitaminc --target=llvm -o {0} {1}"},
+}};
+constexpr auto kReference = std::size_t{0};
+constexpr auto kBaseline = std::size_t{1};
+
+struct Measurement {
+  double median_ms;
+  /// @brief FNV-1a of the output.
+  std::uint32_t checksum;
+};
+
+std::uint32_t ChecksumOf(const std::string& output) {
+  auto hash = std::uint32_t{2166136261U};
+  for (const auto c : output) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619U;
+  }
+  return hash;
+}
+
+/// @brief Runs `executable` and captures its standard output.
+/// @return The output; `std::nullopt` if the program doesn't exit with 0.
+std::optional<std::string> Run(const std::string& executable) {
+  auto fds = std::array<int, 2>{};
+  if (pipe(fds.data()) != 0) {
+    return std::nullopt;
+  }
+  const auto pid = fork();
+  if (pid == 0) {
+    dup2(fds[1], STDOUT_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+    execl(executable.c_str(), executable.c_str(),
+          static_cast<char*>(nullptr));
+    std::_Exit(127);
+  }
+  close(fds[1]);
+  auto output = std::string{};
+  auto buf = std::array<char, 4096>{};
+  auto len = ssize_t{0};
+  while ((len = read(fds[0], buf.data(), buf.size())) > 0) {
+    output.append(buf.data(), static_cast<std::size_t>(len));
+  }
+  close(fds[0]);
+  auto status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return std::nullopt;
+  }
+  return output;
+}
+
+/// @return `std::nullopt` if any run fails or the runs disagree on the output.
+std::optional<Measurement> Measure(const std::string& executable,
+                                   int num_of_runs) {
+  auto times = std::vector<double>{};
+  auto first_output = std::optional<std::string>{};
+  for (auto i = 0; i < num_of_runs; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    auto output = Run(executable);
+    const auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start);
+    if (!output || (first_output && *output != *first_output)) {
+      return std::nullopt;
+    }
+    first_output = std::move(output);
+    times.push_back(elapsed.count());
+  }
+  std::sort(times.begin(), times.end());
+  const auto mid = times.size() / 2;
+  const auto median = times.size() % 2
+                           ? times.at(mid)
+                           : (times.at(mid - 1) + times.at(mid)) / 2;
+  return Measurement{median, ChecksumOf(*first_output)};
+}
+
+/// @return The commit of the working tree, suffixed with "-dirty" if there
+/// are uncommitted changes; "unknown" if it's not a git repository.
+std::string CurrentCommit() {
+  auto* git = popen("git describe --always --dirty 2>/dev/null", "r");
+  if (!git) {
+    return "unknown";
+  }
+  auto buf = std::array<char, 128>{};
+  auto commit = std::string{};
+  if (std::fgets(buf.data(), buf.size(), git)) {
+    commit = buf.data();
+  }
+  pclose(git);
+  commit.erase(commit.find_last_not_of('\n') + 1);
+  return commit.empty() ? "unknown" : commit;
+}
+
+/// @brief The median times of the latest results of each kernel and compiler
+/// that are measured at a commit other than `commit`.
+std::map<std::pair<std::string, std::string>, double> LoadPrevResults(
+    const std::string& commit) {
+  auto prev_results = std::map<std::pair<std::string, std::string>, double>{};
+  auto results = std::ifstream{kResultsPath};
+  auto line = std::string{};
+  std::getline(results, line);  // header
+  while (std::getline(results, line)) {
+    auto fields = std::vector<std::string>{};
+    auto field_stream = std::istringstream{line};
+    auto field = std::string{};
+    while (std::getline(field_stream, field, '\t')) {
+      fields.push_back(field);
+    }
+    // commit, kernel, compiler, median_ms, checksum
+    if (fields.size() == 5 && fields.at(0) != commit) {
+      prev_results[{fields.at(1), fields.at(2)}] = std::stod(fields.at(3));
+    }
+  }
+  return prev_results;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto num_of_runs = kDefaultNumOfRuns;
+  if (argc > 1) {
+    num_of_runs = std::atoi(
+        argv[1]);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    num_of_runs = std::max(num_of_runs, 1);
+  }
+
+  auto kernels = std::vector<std::filesystem::path>{};
+  for (const auto& entry : std::filesystem::directory_iterator{kKernelDir}) {
+    if (entry.path().extension() == ".c") {
+      kernels.push_back(std::filesystem::absolute(entry.path()));
+    }
+  }
+  std::sort(kernels.begin(), kernels.end());
+  if (kernels.empty()) {
+    fmt::print(stderr, "no kernels under {}; run from the repository root\n",
+               kKernelDir);
+    return 1;
+  }
+
+  const auto root = std::filesystem::current_path();
+  auto build_dir_template =
+      (std::filesystem::temp_directory_path() / "vitaminc-bench-XXXXXX")
+          .string();
+  if (!mkdtemp(build_dir_template.data())) {
+    fmt::print(stderr, "cannot create the build directory\n");
+    return 1;
+  }
+  const auto build_dir = std::filesystem::path{build_dir_template};
+
+  const auto commit = CurrentCommit();
+  const auto prev_results = LoadPrevResults(commit);
+  const auto has_results = std::filesystem::exists(kResultsPath);
+  auto results = std::ofstream{kResultsPath, std::ios::app};
+  if (!has_results) {
+    results << "commit\tkernel\tcompiler\tmedian_ms\tchecksum\n";
+  }
+
+  fmt::print("commit {}, median of {} runs\n", commit, num_of_runs);
+  fmt::print("{:<16} {:<16} {:>12} {:>9} {:>9}  {}\n", "kernel", "compiler",
+             "median", "/gcc -O2", "/prev", "checksum");
+  auto has_mismatch = false;
+  auto has_failure = false;
+  for (const auto& kernel : kernels) {
+    const auto name = kernel.stem().string();
+    auto measurements = std::vector<std::optional<Measurement>>{};
+    for (auto i = std::size_t{0}; i < kCompilers.size(); ++i) {
+      const auto dir = build_dir / fmt::format("{}-{}", name, i);
+      std::filesystem::create_directory(dir);
+      const auto executable = (dir / name).string();
+      const auto compile =
+          fmt::format("cd {} && ({}) >/dev/null 2>&1", dir.string(),
+                      fmt::format(kCompilers.at(i).command, executable,
+                                  kernel.string(), root.string()));
+      if (std::system(compile.c_str()) == 0) {
+        measurements.push_back(Measure(executable, num_of_runs));
+      } else {
+        measurements.push_back(std::nullopt);
+      }
+    }
+
+    const auto& reference = measurements.at(kReference);
+    const auto& baseline = measurements.at(kBaseline);
+    for (auto i = std::size_t{0}; i < kCompilers.size(); ++i) {
+      const auto* compiler_name = kCompilers.at(i).name;
+      const auto& measurement = measurements.at(i);
+      if (!measurement) {
+        has_failure = true;
+        fmt::print("{:<16} {:<16} {:>12}\n", name, compiler_name, "failed");
+        continue;
+      }
+      const auto ratio =
+          baseline ? fmt::format("{:.2f}x",
+                                 measurement->median_ms / baseline->median_ms)
+                   : "-";
+      const auto prev = prev_results.find({name, compiler_name});
+      const auto change =
+          prev != prev_results.cend()
+              ? fmt::format("{:+.1f}%",
+                            (measurement->median_ms / prev->second - 1) * 100)
+              : "-";
+      const auto is_mismatch =
+          reference && measurement->checksum != reference->checksum;
+      has_mismatch = has_mismatch || is_mismatch;
+      fmt::print("{:<16} {:<16} {:>9.1f} ms {:>9} {:>9}  {:08x}{}\n", name,
+                 compiler_name, measurement->median_ms, ratio, change,
+                 measurement->checksum, is_mismatch ? " MISMATCH" : "");
+      results << fmt::format("{}\t{}\t{}\t{:.3f}\t{:08x}\n", commit, name,
+                             compiler_name, measurement->median_ms,
+                             measurement->checksum);
+    }
+  }
+
+  std::filesystem::remove_all(build_dir);
+  fmt::print("results are appended to {}\n", kResultsPath);
+  // A mismatch is a miscompilation, unless the kernel has undefined behavior;
+  // a failure is a compiler that rejects or crashes on a supported kernel, or
+  // a program that doesn't exit with 0.
+  return has_mismatch || has_failure ? 1 : 0;
+}
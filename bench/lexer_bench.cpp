@@ -0,0 +1,116 @@
+// Compares the flex scanner with the hand-written lexer on the same source.
+//
+// Usage: lexer_bench [file]
+// Without a file, a synthetic source of many small functions is used.
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "lexer.hpp"
+#include "y.tab.hpp"
+
+extern FILE*
+    yyin;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables):
+           // flex read from this file pointer.
+extern void yylex_destroy();  // NOLINT(readability-identifier-naming): extern
+                              // from flex generated code.
+extern yy::parser::symbol_type yylex();
+
+namespace {
+
+constexpr auto kNumOfRuns = 5;
+
+std::string SyntheticSource() {
+  const auto num_of_funcs = 20000;
+  auto source = std::string{};
+  for (auto i = 0; i < num_of_funcs; ++i) {
+    source += fmt::format(
+        "/* Function number {0}. */\n"
+        "int function_{0}(int first_param, int* second_param) {{\n"
+        "  int accumulator = first_param * {0};\n"
+        "  for (int i = 0; i < 100; ++i) {{\n"
+        "    accumulator = accumulator + second_param[i] % 7;  // body\n"
+        "  }}\n"
+        "  return accumulator >= 12345 ? accumulator : -accumulator;\n"
+        "}}\n\n",
+        i);
+  }
+  return source;
+}
+
+/// @return The number of tokens read by `yylex`, excluding the EOF.
+std::size_t DrainParserTokens() {
+  auto num_of_tokens = std::size_t{0};
+  while (yylex().kind() != yy::parser::symbol_kind::S_YYEOF) {
+    ++num_of_tokens;
+  }
+  return num_of_tokens;
+}
+
+/// @return The best time of the runs in seconds.
+template <typename Func>
+double BestOf(Func&& run) {
+  auto best = std::chrono::duration<double>::max();
+  for (auto i = 0; i < kNumOfRuns; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min<std::chrono::duration<double>>(
+        best, std::chrono::steady_clock::now() - start);
+  }
+  return best.count();
+}
+
+void Report(const char* name, double seconds, std::size_t size,
+            std::size_t num_of_tokens) {
+  const auto mib = static_cast<double>(size) / (1024.0 * 1024.0);
+  fmt::print("{:<28} {:>9.2f} ms {:>9.1f} MiB/s {:>10} tokens\n", name,
+             seconds * 1e3, mib / seconds, num_of_tokens);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto source = std::string{};
+  if (argc > 1) {
+    auto input = std::ifstream{
+        argv[1],  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        std::ios::binary};
+    source.assign(std::istreambuf_iterator<char>{input}, {});
+  } else {
+    source = SyntheticSource();
+  }
+
+  auto flex_tokens = std::size_t{0};
+  const auto flex_time = BestOf([&] {
+    yyin = fmemopen(source.data(), source.size(), "r");
+    flex_tokens = DrainParserTokens();
+    fclose(yyin);
+    yylex_destroy();
+  });
+
+  auto lex_tokens = std::size_t{0};
+  const auto lex_time = BestOf([&] {
+    // The kEof token is excluded.
+    lex_tokens = Lex(source).size() - 1;
+  });
+
+  auto simd_tokens = std::size_t{0};
+  const auto simd_time = BestOf([&] {
+    const auto tokens = Lex(source);
+    SetParserTokens(&tokens);
+    simd_tokens = DrainParserTokens();
+    SetParserTokens(nullptr);
+  });
+
+  Report("flex", flex_time, source.size(), flex_tokens);
+  Report("simd (token buffer only)", lex_time, source.size(), lex_tokens);
+  Report("simd (to parser tokens)", simd_time, source.size(), simd_tokens);
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Compares the buffered `__vitaminc_print_int` of the runtime library, which
+// `__builtin_print` is lowered to, with `printf("%d\n")`, which it used to be.
+//
+// Usage: print_bench [count]
+// The integers printed span all lengths and both signs. The output goes to
+// /dev/null while measuring.
+
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "runtime.h"
+
+namespace {
+
+constexpr auto kNumOfRuns = 5;
+constexpr auto kDefaultCount = 10'000'000;
+
+std::vector<int> MakeInts(int count) {
+  auto ints = std::vector<int>{};
+  ints.reserve(static_cast<std::size_t>(count));
+  // A linear congruential generator, shifted to vary the number of digits.
+  auto state = 12345U;
+  for (auto i = 0; i < count; ++i) {
+    state = state * 1103515245U + 12345U;
+    ints.push_back(static_cast<int>(state) >> (i % 31));
+  }
+  return ints;
+}
+
+/// @return The best time of the runs in seconds.
+template <typename Func>
+double BestOf(Func&& run) {
+  auto best = std::chrono::duration<double>::max();
+  for (auto i = 0; i < kNumOfRuns; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min<std::chrono::duration<double>>(
+        best, std::chrono::steady_clock::now() - start);
+  }
+  return best.count();
+}
+
+void Report(const char* name, double seconds, std::size_t count) {
+  fmt::print("{:<24} {:>9.2f} ms {:>8.2f} ns/int\n", name, seconds * 1e3,
+             seconds * 1e9 / static_cast<double>(count));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto count = kDefaultCount;
+  if (argc > 1) {
+    count = std::atoi(
+        argv[1]);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+  const auto ints = MakeInts(count);
+
+  // Both write to the standard output, which is redirected to /dev/null and
+  // restored for the report.
+  std::fflush(stdout);
+  const auto stdout_fd = dup(STDOUT_FILENO);
+  const auto null_fd = open("/dev/null", O_WRONLY);
+  dup2(null_fd, STDOUT_FILENO);
+
+  const auto printf_time = BestOf([&] {
+    for (const auto val : ints) {
+      std::printf("%d\n", val);
+    }
+    std::fflush(stdout);
+  });
+  const auto runtime_time = BestOf([&] {
+    for (const auto val : ints) {
+      __vitaminc_print_int(val);
+    }
+    __vitaminc_flush();
+  });
+
+  dup2(stdout_fd, STDOUT_FILENO);
+  close(null_fd);
+  close(stdout_fd);
+
+  Report("printf", printf_time, ints.size());
+  Report("__vitaminc_print_int", runtime_time, ints.size());
+  return 0;
+}
@@ -0,0 +1,177 @@
+// Compares the double dispatch of `Accept()` and `Visit()` with the static
+// dispatch of `StaticVisitor`, with and without a `VisitProfiler`, and
+// `dynamic_cast` with `Isa`, on the same synthetic expression tree.
+//
+// Usage: traversal_bench [depth]
+// The tree is a complete binary tree of binary expressions of the depth.
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+#include "casting.hpp"
+#include "operator.hpp"
+#include "static_visitor.hpp"
+#include "visit_profiler.hpp"
+#include "visitor.hpp"
+
+namespace {
+
+constexpr auto kNumOfRuns = 5;
+constexpr auto kDefaultDepth = 20;
+
+/// @brief Builds a complete binary tree of binary expressions, whose leaves
+/// alternate between constants and negated identifiers.
+std::unique_ptr<ExprNode> BuildTree(int depth, int& num_of_leaves) {
+  const auto loc = Location{0};
+  if (depth == 0) {
+    if (num_of_leaves++ % 2 == 0) {
+      return std::make_unique<IntConstExprNode>(loc, num_of_leaves);
+    }
+    return std::make_unique<UnaryExprNode>(
+        loc, UnaryOperator::kNeg, std::make_unique<IdExprNode>(loc, "x"));
+  }
+  auto lhs = BuildTree(depth - 1, num_of_leaves);
+  auto rhs = BuildTree(depth - 1, num_of_leaves);
+  return std::make_unique<BinaryExprNode>(loc, BinaryOperator::kAdd,
+                                          std::move(lhs), std::move(rhs));
+}
+
+void CollectNodes(const ExprNode& expr, std::vector<const ExprNode*>& nodes) {
+  nodes.push_back(&expr);
+  if (const auto* bin_expr = DynCast<BinaryExprNode>(&expr)) {
+    CollectNodes(*bin_expr->lhs, nodes);
+    CollectNodes(*bin_expr->rhs, nodes);
+  } else if (const auto* unary_expr = DynCast<UnaryExprNode>(&expr)) {
+    CollectNodes(*unary_expr->operand, nodes);
+  }
+}
+
+/// @brief Sums up the constants and counts the identifiers.
+class VirtualSummer : public NonModifyingVisitor {
+ public:
+  void Visit(const BinaryExprNode& bin_expr) override {
+    bin_expr.lhs->Accept(*this);
+    bin_expr.rhs->Accept(*this);
+  }
+  void Visit(const UnaryExprNode& unary_expr) override {
+    unary_expr.operand->Accept(*this);
+  }
+  void Visit(const IntConstExprNode& int_expr) override {
+    sum += int_expr.val;
+  }
+  void Visit(const IdExprNode&) override {
+    ++sum;
+  }
+
+  long long sum = 0;
+};
+
+/// @brief Same as `VirtualSummer`.
+class StaticSummer : public StaticVisitor<StaticSummer> {
+ public:
+  using StaticVisitor::Visit;
+
+  void Visit(const BinaryExprNode& bin_expr) {
+    Dispatch(*bin_expr.lhs);
+    Dispatch(*bin_expr.rhs);
+  }
+  void Visit(const UnaryExprNode& unary_expr) {
+    Dispatch(*unary_expr.operand);
+  }
+  void Visit(const IntConstExprNode& int_expr) {
+    sum += int_expr.val;
+  }
+  void Visit(const IdExprNode&) {
+    ++sum;
+  }
+
+  long long sum = 0;
+};
+
+/// @return The best time of the runs in seconds.
+template <typename Func>
+double BestOf(Func&& run) {
+  auto best = std::chrono::duration<double>::max();
+  for (auto i = 0; i < kNumOfRuns; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min<std::chrono::duration<double>>(
+        best, std::chrono::steady_clock::now() - start);
+  }
+  return best.count();
+}
+
+void Report(const char* name, double seconds, std::size_t num_of_nodes,
+            long long result) {
+  fmt::print("{:<24} {:>9.2f} ms {:>8.2f} ns/node   (result {})\n", name,
+             seconds * 1e3, seconds * 1e9 / static_cast<double>(num_of_nodes),
+             result);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto depth = kDefaultDepth;
+  if (argc > 1) {
+    depth = std::atoi(
+        argv[1]);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+  auto num_of_leaves = 0;
+  const auto tree = BuildTree(depth, num_of_leaves);
+  auto nodes = std::vector<const ExprNode*>{};
+  CollectNodes(*tree, nodes);
+
+  auto virtual_sum = 0LL;
+  const auto virtual_time = BestOf([&] {
+    auto summer = VirtualSummer{};
+    tree->Accept(summer);
+    virtual_sum = summer.sum;
+  });
+
+  auto static_sum = 0LL;
+  const auto static_time = BestOf([&] {
+    auto summer = StaticSummer{};
+    summer.Dispatch(*tree);
+    static_sum = summer.sum;
+  });
+
+  auto profiled_sum = 0LL;
+  const auto profiled_time = BestOf([&] {
+    auto profiler = VisitProfiler{"summing"};
+    auto summer = StaticSummer{};
+    summer.SetProfiler(&profiler);
+    summer.Dispatch(*tree);
+    profiled_sum = summer.sum;
+  });
+
+  auto dynamic_cast_count = 0LL;
+  const auto dynamic_cast_time = BestOf([&] {
+    dynamic_cast_count = std::count_if(
+        nodes.cbegin(), nodes.cend(), [](const ExprNode* node) {
+          return dynamic_cast<const IdExprNode*>(node) != nullptr;
+        });
+  });
+
+  auto isa_count = 0LL;
+  const auto isa_time = BestOf([&] {
+    isa_count =
+        std::count_if(nodes.cbegin(), nodes.cend(), [](const ExprNode* node) {
+          return Isa<IdExprNode>(*node);
+        });
+  });
+
+  Report("Accept + Visit", virtual_time, nodes.size(), virtual_sum);
+  Report("StaticVisitor::Dispatch", static_time, nodes.size(), static_sum);
+  Report("... with VisitProfiler", profiled_time, nodes.size(), profiled_sum);
+  Report("dynamic_cast", dynamic_cast_time, nodes.size(), dynamic_cast_count);
+  Report("Isa", isa_time, nodes.size(), isa_count);
+  return 0;
+}
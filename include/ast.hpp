@@ -1,6 +1,7 @@
 #ifndef AST_HPP_
 #define AST_HPP_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -12,8 +13,63 @@
 #include "type.hpp"
 #include "visitor.hpp"
 
+/// @brief The concrete classes of the nodes.
+/// @note The kinds of the classes derived from the same abstract class are
+/// kept contiguous, so that `ClassOf` of an abstract class is a range check.
+/// Update the ranges every time a new kind of node is introduced.
+enum class AstNodeKind : std::uint8_t {
+  // DeclNode
+  kVarDecl,
+  kArrDecl,
+  kRecordDecl,
+  kField,
+  kRecordVarDecl,
+  kParam,
+  kFuncDef,
+  // StmtNode
+  kDeclStmt,
+  kCompoundStmt,
+  kIfStmt,
+  kWhileStmt,
+  kForStmt,
+  kReturnStmt,
+  kGotoStmt,
+  kBreakStmt,
+  kContinueStmt,
+  kSwitchStmt,
+  kExprStmt,
+  // LabeledStmtNode, which is also a StmtNode
+  kIdLabeledStmt,
+  kCaseStmt,
+  kDefaultStmt,
+  // ExprNode
+  kInitExpr,
+  kNullExpr,
+  kIdExpr,
+  kIntConstExpr,
+  kArgExpr,
+  kArrSubExpr,
+  kCondExpr,
+  kFuncCallExpr,
+  kPostfixArithExpr,
+  kRecordMemExpr,
+  kUnaryExpr,
+  kBinaryExpr,
+  // AssignmentExprNode, which is also an ExprNode
+  kSimpleAssignmentExpr,
+  // DesNode
+  kArrDes,
+  kIdDes,
+  // others
+  kLoopInit,
+  kExternDecl,
+  kTransUnit,
+};
+
 /// @brief The most general base node of the Abstract Syntax Tree.
 /// @note This is an abstract class.
+/// @note Use `Isa`, `Cast` and `DynCast` from "casting.hpp" to test and
+/// convert to the derived classes.
 struct AstNode {
   virtual void Accept(NonModifyingVisitor&) const;
   virtual void Accept(ModifyingVisitor&);
@@ -21,7 +77,7 @@ struct AstNode {
   /// @note To make the class abstract.
   virtual ~AstNode() = 0;
 
-  AstNode(Location loc) : loc{loc} {}
+  AstNode(AstNodeKind kind, Location loc) : loc{loc}, kind{kind} {}
 
   // Delete copy/move operations to avoid slicing. [1]
   // And "You almost never want to copy or move polymorphic objects. They
@@ -36,6 +92,8 @@ struct AstNode {
   AstNode& operator=(AstNode&&) = delete;
 
   Location loc;
+  /// @note Fits in the padding after `loc`, so it costs no extra space.
+  const AstNodeKind kind;
 };
 
 // NOLINTBEGIN(cppcoreguidelines-special-member-functions):
@@ -51,6 +109,11 @@ struct StmtNode : public AstNode {
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind >= AstNodeKind::kDeclStmt &&
+           node.kind <= AstNodeKind::kDefaultStmt;
+  }
+
   /// @note To make the class abstract.
   ~StmtNode() override = 0;
 };
@@ -60,12 +123,18 @@ struct StmtNode : public AstNode {
 /// @note This is an abstract class.
 struct DeclNode  // NOLINT(cppcoreguidelines-special-member-functions)
     : public AstNode {
-  DeclNode(Location loc, std::string id, std::unique_ptr<Type> type)
-      : AstNode{loc}, id{std::move(id)}, type{std::move(type)} {}
+  DeclNode(AstNodeKind kind, Location loc, std::string id,
+           std::unique_ptr<Type> type)
+      : AstNode{kind, loc}, id{std::move(id)}, type{std::move(type)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind >= AstNodeKind::kVarDecl &&
+           node.kind <= AstNodeKind::kFuncDef;
+  }
+
   /// @note To make the class abstract.
   ~DeclNode() override = 0;
 
@@ -81,6 +150,11 @@ struct ExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind >= AstNodeKind::kInitExpr &&
+           node.kind <= AstNodeKind::kSimpleAssignmentExpr;
+  }
+
   /// @note To make the class abstract.
   ~ExprNode() override = 0;
 
@@ -98,6 +172,11 @@ struct DesNode  // NOLINT(cppcoreguidelines-special-member-functions)
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind >= AstNodeKind::kArrDes &&
+           node.kind <= AstNodeKind::kIdDes;
+  }
+
   /// @note To make the class abstract.
   ~DesNode() override = 0;
 
@@ -108,34 +187,47 @@ struct DesNode  // NOLINT(cppcoreguidelines-special-member-functions)
 /// @brief A declaration statement may declare multiple identifiers.
 struct DeclStmtNode : public StmtNode {
   DeclStmtNode(Location loc, std::vector<std::unique_ptr<DeclNode>> decls)
-      : StmtNode{loc}, decls{std::move(decls)} {}
+      : StmtNode{AstNodeKind::kDeclStmt, loc}, decls{std::move(decls)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kDeclStmt;
+  }
+
   std::vector<std::unique_ptr<DeclNode>> decls;
 };
 
 struct VarDeclNode : public DeclNode {
   VarDeclNode(Location loc, std::string id, std::unique_ptr<Type> type,
               std::unique_ptr<ExprNode> init = {})
-      : DeclNode{loc, std::move(id), std::move(type)}, init{std::move(init)} {}
+      : DeclNode{AstNodeKind::kVarDecl, loc, std::move(id), std::move(type)},
+        init{std::move(init)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kVarDecl;
+  }
+
   std::unique_ptr<ExprNode> init;
 };
 
 struct ArrDeclNode : public DeclNode {
   ArrDeclNode(Location loc, std::string id, std::unique_ptr<Type> type,
               std::vector<std::unique_ptr<InitExprNode>> init_list)
-      : DeclNode{loc, std::move(id), std::move(type)},
+      : DeclNode{AstNodeKind::kArrDecl, loc, std::move(id), std::move(type)},
         init_list{std::move(init_list)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kArrDecl;
+  }
+
   std::vector<std::unique_ptr<InitExprNode>> init_list;
 };
 
@@ -143,41 +235,60 @@ struct ArrDeclNode : public DeclNode {
 struct RecordDeclNode : public DeclNode {
   RecordDeclNode(Location loc, std::string id, std::unique_ptr<Type> type,
                  std::vector<std::unique_ptr<FieldNode>> fields)
-      : DeclNode{loc, std::move(id), std::move(type)},
+      : DeclNode{AstNodeKind::kRecordDecl, loc, std::move(id), std::move(type)},
         fields{std::move(fields)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kRecordDecl;
+  }
+
   std::vector<std::unique_ptr<FieldNode>> fields;
 };
 
 /// @brief A field in a struct or an union.
 struct FieldNode : public DeclNode {
-  using DeclNode::DeclNode;
+  FieldNode(Location loc, std::string id, std::unique_ptr<Type> type)
+      : DeclNode{AstNodeKind::kField, loc, std::move(id), std::move(type)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
+
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kField;
+  }
 };
 
 /// @brief This holds the declaration of struct or union variable.
 struct RecordVarDeclNode : public DeclNode {
   RecordVarDeclNode(Location loc, std::string id, std::unique_ptr<Type> type,
                     std::vector<std::unique_ptr<InitExprNode>> inits)
-      : DeclNode{loc, std::move(id), std::move(type)},
+      : DeclNode{AstNodeKind::kRecordVarDecl, loc, std::move(id),
+                 std::move(type)},
         inits{std::move(inits)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kRecordVarDecl;
+  }
+
   std::vector<std::unique_ptr<InitExprNode>> inits;
 };
 
 struct ParamNode : public DeclNode {
-  using DeclNode::DeclNode;
+  ParamNode(Location loc, std::string id, std::unique_ptr<Type> type)
+      : DeclNode{AstNodeKind::kParam, loc, std::move(id), std::move(type)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
+
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kParam;
+  }
 };
 
 struct FuncDefNode : public DeclNode {
@@ -185,13 +296,17 @@ struct FuncDefNode : public DeclNode {
               std::vector<std::unique_ptr<ParamNode>> parameters,
               std::unique_ptr<CompoundStmtNode> body,
               std::unique_ptr<Type> type)
-      : DeclNode{loc, std::move(id), std::move(type)},
+      : DeclNode{AstNodeKind::kFuncDef, loc, std::move(id), std::move(type)},
         parameters{std::move(parameters)},
         body{std::move(body)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kFuncDef;
+  }
+
   std::vector<std::unique_ptr<ParamNode>> parameters;
   std::unique_ptr<CompoundStmtNode> body;
 };
@@ -202,21 +317,34 @@ struct LoopInitNode : public AstNode {
       Location loc,
       std::variant<std::unique_ptr<DeclStmtNode>, std::unique_ptr<ExprNode>>
           clause)
-      : AstNode{loc}, clause{std::move(clause)} {}
+      : AstNode{AstNodeKind::kLoopInit, loc}, clause{std::move(clause)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kLoopInit;
+  }
+
   std::variant<std::unique_ptr<DeclStmtNode>, std::unique_ptr<ExprNode>> clause;
 };
 
-struct CompoundStmtNode : public StmtNode {
+struct CompoundStmtNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public StmtNode {
   CompoundStmtNode(Location loc, std::vector<std::unique_ptr<StmtNode>> stmts)
-      : StmtNode{loc}, stmts{std::move(stmts)} {}
+      : StmtNode{AstNodeKind::kCompoundStmt, loc}, stmts{std::move(stmts)} {}
+
+  /// @note The nested compound statements are destroyed one after another
+  /// rather than recursively, however deep they are nested.
+  ~CompoundStmtNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kCompoundStmt;
+  }
+
   std::vector<std::unique_ptr<StmtNode>> stmts;
 };
 
@@ -227,11 +355,15 @@ struct ExternDeclNode : public AstNode {
       Location loc,
       std::variant<std::unique_ptr<FuncDefNode>, std::unique_ptr<DeclStmtNode>>
           decl)
-      : AstNode{loc}, decl{std::move(decl)} {}
+      : AstNode{AstNodeKind::kExternDecl, loc}, decl{std::move(decl)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kExternDecl;
+  }
+
   std::variant<std::unique_ptr<FuncDefNode>, std::unique_ptr<DeclStmtNode>>
       decl;
 };
@@ -242,61 +374,87 @@ struct TransUnitNode : public AstNode {
   /// @note vector of move-only elements are move-only
   TransUnitNode(Location loc,
                 std::vector<std::unique_ptr<ExternDeclNode>> extern_decls)
-      : AstNode{loc}, extern_decls{std::move(extern_decls)} {}
+      : AstNode{AstNodeKind::kTransUnit, loc},
+        extern_decls{std::move(extern_decls)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kTransUnit;
+  }
+
   std::vector<std::unique_ptr<ExternDeclNode>> extern_decls;
 };
 
-struct IfStmtNode : public StmtNode {
+struct IfStmtNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public StmtNode {
   IfStmtNode(Location loc, std::unique_ptr<ExprNode> expr,
              std::unique_ptr<StmtNode> then,
              std::unique_ptr<StmtNode> or_else = {})
-      : StmtNode{loc},
+      : StmtNode{AstNodeKind::kIfStmt, loc},
         predicate{std::move(expr)},
         then{std::move(then)},
         or_else{std::move(or_else)} {}
 
+  ~IfStmtNode() override;
+
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kIfStmt;
+  }
+
   std::unique_ptr<ExprNode> predicate;
   std::unique_ptr<StmtNode> then;
   std::unique_ptr<StmtNode> or_else;
 };
 
-struct WhileStmtNode : public StmtNode {
+struct WhileStmtNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public StmtNode {
   WhileStmtNode(Location loc, std::unique_ptr<ExprNode> predicate,
                 std::unique_ptr<StmtNode> loop_body, bool is_do_while = false)
-      : StmtNode{loc},
+      : StmtNode{AstNodeKind::kWhileStmt, loc},
         predicate{std::move(predicate)},
         loop_body{std::move(loop_body)},
         is_do_while{is_do_while} {}
 
+  ~WhileStmtNode() override;
+
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kWhileStmt;
+  }
+
   std::unique_ptr<ExprNode> predicate;
   std::unique_ptr<StmtNode> loop_body;
   bool is_do_while;
 };
 
-struct ForStmtNode : public StmtNode {
+struct ForStmtNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public StmtNode {
   ForStmtNode(Location loc, std::unique_ptr<LoopInitNode> loop_init,
               std::unique_ptr<ExprNode> predicate,
               std::unique_ptr<ExprNode> step,
               std::unique_ptr<StmtNode> loop_body)
-      : StmtNode{loc},
+      : StmtNode{AstNodeKind::kForStmt, loc},
         loop_init{std::move(loop_init)},
         predicate{std::move(predicate)},
         step{std::move(step)},
         loop_body{std::move(loop_body)} {}
 
+  ~ForStmtNode() override;
+
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kForStmt;
+  }
+
   std::unique_ptr<LoopInitNode> loop_init;
   std::unique_ptr<ExprNode> predicate;
   std::unique_ptr<ExprNode> step;
@@ -305,46 +463,72 @@ struct ForStmtNode : public StmtNode {
 
 struct ReturnStmtNode : public StmtNode {
   ReturnStmtNode(Location loc, std::unique_ptr<ExprNode> expr)
-      : StmtNode{loc}, expr{std::move(expr)} {}
+      : StmtNode{AstNodeKind::kReturnStmt, loc}, expr{std::move(expr)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kReturnStmt;
+  }
+
   std::unique_ptr<ExprNode> expr;
 };
 
 struct GotoStmtNode : public StmtNode {
   GotoStmtNode(Location loc, std::string label)
-      : StmtNode{loc}, label{std::move(label)} {}
+      : StmtNode{AstNodeKind::kGotoStmt, loc}, label{std::move(label)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kGotoStmt;
+  }
+
   std::string label;
 };
 
 struct BreakStmtNode : public StmtNode {
-  using StmtNode::StmtNode;
+  BreakStmtNode(Location loc) : StmtNode{AstNodeKind::kBreakStmt, loc} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
+
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kBreakStmt;
+  }
 };
 
 struct ContinueStmtNode : public StmtNode {
-  using StmtNode::StmtNode;
+  ContinueStmtNode(Location loc)
+      : StmtNode{AstNodeKind::kContinueStmt, loc} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
+
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kContinueStmt;
+  }
 };
 
-struct SwitchStmtNode : public StmtNode {
+struct SwitchStmtNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public StmtNode {
   SwitchStmtNode(Location loc, std::unique_ptr<ExprNode> ctrl,
                  std::unique_ptr<StmtNode> stmt)
-      : StmtNode{loc}, ctrl{std::move(ctrl)}, stmt{std::move(stmt)} {}
+      : StmtNode{AstNodeKind::kSwitchStmt, loc},
+        ctrl{std::move(ctrl)},
+        stmt{std::move(stmt)} {}
+
+  ~SwitchStmtNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kSwitchStmt;
+  }
+
   /// @brief The expression that controls which case to jump to.
   std::unique_ptr<ExprNode> ctrl;
   std::unique_ptr<StmtNode> stmt;
@@ -353,12 +537,18 @@ struct SwitchStmtNode : public StmtNode {
 /// @brief This is an abstract class.
 struct LabeledStmtNode  // NOLINT(cppcoreguidelines-special-member-functions)
     : public StmtNode {
-  LabeledStmtNode(Location loc, std::unique_ptr<StmtNode> stmt)
-      : StmtNode{loc}, stmt{std::move(stmt)} {}
+  LabeledStmtNode(AstNodeKind kind, Location loc,
+                  std::unique_ptr<StmtNode> stmt)
+      : StmtNode{kind, loc}, stmt{std::move(stmt)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind >= AstNodeKind::kIdLabeledStmt &&
+           node.kind <= AstNodeKind::kDefaultStmt;
+  }
+
   /// @note To make the class abstract.
   ~LabeledStmtNode() override = 0;
 
@@ -368,11 +558,16 @@ struct LabeledStmtNode  // NOLINT(cppcoreguidelines-special-member-functions)
 struct IdLabeledStmtNode : public LabeledStmtNode {
   IdLabeledStmtNode(Location loc, std::string label,
                     std::unique_ptr<StmtNode> stmt)
-      : LabeledStmtNode{loc, std::move(stmt)}, label{std::move(label)} {}
+      : LabeledStmtNode{AstNodeKind::kIdLabeledStmt, loc, std::move(stmt)},
+        label{std::move(label)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kIdLabeledStmt;
+  }
+
   std::string label;
 };
 
@@ -380,31 +575,45 @@ struct IdLabeledStmtNode : public LabeledStmtNode {
 struct CaseStmtNode : public LabeledStmtNode {
   CaseStmtNode(Location loc, std::unique_ptr<ExprNode> expr,
                std::unique_ptr<StmtNode> stmt)
-      : LabeledStmtNode{loc, std::move(stmt)}, expr{std::move(expr)} {}
+      : LabeledStmtNode{AstNodeKind::kCaseStmt, loc, std::move(stmt)},
+        expr{std::move(expr)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kCaseStmt;
+  }
+
   std::unique_ptr<ExprNode> expr;
 };
 
 /// @brief A specialized labeled statement with label `default`.
 struct DefaultStmtNode : public LabeledStmtNode {
-  using LabeledStmtNode::LabeledStmtNode;
+  DefaultStmtNode(Location loc, std::unique_ptr<StmtNode> stmt)
+      : LabeledStmtNode{AstNodeKind::kDefaultStmt, loc, std::move(stmt)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
+
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kDefaultStmt;
+  }
 };
 
 /// @note Any expression can be turned into a statement by adding a semicolon
 /// to the end of the expression.
 struct ExprStmtNode : public StmtNode {
   ExprStmtNode(Location loc, std::unique_ptr<ExprNode> expr)
-      : StmtNode{loc}, expr{std::move(expr)} {}
+      : StmtNode{AstNodeKind::kExprStmt, loc}, expr{std::move(expr)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kExprStmt;
+  }
+
   std::unique_ptr<ExprNode> expr;
 };
 
@@ -412,11 +621,17 @@ struct ExprStmtNode : public StmtNode {
 struct InitExprNode : public ExprNode {
   InitExprNode(Location loc, std::vector<std::unique_ptr<DesNode>> des,
                std::unique_ptr<ExprNode> expr)
-      : ExprNode{loc}, des{std::move(des)}, expr{std::move(expr)} {}
+      : ExprNode{AstNodeKind::kInitExpr, loc},
+        des{std::move(des)},
+        expr{std::move(expr)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kInitExpr;
+  }
+
   std::vector<std::unique_ptr<DesNode>> des;
   std::unique_ptr<ExprNode> expr;
 };
@@ -425,152 +640,246 @@ struct InitExprNode : public ExprNode {
 /// array subscripting.
 struct ArrDesNode : public DesNode {
   ArrDesNode(Location loc, std::unique_ptr<ExprNode> index)
-      : DesNode{loc}, index{std::move(index)} {}
+      : DesNode{AstNodeKind::kArrDes, loc}, index{std::move(index)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kArrDes;
+  }
+
   std::unique_ptr<ExprNode> index;
 };
 
 /// @brief An identifier designator node can designate a member by using
 /// parameter "id".
 struct IdDesNode : public DesNode {
-  IdDesNode(Location loc, std::string id) : DesNode{loc}, id{std::move(id)} {}
+  IdDesNode(Location loc, std::string id)
+      : DesNode{AstNodeKind::kIdDes, loc}, id{std::move(id)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kIdDes;
+  }
+
   std::string id;
 };
 
 /// @note Only appears in for statement's expressions and null statement.
 struct NullExprNode : public ExprNode {
-  using ExprNode::ExprNode;
+  NullExprNode(Location loc) : ExprNode{AstNodeKind::kNullExpr, loc} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
+
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kNullExpr;
+  }
 };
 
 struct IdExprNode : public ExprNode {
-  IdExprNode(Location loc, std::string id) : ExprNode{loc}, id{std::move(id)} {}
+  IdExprNode(Location loc, std::string id)
+      : ExprNode{AstNodeKind::kIdExpr, loc}, id{std::move(id)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kIdExpr;
+  }
+
   std::string id;
 };
 
 struct IntConstExprNode : public ExprNode {
-  IntConstExprNode(Location loc, int val) : ExprNode{loc}, val{val} {}
+  IntConstExprNode(Location loc, std::uint64_t val)
+      : ExprNode{AstNodeKind::kIntConstExpr, loc}, val{val} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
-  int val;
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kIntConstExpr;
+  }
+
+  /// @note An integer constant is never negative; `-1` is the negation of the
+  /// constant `1`.
+  std::uint64_t val;
 };
 
 struct ArgExprNode : public ExprNode {
   ArgExprNode(Location loc, std::unique_ptr<ExprNode> arg)
-      : ExprNode{loc}, arg{std::move(arg)} {}
+      : ExprNode{AstNodeKind::kArgExpr, loc}, arg{std::move(arg)} {}
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kArgExpr;
+  }
+
   std::unique_ptr<ExprNode> arg;
 };
 
 /// @brief An array subscripting expression.
-struct ArrSubExprNode : public ExprNode {
+struct ArrSubExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public ExprNode {
   /// @param arr An expression that evaluates to the target array.
   /// @param index An expression that evaluates to the subscription index.
   ArrSubExprNode(Location loc, std::unique_ptr<ExprNode> arr,
                  std::unique_ptr<ExprNode> index)
-      : ExprNode{loc}, arr{std::move(arr)}, index{std::move(index)} {}
+      : ExprNode{AstNodeKind::kArrSubExpr, loc},
+        arr{std::move(arr)},
+        index{std::move(index)} {}
+
+  ~ArrSubExprNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kArrSubExpr;
+  }
+
   std::unique_ptr<ExprNode> arr;
   std::unique_ptr<ExprNode> index;
 };
 
-struct CondExprNode : public ExprNode {
+struct CondExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public ExprNode {
   CondExprNode(Location loc, std::unique_ptr<ExprNode> predicate,
                std::unique_ptr<ExprNode> then,
                std::unique_ptr<ExprNode> or_else)
-      : ExprNode{loc},
+      : ExprNode{AstNodeKind::kCondExpr, loc},
         predicate{std::move(predicate)},
         then{std::move(then)},
         or_else{std::move(or_else)} {}
 
+  ~CondExprNode() override;
+
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kCondExpr;
+  }
+
   std::unique_ptr<ExprNode> predicate;
   std::unique_ptr<ExprNode> then;
   std::unique_ptr<ExprNode> or_else;
 };
 
-struct FuncCallExprNode : public ExprNode {
+struct FuncCallExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public ExprNode {
   FuncCallExprNode(Location loc, std::unique_ptr<ExprNode> func_expr,
                    std::vector<std::unique_ptr<ArgExprNode>> args)
-      : ExprNode{loc}, func_expr{std::move(func_expr)}, args{std::move(args)} {}
+      : ExprNode{AstNodeKind::kFuncCallExpr, loc},
+        func_expr{std::move(func_expr)},
+        args{std::move(args)} {}
+
+  ~FuncCallExprNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kFuncCallExpr;
+  }
+
   std::unique_ptr<ExprNode> func_expr;
   std::vector<std::unique_ptr<ArgExprNode>> args;
 };
 
 /// @brief A postfix arithmetic expression.
-struct PostfixArithExprNode : public ExprNode {
+struct PostfixArithExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public ExprNode {
   PostfixArithExprNode(Location loc, PostfixOperator op,
                        std::unique_ptr<ExprNode> operand)
-      : ExprNode{loc}, op{op}, operand{std::move(operand)} {}
+      : ExprNode{AstNodeKind::kPostfixArithExpr, loc},
+        op{op},
+        operand{std::move(operand)} {}
+
+  ~PostfixArithExprNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kPostfixArithExpr;
+  }
+
   PostfixOperator op;
   std::unique_ptr<ExprNode> operand;
 };
 
 /// @brief A postfix expression that designates a member of struct or union.
-struct RecordMemExprNode : public ExprNode {
+struct RecordMemExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public ExprNode {
   RecordMemExprNode(Location loc, PostfixOperator op,
                     std::unique_ptr<ExprNode> expr, std::string id)
-      : ExprNode{loc}, op{op}, expr{std::move(expr)}, id{std::move(id)} {}
+      : ExprNode{AstNodeKind::kRecordMemExpr, loc},
+        op{op},
+        expr{std::move(expr)},
+        id{std::move(id)} {}
+
+  ~RecordMemExprNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kRecordMemExpr;
+  }
+
   PostfixOperator op;
   std::unique_ptr<ExprNode> expr;
   std::string id;
 };
 
-struct UnaryExprNode : public ExprNode {
+struct UnaryExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public ExprNode {
   UnaryExprNode(Location loc, UnaryOperator op,
                 std::unique_ptr<ExprNode> operand)
-      : ExprNode{loc}, op{op}, operand{std::move(operand)} {}
+      : ExprNode{AstNodeKind::kUnaryExpr, loc},
+        op{op},
+        operand{std::move(operand)} {}
+
+  ~UnaryExprNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kUnaryExpr;
+  }
+
   UnaryOperator op;
   std::unique_ptr<ExprNode> operand;
 };
 
-struct BinaryExprNode : public ExprNode {
+struct BinaryExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public ExprNode {
   BinaryExprNode(Location loc, BinaryOperator op, std::unique_ptr<ExprNode> lhs,
                  std::unique_ptr<ExprNode> rhs)
-      : ExprNode{loc}, op{op}, lhs{std::move(lhs)}, rhs{std::move(rhs)} {}
+      : ExprNode{AstNodeKind::kBinaryExpr, loc},
+        op{op},
+        lhs{std::move(lhs)},
+        rhs{std::move(rhs)} {}
+
+  /// @note The chain of binary expressions in the left operands is destroyed
+  /// one after another rather than recursively, however long it is.
+  ~BinaryExprNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kBinaryExpr;
+  }
+
   BinaryOperator op;
   std::unique_ptr<ExprNode> lhs;
   std::unique_ptr<ExprNode> rhs;
@@ -584,18 +893,31 @@ struct AssignmentExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kSimpleAssignmentExpr;
+  }
+
   /// @note To make the class abstract.
   ~AssignmentExprNode() override = 0;
 };
 
-struct SimpleAssignmentExprNode : public AssignmentExprNode {
+struct SimpleAssignmentExprNode  // NOLINT(cppcoreguidelines-special-member-functions)
+    : public AssignmentExprNode {
   SimpleAssignmentExprNode(Location loc, std::unique_ptr<ExprNode> lhs,
                            std::unique_ptr<ExprNode> rhs)
-      : AssignmentExprNode{loc}, lhs{std::move(lhs)}, rhs{std::move(rhs)} {}
+      : AssignmentExprNode{AstNodeKind::kSimpleAssignmentExpr, loc},
+        lhs{std::move(lhs)},
+        rhs{std::move(rhs)} {}
+
+  ~SimpleAssignmentExprNode() override;
 
   void Accept(NonModifyingVisitor&) const override;
   void Accept(ModifyingVisitor&) override;
 
+  static bool ClassOf(const AstNode& node) noexcept {
+    return node.kind == AstNodeKind::kSimpleAssignmentExpr;
+  }
+
   std::unique_ptr<ExprNode> lhs;
   std::unique_ptr<ExprNode> rhs;
 };
@@ -1,56 +1,68 @@
 #ifndef AST_DUMPER_HPP_
 #define AST_DUMPER_HPP_
 
+#include <string>
+
 #include "ast.hpp"
+#include "location.hpp"
+#include "static_visitor.hpp"
 #include "util.hpp"
-#include "visitor.hpp"
 
-class AstDumper : public NonModifyingVisitor {
+class AstDumper : public StaticVisitor<AstDumper> {
  public:
-  void Visit(const DeclStmtNode&) override;
-  void Visit(const LoopInitNode&) override;
-  void Visit(const VarDeclNode&) override;
-  void Visit(const ArrDeclNode&) override;
-  void Visit(const RecordDeclNode&) override;
-  void Visit(const FieldNode&) override;
-  void Visit(const RecordVarDeclNode&) override;
-  void Visit(const ParamNode&) override;
-  void Visit(const FuncDefNode&) override;
-  void Visit(const CompoundStmtNode&) override;
-  void Visit(const ExternDeclNode&) override;
-  void Visit(const TransUnitNode&) override;
-  void Visit(const IfStmtNode&) override;
-  void Visit(const WhileStmtNode&) override;
-  void Visit(const ForStmtNode&) override;
-  void Visit(const ReturnStmtNode&) override;
-  void Visit(const GotoStmtNode&) override;
-  void Visit(const BreakStmtNode&) override;
-  void Visit(const ContinueStmtNode&) override;
-  void Visit(const SwitchStmtNode&) override;
-  void Visit(const IdLabeledStmtNode&) override;
-  void Visit(const CaseStmtNode&) override;
-  void Visit(const DefaultStmtNode&) override;
-  void Visit(const ExprStmtNode&) override;
-  void Visit(const InitExprNode&) override;
-  void Visit(const ArrDesNode&) override;
-  void Visit(const IdDesNode&) override;
-  void Visit(const NullExprNode&) override;
-  void Visit(const IdExprNode&) override;
-  void Visit(const IntConstExprNode&) override;
-  void Visit(const ArgExprNode&) override;
-  void Visit(const ArrSubExprNode&) override;
-  void Visit(const CondExprNode&) override;
-  void Visit(const FuncCallExprNode&) override;
-  void Visit(const PostfixArithExprNode&) override;
-  void Visit(const RecordMemExprNode&) override;
-  void Visit(const UnaryExprNode&) override;
-  void Visit(const BinaryExprNode&) override;
-  void Visit(const SimpleAssignmentExprNode&) override;
-
-  AstDumper(Indenter indenter) : indenter_{indenter} {}
+  using StaticVisitor::Visit;
+
+  void Visit(const DeclStmtNode&);
+  void Visit(const LoopInitNode&);
+  void Visit(const VarDeclNode&);
+  void Visit(const ArrDeclNode&);
+  void Visit(const RecordDeclNode&);
+  void Visit(const FieldNode&);
+  void Visit(const RecordVarDeclNode&);
+  void Visit(const ParamNode&);
+  void Visit(const FuncDefNode&);
+  void Visit(const CompoundStmtNode&);
+  void Visit(const ExternDeclNode&);
+  void Visit(const TransUnitNode&);
+  void Visit(const IfStmtNode&);
+  void Visit(const WhileStmtNode&);
+  void Visit(const ForStmtNode&);
+  void Visit(const ReturnStmtNode&);
+  void Visit(const GotoStmtNode&);
+  void Visit(const BreakStmtNode&);
+  void Visit(const ContinueStmtNode&);
+  void Visit(const SwitchStmtNode&);
+  void Visit(const IdLabeledStmtNode&);
+  void Visit(const CaseStmtNode&);
+  void Visit(const DefaultStmtNode&);
+  void Visit(const ExprStmtNode&);
+  void Visit(const InitExprNode&);
+  void Visit(const ArrDesNode&);
+  void Visit(const IdDesNode&);
+  void Visit(const NullExprNode&);
+  void Visit(const IdExprNode&);
+  void Visit(const IntConstExprNode&);
+  void Visit(const ArgExprNode&);
+  void Visit(const ArrSubExprNode&);
+  void Visit(const CondExprNode&);
+  void Visit(const FuncCallExprNode&);
+  void Visit(const PostfixArithExprNode&);
+  void Visit(const RecordMemExprNode&);
+  void Visit(const UnaryExprNode&);
+  void Visit(const BinaryExprNode&);
+  void Visit(const SimpleAssignmentExprNode&);
+
+  /// @param line_map Resolves the locations of the nodes.
+  AstDumper(Indenter indenter, const LineMap& line_map)
+      : indenter_{indenter}, line_map_{line_map} {}
 
  private:
   Indenter indenter_;
+  const LineMap& line_map_;
+
+  /// @return The line and column of `loc`, after the path of its file if it's
+  /// not the first file, such as an included one.
+  std::string Where_(Location loc) const;
 };
 
 #endif  // AST_DUMPER_HPP_
@@ -0,0 +1,59 @@
+#ifndef AST_SERIALIZER_HPP_
+#define AST_SERIALIZER_HPP_
+
+#include <filesystem>
+#include <memory>
+#include <ostream>
+
+#include "ast.hpp"
+#include "location.hpp"
+
+// A type-checked translation unit can be serialized into a binary file, which
+// is then loaded in place of the source file, without parsing and type checking
+// it again.
+//
+// The file consists of four parts, with all integers in little-endian:
+//  1. The header: the magic "VCAST\0\0\0", a u32 version, a u64 FNV-1a
+//     checksum of the rest of the file, and for each of the string, type and
+//     node sections, a u32 count followed by its u32 offset from the start of
+//     file. Then the u32 count of the source files that the locations are in,
+//     followed by the u32 string index of the absolute path and the u32 size
+//     of each, in the order of the `LineMap`. A count is never more than its
+//     section can hold.
+//  2. The strings: a u32 offset of each string relative to the section's
+//     blob, plus one past the last, followed by the blob of the characters.
+//  3. The types: a u32 offset of each type relative to the section's records,
+//     followed by the records. A record starts with a u8 `TypeKind`, and refers
+//     to its base, element, return, parameter or member types by index; such
+//     types always have smaller indices. Every type appears only once.
+//  4. The nodes: the tree in pre-order, starting from the `TransUnitNode`. A
+//     node starts with a u8 `AstNodeKind` and a u32 offset of its location,
+//     followed by its id and type, if any, and then its own fields. A list is
+//     prefixed with its u32 count; an optional child, with a u8 of whether it
+//     exists.
+//
+// The strings and types are looked up by index, so the file can be mapped into
+// memory and decoded in a single pass.
+
+/// @brief Writes `trans_unit` to `output` in the binary format.
+/// @param line_map The source files that `trans_unit` is parsed from, with
+/// which the locations are resolved.
+void SerializeAst(const TransUnitNode& trans_unit, const LineMap& line_map,
+                  std::ostream& output);
+
+/// @return Whether the file at `path` starts with the magic of the binary
+/// format.
+bool IsSerializedAst(const std::filesystem::path& path);
+
+struct SerializedAst {
+  /// @brief The source files, with which the locations are resolved.
+  LineMap line_map;
+  std::unique_ptr<TransUnitNode> trans_unit;
+};
+
+/// @brief Loads the translation unit serialized at `path`.
+/// @throw `std::runtime_error` if the file can't be mapped, is of another
+/// version, or is malformed, truncated or corrupted.
+SerializedAst DeserializeAst(const std::filesystem::path& path);
+
+#endif  // AST_SERIALIZER_HPP_
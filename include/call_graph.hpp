@@ -0,0 +1,64 @@
+#ifndef CALL_GRAPH_HPP_
+#define CALL_GRAPH_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.hpp"
+
+/// @return The name of the function that `expr` designates; `nullptr` if
+/// `expr` isn't the name of a function.
+const std::string* FuncNameOf(const ExprNode& expr);
+
+/// @return The name of the function that `call_expr` calls directly; `nullptr`
+/// if it's called through a pointer.
+const std::string* CalleeOf(const FuncCallExprNode& call_expr);
+
+/// @brief The functions defined in a translation unit, each with the functions
+/// that it refers to.
+/// @note A function whose address is taken may be called through a pointer
+/// wherever the address is passed to; it's conservatively treated as called by
+/// the function that takes its address.
+class CallGraph {
+ public:
+  explicit CallGraph(const TransUnitNode& trans_unit);
+
+  /// @return The defined functions, in the order of definition.
+  const std::vector<std::string>& funcs()  // NOLINT(readability-identifier-naming)
+      const noexcept {
+    return funcs_;
+  }
+
+  /// @return The functions that `func` calls or takes the address of, in the
+  /// order that they are first referred to, defined or not.
+  const std::vector<std::string>& CalleesOf(const std::string& func) const;
+
+  /// @return Whether `func` is referred to other than by its direct calls.
+  bool IsAddressTaken(const std::string& func) const;
+
+  /// @return The defined functions that can be reached from `roots`, `roots`
+  /// included if they are defined.
+  std::unordered_set<std::string> ReachableFrom(
+      const std::vector<std::string>& roots) const;
+
+  /// @return The defined functions, ordered so that each function follows its
+  /// first caller as closely as possible: a depth-first walk of the calls from
+  /// `main`, and then from each function left, in the order of definition.
+  std::vector<std::string> LocalityOrder() const;
+
+ private:
+  std::vector<std::string> funcs_{};
+  std::unordered_map<std::string, std::vector<std::string>> callees_{};
+  std::unordered_set<std::string> address_taken_{};
+};
+
+/// @brief Moves the function definitions of `trans_unit` after its other
+/// declarations, in the locality order of its call graph, so that callers and
+/// their callees are emitted close together.
+/// @note The other declarations only declare types and prototypes, which come
+/// before every function that uses them.
+void OrderFuncsByCalls(TransUnitNode& trans_unit);
+
+#endif  // CALL_GRAPH_HPP_
@@ -0,0 +1,52 @@
+#ifndef CASTING_HPP_
+#define CASTING_HPP_
+
+#include <cassert>
+#include <type_traits>
+
+// Checked conversions between the classes of a hierarchy that is tagged with
+// kinds, such as `AstNode` and `Type`. Every class `To` that is converted to
+// provides `static bool ClassOf(const Base&)`, which tells from the kind
+// whether an object is a `To`. Unlike `dynamic_cast`, no RTTI lookup is
+// involved; a test is a single comparison of the kind, or two for abstract
+// classes.
+
+/// @return Whether `from` is a `To`.
+template <typename To, typename From>
+bool Isa(const From& from) noexcept {
+  if constexpr (std::is_base_of_v<To, From>) {
+    return true;
+  } else {
+    return To::ClassOf(from);
+  }
+}
+
+/// @note `from` must be a `To`.
+template <typename To, typename From>
+const To& Cast(const From& from) noexcept {
+  assert(Isa<To>(from));
+  return static_cast<const To&>(from);
+}
+
+/// @note `from` must be a `To`.
+template <typename To, typename From>
+To& Cast(From& from) noexcept {
+  assert(Isa<To>(from));
+  return static_cast<To&>(from);
+}
+
+/// @return `from` as a `To` if it is one; otherwise, `nullptr`.
+/// @note `from` may be `nullptr`.
+template <typename To, typename From>
+const To* DynCast(const From* from) noexcept {
+  return from && Isa<To>(*from) ? static_cast<const To*>(from) : nullptr;
+}
+
+/// @return `from` as a `To` if it is one; otherwise, `nullptr`.
+/// @note `from` may be `nullptr`.
+template <typename To, typename From>
+To* DynCast(From* from) noexcept {
+  return from && Isa<To>(*from) ? static_cast<To*>(from) : nullptr;
+}
+
+#endif  // CASTING_HPP_
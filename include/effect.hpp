@@ -0,0 +1,65 @@
+#ifndef EFFECT_HPP_
+#define EFFECT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.hpp"
+
+/// @brief What the evaluation of an expression, or a call of a function, may
+/// do besides computing its value; ordered from the least to the most.
+enum class Effect : std::uint8_t {
+  /// @brief Computes only from its operands; can be removed if its value is
+  /// unused, and reused if it's computed again from the same operands.
+  kPure,
+  /// @brief Also reads objects; can be removed if its value is unused, and
+  /// nothing that it reads is written by it.
+  kReadOnly,
+  /// @brief May write objects, write the output, or never return.
+  kSideEffecting,
+};
+
+/// @brief An interprocedural analysis of the effects of the functions of a
+/// translation unit. The effect of a function is that of its body, where
+/// reading and writing its own variables has no effect, joined with the
+/// effects of the functions that it calls, to a fixed point over the call
+/// graph; a recursive function is pure unless something else makes it not.
+/// @note A function is assumed to return unless it loops on a constant
+/// condition or has a `goto`, which is then a side effect. Calls through
+/// pointers and of functions that aren't defined in the unit, the builtins
+/// included, are side-effecting.
+class EffectAnalysis {
+ public:
+  explicit EffectAnalysis(const TransUnitNode& trans_unit);
+
+  /// @return The effect of calling `func`.
+  Effect EffectOfFunc(const std::string& func) const;
+
+  /// @return The effect of evaluating `expr`, where reading any object is
+  /// read-only and writing any object is side-effecting.
+  Effect EffectOf(const ExprNode& expr) const;
+
+  /// @param loop A `WhileStmtNode` or a `ForStmtNode` of `func`.
+  /// @return The outermost calls of pure functions in the predicate of `loop`
+  /// whose arguments don't change while the loop runs, in the order of
+  /// evaluation; each can be evaluated once before the loop instead. Only the
+  /// calls that the first evaluation of the predicate never skips are
+  /// included, so that none is evaluated that the loop wouldn't.
+  /// @note A do-while loop, whose predicate may never be evaluated, and a
+  /// loop that has a label in it, which may be entered other than from its
+  /// start, have none.
+  std::vector<const FuncCallExprNode*> HoistableCallsOf(
+      const StmtNode& loop, const std::string& func) const;
+
+ private:
+  std::unordered_map<std::string, Effect> effects_{};
+  /// @brief The variables of each function whose addresses are taken, which
+  /// may then be written through pointers.
+  std::unordered_map<std::string, std::unordered_set<std::string>>
+      address_taken_{};
+};
+
+#endif  // EFFECT_HPP_
@@ -0,0 +1,214 @@
+#ifndef EXPR_SLOT_VISITOR_HPP_
+#define EXPR_SLOT_VISITOR_HPP_
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <variant>
+
+#include "ast.hpp"
+#include "static_visitor.hpp"
+
+/// @brief Calls `on_expr` with each slot of an expression in the visited tree,
+/// after the slots of its subexpressions, and `on_decl` with each declaration
+/// of a variable. `on_expr` may replace the expression in the slot if
+/// `is_modifying`.
+template <bool is_modifying>
+class BasicExprSlotVisitor
+    : public StaticVisitor<BasicExprSlotVisitor<is_modifying>, is_modifying> {
+  using Base = StaticVisitor<BasicExprSlotVisitor, is_modifying>;
+  template <typename Node>
+  using CondMut = typename Base::template CondMut<Node>;
+
+ public:
+  using Base::Dispatch;
+  using Base::Visit;
+  using OnExpr = std::function<void(CondMut<std::unique_ptr<ExprNode>>&)>;
+  using OnDecl = std::function<void(const DeclNode&)>;
+
+  explicit BasicExprSlotVisitor(OnExpr on_expr, OnDecl on_decl = {})
+      : on_expr_{std::move(on_expr)}, on_decl_{std::move(on_decl)} {}
+
+  void Visit(CondMut<DeclStmtNode>& decl_stmt) {
+    for (auto& decl : decl_stmt.decls) {
+      Dispatch(*decl);
+    }
+  }
+
+  void Visit(CondMut<VarDeclNode>& decl) {
+    if (decl.init) {
+      Walk_(decl.init);
+    }
+    OnDecl_(decl);
+  }
+
+  void Visit(CondMut<ArrDeclNode>& arr_decl) {
+    for (auto& init : arr_decl.init_list) {
+      Dispatch(*init);
+    }
+    OnDecl_(arr_decl);
+  }
+
+  void Visit(CondMut<RecordVarDeclNode>& record_var_decl) {
+    for (auto& init : record_var_decl.inits) {
+      Dispatch(*init);
+    }
+    OnDecl_(record_var_decl);
+  }
+
+  void Visit(CondMut<FuncDefNode>& func_def) {
+    if (func_def.body) {
+      Dispatch(*func_def.body);
+    }
+  }
+
+  void Visit(CondMut<LoopInitNode>& loop_init) {
+    if (auto* expr =
+            std::get_if<std::unique_ptr<ExprNode>>(&loop_init.clause)) {
+      Walk_(*expr);
+    } else {
+      Dispatch(*std::get<std::unique_ptr<DeclStmtNode>>(loop_init.clause));
+    }
+  }
+
+  void Visit(CondMut<CompoundStmtNode>& compound_stmt) {
+    this->VisitBlocks_(
+        compound_stmt, [](CondMut<CompoundStmtNode>&) {},
+        [](CondMut<CompoundStmtNode>&) {});
+  }
+
+  void Visit(CondMut<ExternDeclNode>& extern_decl) {
+    std::visit([this](auto&& decl) { Dispatch(*decl); }, extern_decl.decl);
+  }
+
+  void Visit(CondMut<TransUnitNode>& trans_unit) {
+    for (auto& extern_decl : trans_unit.extern_decls) {
+      Dispatch(*extern_decl);
+    }
+  }
+
+  void Visit(CondMut<IfStmtNode>& if_stmt) {
+    Walk_(if_stmt.predicate);
+    Dispatch(*if_stmt.then);
+    if (if_stmt.or_else) {
+      Dispatch(*if_stmt.or_else);
+    }
+  }
+
+  void Visit(CondMut<WhileStmtNode>& while_stmt) {
+    Walk_(while_stmt.predicate);
+    Dispatch(*while_stmt.loop_body);
+  }
+
+  void Visit(CondMut<ForStmtNode>& for_stmt) {
+    Dispatch(*for_stmt.loop_init);
+    Walk_(for_stmt.predicate);
+    Walk_(for_stmt.step);
+    Dispatch(*for_stmt.loop_body);
+  }
+
+  void Visit(CondMut<ReturnStmtNode>& ret_stmt) {
+    Walk_(ret_stmt.expr);
+  }
+
+  void Visit(CondMut<SwitchStmtNode>& switch_stmt) {
+    Walk_(switch_stmt.ctrl);
+    Dispatch(*switch_stmt.stmt);
+  }
+
+  void Visit(CondMut<LabeledStmtNode>& labeled_stmt) {
+    Dispatch(*labeled_stmt.stmt);
+  }
+
+  void Visit(CondMut<CaseStmtNode>& case_stmt) {
+    Walk_(case_stmt.expr);
+    Dispatch(*case_stmt.stmt);
+  }
+
+  void Visit(CondMut<ExprStmtNode>& expr_stmt) {
+    Walk_(expr_stmt.expr);
+  }
+
+  void Visit(CondMut<InitExprNode>& init_expr) {
+    for (auto& des : init_expr.des) {
+      Dispatch(*des);
+    }
+    Walk_(init_expr.expr);
+  }
+
+  void Visit(CondMut<ArrDesNode>& arr_des) {
+    Walk_(arr_des.index);
+  }
+
+  void Visit(CondMut<ArgExprNode>& arg_expr) {
+    Walk_(arg_expr.arg);
+  }
+
+  void Visit(CondMut<ArrSubExprNode>& arr_sub_expr) {
+    Walk_(arr_sub_expr.arr);
+    Walk_(arr_sub_expr.index);
+  }
+
+  void Visit(CondMut<CondExprNode>& cond_expr) {
+    Walk_(cond_expr.predicate);
+    Walk_(cond_expr.then);
+    Walk_(cond_expr.or_else);
+  }
+
+  void Visit(CondMut<FuncCallExprNode>& call_expr) {
+    Walk_(call_expr.func_expr);
+    for (auto& arg : call_expr.args) {
+      Dispatch(*arg);
+    }
+  }
+
+  void Visit(CondMut<PostfixArithExprNode>& postfix_expr) {
+    Walk_(postfix_expr.operand);
+  }
+
+  void Visit(CondMut<RecordMemExprNode>& mem_expr) {
+    Walk_(mem_expr.expr);
+  }
+
+  void Visit(CondMut<UnaryExprNode>& unary_expr) {
+    Walk_(unary_expr.operand);
+  }
+
+  void Visit(CondMut<BinaryExprNode>& bin_expr) {
+    // The slot of each left operand of the chain is handed over once the
+    // operand is visited.
+    this->VisitLeftChain_(
+        bin_expr, [](CondMut<BinaryExprNode>&) {},
+        [this](CondMut<BinaryExprNode>& expr) {
+          on_expr_(expr.lhs);
+          Walk_(expr.rhs);
+        });
+  }
+
+  void Visit(CondMut<SimpleAssignmentExprNode>& assign_expr) {
+    Walk_(assign_expr.lhs);
+    Walk_(assign_expr.rhs);
+  }
+
+ private:
+  OnExpr on_expr_;
+  OnDecl on_decl_;
+
+  void Walk_(CondMut<std::unique_ptr<ExprNode>>& expr) {
+    Dispatch(*expr);
+    on_expr_(expr);
+  }
+
+  void OnDecl_(const DeclNode& decl) {
+    if (on_decl_) {
+      on_decl_(decl);
+    }
+  }
+};
+
+/// @brief Visits a tree that it may modify.
+using ExprSlotVisitor = BasicExprSlotVisitor</* is_modifying */ true>;
+/// @brief Visits a tree that it only traverses.
+using ConstExprSlotVisitor = BasicExprSlotVisitor</* is_modifying */ false>;
+
+#endif  // EXPR_SLOT_VISITOR_HPP_
@@ -0,0 +1,57 @@
+#ifndef INCREMENTAL_STORE_HPP_
+#define INCREMENTAL_STORE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+
+/// @brief Keeps the IR of the function definitions of a file across
+/// compilations, so that unchanged functions are neither checked nor generated
+/// again.
+/// @note A function is considered unchanged if its own source text, as well as
+/// the source text of the file-scope declarations it refers to, are unchanged.
+class IncrementalStore {
+ public:
+  using Fingerprint = std::uint64_t;
+
+  /// @brief Loads the store from `path`; the store is empty if the file
+  /// doesn't exist or is malformed.
+  explicit IncrementalStore(std::filesystem::path path);
+
+  /// @brief Fingerprints each top-level declaration of `trans_unit`.
+  /// @param source The source text that `trans_unit` is parsed from.
+  /// @note Must be called before the other member functions, which refer to a
+  /// declaration by its index in `trans_unit.extern_decls`.
+  void FingerprintDecls(const TransUnitNode& trans_unit,
+                        std::string_view source);
+
+  /// @return The IR of the function definition at `index` from a previous
+  /// compilation; `nullptr` if the function is new or changed, or the
+  /// declaration isn't a function definition.
+  const std::string* ReusableIrOf(std::size_t index) const;
+  /// @brief Records the IR generated for the function definition at `index`.
+  void Update(std::size_t index, std::string ir);
+
+  /// @brief Writes the IR of the functions of the current compilation back to
+  /// the file; the IR of functions which no longer exist is dropped.
+  void Save() const;
+
+ private:
+  std::filesystem::path path_;
+  /// @brief The IR from the previous compilation.
+  std::map<Fingerprint, std::string> prev_irs_{};
+  /// @brief The fingerprint of each top-level declaration; `std::nullopt` for
+  /// those which are not function definitions.
+  std::vector<std::optional<Fingerprint>> fingerprints_{};
+  /// @brief The IR of the current compilation, indexed by declaration.
+  std::map<std::size_t, std::string> irs_{};
+};
+
+#endif  // INCREMENTAL_STORE_HPP_
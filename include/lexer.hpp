@@ -0,0 +1,169 @@
+#ifndef LEXER_HPP_
+#define LEXER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "location.hpp"
+
+/// @brief The kinds of tokens, one for each token of the parser.
+enum class TokenKind : std::uint8_t {
+  kEof,
+  /// @brief A character that can't start any token.
+  kInvalid,
+  kId,
+  kNum,
+  /// @brief A string literal, which is only used by the preprocessor.
+  kString,
+  // keywords
+  kBreak,
+  kCase,
+  kChar,
+  kContinue,
+  kDefault,
+  kDo,
+  kElse,
+  kFor,
+  kGoto,
+  kIf,
+  kInt,
+  kLong,
+  kReturn,
+  kShort,
+  kSigned,
+  kStruct,
+  kSwitch,
+  kUnion,
+  kUnsigned,
+  kWhile,
+  // delimiters
+  kSemicolon,
+  kColon,
+  kComma,
+  kDot,
+  kArrow,
+  // operators
+  kMinus,
+  kPlus,
+  kStar,
+  kDiv,
+  kMod,
+  kAmpersand,
+  kExclamation,
+  kQuestion,
+  kXor,
+  kOr,
+  kLogicOr,
+  kLogicAnd,
+  kTilde,
+  kAssign,
+  kShiftLeft,
+  kShiftRight,
+  kLt,
+  kGt,
+  kDecr,
+  kIncr,
+  kEq,
+  kNe,
+  kLe,
+  kGe,
+  // brackets
+  kLeftParen,
+  kRightParen,
+  kLeftCurly,
+  kRightCurly,
+  kLeftSquare,
+  kRightSquare,
+  // preprocessing
+  kHash,
+  kHashHash,
+};
+
+/// @brief The tokens of a source, stored as parallel arrays so that scanning
+/// through the kinds touches as little memory as possible.
+/// @note The buffer always ends with a `kEof` token.
+class TokenBuffer {
+ public:
+  /// @return The text of the `i`-th token.
+  std::string_view TextOf(std::size_t i) const {
+    return std::string_view{source_}.substr(offsets_.at(i), lengths_.at(i));
+  }
+
+  std::size_t size() const noexcept {  // NOLINT(readability-identifier-naming)
+    return kinds_.size();
+  }
+
+  std::string_view source()  // NOLINT(readability-identifier-naming)
+      const noexcept {
+    return source_;
+  }
+  const std::vector<TokenKind>& kinds()  // NOLINT(readability-identifier-naming)
+      const {
+    return kinds_;
+  }
+  /// @return The offsets of the first characters of the tokens in the source.
+  const std::vector<std::uint32_t>&
+  offsets() const {  // NOLINT(readability-identifier-naming)
+    return offsets_;
+  }
+  const std::vector<std::uint32_t>&
+  lengths() const {  // NOLINT(readability-identifier-naming)
+    return lengths_;
+  }
+
+  friend TokenBuffer Lex(std::string source);
+  friend TokenBuffer LexInPlace(std::string_view source);
+
+ private:
+  /// @brief The source, if it's owned by the buffer; kept on the heap so that
+  /// `source_` stays valid when the buffer is moved.
+  std::unique_ptr<const std::string> owned_source_{};
+  std::string_view source_;
+  std::vector<TokenKind> kinds_{};
+  std::vector<std::uint32_t> offsets_{};
+  std::vector<std::uint32_t> lengths_{};
+
+  explicit TokenBuffer(std::string_view source) : source_{source} {}
+
+  void Push_(TokenKind kind, std::size_t offset, std::size_t length) {
+    kinds_.push_back(kind);
+    offsets_.push_back(static_cast<std::uint32_t>(offset));
+    lengths_.push_back(static_cast<std::uint32_t>(length));
+  }
+};
+
+/// @brief Splits the `source` into tokens. Runs of identifier characters,
+/// digits and whitespace, as well as the ends of comments, are found 16 bytes
+/// at a time when SSE2 is available.
+/// @note An invalid character is kept as a `kInvalid` token of its own, which
+/// is reported only if it reaches the parser; a preprocessing directive may
+/// skip it. A backslash followed by a newline is skipped as whitespace.
+TokenBuffer Lex(std::string source);
+
+/// @brief Same as `Lex`, but the tokens refer to `source` instead of a copy.
+/// @note `source` must outlive the buffer.
+TokenBuffer LexInPlace(std::string_view source);
+
+/// @brief Converts the digits of a decimal integer constant to its value.
+/// @return `std::nullopt` if the value doesn't fit in 64 bits, i.e., it can't be
+/// represented by `unsigned long`, the widest integer type.
+std::optional<std::uint64_t> DecimalValueOf(std::string_view digits) noexcept;
+
+/// @brief Makes the parser read its tokens from `tokens` instead of the flex
+/// scanner; `nullptr` switches back to the flex scanner.
+/// @note `tokens` must outlive the parsing.
+void SetParserTokens(const TokenBuffer* tokens);
+
+/// @brief Locates the tokens of the flex scanner and of `SetParserTokens` in
+/// the file that starts at `base` in the `LineMap`; 0, the first file, by
+/// default.
+/// @note The tokens of a `Preprocessor` are located by the preprocessor.
+void SetParserFileBase(Location base);
+
+#endif  // LEXER_HPP_
@@ -0,0 +1,181 @@
+#ifndef LLVM_IR_GENERATOR_HPP_
+#define LLVM_IR_GENERATOR_HPP_
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+#include "operator.hpp"
+#include "static_visitor.hpp"
+#include "thread_pool.hpp"
+#include "type.hpp"
+
+namespace llvm_ir {
+
+/// @brief An operand of an instruction: a named value, or an integer constant
+/// that is spelled by the type it's used as.
+struct Operand {
+  /// @brief Empty for a constant.
+  std::string name{};
+  std::int64_t imm = 0;
+
+  static Operand OfName(std::string name) {
+    return {std::move(name)};
+  }
+  static Operand OfImm(std::int64_t imm) {
+    return {{}, imm};
+  }
+
+  bool IsImm() const noexcept {
+    return name.empty();
+  }
+};
+
+/// @brief How the pointers of the generated IR are spelled.
+enum class PointerKind : std::uint8_t {
+  /// @brief `ptr`, which LLVM 15 and later use.
+  kOpaque,
+  /// @brief `i8*`, which is cast to a pointer to the type that is loaded or
+  /// stored. LLVM 14 and earlier only have partial support for opaque
+  /// pointers, with which `opt` may crash.
+  kTyped,
+};
+
+}  // namespace llvm_ir
+
+/// @brief Generates the textual LLVM IR of a translation unit, so that it can
+/// be optimized by `opt` and compiled by `llc`.
+/// @note The generated code behaves the same as the QBE IR of
+/// `QbeIrGenerator`, which is the reference. The records are passed and
+/// returned as the x86-64 System V ABI requires, so that the functions can be
+/// called from the code of other compilers.
+class LlvmIrGenerator : public StaticVisitor<LlvmIrGenerator> {
+ public:
+  using StaticVisitor::Visit;
+
+  void Visit(const DeclStmtNode&);
+  void Visit(const LoopInitNode&);
+  void Visit(const VarDeclNode&);
+  void Visit(const ArrDeclNode&);
+  void Visit(const RecordDeclNode&);
+  void Visit(const FieldNode&);
+  void Visit(const RecordVarDeclNode&);
+  void Visit(const ParamNode&);
+  void Visit(const FuncDefNode&);
+  void Visit(const CompoundStmtNode&);
+  void Visit(const ExternDeclNode&);
+  void Visit(const TransUnitNode&);
+  void Visit(const IfStmtNode&);
+  void Visit(const WhileStmtNode&);
+  void Visit(const ForStmtNode&);
+  void Visit(const ReturnStmtNode&);
+  void Visit(const GotoStmtNode&);
+  void Visit(const BreakStmtNode&);
+  void Visit(const ContinueStmtNode&);
+  void Visit(const SwitchStmtNode&);
+  void Visit(const IdLabeledStmtNode&);
+  void Visit(const CaseStmtNode&);
+  void Visit(const DefaultStmtNode&);
+  void Visit(const ExprStmtNode&);
+  void Visit(const InitExprNode&);
+  void Visit(const ArrDesNode&);
+  void Visit(const IdDesNode&);
+  void Visit(const NullExprNode&);
+  void Visit(const IdExprNode&);
+  void Visit(const IntConstExprNode&);
+  void Visit(const ArgExprNode&);
+  void Visit(const ArrSubExprNode&);
+  void Visit(const CondExprNode&);
+  void Visit(const FuncCallExprNode&);
+  void Visit(const PostfixArithExprNode&);
+  void Visit(const RecordMemExprNode&);
+  void Visit(const UnaryExprNode&);
+  void Visit(const BinaryExprNode&);
+  void Visit(const SimpleAssignmentExprNode&);
+
+  /// @param thread_pool If provided, the functions of a translation unit are
+  /// generated in parallel with it.
+  explicit LlvmIrGenerator(
+      std::ostream& output, ThreadPool* thread_pool = nullptr,
+      llvm_ir::PointerKind pointer_kind = llvm_ir::PointerKind::kOpaque)
+      : output_{output},
+        thread_pool_{thread_pool},
+        pointer_kind_{pointer_kind} {}
+
+  /// @brief Writes the target of the module, which the records are passed
+  /// for. Called before the first top-level declaration is generated.
+  void BeginModule();
+
+  /// @brief Generates a single top-level declaration, after which nothing
+  /// refers to the node, so it can be freed.
+  /// @note The module has to be begun before the first one, and finished after
+  /// the last one.
+  void GenerateExternDecl(const ExternDeclNode& extern_decl);
+
+  /// @brief Writes the declarations of the functions that are referred to but
+  /// not defined in the module, which LLVM requires unlike QBE. Called once all
+  /// the top-level declarations are generated.
+  void FinishModule();
+
+ private:
+  std::ostream& output_;
+  /// @note This is a non-owning pointer.
+  ThreadPool* thread_pool_;
+  llvm_ir::PointerKind pointer_kind_;
+  /// @brief The declaration of each function that is referred to, by its
+  /// symbol.
+  std::map<std::string, std::string> referred_funcs_{};
+  std::set<std::string> defined_funcs_{};
+
+  /// @brief Writes the function that is generated, whose definition begins
+  /// with `header`, to `output`.
+  void WriteFunction_(const std::string& header);
+
+  /// @brief Resets the states that live through the generation of a single
+  /// top-level declaration.
+  void ResetStates_();
+
+  /// @brief Called by the code generation of `TransUnitNode` to generate each
+  /// function into its own buffer in parallel.
+  void GenerateInParallel_(const TransUnitNode&);
+
+  /// @brief Called by the code generation of `FuncDefNode` to receive the
+  /// arguments, whose values are stored to the slots of the parameters.
+  /// @return The parameter list of the definition.
+  std::string ReceiveParams_(const FuncDefNode&);
+
+  /// @brief Called by the code generation of `SwitchStmtNode` to generate the
+  /// condition matching of the cases.
+  void GenerateConditions_(const SwitchStmtNode&, int first_cond_label,
+                           const llvm_ir::Operand& ctrl);
+  /// @brief Called by the code generation of `BinaryExprNode` to generate the
+  /// right operand and the operation itself; the left operand is already
+  /// generated.
+  void GenerateBinaryExpr_(const BinaryExprNode&);
+
+  /// @brief Records the declaration of the function `symbol` of `func_type`,
+  /// which is written by `FinishModule` unless the function is defined.
+  void ReferTo_(const std::string& symbol, const FuncType& func_type);
+
+  /// @brief Converts `val` from `from` to `to`, as `QbeIrGenerator` does.
+  /// Unlike QBE, LLVM requires the operands to be exactly of the type of the
+  /// instruction, so the truncations are explicit.
+  llvm_ir::Operand ConvertTo_(const llvm_ir::Operand& val, const Type& from,
+                              const Type& to);
+  /// @brief Adds (`kAdd`) or subtracts (`kSub`) 1 to `val` of `type`.
+  llvm_ir::Operand WriteIncrOrDecr_(BinaryOperator op,
+                                    const llvm_ir::Operand& val,
+                                    const Type& type);
+  /// @brief Stores `val` of `from` to the object of `to` at `addr`; a record,
+  /// whose value is its address, is copied as a whole.
+  void WriteStoreOf_(const llvm_ir::Operand& val, const Type& from,
+                     const Type& to, const std::string& addr);
+};
+
+#endif  // LLVM_IR_GENERATOR_HPP_
@@ -1,17 +1,109 @@
 #ifndef LOCATION_HPP_
 #define LOCATION_HPP_
 
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
 #include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
 
+/// @brief A position in the source files, kept as the offset of its first
+/// character so that it costs each AST node only 4 bytes. Each file, whether
+/// it's compiled or included, takes a range of offsets of its own.
+/// @note Use `LineMap` to get the file, line and column of a location.
 struct Location {
+  std::uint32_t offset;
+};
+
+/// @brief The source range of a token or a grammar rule; this is the location
+/// type of the parser.
+struct SourceRange {
+  Location begin;
+  /// @note One past the last character.
+  Location end;
+};
+
+/// @brief Outputs the range in the format "begin-end" of offsets, which is only
+/// used by the debug traces of the parser.
+inline std::ostream& operator<<(std::ostream& os, const SourceRange& range) {
+  return os << range.begin.offset << "-" << range.end.offset;
+}
+
+struct LineColumn {
   int line;
   int column;
 };
 
 /// @brief Outputs the location in the format "line:column".
-inline std::ostream& operator<<(std::ostream& os, const Location& loc) {
+inline std::ostream& operator<<(std::ostream& os, const LineColumn& loc) {
   return os << loc.line << ":" << loc.column;
-  ;
 }
 
+/// @brief Resolves locations into the files that they're in, and into lines
+/// and columns with the line table of each file.
+/// @note A file is only read, and its line starts are only found, when the
+/// first location in it is resolved, which is usually for diagnostics and
+/// dumps.
+class LineMap {
+ public:
+  LineMap() = default;
+  /// @brief Adds the file at `path` as the first one.
+  explicit LineMap(std::filesystem::path path) {
+    AddFile(std::move(path));
+  }
+
+  /// @brief Adds the file at `path`, whose offsets follow those of the files
+  /// added before; a location in it is its offset in the file added to the
+  /// returned one. Its end, one past its last character, is a location in it
+  /// as well.
+  /// @note The size of the file is taken from the file system.
+  /// @note Not thread-safe; the files are added while parsing.
+  Location AddFile(std::filesystem::path path);
+  /// @param size The size of the file, with which the map can be rebuilt as it
+  /// was even if the file has changed since.
+  Location AddFile(std::filesystem::path path, std::uint32_t size);
+
+  /// @note Both line and column start from 1. Locations past the end of the
+  /// file resolve to the end of the last line.
+  LineColumn Resolve(Location loc) const;
+
+  /// @return The path of the file that `loc` is in.
+  const std::filesystem::path& PathOf(Location loc) const;
+
+  /// @return The location in the format "path:line:column", which starts the
+  /// diagnostics.
+  std::string Describe(Location loc) const;
+
+  /// @return The paths and the sizes of the files, in the order that they're
+  /// added.
+  std::vector<std::pair<std::filesystem::path, std::uint32_t>> Files() const;
+
+ private:
+  struct File {
+    std::filesystem::path path;
+    /// @brief The offset of the first character.
+    std::uint32_t begin;
+    std::uint32_t size;
+    /// @brief The offsets of the first characters of the lines, relative to
+    /// the file.
+    mutable std::vector<std::uint32_t> line_starts{};
+    mutable std::once_flag is_built{};
+
+    File(std::filesystem::path file_path, std::uint32_t file_begin,
+         std::uint32_t file_size)
+        : path{std::move(file_path)}, begin{file_begin}, size{file_size} {}
+
+    void Build() const;
+  };
+
+  /// @note A deque, since a file can't be moved once its line table may be
+  /// built.
+  std::deque<File> files_{};
+
+  const File& FileOf_(Location loc) const;
+};
+
 #endif /* LOCATION_HPP_ */
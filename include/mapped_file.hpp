@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_HPP_
+#define MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+/// @brief A read-only mapping of a whole file into memory, which is unmapped
+/// on destruction.
+class MappedFile {
+ public:
+  /// @note Check `is_open()` for whether the file is mapped.
+  explicit MappedFile(const std::filesystem::path& path);
+
+  bool is_open() const noexcept {  // NOLINT(readability-identifier-naming)
+    return is_open_;
+  }
+
+  /// @note Empty if the file isn't mapped.
+  std::string_view bytes()  // NOLINT(readability-identifier-naming)
+      const noexcept {
+    return {static_cast<const char*>(data_), size_};
+  }
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+ private:
+  bool is_open_{false};
+  /// @note `nullptr` for an empty file, which can't be mapped.
+  void* data_{nullptr};
+  std::size_t size_{0};
+};
+
+#endif  // MAPPED_FILE_HPP_
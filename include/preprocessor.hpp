@@ -0,0 +1,199 @@
+#ifndef PREPROCESSOR_HPP_
+#define PREPROCESSOR_HPP_
+
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "lexer.hpp"
+#include "location.hpp"
+
+/// @brief A token after preprocessing.
+struct PpToken {
+  TokenKind kind;
+  std::string_view text;
+  /// @brief Where the token is in the file that it's read from, which is
+  /// added to the `LineMap` of the preprocessor; a token from a macro
+  /// expansion is located at the name of the macro.
+  Location loc;
+};
+
+/// @brief A file that is read by the preprocessor. It's mapped into memory and
+/// lexed once per process, no matter how many times it's included.
+struct SourceFile;
+
+/// @brief Handles the preprocessing directives and expands the macros of a
+/// source file, on the tokens of `LexInPlace`.
+/// @note Supports `#include`, `#define` of object-like and function-like
+/// macros (with `#`, `##` and `__VA_ARGS__`), `#undef`, the conditional
+/// directives, `#error` and `#pragma once`. A file guarded by `#pragma once`,
+/// or by `#ifndef` and the matching `#endif` around the whole file, is skipped
+/// without being scanned again when it's included once more.
+/// @note Errors are reported to the standard error, at the directive or at the
+/// invocation of the macro that they're in, and the program exits.
+class Preprocessor {
+ public:
+  /// @param include_dirs The directories to search for included files, in
+  /// order; the directory of the including file is searched first for the
+  /// `#include "..."` form.
+  /// @param line_map Where each file that's read, the one at `path` first, is
+  /// added once. It must outlive the preprocessor.
+  Preprocessor(const std::filesystem::path& path,
+               std::vector<std::filesystem::path> include_dirs,
+               LineMap& line_map);
+
+  /// @brief Defines an object-like macro, as if by `#define name value`.
+  void Define(std::string_view name, std::string_view value);
+
+  /// @return The next token of the preprocessed source; `kEof` at the end and
+  /// repeatedly thereafter.
+  PpToken Next();
+
+  /// @return Whether any file is included or any macro is defined so far,
+  /// after which the tokens are not only those of the main file.
+  bool HasDirectives() const noexcept {
+    return has_directives_;
+  }
+
+ private:
+  /// @brief The macros that a token is expanded from, which are not expanded
+  /// again in the token. Sorted.
+  using HideSet = std::vector<std::string_view>;
+
+  struct Token {
+    TokenKind kind;
+    std::string_view text;
+    Location loc;
+    /// @note `nullptr` for the empty set.
+    const HideSet* hide_set;
+  };
+
+  struct Macro {
+    bool is_function_like;
+    /// @note `__VA_ARGS__` is the last parameter of a variadic macro.
+    std::vector<std::string_view> params;
+    bool is_variadic;
+    std::vector<Token> body;
+  };
+
+  /// @brief An if-section of the conditional directives.
+  struct Conditional {
+    /// @brief Whether the tokens of the current group are kept.
+    bool is_taking;
+    /// @brief Whether a group of the section has been taken, or the whole
+    /// section is skipped; no later group is taken if so.
+    bool has_taken;
+    bool has_else;
+    /// @brief Where the `#if`, `#ifdef` or `#ifndef` is, for diagnostics.
+    Location loc;
+  };
+
+  /// @brief The states of the detection of an include guard.
+  enum class GuardState {
+    /// @brief Nothing in the file is seen.
+    kStart,
+    /// @brief Inside the `#ifndef` that starts the file.
+    kInGuard,
+    /// @brief Right after the `#endif` of the guard.
+    kAfterGuard,
+    kNoGuard,
+  };
+
+  /// @brief A file that is being preprocessed.
+  struct Frame {
+    SourceFile* file;
+    /// @brief The index of the next token.
+    std::size_t next;
+    /// @brief Where the file starts in the `LineMap`; a token is located at
+    /// its offset from there.
+    Location base;
+    /// @brief The number of if-sections outside of the file.
+    std::size_t num_of_outer_conds;
+    GuardState guard_state;
+    std::string_view guard;
+  };
+
+  std::vector<std::filesystem::path> include_dirs_;
+  LineMap& line_map_;
+  /// @brief Where each file that's read starts in `line_map_`, so that a file
+  /// that's included many times is added once.
+  std::unordered_map<const SourceFile*, Location> bases_{};
+  std::unordered_map<std::string_view, Macro> macros_{};
+  std::vector<Frame> frames_{};
+  std::vector<Conditional> conds_{};
+  /// @brief The tokens to read before those of the files, in reverse order,
+  /// which are mostly the results of macro expansions.
+  std::vector<Token> pending_{};
+  /// @brief If not reading the files, the end of `pending_` is the end of the
+  /// tokens.
+  bool is_reading_files_{true};
+  /// @brief The files that have been entered, for `#pragma once`.
+  std::unordered_set<const SourceFile*> entered_{};
+  /// @brief Owns the texts that are not in any file, such as the results of
+  /// `#`, `##` and `Define`.
+  std::deque<std::string> texts_{};
+  std::deque<HideSet> hide_sets_{};
+  std::map<std::pair<const HideSet*, std::string_view>, const HideSet*>
+      extended_hide_sets_{};
+  /// @brief Where the current directive starts, for diagnostics.
+  Location directive_loc_{0};
+  bool has_directives_{false};
+
+  /// @return The next token, which is not yet macro-expanded.
+  Token NextUnexpanded_();
+  Token NextFromFiles_();
+  /// @brief Expands `token` if it names a macro that is not hidden from it; the
+  /// result is put into `pending_`.
+  /// @return Whether `token` is expanded.
+  bool TryExpand_(const Token& token);
+  /// @return The arguments of a function-like macro, not expanded; `nullopt`
+  /// if the name isn't followed by a left parenthesis.
+  std::optional<std::vector<std::vector<Token>>> ReadArgs_(const Token& name,
+                                                          const Macro& macro);
+  std::vector<Token> Substitute_(const Macro& macro,
+                                 const std::vector<std::vector<Token>>& args,
+                                 const Token& name);
+  /// @return `tokens` with all their macros expanded.
+  std::vector<Token> ExpandAll_(std::vector<Token> tokens);
+  /// @return The token that is spelled as `lhs` followed by `rhs`.
+  /// @param loc Where the macro is invoked, for diagnostics.
+  Token Paste_(const Token& lhs, const Token& rhs, Location loc);
+  /// @return The string literal of the spelling of `tokens`.
+  Token Stringize_(const std::vector<Token>& tokens, Location loc);
+  const HideSet* Extend_(const HideSet* hide_set, std::string_view name);
+  /// @brief Stores `text` for the rest of the preprocessing.
+  std::string_view Store_(std::string text);
+
+  /// @return The tokens till the end of the line of the current directive.
+  std::vector<Token> ReadLine_();
+  void HandleDirective_();
+  void HandleDefine_(const std::vector<Token>& line);
+  void HandleInclude_(const std::vector<Token>& line);
+  void EnterFile_(SourceFile& file);
+  /// @return The value of the controlling expression of `#if` or `#elif`.
+  bool Evaluate_(const std::vector<Token>& line);
+  /// @brief Notes that a token or directive other than the guard is seen.
+  void SeeNonGuard_();
+  bool IsTaking_() const noexcept {
+    return conds_.empty() || conds_.back().is_taking;
+  }
+
+  /// @brief Reports `message` at `loc`, in the format of the other
+  /// diagnostics of the driver, and exits.
+  [[noreturn]] void Error_(Location loc, const std::string& message) const;
+};
+
+/// @brief Makes the parser read its tokens from `preprocessor` instead of the
+/// flex scanner; `nullptr` switches back to the flex scanner.
+/// @note `preprocessor` must outlive the parsing.
+void SetParserPreprocessor(Preprocessor* preprocessor);
+
+#endif  // PREPROCESSOR_HPP_
@@ -0,0 +1,81 @@
+#ifndef PROFILE_HPP_
+#define PROFILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+
+/// @brief The sites of a function whose executions are counted by a program
+/// compiled with `--profile-generate`, numbered in the order of the tree, so
+/// that they are numbered the same however the code is laid out:
+/// - the entry of the function, which is always site 0;
+/// - each `if` statement, whose `then` arm is counted at the next site;
+/// - each `while`, `do` and `for` loop, which is counted each time that it
+/// jumps back to its body from its condition or step;
+/// - each `case` and `default` label, which is counted when the `switch`
+/// jumps to it, but not when the label is fallen through;
+/// - each `&&` and `||` operator, whose right operand is counted at the next
+/// site;
+/// - each `?:` operator, whose second operand is counted at the next site.
+/// @note An expression that is evaluated more than once, such as the
+/// condition of a loop, counts all of its evaluations.
+class ProfileSites {
+ public:
+  explicit ProfileSites(const FuncDefNode& func_def);
+
+  static constexpr auto kEntry = std::size_t{0};
+
+  /// @param node An `IfStmtNode`, a `WhileStmtNode`, a `ForStmtNode`, a
+  /// `CaseStmtNode`, a `DefaultStmtNode`, a `CondExprNode`, or a
+  /// `BinaryExprNode` of `&&` or `||` of the function.
+  std::size_t SiteOf(const AstNode& node) const {
+    return sites_.at(&node);
+  }
+
+  /// @return The number of sites.
+  std::size_t size() const noexcept {  // NOLINT(readability-identifier-naming)
+    return size_;
+  }
+
+ private:
+  std::unordered_map<const AstNode*, std::size_t> sites_{};
+  std::size_t size_ = 1;
+};
+
+/// @brief The counts of the sites of each function, as written at exit by a
+/// program compiled with `--profile-generate`: a line of the name of each
+/// function followed by the counts of its sites, in the order of
+/// `ProfileSites`.
+class Profile {
+ public:
+  /// @throws `std::runtime_error` if the file can't be read or isn't a
+  /// profile.
+  static Profile Read(const std::filesystem::path& path);
+
+  /// @return The counts of the sites of `func`; `nullptr` if the function
+  /// isn't profiled, or is profiled with a different number of sites than
+  /// `sites`, i.e., it has changed since.
+  const std::vector<std::uint64_t>* CountsOf(const std::string& func,
+                                             const ProfileSites& sites) const;
+
+  /// @return The number of times that `func` is entered; `std::nullopt` if the
+  /// function isn't profiled.
+  std::optional<std::uint64_t> EntryCountOf(const std::string& func) const;
+
+ private:
+  std::unordered_map<std::string, std::vector<std::uint64_t>> counts_{};
+};
+
+/// @brief Moves the functions of `trans_unit` that are never entered in
+/// `profile` after the others, keeping the order within each group, so that
+/// the functions that run share the instruction cache.
+/// @note The functions that aren't profiled are kept with those that run.
+void PlaceColdFuncsLast(TransUnitNode& trans_unit, const Profile& profile);
+
+#endif  // PROFILE_HPP_
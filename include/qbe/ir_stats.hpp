@@ -0,0 +1,57 @@
+#ifndef QBE_IR_STATS_HPP_
+#define QBE_IR_STATS_HPP_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace qbe {
+
+/// @brief The figures of the IR of a function, which tell the quality of the
+/// generated code without running it.
+struct FuncStats {
+  std::string name;
+  std::uint64_t num_of_instrs = 0;
+  std::uint64_t num_of_allocs = 0;
+  /// @brief The bytes allocated by the `alloc`s.
+  std::uint64_t stack_bytes = 0;
+  std::uint64_t num_of_loads = 0;
+  std::uint64_t num_of_stores = 0;
+  std::uint64_t num_of_calls = 0;
+  std::uint64_t num_of_blocks = 0;
+  /// @brief The jumps, conditional or not; the returns are not counted.
+  std::uint64_t num_of_branches = 0;
+
+  FuncStats& operator+=(const FuncStats& other);
+};
+
+/// @brief Collects the figures of each function from the QBE IR of a file, so
+/// that the IR written by every mode of generation, including the IR reused by
+/// incremental compilation, is counted alike.
+class IrStats {
+ public:
+  /// @param file The name of the file that the IR is generated from.
+  explicit IrStats(std::string file) : file_{std::move(file)} {}
+
+  /// @brief Counts the functions defined in `ir`, in order.
+  void Collect(std::istream& ir);
+
+  /// @brief Writes the figures of each function and their totals as a table.
+  void WriteTable(std::ostream& output) const;
+  /// @brief Writes the figures of each function and their totals as a JSON
+  /// object.
+  void WriteJson(std::ostream& output) const;
+
+ private:
+  std::string file_;
+  std::vector<FuncStats> funcs_{};
+
+  FuncStats Total_() const;
+};
+
+}  // namespace qbe
+
+#endif  // QBE_IR_STATS_HPP_
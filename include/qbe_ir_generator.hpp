@@ -3,61 +3,134 @@
 
 #include <fmt/core.h>
 
+#include <cstddef>
 #include <iosfwd>
+#include <map>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "ast.hpp"
+#include "effect.hpp"
+#include "incremental_store.hpp"
+#include "profile.hpp"
 #include "qbe/sigil.hpp"
-#include "visitor.hpp"
+#include "static_visitor.hpp"
+#include "thread_pool.hpp"
+#include "type.hpp"
 
-class QbeIrGenerator : public NonModifyingVisitor {
+class QbeIrGenerator : public StaticVisitor<QbeIrGenerator> {
  public:
-  void Visit(const DeclStmtNode&) override;
-  void Visit(const LoopInitNode&) override;
-  void Visit(const VarDeclNode&) override;
-  void Visit(const ArrDeclNode&) override;
-  void Visit(const RecordDeclNode&) override;
-  void Visit(const FieldNode&) override;
-  void Visit(const RecordVarDeclNode&) override;
-  void Visit(const ParamNode&) override;
-  void Visit(const FuncDefNode&) override;
-  void Visit(const CompoundStmtNode&) override;
-  void Visit(const ExternDeclNode&) override;
-  void Visit(const TransUnitNode&) override;
-  void Visit(const IfStmtNode&) override;
-  void Visit(const WhileStmtNode&) override;
-  void Visit(const ForStmtNode&) override;
-  void Visit(const ReturnStmtNode&) override;
-  void Visit(const GotoStmtNode&) override;
-  void Visit(const BreakStmtNode&) override;
-  void Visit(const ContinueStmtNode&) override;
-  void Visit(const SwitchStmtNode&) override;
-  void Visit(const IdLabeledStmtNode&) override;
-  void Visit(const CaseStmtNode&) override;
-  void Visit(const DefaultStmtNode&) override;
-  void Visit(const ExprStmtNode&) override;
-  void Visit(const InitExprNode&) override;
-  void Visit(const ArrDesNode&) override;
-  void Visit(const IdDesNode&) override;
-  void Visit(const NullExprNode&) override;
-  void Visit(const IdExprNode&) override;
-  void Visit(const IntConstExprNode&) override;
-  void Visit(const ArgExprNode&) override;
-  void Visit(const ArrSubExprNode&) override;
-  void Visit(const CondExprNode&) override;
-  void Visit(const FuncCallExprNode&) override;
-  void Visit(const PostfixArithExprNode&) override;
-  void Visit(const RecordMemExprNode&) override;
-  void Visit(const UnaryExprNode&) override;
-  void Visit(const BinaryExprNode&) override;
-  void Visit(const SimpleAssignmentExprNode&) override;
-
-  QbeIrGenerator(std::ostream& output) : output_{output} {}
+  using StaticVisitor::Visit;
+
+  void Visit(const DeclStmtNode&);
+  void Visit(const LoopInitNode&);
+  void Visit(const VarDeclNode&);
+  void Visit(const ArrDeclNode&);
+  void Visit(const RecordDeclNode&);
+  void Visit(const FieldNode&);
+  void Visit(const RecordVarDeclNode&);
+  void Visit(const ParamNode&);
+  void Visit(const FuncDefNode&);
+  void Visit(const CompoundStmtNode&);
+  void Visit(const ExternDeclNode&);
+  void Visit(const TransUnitNode&);
+  void Visit(const IfStmtNode&);
+  void Visit(const WhileStmtNode&);
+  void Visit(const ForStmtNode&);
+  void Visit(const ReturnStmtNode&);
+  void Visit(const GotoStmtNode&);
+  void Visit(const BreakStmtNode&);
+  void Visit(const ContinueStmtNode&);
+  void Visit(const SwitchStmtNode&);
+  void Visit(const IdLabeledStmtNode&);
+  void Visit(const CaseStmtNode&);
+  void Visit(const DefaultStmtNode&);
+  void Visit(const ExprStmtNode&);
+  void Visit(const InitExprNode&);
+  void Visit(const ArrDesNode&);
+  void Visit(const IdDesNode&);
+  void Visit(const NullExprNode&);
+  void Visit(const IdExprNode&);
+  void Visit(const IntConstExprNode&);
+  void Visit(const ArgExprNode&);
+  void Visit(const ArrSubExprNode&);
+  void Visit(const CondExprNode&);
+  void Visit(const FuncCallExprNode&);
+  void Visit(const PostfixArithExprNode&);
+  void Visit(const RecordMemExprNode&);
+  void Visit(const UnaryExprNode&);
+  void Visit(const BinaryExprNode&);
+  void Visit(const SimpleAssignmentExprNode&);
+
+  /// @param thread_pool If provided, the top-level declarations of a
+  /// translation unit are generated in parallel with it.
+  /// @param store If provided, the IR of unchanged functions is reused from the
+  /// store, and the IR of the others is recorded to it.
+  QbeIrGenerator(std::ostream& output, ThreadPool* thread_pool = nullptr,
+                 IncrementalStore* store = nullptr);
+  ~QbeIrGenerator();
+
+  /// @brief Generates a single top-level declaration. The numbering of
+  /// file-scope declarations is kept for the declarations that follow, but
+  /// nothing refers to the node afterwards, so it can be freed.
+  void GenerateExternDecl(const ExternDeclNode& extern_decl);
+
+  /// @brief Counts the executions of the `ProfileSites` of each function,
+  /// which `main` writes to `path` at exit.
+  /// @note The counters are only registered by a translation unit that has
+  /// `main`.
+  void InstrumentForProfile(std::string path) {
+    profile_path_ = std::move(path);
+  }
+
+  /// @brief Lays out the blocks of the functions by the counts of `profile`:
+  /// the arm of an `if` that runs more is placed first, and an arm that never
+  /// runs is moved after the other blocks; the cases of a `switch` are tested
+  /// in the order of the number of times that they are matched.
+  /// @note `profile` must outlive the generation.
+  void UseProfile(const Profile* profile) noexcept {
+    profile_ = profile;
+  }
+
+  /// @brief Leaves out the expressions whose values are unused and that have
+  /// no side effects, such as the left operand of a comma; reuses the results
+  /// of pure calls, and evaluates those that a loop would evaluate anew on
+  /// each iteration once before it.
+  /// @note `effects` must be of the translation unit that is generated, and
+  /// outlive the generation.
+  void UseEffects(const EffectAnalysis* effects) noexcept {
+    effects_ = effects;
+  }
 
  private:
   std::ostream& output_;
+  /// @note This is a non-owning pointer.
+  ThreadPool* thread_pool_;
+  /// @note This is a non-owning pointer.
+  IncrementalStore* store_;
+  /// @brief The path that the counters are written to; empty if the functions
+  /// aren't instrumented.
+  std::string profile_path_{};
+  /// @note This is a non-owning pointer.
+  const Profile* profile_ = nullptr;
+  /// @note This is a non-owning pointer.
+  const EffectAnalysis* effects_ = nullptr;
+
+  struct FuncContext;
+  /// @brief The states of the top-level declaration that is being generated,
+  /// e.g., the numbering of temporaries and labels; `nullptr` in between the
+  /// declarations.
+  std::unique_ptr<FuncContext> ctx_{};
+  /// @brief The numbers of the file-scope declarations, which every top-level
+  /// declaration starts with. Shared with the generators of
+  /// `GenerateSeparately_`.
+  /// @note Only modified in between the generation of top-level declarations,
+  /// so it's safe to be read by multiple threads.
+  std::shared_ptr<std::map<std::string, int>> file_scope_id_to_num_ =
+      std::make_shared<std::map<std::string, int>>();
 
   static constexpr auto kIndentStr = "\t";
 
@@ -71,13 +144,64 @@ class QbeIrGenerator : public NonModifyingVisitor {
   }
 
   /// @brief Writes the definition of a label with newline.
-  void WriteLabel_(const qbe::user_defined::BlockLabel& label) {
-    Write_("{}\n", label);
-  }
+  /// @note A label begins a new block, so values of the previous block are no
+  /// longer reused.
+  void WriteLabel_(const qbe::user_defined::BlockLabel& label);
   /// @brief Writes the definition of a label with newline.
-  void WriteLabel_(const qbe::compiler_generated::BlockLabel& label) {
-    Write_("{}\n", label);
-  }
+  /// @note A label begins a new block, so values of the previous block are no
+  /// longer reused.
+  void WriteLabel_(const qbe::compiler_generated::BlockLabel& label);
+
+  /// @brief Writes an instruction that computes a value without side effects,
+  /// such as arithmetic or address calculation. If the same computation is
+  /// already available in the current block, its result is copied instead.
+  /// @param type The base type of the result, e.g., "w".
+  /// @param operands The formatted operands; temporaries should be in their
+  /// canonical form so that equivalent computations are spelled the same.
+  /// @return The number of the temporary that holds the result.
+  int WritePureInstr_(std::string_view type, std::string_view op,
+                      const std::string& operands);
+  /// @brief Writes a load from `addr_num`, unless the value last loaded from or
+  /// stored to that address is still available, in which case it is copied.
+  /// @return The number of the temporary that holds the result.
+  int WriteLoad_(std::string_view type, std::string_view load_op,
+                 int addr_num);
+  /// @brief Writes a store of `val_num` to `addr_num`, forgetting the loads
+  /// that the store may alias.
+  void WriteStore_(std::string_view store_op, int val_num, int addr_num);
+  /// @brief Writes a copy of the `size` bytes at `src_addr_num` to
+  /// `dst_addr_num`, forgetting the loads that the copy may alias.
+  void WriteBlit_(int src_addr_num, int dst_addr_num, std::size_t size);
+  /// @brief Converts the value of `num` from `from` to `to`, e.g., extends an
+  /// `int` to a `long`, or truncates an `int` to a `char`.
+  /// @note The values of the integers narrower than a word are kept extended
+  /// to a word in the temporaries.
+  /// @return The number of the temporary that holds the converted value; `num`
+  /// itself if no instruction is needed.
+  int ConvertTo_(int num, const Type& from, const Type& to);
+  /// @brief Converts the value of `num` from `from` to `to` for a store to an
+  /// object of `to`, which truncates the value by itself.
+  int ConvertForStore_(int num, const Type& from, const Type& to);
+  /// @brief Writes the addition (`kAdd`) or subtraction (`kSub`) of 1 to the
+  /// value of `num`, which is of `type`.
+  /// @return The number of the temporary that holds the result, which is
+  /// converted back to `type`.
+  int WriteIncrOrDecr_(BinaryOperator op, int num, const Type& type);
+
+  /// @brief Writes the increment of the counter of `site` of the function.
+  void WriteCounterIncr_(std::size_t site);
+  /// @brief Writes the block labeled `back_label`, which counts the jump back
+  /// to `body_label` of the loop at `site`.
+  void WriteBackEdge_(const qbe::compiler_generated::BlockLabel& back_label,
+                      std::size_t site,
+                      const qbe::compiler_generated::BlockLabel& body_label);
+  /// @brief Writes the blocks that `write` writes after the other blocks of
+  /// the function, so that the blocks which run are laid out together.
+  template <typename Write>
+  void WriteColdBlocks_(Write&& write);
+  /// @brief Writes the table of the counters of the functions of `trans_unit`,
+  /// which `main` passes to the runtime library, and the path of the profile.
+  void WriteProfileTable_(const TransUnitNode& trans_unit);
 
   /// @brief Writes the `# ` comment with newline.
   template <typename... T>
@@ -102,11 +226,25 @@ class QbeIrGenerator : public NonModifyingVisitor {
   /// @note This function is not meant to be used directly.
   void VWrite_(fmt::string_view format, fmt::format_args args);
 
+  /// @brief Generates `extern_decl` to `output` with a generator of its own,
+  /// which has the options and the file-scope declarations of this one.
+  /// @note Functions can be generated this way by multiple threads at once.
+  void GenerateSeparately_(const ExternDeclNode& extern_decl,
+                           std::ostream& output);
+
+  /// @brief Called by the code generation of `TransUnitNode` to generate each
+  /// top-level declaration into its own buffer in parallel.
+  void GenerateInParallel_(const TransUnitNode&);
+
   /// @brief Called by the code generation of `FuncDefNode` to allocate memory
   /// for the parameters. The value of the parameters are stored in their
   /// corresponding memory locations.
   void AllocMemForParams_(const std::vector<std::unique_ptr<ParamNode>>&);
 
+  /// @brief Called by the code generation of loops to generate the pure calls
+  /// of `loop` that can be hoisted, before the loop.
+  void HoistCalls_(const StmtNode& loop);
+
   /// @brief Called by the code generation of `SwitchStmtNode` to generate the
   /// statement of its cases.
   void GenerateCases_(const SwitchStmtNode&);
@@ -116,6 +254,14 @@ class QbeIrGenerator : public NonModifyingVisitor {
       const SwitchStmtNode&,
       const qbe::compiler_generated::BlockLabel& first_cond_label,
       int ctrl_num);
+  /// @brief Called by the code generation of `BinaryExprNode` to generate the
+  /// right operand and the operation itself; the left operand is already
+  /// generated.
+  void GenerateBinaryExpr_(const BinaryExprNode&);
+  /// @brief Called by the code generation of `BinaryExprNode` to generate a
+  /// chain of comma operators, leaving out the operands whose values are
+  /// unused and that have no side effects.
+  void GenerateCommaExpr_(const BinaryExprNode&);
 };
 
 #endif  // QBE_IR_GENERATOR_HPP_
@@ -1,10 +1,13 @@
 #ifndef SCOPE_HPP_
 #define SCOPE_HPP_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -40,6 +43,28 @@ struct Scope {
 /// @brief Manages scopes and symbol tables.
 class ScopeStack {
  public:
+  /// @brief The numbers of the symbols and the types in the top-most scope,
+  /// which marks a point between the declarations of the scope.
+  struct Mark {
+    std::size_t num_of_symbols;
+    std::size_t num_of_types;
+  };
+
+  ScopeStack() = default;
+  /// @brief Creates a stack on top of the scopes of `enclosing`, which are
+  /// only looked up but never modified. This allows multiple stacks to share
+  /// the same file scope, e.g., when checking functions in parallel.
+  /// @param mark Only the entries of the top-most scope of `enclosing` that
+  /// are added before it are visible, as if the later declarations are not
+  /// yet seen.
+  /// @note `enclosing` must outlive this stack.
+  ScopeStack(const ScopeStack* enclosing, Mark mark)
+      : enclosing_{enclosing}, mark_of_enclosing_{mark} {}
+
+  /// @return The mark of the current end of the top-most scope.
+  /// @throws `NotInScopeError`
+  Mark MarkOfTopScope() const;
+
   /// @brief Pushes a new scope of the kind.
   /// @throws `ScopesOfDifferentKindIsNotMergeableError` if the previous scope
   /// had set to merge with the next (this) scope, which is of a different kind.
@@ -70,7 +95,8 @@ class ScopeStack {
   /// @throws `NotInSuchKindOfScopeError`
   std::shared_ptr<SymbolEntry> AddSymbol(std::unique_ptr<SymbolEntry> entry,
                                          ScopeKind kind);
-  /// @brief Looks up the symbol with the `id` from through all scopes.
+  /// @brief Looks up the symbol with the `id` from through all scopes,
+  /// including the ones of the enclosing stack.
   /// @return The symbol with the `id` if it exists; otherwise, `nullptr`.
   /// @throws `NotInScopeError`
   std::shared_ptr<SymbolEntry> LookUpSymbol(const std::string& id) const;
@@ -86,7 +112,8 @@ class ScopeStack {
   /// @throws `NotInSuchKindOfScopeError`
   std::shared_ptr<TypeEntry> AddType(std::unique_ptr<TypeEntry> entry,
                                      ScopeKind kind);
-  /// @brief Looks up the type with the `id` from through all scopes.
+  /// @brief Looks up the type with the `id` from through all scopes,
+  /// including the ones of the enclosing stack.
   /// @return The type with the `id` if it exists; otherwise, `nullptr`.
   /// @throws `NotInScopeError`
   std::shared_ptr<TypeEntry> LookUpType(const std::string& id) const;
@@ -97,6 +124,17 @@ class ScopeStack {
 
  private:
   std::vector<Scope> scopes_{};
+  /// @brief The indices of the scopes that have any symbol, in order, so that
+  /// a look-up skips the empty scopes, e.g., those of deeply nested blocks.
+  std::vector<std::size_t> scopes_with_symbols_{};
+  /// @brief The indices of the scopes that have any type, in order.
+  std::vector<std::size_t> scopes_with_types_{};
+  /// @brief Scopes that are looked up after all scopes of this stack.
+  /// @note This is a non-owning pointer.
+  const ScopeStack* enclosing_{nullptr};
+  /// @brief The end of the entries of the top-most scope of `enclosing_` that
+  /// are visible from this stack.
+  Mark mark_of_enclosing_{};
   /// @brief If `true`, the current scope will be merged with the next scope.
   /// @note This is used specifically for the function parameters to be included
   /// in the scope of the function body.
@@ -109,6 +147,17 @@ class ScopeStack {
     }
   }
 
+  /// @return The indices of the scopes of `self` that have any entry of the
+  /// `Entry` type.
+  template <typename Entry, typename Self>
+  static auto& ScopesWithEntries_(Self& self) {
+    if constexpr (std::is_same_v<Entry, SymbolEntry>) {
+      return self.scopes_with_symbols_;
+    } else {
+      return self.scopes_with_types_;
+    }
+  }
+
   /// @brief Adds the `entry` to the top-most scope of the `kind`.
   /// @tparam Table The type of the table to add the entry.
   /// @tparam Entry The type of the entry to add.
@@ -126,12 +175,15 @@ class ScopeStack {
   /// @tparam Entry The type of the entry to look up.
   /// @param table The class member pointer to the table to look up from the
   /// scope.
+  /// @param num_of_visible_entries If provided, only the entries of the
+  /// top-most scope that are added before it are looked up.
   /// @return The entry with the `id` if it exists; otherwise, `nullptr`.
   /// @throws `NotInScopeError`
   template <typename Entry>
   std::shared_ptr<Entry> LookUpEntry_(
       const std::string& id,
-      std::unique_ptr<TableTemplate<Entry>> Scope::*table) const;
+      std::unique_ptr<TableTemplate<Entry>> Scope::*table,
+      std::optional<std::size_t> num_of_visible_entries = std::nullopt) const;
 
   /// @brief Probes the `id` from the top-most scope.
   /// @tparam Table The type of the table to probe from the scope.
@@ -0,0 +1,38 @@
+#ifndef STACK_SEGMENT_HPP_
+#define STACK_SEGMENT_HPP_
+
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/// @return Whether the stack of the calling thread has enough room left for
+/// another level of recursion.
+bool HasSufficientStack() noexcept;
+
+/// @brief Calls `func` on a new segment of stack, which is allocated for the
+/// call and freed once `func` returns. The exception thrown by `func`, if any,
+/// is rethrown to the caller.
+void RunOnNewStackSegment(const std::function<void()>& func);
+
+/// @brief Calls `func` on the current stack if it has enough room left;
+/// otherwise, on a new segment of stack. A recursion that goes through this at
+/// each level can be nested arbitrarily deep, using memory in proportion to
+/// its depth, without overflowing the stack of the thread.
+/// @return What `func` returns.
+template <typename Func>
+std::invoke_result_t<Func> WithSufficientStack(Func&& func) {
+  using Result = std::invoke_result_t<Func>;
+  if (HasSufficientStack()) {
+    return std::forward<Func>(func)();
+  }
+  if constexpr (std::is_void_v<Result>) {
+    RunOnNewStackSegment(std::forward<Func>(func));
+  } else {
+    auto result = std::optional<Result>{};
+    RunOnNewStackSegment([&func, &result] { result.emplace(func()); });
+    return std::move(*result);
+  }
+}
+
+#endif  // STACK_SEGMENT_HPP_
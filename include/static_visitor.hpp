@@ -0,0 +1,229 @@
+#ifndef STATIC_VISITOR_HPP_
+#define STATIC_VISITOR_HPP_
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+#include "casting.hpp"
+#include "stack_segment.hpp"
+#include "visit_profiler.hpp"
+
+/// @brief A visitor that dispatches with a `switch` on the kind of the node,
+/// instead of the two virtual calls of `Accept()` and `Visit()`. The `Visit()`
+/// to call is known at compile time, so the traversal can be inlined.
+/// @tparam Derived The concrete visitor. Define `Visit()` on the classes that
+/// you care about and bring the fallback into scope with
+/// `using StaticVisitor::Visit;`.
+/// @tparam is_modifying If `true`, `Visit()` takes a non-const reference of the
+/// visitable; otherwise, a const reference. Default to `false`.
+/// @note Unlike `Visitor`, a node whose class has no `Visit()` of its own is
+/// visited as its closest base class that has one, through overload
+/// resolution; the fallback on `AstNode` does nothing.
+template <typename Derived, bool is_modifying = false>
+class StaticVisitor {
+ public:
+  /// @brief Conditionally mutable.
+  template <typename Visitable>
+  using CondMut = std::conditional_t<is_modifying, Visitable, const Visitable>;
+
+  /// @brief Calls the `Visit()` of `Derived` on the concrete class of `node`.
+  /// @note The visit continues on a new segment of stack once the current one
+  /// runs low, so that the nodes can be nested arbitrarily deep, e.g., the
+  /// statements of `if (a) if (a) ...` or the operands of `-(a + -(a + ...))`.
+  void Dispatch(CondMut<AstNode>& node) {
+    WithSufficientStack([this, &node] {
+      // NOTE: The profiler is checked on every node, so profiling isn't free
+      // even when it's off; bench-traversal measures the cost of the check.
+      if (profiler_) {
+        profiler_->Enter(node.kind);
+        DispatchByKind_(node);
+        profiler_->Exit();
+      } else {
+        DispatchByKind_(node);
+      }
+    });
+  }
+
+  /// @brief The fallback for the nodes that `Derived` doesn't care about.
+  void Visit(CondMut<AstNode>&) {}
+
+  /// @brief Records the visits of the nodes to `profiler`; `nullptr` to stop
+  /// recording.
+  /// @note `profiler` must outlive the visits.
+  void SetProfiler(VisitProfiler* profiler) noexcept {
+    profiler_ = profiler;
+  }
+  VisitProfiler* profiler()  // NOLINT(readability-identifier-naming)
+      const noexcept {
+    return profiler_;
+  }
+
+ protected:
+  /// @brief Dispatches the statements of `compound_stmt` in order, except
+  /// that a nested compound statement is entered in place, with an explicit
+  /// stack instead of recursion; so blocks can be nested arbitrarily deep.
+  /// @param enter Called with each compound statement, `compound_stmt`
+  /// included, before its statements.
+  /// @param exit Called with each compound statement after its statements.
+  template <typename Enter, typename Exit>
+  void VisitBlocks_(CondMut<CompoundStmtNode>& compound_stmt, Enter&& enter,
+                    Exit&& exit) {
+    // Each compound statement is paired with the index of its next statement.
+    auto blocks =
+        std::vector<std::pair<CondMut<CompoundStmtNode>*, std::size_t>>{};
+    enter(compound_stmt);
+    blocks.emplace_back(&compound_stmt, 0);
+    while (!blocks.empty()) {
+      auto& [block, next] = blocks.back();
+      if (next == block->stmts.size()) {
+        exit(*block);
+        // The visit of `compound_stmt` itself is recorded by `Dispatch()`.
+        if (profiler_ && block != &compound_stmt) {
+          profiler_->Exit();
+        }
+        blocks.pop_back();
+        continue;
+      }
+      auto& stmt = *block->stmts.at(next++);
+      if (auto* nested = DynCast<CompoundStmtNode>(&stmt)) {
+        if (profiler_) {
+          profiler_->Enter(AstNodeKind::kCompoundStmt);
+        }
+        enter(*nested);
+        blocks.emplace_back(nested, 0);
+      } else {
+        Dispatch(stmt);
+      }
+    }
+  }
+
+  /// @brief Visits `bin_expr` along with the chain of binary expressions in
+  /// its left operands, from the innermost one outwards, so that the depth of
+  /// the recursion doesn't grow with the length of the chain, e.g., of
+  /// `a + a + ... + a`, which nests in its left operands.
+  /// @param pre Called with each binary expression of the chain, from
+  /// `bin_expr` down to the innermost one, before the left operand of the
+  /// innermost one is dispatched.
+  /// @param post Called with each binary expression of the chain, from the
+  /// innermost one up to `bin_expr`, once its left operand is visited; the
+  /// right operand is left to it.
+  template <typename Pre, typename Post>
+  void VisitLeftChain_(CondMut<BinaryExprNode>& bin_expr, Pre&& pre,
+                       Post&& post) {
+    auto chain = std::vector<CondMut<BinaryExprNode>*>{&bin_expr};
+    while (auto* lhs = DynCast<BinaryExprNode>(chain.back()->lhs.get())) {
+      chain.push_back(lhs);
+    }
+    // The visit of `bin_expr` itself is recorded by `Dispatch()`.
+    for (auto* expr : chain) {
+      if (profiler_ && expr != &bin_expr) {
+        profiler_->Enter(AstNodeKind::kBinaryExpr);
+      }
+      pre(*expr);
+    }
+    Dispatch(*chain.back()->lhs);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+      post(**it);
+      if (profiler_ && *it != &bin_expr) {
+        profiler_->Exit();
+      }
+    }
+  }
+
+ private:
+  /// @note This is a non-owning pointer.
+  VisitProfiler* profiler_{nullptr};
+
+  void DispatchByKind_(CondMut<AstNode>& node) {
+    switch (node.kind) {
+      case AstNodeKind::kVarDecl:
+        return Visit_<VarDeclNode>(node);
+      case AstNodeKind::kArrDecl:
+        return Visit_<ArrDeclNode>(node);
+      case AstNodeKind::kRecordDecl:
+        return Visit_<RecordDeclNode>(node);
+      case AstNodeKind::kField:
+        return Visit_<FieldNode>(node);
+      case AstNodeKind::kRecordVarDecl:
+        return Visit_<RecordVarDeclNode>(node);
+      case AstNodeKind::kParam:
+        return Visit_<ParamNode>(node);
+      case AstNodeKind::kFuncDef:
+        return Visit_<FuncDefNode>(node);
+      case AstNodeKind::kDeclStmt:
+        return Visit_<DeclStmtNode>(node);
+      case AstNodeKind::kCompoundStmt:
+        return Visit_<CompoundStmtNode>(node);
+      case AstNodeKind::kIfStmt:
+        return Visit_<IfStmtNode>(node);
+      case AstNodeKind::kWhileStmt:
+        return Visit_<WhileStmtNode>(node);
+      case AstNodeKind::kForStmt:
+        return Visit_<ForStmtNode>(node);
+      case AstNodeKind::kReturnStmt:
+        return Visit_<ReturnStmtNode>(node);
+      case AstNodeKind::kGotoStmt:
+        return Visit_<GotoStmtNode>(node);
+      case AstNodeKind::kBreakStmt:
+        return Visit_<BreakStmtNode>(node);
+      case AstNodeKind::kContinueStmt:
+        return Visit_<ContinueStmtNode>(node);
+      case AstNodeKind::kSwitchStmt:
+        return Visit_<SwitchStmtNode>(node);
+      case AstNodeKind::kExprStmt:
+        return Visit_<ExprStmtNode>(node);
+      case AstNodeKind::kIdLabeledStmt:
+        return Visit_<IdLabeledStmtNode>(node);
+      case AstNodeKind::kCaseStmt:
+        return Visit_<CaseStmtNode>(node);
+      case AstNodeKind::kDefaultStmt:
+        return Visit_<DefaultStmtNode>(node);
+      case AstNodeKind::kInitExpr:
+        return Visit_<InitExprNode>(node);
+      case AstNodeKind::kNullExpr:
+        return Visit_<NullExprNode>(node);
+      case AstNodeKind::kIdExpr:
+        return Visit_<IdExprNode>(node);
+      case AstNodeKind::kIntConstExpr:
+        return Visit_<IntConstExprNode>(node);
+      case AstNodeKind::kArgExpr:
+        return Visit_<ArgExprNode>(node);
+      case AstNodeKind::kArrSubExpr:
+        return Visit_<ArrSubExprNode>(node);
+      case AstNodeKind::kCondExpr:
+        return Visit_<CondExprNode>(node);
+      case AstNodeKind::kFuncCallExpr:
+        return Visit_<FuncCallExprNode>(node);
+      case AstNodeKind::kPostfixArithExpr:
+        return Visit_<PostfixArithExprNode>(node);
+      case AstNodeKind::kRecordMemExpr:
+        return Visit_<RecordMemExprNode>(node);
+      case AstNodeKind::kUnaryExpr:
+        return Visit_<UnaryExprNode>(node);
+      case AstNodeKind::kBinaryExpr:
+        return Visit_<BinaryExprNode>(node);
+      case AstNodeKind::kSimpleAssignmentExpr:
+        return Visit_<SimpleAssignmentExprNode>(node);
+      case AstNodeKind::kArrDes:
+        return Visit_<ArrDesNode>(node);
+      case AstNodeKind::kIdDes:
+        return Visit_<IdDesNode>(node);
+      case AstNodeKind::kLoopInit:
+        return Visit_<LoopInitNode>(node);
+      case AstNodeKind::kExternDecl:
+        return Visit_<ExternDeclNode>(node);
+      case AstNodeKind::kTransUnit:
+        return Visit_<TransUnitNode>(node);
+    }
+  }
+
+  template <typename Node>
+  void Visit_(CondMut<AstNode>& node) {
+    static_cast<Derived&>(*this).Visit(Cast<Node>(node));
+  }
+};
+
+#endif  // STATIC_VISITOR_HPP_
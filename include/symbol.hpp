@@ -1,6 +1,7 @@
 #ifndef SYMBOL_HPP_
 #define SYMBOL_HPP_
 
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
@@ -35,9 +36,21 @@ class TableTemplate {
   /// @brief Probes the entry with the `id` from the table.
   /// @returns The entry with the `id` if it exists; otherwise, `nullptr`.
   std::shared_ptr<Entry> Probe(const std::string& id) const;
+  /// @brief Probes the entry with the `id` from the first `num_of_entries`
+  /// entries added to the table.
+  /// @returns The entry with the `id` if it's one of them; otherwise,
+  /// `nullptr`.
+  std::shared_ptr<Entry> ProbeFirst(const std::string& id,
+                                    std::size_t num_of_entries) const;
+
+  std::size_t NumOfEntries() const noexcept {
+    return entries_.size();
+  }
 
  private:
-  std::map<std::string, std::shared_ptr<Entry>> entries_{};
+  /// @brief Each entry with the number of entries added before it.
+  std::map<std::string, std::pair<std::shared_ptr<Entry>, std::size_t>>
+      entries_{};
 };
 
 /// @brief Stores declared symbols.
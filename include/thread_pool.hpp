@@ -0,0 +1,67 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/// @brief A fixed number of workers, each with its own task queue. An idle
+/// worker steals from the queues of the others, so that a few long tasks don't
+/// keep the rest of the workers waiting.
+class ThreadPool {
+ public:
+  /// @param num_of_workers If equals to `0`, uses the number of concurrent
+  /// threads supported by the hardware.
+  explicit ThreadPool(std::size_t num_of_workers);
+  /// @brief Finishes all submitted tasks before joining the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  /// @return A future which becomes ready once the `task` is done; the
+  /// exception thrown by the `task`, if any, is rethrown by its `get`.
+  std::future<void> Submit(std::function<void()> task);
+
+  std::size_t NumOfWorkers() const {
+    return workers_.size();
+  }
+
+ private:
+  using Task = std::packaged_task<void()>;
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_{};
+  std::vector<std::thread> workers_{};
+  /// @brief The queue that the next submitted task goes to.
+  std::atomic<std::size_t> next_queue_{0};
+
+  /// @brief Guards `num_of_pending_tasks_` and `is_stopping_`; idle workers
+  /// sleep on `has_pending_task_`.
+  /// @note It's locked before the mutex of a queue, if both are held.
+  std::mutex mutex_{};
+  std::condition_variable has_pending_task_{};
+  std::size_t num_of_pending_tasks_{0};
+  bool is_stopping_{false};
+
+  void RunWorker_(std::size_t index);
+  /// @brief Pops from the back of the worker's own queue; if empty, steals from
+  /// the front of the others.
+  std::optional<Task> PopTask_(std::size_t index);
+};
+
+#endif  // THREAD_POOL_HPP_
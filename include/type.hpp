@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -13,28 +14,63 @@
 enum class PrimitiveType : std::uint8_t {
   kUnknown = 0,  // HACK: default initialized to 0 -> unknown
   kInt,
+  kChar,
+  kShort,
+  kLong,
+  kUChar,
+  kUShort,
+  kUInt,
+  kULong,
+};
+
+/// @note `char` is signed, as it is on x86-64.
+bool IsUnsigned(PrimitiveType prim_type) noexcept;
+/// @return The integer type of `size` bytes, e.g., `unsigned short` for 2
+/// bytes and unsigned.
+PrimitiveType IntegerTypeOf(std::size_t size, bool is_unsigned) noexcept;
+/// @return The type that an operand of `prim_type` is converted to by the
+/// integer promotions; `char` and `short` are promoted to `int`.
+PrimitiveType Promote(PrimitiveType prim_type) noexcept;
+/// @return The common type of the operands of `lhs` and `rhs` under the usual
+/// arithmetic conversions.
+PrimitiveType CommonTypeOf(PrimitiveType lhs, PrimitiveType rhs) noexcept;
+
+/// @brief The concrete classes of the types.
+enum class TypeKind : std::uint8_t {
+  kPrim,
+  kPtr,
+  kArr,
+  kFunc,
+  kStruct,
+  kUnion,
 };
 
 /// @brief The abstract base class for all types.
+/// @note Use `Isa`, `Cast` and `DynCast` from "casting.hpp" to test and
+/// convert to the derived classes.
 class Type {
  public:
-  virtual bool IsPtr() const noexcept {
-    return false;
+  TypeKind kind() const noexcept {  // NOLINT(readability-identifier-naming)
+    return kind_;
   }
-  virtual bool IsPrim() const noexcept {
-    return false;
+
+  bool IsPtr() const noexcept {
+    return kind_ == TypeKind::kPtr;
   }
-  virtual bool IsArr() const noexcept {
-    return false;
+  bool IsPrim() const noexcept {
+    return kind_ == TypeKind::kPrim;
   }
-  virtual bool IsFunc() const noexcept {
-    return false;
+  bool IsArr() const noexcept {
+    return kind_ == TypeKind::kArr;
   }
-  virtual bool IsStruct() const noexcept {
-    return false;
+  bool IsFunc() const noexcept {
+    return kind_ == TypeKind::kFunc;
   }
-  virtual bool IsUnion() const noexcept {
-    return false;
+  bool IsStruct() const noexcept {
+    return kind_ == TypeKind::kStruct;
+  }
+  bool IsUnion() const noexcept {
+    return kind_ == TypeKind::kUnion;
   }
 
   virtual bool IsEqual(const Type& that) const noexcept = 0;
@@ -49,11 +85,15 @@ class Type {
 
   virtual std::size_t size()  // NOLINT(readability-identifier-naming)
       const = 0;
+  /// @return The alignment of an object of the type in bytes, which follows
+  /// the x86-64 System V ABI.
+  virtual std::size_t alignment()  // NOLINT(readability-identifier-naming)
+      const = 0;
   virtual std::string ToString() const = 0;
   virtual std::unique_ptr<Type> Clone() const = 0;
 
   virtual ~Type() = default;
-  Type() = default;
+  explicit Type(TypeKind kind) : kind_{kind} {}
 
   // Delete copy/move operations to avoid slicing.
 
@@ -63,6 +103,8 @@ class Type {
   Type& operator=(Type&&) = delete;
 
  private:
+  TypeKind kind_;
+
   /// @note By default, types are only convertible to themselves. Derived types
   /// should override this hook to provide additional compatibility rules.
   virtual bool ConvertibleHook_(const Type& that) const noexcept {
@@ -74,37 +116,55 @@ class Type {
 class PrimType : public Type {
  public:
   /// @note Implicit conversion is intentional.
-  PrimType(PrimitiveType prim_type) : prim_type_{prim_type} {}
+  PrimType(PrimitiveType prim_type)
+      : Type{TypeKind::kPrim}, prim_type_{prim_type} {}
+
+  static bool ClassOf(const Type& type) noexcept {
+    return type.kind() == TypeKind::kPrim;
+  }
+
+  PrimitiveType prim_type()  // NOLINT(readability-identifier-naming)
+      const noexcept {
+    return prim_type_;
+  }
 
-  bool IsPrim() const noexcept override {
-    return true;
+  bool IsInteger() const noexcept {
+    return prim_type_ != PrimitiveType::kUnknown;
+  }
+  bool IsUnsigned() const noexcept {
+    return ::IsUnsigned(prim_type_);
   }
 
   bool IsEqual(const Type& that) const noexcept override;
   std::size_t size() const override;
+  std::size_t alignment() const override;
   std::string ToString() const override;
   std::unique_ptr<Type> Clone() const override;
 
  private:
   PrimitiveType prim_type_;
+
+  /// @note Integer types are implicitly converted to each other.
+  bool ConvertibleHook_(const Type& that) const noexcept override;
 };
 
 class PtrType : public Type {
  public:
   explicit PtrType(std::unique_ptr<Type> base_type)
-      : base_type_{std::move(base_type)} {}
+      : Type{TypeKind::kPtr}, base_type_{std::move(base_type)} {}
+
+  static bool ClassOf(const Type& type) noexcept {
+    return type.kind() == TypeKind::kPtr;
+  }
 
   const Type& base_type()  // NOLINT(readability-identifier-naming)
       const noexcept {
     return *base_type_;
   }
 
-  bool IsPtr() const noexcept override {
-    return true;
-  }
-
   bool IsEqual(const Type& that) const noexcept override;
   std::size_t size() const override;
+  std::size_t alignment() const override;
   std::string ToString() const override;
   std::unique_ptr<Type> Clone() const override;
 
@@ -116,19 +176,22 @@ class ArrType : public Type {
  public:
   /// @param element_type The type of a single element in the array.
   explicit ArrType(std::unique_ptr<Type> element_type, std::size_t len)
-      : element_type_{std::move(element_type)}, len_{len} {}
+      : Type{TypeKind::kArr},
+        element_type_{std::move(element_type)},
+        len_{len} {}
+
+  static bool ClassOf(const Type& type) noexcept {
+    return type.kind() == TypeKind::kArr;
+  }
 
   const Type& element_type()  // NOLINT(readability-identifier-naming)
       const noexcept {
     return *element_type_;
   }
 
-  bool IsArr() const noexcept override {
-    return true;
-  }
-
   bool IsEqual(const Type& that) const noexcept override;
   std::size_t size() const override;
+  std::size_t alignment() const override;
   std::string ToString() const override;
   std::unique_ptr<Type> Clone() const override;
 
@@ -143,9 +206,14 @@ class FuncType : public Type {
  public:
   FuncType(std::unique_ptr<Type> return_type,
            std::vector<std::unique_ptr<Type>> param_types)
-      : return_type_{std::move(return_type)},
+      : Type{TypeKind::kFunc},
+        return_type_{std::move(return_type)},
         param_types_{std::move(param_types)} {}
 
+  static bool ClassOf(const Type& type) noexcept {
+    return type.kind() == TypeKind::kFunc;
+  }
+
   const Type& return_type()  // NOLINT(readability-identifier-naming)
       const noexcept {
     return *return_type_;
@@ -158,12 +226,9 @@ class FuncType : public Type {
     return param_types_;
   }
 
-  bool IsFunc() const noexcept override {
-    return true;
-  }
-
   bool IsEqual(const Type& that) const noexcept override;
   std::size_t size() const override;
+  std::size_t alignment() const override;
   std::string ToString() const override;
   std::unique_ptr<Type> Clone() const override;
 
@@ -183,8 +248,32 @@ struct Field {
       : id{std::move(id)}, type{std::move(type)} {}
 };
 
+/// @brief Where the members of a record are placed, under the x86-64 System V
+/// ABI: each member is aligned to its own alignment, and the record is padded
+/// to a multiple of the largest one.
+/// @note Computed once when the record type is constructed, and shared by its
+/// clones, so that accessing a member doesn't depend on the number of members.
+struct RecordLayout {
+  /// @brief The offsets of the members in the order of declaration.
+  std::vector<std::size_t> offsets;
+  std::size_t size;
+  std::size_t alignment;
+  /// @brief Maps the id of a member to its index in the order of declaration.
+  std::unordered_map<std::string, std::size_t> indices;
+
+  /// @param is_union Whether every member is placed at offset 0.
+  RecordLayout(const std::vector<std::unique_ptr<Field>>& fields,
+               bool is_union);
+};
+
 class RecordType : public Type {
  public:
+  using Type::Type;
+
+  static bool ClassOf(const Type& type) noexcept {
+    return type.kind() == TypeKind::kStruct || type.kind() == TypeKind::kUnion;
+  }
+
   /// @return The type id.
   virtual std::string id()  // NOLINT(readability-identifier-naming)
       const noexcept = 0;
@@ -192,8 +281,7 @@ class RecordType : public Type {
   virtual bool IsMember(const std::string& id) const noexcept = 0;
   /// @return The type of a member in struct or union. The unknown type if the
   /// `id` is not a member of the record type.
-  virtual std::unique_ptr<Type> MemberType(
-      const std::string& id) const noexcept = 0;
+  virtual const Type& MemberType(const std::string& id) const noexcept = 0;
   /// @note Every member in union shares the same offset 0.
   /// @return The type offset in the record based on `id`.
   /// @throw `std::runtime_error` if the `id` is not a member of the record.
@@ -205,6 +293,10 @@ class RecordType : public Type {
   /// @return The total number of members a record can hold.
   /// @note For union type, there's at most one slot.
   virtual std::size_t SlotCount() const noexcept = 0;
+  /// @return The members in the order of declaration.
+  virtual const std::vector<std::unique_ptr<Field>>&
+  fields()  // NOLINT(readability-identifier-naming)
+      const noexcept = 0;
 };
 
 class StructType : public RecordType {
@@ -212,28 +304,48 @@ class StructType : public RecordType {
   /// @param id The identifier of the struct type. May be empty ("") for unnamed
   /// structs.
   StructType(std::string id, std::vector<std::unique_ptr<Field>> fields)
-      : id_{std::move(id)}, fields_{std::move(fields)} {}
+      : RecordType{TypeKind::kStruct},
+        id_{std::move(id)},
+        fields_{std::make_shared<const std::vector<std::unique_ptr<Field>>>(
+            std::move(fields))},
+        layout_{std::make_shared<const RecordLayout>(*fields_,
+                                                     /* is_union */ false)} {}
+
+  /// @param fields The members, which are never modified once the type is
+  /// constructed, so that they're shared with the type that they're declared
+  /// for, as is their `layout`; used to clone the type.
+  StructType(std::string id,
+             std::shared_ptr<const std::vector<std::unique_ptr<Field>>> fields,
+             std::shared_ptr<const RecordLayout> layout)
+      : RecordType{TypeKind::kStruct},
+        id_{std::move(id)},
+        fields_{std::move(fields)},
+        layout_{std::move(layout)} {}
+
+  static bool ClassOf(const Type& type) noexcept {
+    return type.kind() == TypeKind::kStruct;
+  }
 
   std::string id() const noexcept override;
   bool IsMember(const std::string& id) const noexcept override;
-  std::unique_ptr<Type> MemberType(
-      const std::string& id) const noexcept override;
+  const Type& MemberType(const std::string& id) const noexcept override;
   std::size_t OffsetOf(const std::string& id) const override;
   std::size_t OffsetOf(std::size_t index) const override;
   std::size_t SlotCount() const noexcept override;
-
-  bool IsStruct() const noexcept override {
-    return true;
+  const std::vector<std::unique_ptr<Field>>& fields() const noexcept override {
+    return *fields_;
   }
 
   bool IsEqual(const Type& that) const noexcept override;
   std::size_t size() const override;
+  std::size_t alignment() const override;
   std::string ToString() const override;
   std::unique_ptr<Type> Clone() const override;
 
  private:
   std::string id_;
-  std::vector<std::unique_ptr<Field>> fields_;
+  std::shared_ptr<const std::vector<std::unique_ptr<Field>>> fields_;
+  std::shared_ptr<const RecordLayout> layout_;
 };
 
 class UnionType : public RecordType {
@@ -241,28 +353,48 @@ class UnionType : public RecordType {
   /// @param id The identifier of the union type. May be empty ("") for unnamed
   /// unions.
   UnionType(std::string id, std::vector<std::unique_ptr<Field>> fields)
-      : id_{std::move(id)}, fields_{std::move(fields)} {}
+      : RecordType{TypeKind::kUnion},
+        id_{std::move(id)},
+        fields_{std::make_shared<const std::vector<std::unique_ptr<Field>>>(
+            std::move(fields))},
+        layout_{std::make_shared<const RecordLayout>(*fields_,
+                                                     /* is_union */ true)} {}
+
+  /// @param fields The members, which are never modified once the type is
+  /// constructed, so that they're shared with the type that they're declared
+  /// for, as is their `layout`; used to clone the type.
+  UnionType(std::string id,
+            std::shared_ptr<const std::vector<std::unique_ptr<Field>>> fields,
+            std::shared_ptr<const RecordLayout> layout)
+      : RecordType{TypeKind::kUnion},
+        id_{std::move(id)},
+        fields_{std::move(fields)},
+        layout_{std::move(layout)} {}
+
+  static bool ClassOf(const Type& type) noexcept {
+    return type.kind() == TypeKind::kUnion;
+  }
 
   std::string id() const noexcept override;
   bool IsMember(const std::string& id) const noexcept override;
-  std::unique_ptr<Type> MemberType(
-      const std::string& id) const noexcept override;
+  const Type& MemberType(const std::string& id) const noexcept override;
   std::size_t OffsetOf(const std::string& id) const override;
   std::size_t OffsetOf(std::size_t index) const override;
   std::size_t SlotCount() const noexcept override;
-
-  bool IsUnion() const noexcept override {
-    return true;
+  const std::vector<std::unique_ptr<Field>>& fields() const noexcept override {
+    return *fields_;
   }
 
   bool IsEqual(const Type& that) const noexcept override;
   std::size_t size() const override;
+  std::size_t alignment() const override;
   std::string ToString() const override;
   std::unique_ptr<Type> Clone() const override;
 
  private:
   std::string id_;
-  std::vector<std::unique_ptr<Field>> fields_;
+  std::shared_ptr<const std::vector<std::unique_ptr<Field>>> fields_;
+  std::shared_ptr<const RecordLayout> layout_;
 };
 
 #endif  // TYPE_HPP_
@@ -1,60 +1,112 @@
 #ifndef TYPE_CHECKER_HPP_
 #define TYPE_CHECKER_HPP_
 
+#include <cstddef>
+#include <memory>
+
 #include "ast.hpp"
+#include "incremental_store.hpp"
 #include "scope.hpp"
-#include "visitor.hpp"
+#include "static_visitor.hpp"
+#include "thread_pool.hpp"
 
 /// @brief A modifying pass; resolves the type of expressions.
-class TypeChecker : public ModifyingVisitor {
+class TypeChecker
+    : public StaticVisitor<TypeChecker, /* is_modifying */ true> {
  public:
-  TypeChecker(ScopeStack& env) : env_{env} {}
-
-  void Visit(DeclStmtNode&) override;
-  void Visit(LoopInitNode&) override;
-  void Visit(VarDeclNode&) override;
-  void Visit(ArrDeclNode&) override;
-  void Visit(RecordDeclNode&) override;
-  void Visit(FieldNode&) override;
-  void Visit(RecordVarDeclNode&) override;
-  void Visit(ParamNode&) override;
-  void Visit(FuncDefNode&) override;
-  void Visit(CompoundStmtNode&) override;
-  void Visit(ExternDeclNode&) override;
-  void Visit(TransUnitNode&) override;
-  void Visit(IfStmtNode&) override;
-  void Visit(WhileStmtNode&) override;
-  void Visit(ForStmtNode&) override;
-  void Visit(ReturnStmtNode&) override;
-  void Visit(GotoStmtNode&) override;
-  void Visit(BreakStmtNode&) override;
-  void Visit(ContinueStmtNode&) override;
-  void Visit(SwitchStmtNode&) override;
-  void Visit(IdLabeledStmtNode&) override;
-  void Visit(CaseStmtNode&) override;
-  void Visit(DefaultStmtNode&) override;
-  void Visit(ExprStmtNode&) override;
-  void Visit(InitExprNode&) override;
-  void Visit(ArrDesNode&) override;
-  void Visit(IdDesNode&) override;
-  void Visit(NullExprNode&) override;
-  void Visit(IdExprNode&) override;
-  void Visit(IntConstExprNode&) override;
-  void Visit(ArgExprNode&) override;
-  void Visit(ArrSubExprNode&) override;
-  void Visit(CondExprNode&) override;
-  void Visit(FuncCallExprNode&) override;
-  void Visit(PostfixArithExprNode&) override;
-  void Visit(RecordMemExprNode&) override;
-  void Visit(UnaryExprNode&) override;
-  void Visit(BinaryExprNode&) override;
-  void Visit(SimpleAssignmentExprNode&) override;
+  using StaticVisitor::Visit;
+
+  /// @param thread_pool If provided, the function bodies of a translation unit
+  /// are checked in parallel with it.
+  /// @param store If provided, the bodies of the functions whose IR is reused
+  /// from the store are not checked.
+  TypeChecker(ScopeStack& env, ThreadPool* thread_pool = nullptr,
+              const IncrementalStore* store = nullptr);
+  ~TypeChecker();
+
+  void Visit(DeclStmtNode&);
+  void Visit(LoopInitNode&);
+  void Visit(VarDeclNode&);
+  void Visit(ArrDeclNode&);
+  void Visit(RecordDeclNode&);
+  void Visit(FieldNode&);
+  void Visit(RecordVarDeclNode&);
+  void Visit(ParamNode&);
+  void Visit(FuncDefNode&);
+  void Visit(CompoundStmtNode&);
+  void Visit(ExternDeclNode&);
+  void Visit(TransUnitNode&);
+  void Visit(IfStmtNode&);
+  void Visit(WhileStmtNode&);
+  void Visit(ForStmtNode&);
+  void Visit(ReturnStmtNode&);
+  void Visit(GotoStmtNode&);
+  void Visit(BreakStmtNode&);
+  void Visit(ContinueStmtNode&);
+  void Visit(SwitchStmtNode&);
+  void Visit(IdLabeledStmtNode&);
+  void Visit(CaseStmtNode&);
+  void Visit(DefaultStmtNode&);
+  void Visit(ExprStmtNode&);
+  void Visit(InitExprNode&);
+  void Visit(ArrDesNode&);
+  void Visit(IdDesNode&);
+  void Visit(NullExprNode&);
+  void Visit(IdExprNode&);
+  void Visit(IntConstExprNode&);
+  void Visit(ArgExprNode&);
+  void Visit(ArrSubExprNode&);
+  void Visit(CondExprNode&);
+  void Visit(FuncCallExprNode&);
+  void Visit(PostfixArithExprNode&);
+  void Visit(RecordMemExprNode&);
+  void Visit(UnaryExprNode&);
+  void Visit(BinaryExprNode&);
+  void Visit(SimpleAssignmentExprNode&);
+
+  /// @brief Opens the file scope with the built-in functions installed, so that
+  /// the top-level declarations can be checked one at a time while parsing.
+  /// @note Visiting a `TransUnitNode` opens and closes the file scope by
+  /// itself.
+  void EnterFileScope();
+  void ExitFileScope();
 
  private:
   ScopeStack& env_;
+  /// @note This is a non-owning pointer.
+  ThreadPool* thread_pool_;
+  /// @note This is a non-owning pointer.
+  const IncrementalStore* store_;
+
+  struct FuncContext;
+  /// @brief The states of the function body that is being checked, e.g., the
+  /// labels; `nullptr` in between the bodies.
+  std::unique_ptr<FuncContext> ctx_{};
+
+  /// @return Whether the top-level declaration at `index` needs no checking of
+  /// its body.
+  bool IsReused_(std::size_t index) const;
 
   /// @brief Installs the built-in functions into the environment.
   void InstallBuiltins_(ScopeStack&);
+
+  /// @brief Replaces a record type that is only referred to by its tag, e.g.,
+  /// `struct birth`, with the complete type declared with the tag, as well as
+  /// such a record type of the elements of an array. Other types are left as
+  /// is.
+  void ResolveRecordType_(std::unique_ptr<Type>& type) const;
+
+  /// @brief Decays the parameter types and adds the function to the file
+  /// scope; the body is left unchecked.
+  void DeclareFunc_(FuncDefNode&);
+  /// @brief Checks the parameters and the body of a declared function.
+  void CheckFuncBody_(FuncDefNode&);
+  /// @brief Checks the file-scope declarations in order, then the function
+  /// bodies in parallel.
+  void CheckInParallel_(TransUnitNode&);
+  /// @brief Checks the right operand of `bin_expr` and resolves its type; the
+  /// left operand is already checked.
+  void CheckBinaryExpr_(BinaryExprNode& bin_expr);
 };
 
 #endif  // TYPE_CHECKER_HPP_
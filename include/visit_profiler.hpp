@@ -0,0 +1,73 @@
+#ifndef VISIT_PROFILER_HPP_
+#define VISIT_PROFILER_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+
+/// @brief Records, for each kind of node, how many nodes a pass visits, and
+/// the time spent and the bytes of IR emitted while visiting them; so that the
+/// constructs that are expensive to compile can be told.
+/// @note The inclusive figures of a node count its descendants in; the
+/// exclusive ones don't. A node nested in another node of the same kind is only
+/// counted in the inclusive figures of the outermost one.
+/// @note Visits may be recorded from multiple threads at once.
+class VisitProfiler {
+ public:
+  /// @param pass The name of the profiled pass, e.g., "type checking".
+  explicit VisitProfiler(std::string pass) : pass_{std::move(pass)} {}
+
+  /// @brief Marks the start of the visit of a node of `kind` on the current
+  /// thread; the visits of the current thread have to be properly nested.
+  void Enter(AstNodeKind kind);
+  /// @brief Marks the end of the visit that is last entered on the current
+  /// thread.
+  void Exit();
+  /// @brief Counts the `size` bytes of IR emitted by the current thread towards
+  /// the visits it's in.
+  static void CountBytes(std::size_t size) noexcept;
+
+  /// @brief Writes the figures of the kinds visited as a table, sorted by the
+  /// exclusive time.
+  void WriteTable(std::ostream& output) const;
+  /// @brief Writes the figures of the kinds visited as a JSON object, sorted
+  /// by the exclusive time.
+  void WriteJson(std::ostream& output) const;
+
+ private:
+  static constexpr auto kNumOfKinds =
+      static_cast<std::size_t>(AstNodeKind::kTransUnit) + 1;
+
+  struct Stats {
+    std::atomic<std::uint64_t> num_of_visits{0};
+    std::atomic<std::uint64_t> inclusive_ns{0};
+    std::atomic<std::uint64_t> exclusive_ns{0};
+    std::atomic<std::uint64_t> inclusive_bytes{0};
+    std::atomic<std::uint64_t> exclusive_bytes{0};
+  };
+
+  /// @brief The figures of a kind, read out of `Stats`.
+  struct Row {
+    AstNodeKind kind;
+    std::uint64_t num_of_visits;
+    std::uint64_t inclusive_ns;
+    std::uint64_t exclusive_ns;
+    std::uint64_t inclusive_bytes;
+    std::uint64_t exclusive_bytes;
+  };
+
+  std::string pass_;
+  std::array<Stats, kNumOfKinds> stats_{};
+
+  /// @return The figures of the kinds visited, sorted by the exclusive time.
+  std::vector<Row> SortedRows_() const;
+};
+
+#endif  // VISIT_PROFILER_HPP_
@@ -58,6 +58,8 @@ struct SimpleAssignmentExprNode;
 /// @note This is an abstract class.
 /// @note For concrete Visitors, define `Visit()` on the classes that you care
 /// about, others will do nothing by default.
+/// @note The passes of the compiler use `StaticVisitor` instead, which avoids
+/// the virtual calls.
 template <bool is_modifying = false>
 class Visitor {
  public:
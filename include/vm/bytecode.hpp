@@ -0,0 +1,153 @@
+#ifndef VM_BYTECODE_HPP_
+#define VM_BYTECODE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "x86/mir.hpp"
+
+// The bytecode of the interpreter of `--run`. It's assembled from the machine
+// IR of the x86-64 backend, so that a program runs as it does when compiled,
+// without the register allocation and the writing of the assembly.
+//
+// Every operand is a register of the frame; the immediates of a function are
+// placed in the registers after its virtual registers, which are initialized
+// on each call. A register holds 64 bits; the result of an operation on words
+// is zero-extended, as a 32-bit operation on x86-64 does.
+
+namespace vm {
+
+/// @brief The operations, in the order of their handlers. The suffix is the
+/// width of the operands: `W` for a word and `L` for a long; or the size of a
+/// memory access: `B` for a byte, `H` for a half word, `W` for a word and `L`
+/// for a long, signed (`S`) or unsigned (`U`).
+/// @note This is an X macro, which is expanded for the enumerators and for the
+/// handlers of the interpreter.
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define VITAMINC_VM_OPS(X)                                                  \
+  /* `a = b` */                                                             \
+  X(CopyW) X(CopyL)                                                         \
+  /* `a = b op c` */                                                        \
+  X(AddW) X(AddL) X(SubW) X(SubL) X(MulW) X(MulL) X(DivW) X(DivL)          \
+  X(UDivW) X(UDivL) X(RemW) X(RemL) X(URemW) X(URemL) X(AndW) X(AndL)     \
+  X(OrW) X(OrL) X(XorW) X(XorL) X(ShlW) X(ShlL) X(SarW) X(SarL) X(ShrW)    \
+  X(ShrL)                                                                   \
+  /* `a = op b` */                                                          \
+  X(NegW) X(NegL) X(NotW) X(NotL)                                           \
+  /* `a = b cond c`, which is 1 or 0 */                                     \
+  X(EqW) X(EqL) X(NeW) X(NeL) X(LtW) X(LtL) X(LeW) X(LeL) X(GtW) X(GtL)    \
+  X(GeW) X(GeL) X(BelowW) X(BelowL) X(BelowEqW) X(BelowEqL) X(AboveW)      \
+  X(AboveL) X(AboveEqW) X(AboveEqL)                                         \
+  /* `a = ext b` */                                                         \
+  X(ExtSW) X(ExtUW) X(ExtSH) X(ExtUH) X(ExtSB) X(ExtUB)                     \
+  /* `a = the bytes at b + imm` */                                          \
+  X(LoadSB) X(LoadUB) X(LoadSH) X(LoadUH) X(LoadW) X(LoadL)                 \
+  /* `the bytes at b + imm = a` */                                          \
+  X(StoreB) X(StoreH) X(StoreW) X(StoreL)                                   \
+  /* `a = b + imm` */                                                       \
+  X(Lea)                                                                    \
+  /* `a = &functions[imm]` */                                               \
+  X(FuncAddr)                                                               \
+  /* `c bytes at a + imm = c bytes at b` */                                 \
+  X(Blit)                                                                   \
+  /* `a = calls[b](...)` */                                                 \
+  X(Call)                                                                   \
+  /* Jumps to `b`. */                                                       \
+  X(Jmp)                                                                    \
+  /* Jumps to `b` if `a` is non-zero; to `c` otherwise. */                  \
+  X(JnzW) X(JnzL)                                                           \
+  /* Returns `a`. */                                                        \
+  X(RetW) X(RetL)                                                           \
+  /* Returns the record of `c` bytes at `b + imm`. */                       \
+  X(RetRecord)
+
+enum class Op : std::uint8_t {
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define VITAMINC_VM_ENUMERATOR(op) k##op,
+  VITAMINC_VM_OPS(VITAMINC_VM_ENUMERATOR)
+#undef VITAMINC_VM_ENUMERATOR
+      kNumOfOps,
+};
+
+/// @brief A register of the frame.
+using Reg = std::uint32_t;
+
+/// @brief The register that holds the address of the memory of the frame, in
+/// which the stack slots are placed.
+constexpr auto kFrameReg = Reg{0};
+
+/// @brief See `VITAMINC_VM_OPS` for the meaning of the fields of each
+/// operation. A jump target is the index of an instruction in the code of the
+/// program.
+struct Instr {
+  Op op;
+  Reg a = 0;
+  Reg b = 0;
+  Reg c = 0;
+  /// @brief The offset of a memory access, or the index of a function.
+  std::int64_t imm = 0;
+};
+
+/// @brief The functions that are run by the interpreter itself rather than
+/// from the bytecode: the runtime library that the builtins are lowered to.
+enum class Native : std::uint8_t {
+  kNone,
+  /// @brief `__vitaminc_print_int`
+  kPrintInt,
+  /// @brief `__vitaminc_flush`
+  kFlush,
+};
+
+/// @brief A parameter, whose argument is stored to the frame at `offset` on
+/// entry; a record is copied from the address that is passed.
+struct Param {
+  std::size_t size;
+  bool is_record;
+  std::int64_t offset;
+};
+
+struct Function {
+  std::string name;
+  Native native = Native::kNone;
+  /// @brief The index of the first instruction in the code of the program.
+  std::size_t entry = 0;
+  /// @brief The number of registers, the immediates included.
+  Reg num_of_regs = 0;
+  /// @brief The values of the last registers, which are copied to them on
+  /// each call.
+  std::vector<std::uint64_t> imms{};
+  /// @brief The size of the memory of the frame, a multiple of 16.
+  std::size_t frame_size = 0;
+  std::vector<Param> params{};
+};
+
+struct Call {
+  /// @brief The index of the function called directly; `kIndirect` if it's
+  /// called through `callee`, which holds the address of the function.
+  std::size_t func;
+  Reg callee = 0;
+  std::vector<Reg> args{};
+  /// @brief The offset in the frame of the caller that the returned record is
+  /// copied to.
+  std::int64_t ret_offset = 0;
+
+  static constexpr auto kIndirect = static_cast<std::size_t>(-1);
+};
+
+struct Program {
+  std::vector<Instr> code{};
+  std::vector<Function> functions{};
+  std::vector<Call> calls{};
+  /// @brief The index of `main`.
+  std::size_t main = 0;
+};
+
+/// @brief Assembles the functions lowered by `X86AsmGenerator` into a program.
+/// @throws `std::runtime_error` if `main` or a called function isn't defined.
+Program Assemble(const std::vector<x86::Function>& functions);
+
+}  // namespace vm
+
+#endif  // VM_BYTECODE_HPP_
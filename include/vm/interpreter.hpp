@@ -0,0 +1,19 @@
+#ifndef VM_INTERPRETER_HPP_
+#define VM_INTERPRETER_HPP_
+
+#include "vm/bytecode.hpp"
+
+namespace vm {
+
+/// @brief Runs `main` of `program` until it returns. The output of the
+/// builtins is buffered and written to the standard output, as the runtime
+/// library does.
+/// @return The value returned from `main`.
+/// @throws `std::runtime_error` if the stack of the interpreter overflows.
+/// @note The instructions are dispatched by computed goto, each to the address
+/// of the handler of the next one, which is threaded into the code beforehand.
+int Execute(const Program& program);
+
+}  // namespace vm
+
+#endif  // VM_INTERPRETER_HPP_
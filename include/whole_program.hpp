@@ -0,0 +1,56 @@
+#ifndef WHOLE_PROGRAM_HPP_
+#define WHOLE_PROGRAM_HPP_
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+#include "profile.hpp"
+
+/// @brief Links the translation units of several files into one, in order, so
+/// that a function declared in one file resolves to its definition in another.
+/// @param trans_units The root nodes of the files, each a `TransUnitNode`.
+/// @param paths The files that the translation units are parsed from, in the
+/// same order.
+/// @throws `std::runtime_error` if a function is defined in more than one
+/// file.
+std::unique_ptr<TransUnitNode> LinkTransUnits(
+    std::vector<std::unique_ptr<AstNode>> trans_units,
+    const std::vector<std::filesystem::path>& paths);
+
+/// @brief A modifying pass on the type-checked translation unit of a whole
+/// program. Since every call of a function is known, the functions are
+/// optimized across their calls, in order:
+/// 1. A parameter that every call passes the same integer constant is replaced
+/// with the constant, and is removed along with the arguments.
+/// 2. A call of a function whose body only returns an expression of its
+/// parameters is replaced with the expression, with the arguments in place of
+/// the parameters.
+/// 3. The functions that `main` can't reach are removed.
+/// @note The types of the nodes are kept up to date, so that the tree can be
+/// generated as is.
+class InterproceduralOptimizer {
+ public:
+  /// @param profile If provided, the calls in the functions that it never
+  /// enters aren't inlined, which only grows the code that doesn't run.
+  /// @note `profile` must outlive the optimization.
+  explicit InterproceduralOptimizer(const Profile* profile = nullptr)
+      : profile_{profile} {}
+
+  void Optimize(TransUnitNode& trans_unit);
+
+ private:
+  /// @note This is a non-owning pointer.
+  const Profile* profile_;
+  /// @brief The defined functions by their names.
+  std::unordered_map<std::string, FuncDefNode*> funcs_{};
+
+  void PropagateConstArgs_(TransUnitNode& trans_unit);
+  void InlineCalls_(TransUnitNode& trans_unit);
+  void RemoveDeadFuncs_(TransUnitNode& trans_unit);
+};
+
+#endif  // WHOLE_PROGRAM_HPP_
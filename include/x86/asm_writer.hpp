@@ -0,0 +1,22 @@
+#ifndef X86_ASM_WRITER_HPP_
+#define X86_ASM_WRITER_HPP_
+
+#include <iosfwd>
+
+#include "x86/linear_scan.hpp"
+#include "x86/mir.hpp"
+
+namespace x86 {
+
+/// @brief Writes `function` as x86-64 assembly in the AT&T syntax, following
+/// the System V ABI. The frame is addressed by %rbp and holds the slots, the
+/// spilled virtual registers and the callee-saved registers in use; the
+/// records of up to 16 bytes are passed and returned in registers, the larger
+/// ones in memory.
+/// @param allocation The locations of the virtual registers of `function`.
+void WriteAsm(const Function& function, const Allocation& allocation,
+              std::ostream& output);
+
+}  // namespace x86
+
+#endif  // X86_ASM_WRITER_HPP_
@@ -0,0 +1,39 @@
+#ifndef X86_LINEAR_SCAN_HPP_
+#define X86_LINEAR_SCAN_HPP_
+
+#include <vector>
+
+#include "x86/mir.hpp"
+#include "x86/register.hpp"
+
+namespace x86 {
+
+/// @brief Where a virtual register lives: in a register or in a spill slot.
+struct Location {
+  bool is_spilled = false;
+  Reg reg = Reg::kRax;
+  /// @brief The index of the spill slot in the function.
+  int slot = -1;
+};
+
+struct Allocation {
+  /// @brief The location of each virtual register, by number.
+  std::vector<Location> locations{};
+  /// @brief The callee-saved registers that are assigned, which the function
+  /// has to preserve.
+  std::vector<Reg> used_callee_saved_regs{};
+};
+
+/// @brief Assigns a register or a spill slot to each virtual register of
+/// `function` with the linear scan of Poletto and Sarkar: the live range of
+/// each virtual register, from the liveness of the blocks, is widened to a
+/// single interval, and the intervals are scanned by their starts, spilling
+/// the one that ends last when the registers run out.
+/// @note The spill slots are added to the slots of `function`. The values that
+/// live across a call only get callee-saved registers, so nothing has to be
+/// saved around the calls.
+Allocation AllocateRegisters(Function& function);
+
+}  // namespace x86
+
+#endif  // X86_LINEAR_SCAN_HPP_
@@ -0,0 +1,287 @@
+#ifndef X86_MIR_HPP_
+#define X86_MIR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The machine IR of the x86-64 backend. It's a linear list of three-address
+// instructions over an unbounded number of virtual registers, much like the
+// QBE IR that the other backend writes, except that it's kept in memory and
+// handed to the register allocator and the assembly writer directly.
+
+namespace x86 {
+
+/// @brief The width of a value in a register. As in QBE, the integers narrower
+/// than a word are kept extended to a word.
+enum class Width : std::uint8_t {
+  kWord,
+  kLong,
+};
+
+/// @brief A virtual register; they are numbered from 0 within a function.
+using VReg = int;
+constexpr auto kNoVReg = VReg{-1};
+
+/// @brief A label; they are numbered from 0 within a function.
+using Label = int;
+
+struct Operand {
+  enum class Kind : std::uint8_t {
+    kNone,
+    kVReg,
+    kImm,
+  };
+
+  Kind kind = Kind::kNone;
+  /// @brief The number of the virtual register, or the value of the immediate.
+  std::int64_t val = 0;
+
+  static Operand OfVReg(VReg vreg) {
+    return {Kind::kVReg, vreg};
+  }
+  static Operand OfImm(std::int64_t imm) {
+    return {Kind::kImm, imm};
+  }
+
+  bool IsVReg() const noexcept {
+    return kind == Kind::kVReg;
+  }
+  bool IsImm() const noexcept {
+    return kind == Kind::kImm;
+  }
+  VReg vreg() const noexcept {  // NOLINT(readability-identifier-naming)
+    return static_cast<VReg>(val);
+  }
+};
+
+/// @brief A memory location: a stack slot or the address held by a virtual
+/// register, displaced by an offset.
+struct Mem {
+  enum class Base : std::uint8_t {
+    kSlot,
+    kVReg,
+  };
+
+  Base base = Base::kSlot;
+  /// @brief The index of the slot, or the number of the virtual register.
+  int id = 0;
+  std::int64_t offset = 0;
+
+  static Mem OfSlot(int slot, std::int64_t offset = 0) {
+    return {Base::kSlot, slot, offset};
+  }
+  static Mem OfVReg(VReg vreg, std::int64_t offset = 0) {
+    return {Base::kVReg, vreg, offset};
+  }
+};
+
+enum class Opcode : std::uint8_t {
+  /// @brief `dst = lhs`
+  kCopy,
+  /// @brief `dst = lhs op rhs`
+  kAdd,
+  kSub,
+  kMul,
+  kDiv,
+  kUDiv,
+  kRem,
+  kURem,
+  kAnd,
+  kOr,
+  kXor,
+  kShl,
+  kSar,
+  kShr,
+  /// @brief `dst = op lhs`
+  kNeg,
+  kNot,
+  /// @brief `dst = lhs cond rhs`, which is 1 or 0.
+  kCmp,
+  /// @brief `dst = ext lhs`
+  kExt,
+  /// @brief `dst = size bytes at mem`, extended by `is_signed`.
+  kLoad,
+  /// @brief `size bytes at mem = lhs`
+  kStore,
+  /// @brief `dst = &mem`
+  kLea,
+  /// @brief `dst = &symbols[index]`
+  kFuncAddr,
+  /// @brief `size bytes at mem = size bytes at src_mem`
+  kBlit,
+  /// @brief `dst = calls[index](...)`; see `Call`.
+  kCall,
+  /// @brief Defines `label`.
+  kLabel,
+  /// @brief Jumps to `label`.
+  kJmp,
+  /// @brief Jumps to `label` if `lhs` is non-zero; to `else_label` otherwise.
+  kJnz,
+  /// @brief Returns `lhs`, if any.
+  kRet,
+  /// @brief Returns the record of `size` bytes at `mem`.
+  kRetRecord,
+};
+
+enum class Cond : std::uint8_t {
+  kEq,
+  kNe,
+  kLt,
+  kLe,
+  kGt,
+  kGe,
+  /// @brief The unsigned comparisons.
+  kBelow,
+  kBelowEq,
+  kAbove,
+  kAboveEq,
+};
+
+enum class Ext : std::uint8_t {
+  kSignedWord,
+  kUnsignedWord,
+  kSignedHalf,
+  kUnsignedHalf,
+  kSignedByte,
+  kUnsignedByte,
+};
+
+struct Instr {
+  Opcode op;
+  Width width = Width::kWord;
+  Cond cond = Cond::kEq;
+  Ext ext = Ext::kSignedWord;
+  bool is_signed = false;
+  VReg dst = kNoVReg;
+  Operand lhs{};
+  Operand rhs{};
+  Mem mem{};
+  Mem src_mem{};
+  /// @brief The number of bytes of a memory access; or the index of the call
+  /// or symbol that the instruction refers to.
+  std::size_t size = 0;
+  Label label = 0;
+  Label else_label = 0;
+};
+
+/// @brief An argument of a call. An integer or pointer is passed by `val`; a
+/// record of `size` bytes is passed by value from the address in `val`.
+struct CallArg {
+  Operand val;
+  Width width = Width::kWord;
+  bool is_record = false;
+  std::size_t size = 0;
+};
+
+struct Call {
+  /// @brief The function called directly; empty if it's called through
+  /// `callee`.
+  std::string symbol;
+  Operand callee{};
+  std::vector<CallArg> args{};
+  Width ret_width = Width::kWord;
+  /// @brief The size of the returned record; 0 if no record is returned.
+  std::size_t ret_record_size = 0;
+  /// @brief The slot that the returned record is copied to.
+  int ret_slot = -1;
+};
+
+/// @brief A stack slot, which is placed in the frame by the assembly writer.
+struct Slot {
+  std::size_t size;
+  std::size_t alignment;
+};
+
+/// @brief A parameter, whose value is stored to its slot on entry; a record
+/// passed in memory is used in place instead.
+struct Param {
+  std::size_t size;
+  bool is_record;
+  int slot;
+};
+
+struct Function {
+  std::string name;
+  std::vector<Instr> instrs{};
+  std::vector<Slot> slots{};
+  std::vector<Param> params{};
+  std::vector<Call> calls{};
+  std::vector<std::string> symbols{};
+  /// @brief The size of the returned record; 0 if no record is returned.
+  std::size_t ret_record_size = 0;
+  VReg num_of_vregs = 0;
+  Label num_of_labels = 0;
+
+  VReg NewVReg() {
+    return num_of_vregs++;
+  }
+  Label NewLabel() {
+    return num_of_labels++;
+  }
+  int NewSlot(std::size_t size, std::size_t alignment) {
+    slots.push_back({size, alignment});
+    return static_cast<int>(slots.size()) - 1;
+  }
+  void Append(Instr instr) {
+    instrs.push_back(std::move(instr));
+  }
+};
+
+/// @return Whether `instr` ends a block; the instructions after it are not
+/// reached unless a label follows.
+inline bool IsTerminator(const Instr& instr) {
+  return instr.op == Opcode::kJmp || instr.op == Opcode::kJnz ||
+         instr.op == Opcode::kRet || instr.op == Opcode::kRetRecord;
+}
+
+/// @brief Calls `func` with each virtual register that `instr` reads.
+template <typename Func>
+void ForEachUse(const Function& function, const Instr& instr, Func&& func) {
+  const auto use_operand = [&func](const Operand& operand) {
+    if (operand.IsVReg()) {
+      func(operand.vreg());
+    }
+  };
+  const auto use_mem = [&func](const Mem& mem) {
+    if (mem.base == Mem::Base::kVReg) {
+      func(mem.id);
+    }
+  };
+  switch (instr.op) {
+    case Opcode::kLoad:
+    case Opcode::kLea:
+    case Opcode::kRetRecord:
+      use_mem(instr.mem);
+      break;
+    case Opcode::kStore:
+      use_operand(instr.lhs);
+      use_mem(instr.mem);
+      break;
+    case Opcode::kBlit:
+      use_mem(instr.mem);
+      use_mem(instr.src_mem);
+      break;
+    case Opcode::kCall: {
+      const auto& call = function.calls.at(instr.size);
+      use_operand(call.callee);
+      for (const auto& arg : call.args) {
+        use_operand(arg.val);
+      }
+    } break;
+    case Opcode::kFuncAddr:
+    case Opcode::kLabel:
+    case Opcode::kJmp:
+      break;
+    default:
+      use_operand(instr.lhs);
+      use_operand(instr.rhs);
+      break;
+  }
+}
+
+}  // namespace x86
+
+#endif  // X86_MIR_HPP_
@@ -0,0 +1,78 @@
+#ifndef X86_REGISTER_HPP_
+#define X86_REGISTER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace x86 {
+
+enum class Reg : std::uint8_t {
+  kRax,
+  kRcx,
+  kRdx,
+  kRbx,
+  kRsp,
+  kRbp,
+  kRsi,
+  kRdi,
+  kR8,
+  kR9,
+  kR10,
+  kR11,
+  kR12,
+  kR13,
+  kR14,
+  kR15,
+};
+
+constexpr auto kNumOfRegs = std::size_t{16};
+
+/// @brief The registers that hold the integer arguments, in order.
+constexpr auto kArgRegs =
+    std::array{Reg::kRdi, Reg::kRsi, Reg::kRdx, Reg::kRcx, Reg::kR8, Reg::kR9};
+
+/// @brief The registers that the allocator assigns and a call clobbers; they
+/// are only given to the values that don't live across a call.
+constexpr auto kCallerSavedRegs =
+    std::array{Reg::kRsi, Reg::kRdi, Reg::kR8, Reg::kR9, Reg::kR10};
+
+/// @brief The registers that the allocator assigns and a call preserves; they
+/// are saved on entry and restored on return if assigned.
+constexpr auto kCalleeSavedRegs =
+    std::array{Reg::kRbx, Reg::kR12, Reg::kR13, Reg::kR14, Reg::kR15};
+
+// NOTE: %rax, %rcx, %rdx and %r11 are never assigned; they are the scratch
+// registers of the assembly writer, which needs %rax and %rdx for division,
+// %rcx for shifts, and the four of them to load spilled values.
+
+/// @return The AT&T name of the lower `size` bytes of `reg`, e.g., "%eax" for
+/// the 4 lower bytes of %rax.
+constexpr std::string_view NameOf(Reg reg, std::size_t size) {
+  constexpr auto kNames = std::array<std::array<std::string_view, 4>,
+                                     kNumOfRegs>{{
+      {"%al", "%ax", "%eax", "%rax"},
+      {"%cl", "%cx", "%ecx", "%rcx"},
+      {"%dl", "%dx", "%edx", "%rdx"},
+      {"%bl", "%bx", "%ebx", "%rbx"},
+      {"%spl", "%sp", "%esp", "%rsp"},
+      {"%bpl", "%bp", "%ebp", "%rbp"},
+      {"%sil", "%si", "%esi", "%rsi"},
+      {"%dil", "%di", "%edi", "%rdi"},
+      {"%r8b", "%r8w", "%r8d", "%r8"},
+      {"%r9b", "%r9w", "%r9d", "%r9"},
+      {"%r10b", "%r10w", "%r10d", "%r10"},
+      {"%r11b", "%r11w", "%r11d", "%r11"},
+      {"%r12b", "%r12w", "%r12d", "%r12"},
+      {"%r13b", "%r13w", "%r13d", "%r13"},
+      {"%r14b", "%r14w", "%r14d", "%r14"},
+      {"%r15b", "%r15w", "%r15d", "%r15"},
+  }};
+  const auto index = size == 1 ? 0 : size == 2 ? 1 : size == 4 ? 2 : 3;
+  return kNames.at(static_cast<std::size_t>(reg)).at(index);
+}
+
+}  // namespace x86
+
+#endif  // X86_REGISTER_HPP_
@@ -0,0 +1,123 @@
+#ifndef X86_ASM_GENERATOR_HPP_
+#define X86_ASM_GENERATOR_HPP_
+
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "ast.hpp"
+#include "static_visitor.hpp"
+#include "thread_pool.hpp"
+#include "type.hpp"
+#include "x86/mir.hpp"
+
+/// @brief Generates x86-64 assembly without going through QBE: each function
+/// is lowered to the machine IR, allocated registers by linear scan, and
+/// written in the AT&T syntax for the System V ABI.
+/// @note The generated code behaves the same as the QBE IR of
+/// `QbeIrGenerator`, which is the reference.
+class X86AsmGenerator : public StaticVisitor<X86AsmGenerator> {
+ public:
+  using StaticVisitor::Visit;
+
+  void Visit(const DeclStmtNode&);
+  void Visit(const LoopInitNode&);
+  void Visit(const VarDeclNode&);
+  void Visit(const ArrDeclNode&);
+  void Visit(const RecordDeclNode&);
+  void Visit(const FieldNode&);
+  void Visit(const RecordVarDeclNode&);
+  void Visit(const ParamNode&);
+  void Visit(const FuncDefNode&);
+  void Visit(const CompoundStmtNode&);
+  void Visit(const ExternDeclNode&);
+  void Visit(const TransUnitNode&);
+  void Visit(const IfStmtNode&);
+  void Visit(const WhileStmtNode&);
+  void Visit(const ForStmtNode&);
+  void Visit(const ReturnStmtNode&);
+  void Visit(const GotoStmtNode&);
+  void Visit(const BreakStmtNode&);
+  void Visit(const ContinueStmtNode&);
+  void Visit(const SwitchStmtNode&);
+  void Visit(const IdLabeledStmtNode&);
+  void Visit(const CaseStmtNode&);
+  void Visit(const DefaultStmtNode&);
+  void Visit(const ExprStmtNode&);
+  void Visit(const InitExprNode&);
+  void Visit(const ArrDesNode&);
+  void Visit(const IdDesNode&);
+  void Visit(const NullExprNode&);
+  void Visit(const IdExprNode&);
+  void Visit(const IntConstExprNode&);
+  void Visit(const ArgExprNode&);
+  void Visit(const ArrSubExprNode&);
+  void Visit(const CondExprNode&);
+  void Visit(const FuncCallExprNode&);
+  void Visit(const PostfixArithExprNode&);
+  void Visit(const RecordMemExprNode&);
+  void Visit(const UnaryExprNode&);
+  void Visit(const BinaryExprNode&);
+  void Visit(const SimpleAssignmentExprNode&);
+
+  /// @param thread_pool If provided, the functions of a translation unit are
+  /// generated in parallel with it.
+  explicit X86AsmGenerator(std::ostream& output,
+                           ThreadPool* thread_pool = nullptr)
+      : output_{&output}, thread_pool_{thread_pool} {}
+
+  /// @brief Lowers each function to the machine IR and appends it to
+  /// `lowered`, without allocating registers or writing the assembly; used by
+  /// the bytecode interpreter.
+  explicit X86AsmGenerator(std::vector<x86::Function>& lowered)
+      : lowered_{&lowered} {}
+
+  /// @brief Generates a single top-level declaration, after which nothing
+  /// refers to the node, so it can be freed.
+  void GenerateExternDecl(const ExternDeclNode& extern_decl);
+
+ private:
+  /// @note These are non-owning pointers; exactly one of `output_` and
+  /// `lowered_` is set.
+  std::ostream* output_ = nullptr;
+  std::vector<x86::Function>* lowered_ = nullptr;
+  ThreadPool* thread_pool_ = nullptr;
+
+  /// @brief Allocates the registers of the lowered function and writes its
+  /// assembly to `output`; or hands the function over to `lowered`.
+  void WriteFunction_(x86::Function& function);
+
+  /// @brief Resets the states that live through the generation of a single
+  /// top-level declaration.
+  void ResetStates_();
+
+  /// @brief Called by the code generation of `TransUnitNode` to generate each
+  /// function into its own buffer in parallel.
+  void GenerateInParallel_(const TransUnitNode&);
+
+  /// @brief Called by the code generation of `SwitchStmtNode` to generate the
+  /// condition matching of the cases.
+  void GenerateConditions_(const SwitchStmtNode&, x86::Label first_cond_label,
+                           const x86::Operand& ctrl);
+  /// @brief Called by the code generation of `BinaryExprNode` to generate the
+  /// right operand and the operation itself; the left operand is already
+  /// generated.
+  void GenerateBinaryExpr_(const BinaryExprNode&);
+
+  /// @brief Converts `val` from `from` to `to`, as `QbeIrGenerator` does.
+  x86::Operand ConvertTo_(const x86::Operand& val, const Type& from,
+                          const Type& to);
+  /// @brief Converts `val` from `from` to `to` for a store to an object of
+  /// `to`, which truncates the value by itself.
+  x86::Operand ConvertForStore_(const x86::Operand& val, const Type& from,
+                                const Type& to);
+  /// @brief Adds (`kAdd`) or subtracts (`kSub`) 1 to `val` of `type`.
+  x86::Operand WriteIncrOrDecr_(BinaryOperator op, const x86::Operand& val,
+                                const Type& type);
+  /// @brief Stores `val` of `from` to the object of `to` at `mem`; a record,
+  /// whose value is its address, is copied as a whole.
+  void WriteStoreOf_(const x86::Operand& val, const Type& from, const Type& to,
+                     const x86::Mem& mem);
+};
+
+#endif  // X86_ASM_GENERATOR_HPP_
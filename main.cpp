@@ -1,19 +1,49 @@
 #include <fmt/core.h>
+#include <sys/wait.h>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cxxopts.hpp>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
 #include "ast.hpp"
 #include "ast_dumper.hpp"
+#include "ast_serializer.hpp"
+#include "call_graph.hpp"
+#include "effect.hpp"
+#include "incremental_store.hpp"
+#include "lexer.hpp"
+#include "llvm_ir_generator.hpp"
+#include "location.hpp"
+#include "preprocessor.hpp"
+#include "profile.hpp"
+#include "qbe/ir_stats.hpp"
 #include "qbe_ir_generator.hpp"
 #include "scope.hpp"
+#include "thread_pool.hpp"
 #include "type_checker.hpp"
 #include "util.hpp"
+#include "visit_profiler.hpp"
+#include "vm/bytecode.hpp"
+#include "vm/interpreter.hpp"
+#include "whole_program.hpp"
+#include "x86/mir.hpp"
+#include "x86_asm_generator.hpp"
 #include "y.tab.hpp"
 
 extern FILE*
@@ -22,6 +52,58 @@ extern FILE*
 extern void yylex_destroy();  // NOLINT(readability-identifier-naming): extern
                               // from flex generated code.
 
+namespace {
+
+/// @return The path of the runtime library that the build configures with
+/// `VITAMINC_RUNTIME_PATH`; if it's not configured, the library is expected to
+/// be built next to the executable of the compiler.
+std::string DefaultRuntimeLibraryPath() {
+#ifdef VITAMINC_RUNTIME_PATH
+  return VITAMINC_RUNTIME_PATH;
+#else
+  auto ec = std::error_code{};
+  const auto exe_path = std::filesystem::read_symlink("/proc/self/exe", ec);
+  const auto dir = ec ? std::filesystem::current_path() : exe_path.parent_path();
+  return (dir / "runtime" / "runtime.o").string();
+#endif
+}
+
+/// @return The major version of the LLVM tools; empty if it's unknown.
+std::optional<int> LlvmMajorVersion() {
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  auto* version = popen("llc --version", "r");
+  if (version == nullptr) {
+    return std::nullopt;
+  }
+  auto output = std::string{};
+  auto buf = std::array<char, 256>{};  // NOLINT(*-magic-numbers)
+  while (std::fgets(buf.data(), static_cast<int>(buf.size()), version)) {
+    output += buf.data();
+  }
+  pclose(version);
+  constexpr auto kVersionStr = std::string_view{"LLVM version "};
+  const auto pos = output.find(kVersionStr);
+  if (pos == std::string::npos) {
+    return std::nullopt;
+  }
+  return std::atoi(output.c_str() + pos + kVersionStr.size());
+}
+
+/// @brief Runs `command` with the shell.
+/// @return The exit status of the command; 1 if it doesn't exit normally,
+/// e.g., is killed by a signal, or can't be run at all.
+/// @note The value of `std::system()` is a wait status, which can't be used
+/// as an exit status as is: a status of 256 truncates to 0.
+int RunCommand(const std::string& command) {
+  const auto status = std::system(command.c_str());
+  if (status == -1 || !WIFEXITED(status)) {
+    return 1;
+  }
+  return WEXITSTATUS(status);
+}
+
+}  // namespace
+
 int main(  // NOLINT(bugprone-exception-escape): Using a big try-catch block to
            // catch all exceptions isn't reasonable.
     int argc, char** argv)
@@ -32,12 +114,27 @@ int main(  // NOLINT(bugprone-exception-escape): Using a big try-catch block to
                 // std::span is available in C++20.
       "A simple C compiler."};
   // clang-format off
-  cmd_options.custom_help("[options] file");
+  cmd_options.custom_help("[options] file...");
   cmd_options.add_options()
       ("o, output", "Write output to <file>", cxxopts::value<std::string>()->default_value("a.out"), "<file>")
       ("d, dump", "Dump the abstract syntax tree", cxxopts::value<bool>()->default_value("false"))
-      // TODO: support LLVM IR
-      ("t, target", "Specify target IR", cxxopts::value<std::string>()->default_value("qbe"), "[qbe]")
+      ("lexer", "Specify the lexer; only simd runs the preprocessor", cxxopts::value<std::string>()->default_value("simd"), "[flex|simd]")
+      ("I, include-dir", "Search <dir> for included files", cxxopts::value<std::vector<std::string>>(), "<dir>")
+      ("D, define", "Define <macro> to <value>, or to 1 if omitted", cxxopts::value<std::vector<std::string>>(), "<macro>[=<value>]")
+      ("t, target", "Specify the target; x86_64 writes the assembly without QBE, and llvm compiles with opt and llc", cxxopts::value<std::string>()->default_value("qbe"), "[qbe|x86_64|llvm]")
+      ("run", "Run the program in the bytecode interpreter instead of compiling it", cxxopts::value<bool>()->default_value("false"))
+      ("O, opt-level", "Optimize at level <n> with the llvm target", cxxopts::value<unsigned>()->default_value("2"), "<n>")
+      ("incremental", "Reuse the IR of unchanged functions from the previous compilation", cxxopts::value<bool>()->default_value("false"))
+      ("emit-ast", "Write the type-checked abstract syntax tree to <file>.ast instead of compiling; the file can be compiled in place of the source", cxxopts::value<bool>()->default_value("false"))
+      ("stream", "Check and generate each top-level declaration as soon as it's parsed, to bound the memory use", cxxopts::value<bool>()->default_value("false"))
+      ("j, jobs", "Check and generate functions with <n> threads; 0 to use all cores", cxxopts::value<unsigned>()->default_value("1"), "<n>")
+      ("profile-visits", "Write the visit counts, the time and the bytes of IR of each kind of node in each pass to the standard error", cxxopts::value<std::string>()->implicit_value("table"), "[table|json]")
+      ("whole-program", "Compile the files as a single program, whose functions are optimized across the files", cxxopts::value<bool>()->default_value("false"))
+      ("order-functions", "Emit each function close to its callers, in the order of the calls rather than of the source", cxxopts::value<bool>()->default_value("false"))
+      ("profile-generate", "Count the executions of the functions and branches, which the program writes to <file> at exit; defaults to <input>.vcprof", cxxopts::value<std::string>()->implicit_value(""), "<file>")
+      ("profile-use", "Lay out the functions and blocks, order the cases of switch and inline by the counts of <file>; defaults to <input>.vcprof", cxxopts::value<std::string>()->implicit_value(""), "<file>")
+      ("runtime", "Link the program with the runtime library at <file> instead of the one the compiler is built with", cxxopts::value<std::string>(), "<file>")
+      ("codegen-stats", "Write the instructions, allocs and stack bytes, loads, stores, calls, blocks and branches of the QBE IR of each function to the standard error", cxxopts::value<std::string>()->implicit_value("table"), "[table|json]")
       ("h, help", "Display available options")
       ;
   // clang-format on
@@ -54,72 +151,492 @@ int main(  // NOLINT(bugprone-exception-escape): Using a big try-catch block to
     std::exit(0);
   }
 
-  // TODO: support compiling multiple files
-  if (args.size() > 1) {
-    std::cerr << "cannot compile more than one input file" << '\n';
+  // Multiple files are only compiled as a whole program; the output is named
+  // after the first one.
+  const auto is_whole_program = opts["whole-program"].as<bool>();
+  if (args.size() > 1 && !is_whole_program) {
+    std::cerr << "cannot compile more than one input file without "
+                 "--whole-program"
+              << '\n';
     std::exit(0);
   }
 
   auto input_path = std::filesystem::path(args.at(0));
-  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
-  yyin = fopen(input_path.c_str(), "r");
-  if (yyin == nullptr) {
-    std::cerr << "cannot open input file" << '\n';
+  const auto is_streaming = opts["stream"].as<bool>();
+  const auto is_emitting_ast = opts["emit-ast"].as<bool>();
+  if (is_whole_program &&
+      (is_streaming || is_emitting_ast || opts["dump"].as<bool>() ||
+       opts["incremental"].as<bool>() ||
+       std::any_of(args.cbegin(), args.cend(), [](const auto& arg) {
+         return IsSerializedAst(arg);
+       }))) {
+    std::cerr << "cannot use --stream, --dump, --incremental, --emit-ast or a "
+                 "serialized AST with --whole-program"
+              << '\n';
+    std::exit(0);
+  }
+
+  // A serialized AST is loaded in place of the source file, which it's already
+  // parsed and type-checked from.
+  auto serialized_ast = std::optional<SerializedAst>{};
+  if (IsSerializedAst(input_path)) {
+    if (is_streaming || is_emitting_ast || opts["incremental"].as<bool>()) {
+      std::cerr << "cannot use --stream, --incremental or --emit-ast with a "
+                   "serialized AST"
+                << '\n';
+      std::exit(0);
+    }
+    try {
+      serialized_ast = DeserializeAst(input_path);
+    } catch (const std::runtime_error& e) {
+      std::cerr << input_path.string() << ": " << e.what() << '\n';
+      std::exit(0);
+    }
+  }
+
+  // The parser reads from the flex scanner unless it's given the preprocessor.
+  const auto lexer = opts["lexer"].as<std::string>();
+  if (lexer != "simd" && lexer != "flex") {
+    std::cerr << "unknown lexer" << '\n';
+    std::exit(0);
+  }
+  auto include_dirs = std::vector<std::filesystem::path>{};
+  if (opts.count("include-dir")) {
+    for (const auto& dir : opts["include-dir"].as<std::vector<std::string>>()) {
+      include_dirs.emplace_back(dir);
+    }
+  }
+  // Lines and columns are only needed for diagnostics and dumps. Every file
+  // that's parsed, the included ones as well, is added as it's opened.
+  auto line_map =
+      serialized_ast ? std::move(serialized_ast->line_map) : LineMap{};
+  auto preprocessor = std::optional<Preprocessor>{};
+  /// @brief Makes the parser read the source file at `path`.
+  const auto open_source = [&](const std::filesystem::path& path) {
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    yyin = fopen(path.c_str(), "r");
+    if (yyin == nullptr) {
+      std::cerr << "cannot open input file" << '\n';
+      std::exit(0);
+    }
+    if (lexer == "flex") {
+      SetParserFileBase(line_map.AddFile(path));
+      return;
+    }
+    preprocessor.emplace(path, include_dirs, line_map);
+    if (opts.count("define")) {
+      for (const auto& define : opts["define"].as<std::vector<std::string>>()) {
+        const auto pos = define.find('=');
+        preprocessor->Define(
+            define.substr(0, pos),
+            pos == std::string::npos ? "1" : define.substr(pos + 1));
+      }
+    }
+    SetParserPreprocessor(&*preprocessor);
+  };
+  if (!serialized_ast) {
+    open_source(input_path);
+  }
+
+  // Only the QBE IR is stored for reuse; the native backend writes the
+  // assembly itself, and the LLVM IR is optimized as a whole.
+  const auto target = opts["target"].as<std::string>();
+  const auto is_native = target == "x86_64";
+  const auto is_llvm = target == "llvm";
+  if (target != "qbe" && !is_native && !is_llvm) {
+    std::cerr << "unknown target" << '\n';
+    std::exit(0);
+  }
+  if ((is_native || is_llvm) && opts["incremental"].as<bool>()) {
+    std::cerr << "cannot use --incremental with --target=" << target << '\n';
+    std::exit(0);
+  }
+  // The statistics are of the QBE IR, which is read back once it's written.
+  const auto stats_format = opts.count("codegen-stats")
+                                ? opts["codegen-stats"].as<std::string>()
+                                : std::string{};
+  if (!stats_format.empty() && stats_format != "table" &&
+      stats_format != "json") {
+    std::cerr << "unknown codegen stats format" << '\n';
+    std::exit(0);
+  }
+  if ((is_native || is_llvm) && !stats_format.empty()) {
+    std::cerr << "cannot use --codegen-stats with --target=" << target << '\n';
+    std::exit(0);
+  }
+  const auto opt_level = opts["opt-level"].as<unsigned>();
+  constexpr auto kMaxOptLevel = 3U;
+  if (opt_level > kMaxOptLevel) {
+    std::cerr << "unknown optimization level" << '\n';
+    std::exit(0);
+  }
+  // LLVM 14 and earlier only have partial support for opaque pointers, with
+  // which `opt` may crash, so the pointers are typed for them. The records
+  // passed in memory are typed by their attributes, which need LLVM 12.
+  auto pointer_kind = llvm_ir::PointerKind::kOpaque;
+  if (is_llvm) {
+    constexpr auto kFirstSupportedLlvm = 12;
+    constexpr auto kFirstOpaqueLlvm = 15;
+    const auto llvm_version = LlvmMajorVersion();
+    if (llvm_version && *llvm_version < kFirstSupportedLlvm) {
+      std::cerr << "--target=llvm requires LLVM " << kFirstSupportedLlvm
+                << " or later, but llc is of LLVM " << *llvm_version << '\n';
+      return 1;
+    }
+    if (llvm_version && *llvm_version < kFirstOpaqueLlvm) {
+      pointer_kind = llvm_ir::PointerKind::kTyped;
+    }
+  }
+
+  // The program is run from the type-checked tree, so no file is written.
+  const auto is_running = opts["run"].as<bool>();
+  if (is_running && (is_native || is_llvm || is_streaming || is_emitting_ast ||
+                     opts["incremental"].as<bool>() || !stats_format.empty())) {
+    std::cerr << "cannot use --run with --target, --stream, --incremental, "
+                 "--emit-ast or --codegen-stats"
+              << '\n';
     std::exit(0);
   }
 
+  // The counters are only inserted into, and the profile only read back for,
+  // the QBE IR of a whole translation unit.
+  const auto is_profile_generating = opts.count("profile-generate") != 0;
+  const auto is_profile_using = opts.count("profile-use") != 0;
+  if (is_profile_generating && is_profile_using) {
+    std::cerr << "cannot use --profile-generate with --profile-use" << '\n';
+    std::exit(0);
+  }
+  if ((is_profile_generating || is_profile_using) &&
+      (is_native || is_llvm || is_streaming || is_running ||
+       opts["incremental"].as<bool>())) {
+    std::cerr << "cannot use --profile-generate or --profile-use with "
+                 "--target, --stream, --incremental or --run"
+              << '\n';
+    std::exit(0);
+  }
+  /// @return The path of the profile; named after the input by default.
+  const auto profile_path_of = [&](const std::string& option) {
+    const auto path = opts[option].as<std::string>();
+    return path.empty() ? fmt::format("{}.vcprof", input_path.stem().string())
+                        : path;
+  };
+  auto execution_profile = std::optional<Profile>{};
+  if (is_profile_using) {
+    try {
+      execution_profile = Profile::Read(profile_path_of("profile-use"));
+    } catch (const std::runtime_error& e) {
+      std::cerr << e.what() << '\n';
+      std::exit(0);
+    }
+  }
+  const auto* execution_profile_ptr =
+      execution_profile ? &*execution_profile : nullptr;
+
+  // The functions are only reordered once they are all parsed, and then no
+  // longer match the declarations that the store records by their indices.
+  const auto is_ordering_funcs = opts["order-functions"].as<bool>();
+  if (is_ordering_funcs && (is_streaming || opts["incremental"].as<bool>())) {
+    std::cerr << "cannot use --order-functions with --stream or --incremental"
+              << '\n';
+    std::exit(0);
+  }
+
+  if (is_streaming &&
+      (opts["dump"].as<bool>() || opts["incremental"].as<bool>() ||
+       opts["jobs"].as<unsigned>() != 1 || is_emitting_ast)) {
+    std::cerr
+        << "cannot stream with --dump, --incremental, --jobs or --emit-ast"
+        << '\n';
+    std::exit(0);
+  }
+
+  // Each pass that is run gets its own profiler.
+  const auto profile_format = opts.count("profile-visits")
+                                  ? opts["profile-visits"].as<std::string>()
+                                  : std::string{};
+  if (!profile_format.empty() && profile_format != "table" &&
+      profile_format != "json") {
+    std::cerr << "unknown profile format" << '\n';
+    std::exit(0);
+  }
+  auto profilers = std::vector<std::unique_ptr<VisitProfiler>>{};
+  const auto profile = [&](auto& visitor, const char* pass) {
+    if (!profile_format.empty()) {
+      profilers.push_back(std::make_unique<VisitProfiler>(pass));
+      visitor.SetProfiler(profilers.back().get());
+    }
+  };
+  const auto write_profiles = [&] {
+    if (profile_format == "json") {
+      std::cerr << '[';
+      for (const auto& profiler : profilers) {
+        if (profiler != profilers.front()) {
+          std::cerr << ",\n";
+        }
+        profiler->WriteJson(std::cerr);
+      }
+      std::cerr << "]\n";
+    } else {
+      for (const auto& profiler : profilers) {
+        profiler->WriteTable(std::cerr);
+      }
+    }
+  };
+
+  auto input_basename = input_path.stem().string();
+  // No IR is written when the program is run in place or only its tree is
+  // emitted, so no file is left behind for it.
+  auto output_ir = is_running || is_emitting_ast
+                       ? std::ofstream{}
+                       : std::ofstream{fmt::format(
+                             "{}.{}", input_basename,
+                             is_native ? "s" : (is_llvm ? "ll" : "ssa"))};
+  auto scopes = ScopeStack{};
+
+  // When streaming, each top-level declaration is checked and generated as soon
+  // as it's parsed, and then freed; only the file-scope symbols are kept.
+  TypeChecker stream_type_checker{scopes};
+  QbeIrGenerator stream_code_generator{output_ir};
+  X86AsmGenerator stream_asm_generator{output_ir};
+  LlvmIrGenerator stream_llvm_generator{output_ir, nullptr, pointer_kind};
+  auto on_extern_decl = std::function<void(std::unique_ptr<ExternDeclNode>)>{};
+  if (is_streaming) {
+    profile(stream_type_checker, "type checking");
+    if (is_native) {
+      profile(stream_asm_generator, "code generation");
+    } else if (is_llvm) {
+      profile(stream_llvm_generator, "code generation");
+      stream_llvm_generator.BeginModule();
+    } else {
+      profile(stream_code_generator, "code generation");
+    }
+    stream_type_checker.EnterFileScope();
+    on_extern_decl = [&](std::unique_ptr<ExternDeclNode> extern_decl) {
+      stream_type_checker.Dispatch(*extern_decl);
+      if (is_native) {
+        stream_asm_generator.GenerateExternDecl(*extern_decl);
+      } else if (is_llvm) {
+        stream_llvm_generator.GenerateExternDecl(*extern_decl);
+      } else {
+        stream_code_generator.GenerateExternDecl(*extern_decl);
+      }
+    };
+  }
+
   /// @brief The root node of the program.
   auto trans_unit = std::unique_ptr<AstNode>{};
-  yy::parser parser{trans_unit};
-  int ret = parser.parse();
-
-  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
-  fclose(yyin);
-  yylex_destroy();
+  /// @brief Parses the opened source file into `root`.
+  /// @return 0 on success, 1 otherwise.
+  const auto parse_source = [&](std::unique_ptr<AstNode>& root) {
+    yy::parser parser{root, line_map, on_extern_decl};
+    int ret = parser.parse();
 
-  // 0 on success, 1 otherwise
-  if (ret) {
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    fclose(yyin);
+    yylex_destroy();
     return ret;
+  };
+  if (serialized_ast) {
+    trans_unit = std::move(serialized_ast->trans_unit);
+  } else if (auto ret = parse_source(trans_unit)) {
+    return ret;
+  }
+  // The other files of a whole program are parsed one after another, and then
+  // linked with the first one into a single translation unit.
+  if (args.size() > 1) {
+    auto trans_units = std::vector<std::unique_ptr<AstNode>>{};
+    auto paths = std::vector<std::filesystem::path>{input_path};
+    trans_units.push_back(std::move(trans_unit));
+    for (auto i = std::size_t{1}, e = args.size(); i < e; ++i) {
+      paths.emplace_back(args.at(i));
+      open_source(paths.back());
+      trans_units.emplace_back();
+      if (auto ret = parse_source(trans_units.back())) {
+        return ret;
+      }
+    }
+    try {
+      trans_unit = LinkTransUnits(std::move(trans_units), paths);
+    } catch (const std::runtime_error& e) {
+      std::cerr << e.what() << '\n';
+      std::exit(0);
+    }
   }
 
-  // perform analyses and transformations on the ast
-  auto scopes = ScopeStack{};
-  TypeChecker type_checker{scopes};
-  trans_unit->Accept(type_checker);
-  if (opts["dump"].as<bool>()) {
-    const auto max_level = 80u;
-    AstDumper ast_dumper{Indenter{' ', Indenter::SizePerLevel{2},
-                                  Indenter::MaxLevel{max_level}}};
-    trans_unit->Accept(ast_dumper);
+  // Functions are processed in parallel only if more than one job is requested;
+  // the output is the same either way.
+  auto thread_pool = std::optional<ThreadPool>{};
+  if (auto jobs = opts["jobs"].as<unsigned>(); jobs != 1) {
+    thread_pool.emplace(jobs);
   }
+  auto* thread_pool_ptr = thread_pool ? &*thread_pool : nullptr;
 
-  // generate intermediate representation
-  auto input_basename = input_path.stem().string();
-  auto output_ir = std::ofstream{fmt::format("{}.ssa", input_basename)};
-  QbeIrGenerator code_generator{output_ir};
-  trans_unit->Accept(code_generator);
+  // The store sits next to the IR it records. The declarations are
+  // fingerprinted by the text of the source file, which no longer tells their
+  // tokens once a file is included or a macro is defined.
+  auto store = std::optional<IncrementalStore>{};
+  if (opts["incremental"].as<bool>() && preprocessor &&
+      preprocessor->HasDirectives()) {
+    std::cerr << "note: --incremental is ignored for preprocessed sources"
+              << '\n';
+  } else if (opts["incremental"].as<bool>()) {
+    store.emplace(fmt::format("{}.vcstore", input_basename));
+    auto input = std::ifstream{input_path, std::ios::binary};
+    store->FingerprintDecls(
+        dynamic_cast<const TransUnitNode&>(*trans_unit),
+        std::string{std::istreambuf_iterator<char>{input}, {}});
+  }
+  auto* store_ptr = store ? &*store : nullptr;
+
+  if (is_streaming) {
+    stream_type_checker.ExitFileScope();
+    if (is_llvm) {
+      stream_llvm_generator.FinishModule();
+    }
+  } else {
+    // perform analyses and transformations on the ast
+    // The dumped or emitted tree has to be fully typed, so no function is left
+    // unchecked.
+    if (!serialized_ast) {
+      TypeChecker type_checker{
+          scopes, thread_pool_ptr,
+          opts["dump"].as<bool>() || is_emitting_ast ? nullptr : store_ptr};
+      profile(type_checker, "type checking");
+      type_checker.Dispatch(*trans_unit);
+    }
+    if (is_whole_program) {
+      InterproceduralOptimizer{execution_profile_ptr}.Optimize(
+          dynamic_cast<TransUnitNode&>(*trans_unit));
+    }
+    if (is_ordering_funcs) {
+      OrderFuncsByCalls(dynamic_cast<TransUnitNode&>(*trans_unit));
+    }
+    if (execution_profile) {
+      PlaceColdFuncsLast(dynamic_cast<TransUnitNode&>(*trans_unit),
+                         *execution_profile);
+    }
+    if (opts["dump"].as<bool>()) {
+      const auto max_level = 80u;
+      AstDumper ast_dumper{Indenter{' ', Indenter::SizePerLevel{2},
+                                    Indenter::MaxLevel{max_level}},
+                           line_map};
+      profile(ast_dumper, "dumping");
+      ast_dumper.Dispatch(*trans_unit);
+    }
+    if (is_emitting_ast) {
+      // Serialized in memory first, so that no truncated file is left behind
+      // if the compiler fails in the middle.
+      auto ast_bytes = std::ostringstream{};
+      SerializeAst(dynamic_cast<const TransUnitNode&>(*trans_unit), line_map,
+                   ast_bytes);
+      auto output_ast = std::ofstream{fmt::format("{}.ast", input_basename),
+                                      std::ios::binary};
+      output_ast << ast_bytes.str();
+      write_profiles();
+      return 0;
+    }
+
+    // The functions are lowered as the native backend does, and then
+    // assembled into the bytecode, which is run right away.
+    if (is_running) {
+      auto lowered = std::vector<x86::Function>{};
+      X86AsmGenerator lowerer{lowered};
+      profile(lowerer, "code generation");
+      lowerer.Dispatch(*trans_unit);
+      write_profiles();
+      try {
+        return vm::Execute(vm::Assemble(lowered));
+      } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+      }
+    }
+
+    // generate intermediate representation, or the assembly directly
+    if (is_native) {
+      X86AsmGenerator asm_generator{output_ir, thread_pool_ptr};
+      profile(asm_generator, "code generation");
+      asm_generator.Dispatch(*trans_unit);
+    } else if (is_llvm) {
+      LlvmIrGenerator llvm_generator{output_ir, thread_pool_ptr,
+                                     pointer_kind};
+      profile(llvm_generator, "code generation");
+      llvm_generator.Dispatch(*trans_unit);
+    } else {
+      QbeIrGenerator code_generator{output_ir, thread_pool_ptr, store_ptr};
+      profile(code_generator, "code generation");
+      // The program may be run from another directory.
+      if (is_profile_generating) {
+        code_generator.InstrumentForProfile(
+            std::filesystem::absolute(profile_path_of("profile-generate"))
+                .string());
+      }
+      code_generator.UseProfile(execution_profile_ptr);
+      // NOTE: A function reused from the store may have been generated with
+      // the effects of callees that have changed since.
+      auto effects = std::optional<EffectAnalysis>{};
+      if (!store) {
+        effects.emplace(dynamic_cast<const TransUnitNode&>(*trans_unit));
+        code_generator.UseEffects(&*effects);
+      }
+      code_generator.Dispatch(*trans_unit);
+    }
+  }
+  write_profiles();
 
   output_ir.close();
+  if (store) {
+    store->Save();
+  }
+  if (!stats_format.empty()) {
+    auto stats = qbe::IrStats{input_path.string()};
+    auto input_ir = std::ifstream{fmt::format("{}.ssa", input_basename)};
+    stats.Collect(input_ir);
+    if (stats_format == "json") {
+      stats.WriteJson(std::cerr);
+    } else {
+      stats.WriteTable(std::cerr);
+    }
+  }
 
   // generate assembly
-  if (opts["target"].as<std::string>() == "qbe") {
+  if (is_llvm) {
+    std::string opt_command = fmt::format("opt -O{1} -o {0}.bc {0}.ll",
+                                          input_basename, opt_level);
+    auto opt_ret = RunCommand(opt_command);
+    if (opt_ret) {
+      return opt_ret;
+    }
+    // The executable is position-independent, as cc links it by default.
+    std::string llc_command =
+        fmt::format("llc -O{1} -relocation-model=pic -o {0}.s {0}.bc",
+                    input_basename, opt_level);
+    auto llc_ret = RunCommand(llc_command);
+    if (llc_ret) {
+      return llc_ret;
+    }
+  } else if (!is_native) {
     std::string qbe_command =
         fmt::format("qbe -o {0}.s {0}.ssa", input_basename);
-    auto qbe_ret = std::system(qbe_command.c_str());
-    // 0 on success, 1 otherwise
+    auto qbe_ret = RunCommand(qbe_command);
     if (qbe_ret) {
       return qbe_ret;
     }
-  } else {
-    std::cerr << "unknown target" << '\n';
-    std::exit(0);
   }
 
-  // generate executable
+  // generate executable, with the runtime library that the builtins call
+  const auto runtime_path = opts.count("runtime")
+                                ? opts["runtime"].as<std::string>()
+                                : DefaultRuntimeLibraryPath();
+  if (!std::filesystem::exists(runtime_path)) {
+    std::cerr << "cannot find the runtime library " << runtime_path
+              << "; build it with make or specify it with --runtime" << '\n';
+    return 1;
+  }
   auto output = opts["output"].as<std::string>();
-  std::string cc_command = fmt::format("cc -o {} {}.s", output, input_basename);
-  auto cc_ret = std::system(cc_command.c_str());
-  // 0 on success, 1 otherwise
+  std::string cc_command = fmt::format("cc -o {} {}.s {}", output,
+                                       input_basename, runtime_path);
+  auto cc_ret = RunCommand(cc_command);
   if (cc_ret) {
     return cc_ret;
   }
@@ -1,12 +1,15 @@
 %{
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <memory>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "ast.hpp"
+#include "casting.hpp"
 #include "location.hpp"
 #include "operator.hpp"
 #include "type.hpp"
@@ -23,6 +26,17 @@ namespace {
 /// `int` (inner), the resolved type is `int* []` (inner outer).
 std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
                                   std::unique_ptr<Type> unknown_type);
+/// @return The type specified by the declaration specifiers; for a record
+/// declaration, the declared record type, e.g., `struct birth` in
+/// `struct birth f(struct birth b)`.
+std::unique_ptr<Type> TypeOf(
+    std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> decl_specifiers);
+/// @brief Combines the type specifiers of a single declaration, such as
+/// `unsigned` and `long int` into `unsigned long`.
+/// @note Only the integer types are combined; otherwise, `lhs` is the result.
+std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> CombineTypeSpecifiers(
+    std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> lhs,
+    std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> rhs);
 }
 
 %}
@@ -30,12 +44,16 @@ std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
 // Dependency code required for the value and location types;
 // inserts verbatim to the header file.
 %code requires {
+  #include <cstdint>
+  #include <functional>
   #include <memory>
+  #include <optional>
   #include <string>
   #include <variant>
   #include <vector>
 
   #include "ast.hpp"
+  #include "location.hpp"
   #include "type.hpp"
 }
 
@@ -43,9 +61,9 @@ std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
 %code {
   extern yy::parser::symbol_type yylex();
 
-  /// @brief Converts the location information from Bison to our own location type.
-  Location Loc(const yy::location& loc) {
-    return Location{loc.begin.line, loc.begin.column};
+  /// @brief Converts the source range of a symbol to the location of the node.
+  Location Loc(const SourceRange& range) {
+    return range.begin;
   }
 }
 
@@ -55,6 +73,10 @@ std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
 %locations
 
 %parse-param {std::unique_ptr<AstNode>& trans_unit}
+%parse-param {const LineMap& line_map}
+// If set, each top-level declaration is handed to it as soon as it's parsed,
+// instead of being collected into the translation unit.
+%parse-param {const std::function<void(std::unique_ptr<ExternDeclNode>)>& on_extern_decl}
 
 // Use complete symbols (parser::symbol_type).
 %define api.token.constructor
@@ -74,8 +96,8 @@ std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
 // Improve syntax error handling, as LALR parser might perform additional
 // parser stack reductions before discovering the syntax error.
 %define parse.lac full
-// Avoid creating header file since we don't use yy::location outside of the parser.
-%define api.location.file none
+// Tokens only carry their offsets; lines and columns are resolved on error.
+%define api.location.type {SourceRange}
 
 %token MINUS PLUS STAR DIV MOD ASSIGN
 %token EXCLAMATION TILDE AMPERSAND QUESTION
@@ -83,9 +105,10 @@ std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
 // (), {}, []
 %token LEFT_PAREN RIGHT_PAREN LEFT_CURLY RIGHT_CURLY LEFT_SQUARE RIGHT_SQUARE
 
-%token <int> NUM
+// The value of an integer constant; none if it doesn't fit in any integer type.
+%token <std::optional<std::uint64_t>> NUM
 %token <std::string> ID
-%token INT
+%token INT CHAR SHORT LONG SIGNED UNSIGNED
 %token IF ELSE
 %token SWITCH CASE DEFAULT
 %token EQ LT GT NE LE GE
@@ -119,6 +142,7 @@ std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
 %nterm <std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>>> type_specifier declaration_specifiers struct_or_union_specifier
 // The number of '*'s.
 %nterm <int> pointer_opt pointer
+%nterm <std::uint64_t> integer_constant
 // The initializer of a simple variable is an expression, whereas that of an array or complex object is a list of expressions.
 %nterm <std::variant<std::unique_ptr<InitExprNode>, std::vector<std::unique_ptr<InitExprNode>>>> initializer
 %nterm <std::vector<std::unique_ptr<InitExprNode>>> initializer_list
@@ -162,11 +186,19 @@ entry: trans_unit {
 
 trans_unit: external_decl {
     $$ = std::vector<std::unique_ptr<ExternDeclNode>>{};
-    $$.push_back($1);
+    if (on_extern_decl) {
+      on_extern_decl($1);
+    } else {
+      $$.push_back($1);
+    }
   }
   | trans_unit external_decl {
     auto trans_unit = $1;
-    trans_unit.push_back($2);
+    if (on_extern_decl) {
+      on_extern_decl($2);
+    } else {
+      trans_unit.push_back($2);
+    }
     $$ = std::move(trans_unit);
   }
   ;
@@ -182,10 +214,10 @@ func_def: declaration_specifiers declarator compound_stmt {
     // The declarator shall already be a function declarator.
     // We resolve its return type with the declaration specifiers and set the body.
     auto func_def = $2;
-    assert(dynamic_cast<FuncDefNode*>(func_def.get()));
+    assert(Isa<FuncDefNode>(*func_def));
     assert(func_def->type->IsFunc());
     const auto* func_type = static_cast<FuncType*>(func_def->type.get());
-    auto type = std::get<std::unique_ptr<Type>>($1);
+    auto type = TypeOf($1);
     auto resolved_return_type = ResolveType(std::move(type), func_type->return_type().Clone());
     auto param_types = std::vector<std::unique_ptr<Type>>{};
     for (auto& param : func_type->param_types()) {
@@ -267,9 +299,20 @@ expr: assign_expr { $$ = $1; }
     | expr COMMA assign_expr { $$ = std::make_unique<BinaryExprNode>(Loc(@2), BinaryOperator::kComma, $1, $3); }
     ;
 
+/* 6.4.4.1 Integer constants */
+integer_constant: NUM {
+    const auto val = $1;
+    if (!val) {
+      error(@1, "integer constant is too large for its type");
+      YYERROR;
+    }
+    $$ = *val;
+  }
+  ;
+
 /* 6.5.1 Primary expressions */
 primary_expr: ID { $$ = std::make_unique<IdExprNode>(Loc(@1), $1); }
-  | NUM { $$ = std::make_unique<IntConstExprNode>(Loc(@1), $1); }
+  | integer_constant { $$ = std::make_unique<IntConstExprNode>(Loc(@1), $1); }
   | LEFT_PAREN expr RIGHT_PAREN { $$ = $2; }
   ;
 
@@ -425,7 +468,7 @@ decl: declaration_specifiers init_declarator_list_opt SEMICOLON {
         decl_list.push_back(std::move(decl));
       }
 
-      auto* rec_decl = dynamic_cast<RecordDeclNode*>(decl.get());
+      auto* rec_decl = DynCast<RecordDeclNode>(decl.get());
       // Initialize record variable.
       for (auto& init_decl : init_decl_list) {
         if (init_decl) {
@@ -456,8 +499,7 @@ init_declarator_list: init_declarator {
 /* A declaration specifier declares part of the type of a declarator. */
 /* TODO: storage class specifier, type qualifier, function specifier */
 declaration_specifiers: type_specifier declaration_specifiers {
-    // Leave unimplemented; useless without support of other specifiers.
-    $$ = $1;
+    $$ = CombineTypeSpecifiers($1, $2);
   }
   | type_specifier { $$ = $1; }
   ;
@@ -469,16 +511,16 @@ init_declarator: declarator { $$ = $1; }
     auto decl = $1;
     auto init = $3;
     if (std::holds_alternative<std::unique_ptr<InitExprNode>>(init)) {
-      auto* var_decl = dynamic_cast<VarDeclNode*>(decl.get());
+      auto* var_decl = DynCast<VarDeclNode>(decl.get());
       assert(var_decl);
       auto initializer = std::move(std::get<std::unique_ptr<InitExprNode>>(init));
       var_decl->init = std::move(initializer->expr);
     } else { // The initializer is a list of expressions.
       auto init_expr_list = std::move(std::get<std::vector<std::unique_ptr<InitExprNode>>>(init));
-      if (auto* arr_decl = dynamic_cast<ArrDeclNode*>(decl.get())) {
+      if (auto* arr_decl = DynCast<ArrDeclNode>(decl.get())) {
         // Declares an array variable.
         arr_decl->init_list = std::move(init_expr_list);
-      } else if (auto* var_decl = dynamic_cast<VarDeclNode*>(decl.get())) {
+      } else if (auto* var_decl = DynCast<VarDeclNode>(decl.get())) {
         // Declares a struct or union variable.
         decl = std::make_unique<RecordVarDeclNode>(Loc(@1),
                                          std::move(var_decl->id),
@@ -492,8 +534,14 @@ init_declarator: declarator { $$ = $1; }
 
 
 /* 6.7.2 Type specifiers */
-/* TODO: support multiple data types */
+/* `signed` and `unsigned` alone specify `int` and `unsigned int`, which are
+   combined with the rest of the specifiers. */
 type_specifier: INT { $$ = std::make_unique<PrimType>(PrimitiveType::kInt); }
+  | CHAR { $$ = std::make_unique<PrimType>(PrimitiveType::kChar); }
+  | SHORT { $$ = std::make_unique<PrimType>(PrimitiveType::kShort); }
+  | LONG { $$ = std::make_unique<PrimType>(PrimitiveType::kLong); }
+  | SIGNED { $$ = std::make_unique<PrimType>(PrimitiveType::kInt); }
+  | UNSIGNED { $$ = std::make_unique<PrimType>(PrimitiveType::kUInt); }
   | struct_or_union_specifier { $$ = $1; }
   /* TODO: enum specifier */
   /* TODO: typedef name */
@@ -567,7 +615,10 @@ struct_declarator: declarator {
 
 /* TODO: type_qualifier specifier_qualifier_list_opt */
 specifier_qualifier_list: type_specifier {
-    $$ = std::move(std::get<std::unique_ptr<Type>>($1));
+    $$ = TypeOf($1);
+  }
+  | type_specifier specifier_qualifier_list {
+    $$ = TypeOf(CombineTypeSpecifiers($1, $2));
   }
   ;
 
@@ -617,10 +668,10 @@ direct_declarator: ID {
     $$ = $2;
   }
   /* array */
-  | direct_declarator LEFT_SQUARE NUM RIGHT_SQUARE {
+  | direct_declarator LEFT_SQUARE integer_constant RIGHT_SQUARE {
     auto declarator = $1;
     auto type = std::make_unique<ArrType>(std::move(declarator->type), $3);
-    if (!dynamic_cast<ArrDeclNode*>(declarator.get())) {
+    if (!Isa<ArrDeclNode>(*declarator)) {
       // If the declarator is not yet a array declarator, we need to construct one.
       $$ = std::make_unique<ArrDeclNode>(Loc(@1), declarator->id, std::move(type), std::vector<std::unique_ptr<InitExprNode>>{});
     } else {
@@ -681,7 +732,7 @@ parameter_list: parameter_declaration {
   ;
 
 parameter_declaration: declaration_specifiers declarator {
-    auto type = std::move(std::get<std::unique_ptr<Type>>($1));
+    auto type = TypeOf($1);
     auto decl = $2;
     auto resolved_type = ResolveType(std::move(type), std::move(decl->type));
     $$ = std::make_unique<ParamNode>(Loc(@2), std::move(decl->id), std::move(resolved_type));
@@ -689,7 +740,7 @@ parameter_declaration: declaration_specifiers declarator {
   /* Declare parameters without identifiers. */
   | declaration_specifiers abstract_declarator_opt {
     // XXX: The identifier is empty.
-    auto type = std::get<std::unique_ptr<Type>>($1);
+    auto type = TypeOf($1);
     $$ = std::make_unique<ParamNode>(Loc(@1), /* id */ "", ResolveType(std::move(type), $2));
   }
   ;
@@ -722,7 +773,7 @@ direct_abstract_declarator: LEFT_PAREN abstract_declarator RIGHT_PAREN {
     @$ = @2;
     $$ = $2;
   }
-  | direct_abstract_declarator_opt LEFT_SQUARE NUM RIGHT_SQUARE {
+  | direct_abstract_declarator_opt LEFT_SQUARE integer_constant RIGHT_SQUARE {
     $$ = std::make_unique<ArrType>($1, $3);
   }
   /* e.g., (*)(int, int) */
@@ -786,8 +837,8 @@ comma_opt: COMMA
 epsilon: %empty;
 %%
 
-void yy::parser::error(const yy::location& loc, const std::string& err) {
-  std::cerr << loc << ": " << err << std::endl;
+void yy::parser::error(const SourceRange& range, const std::string& err) {
+  std::cerr << line_map.Describe(range.begin) << ": " << err << std::endl;
 }
 
 namespace {
@@ -824,4 +875,38 @@ std::unique_ptr<Type> ResolveType(std::unique_ptr<Type> resolved_type,
   return nullptr;
 }
 
+std::unique_ptr<Type> TypeOf(
+    std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> decl_specifiers) {
+  if (auto* type = std::get_if<std::unique_ptr<Type>>(&decl_specifiers)) {
+    return std::move(*type);
+  }
+  auto& decl = std::get<std::unique_ptr<DeclNode>>(decl_specifiers);
+  assert(Isa<RecordDeclNode>(*decl));
+  return std::move(decl->type);
+}
+
+std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> CombineTypeSpecifiers(
+    std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> lhs,
+    std::variant<std::unique_ptr<Type>, std::unique_ptr<DeclNode>> rhs) {
+  const auto* lhs_type = std::get_if<std::unique_ptr<Type>>(&lhs);
+  const auto* rhs_type = std::get_if<std::unique_ptr<Type>>(&rhs);
+  if (!lhs_type || !rhs_type) {
+    return lhs;
+  }
+  const auto* lhs_prim = DynCast<PrimType>(lhs_type->get());
+  const auto* rhs_prim = DynCast<PrimType>(rhs_type->get());
+  if (!lhs_prim || !rhs_prim) {
+    return lhs;
+  }
+  // `int`, which `signed` and `unsigned` also specify, gives way to the other
+  // sizes, e.g., `short int` is `short`; `long long` is as long as `long`.
+  const auto is_int = [](const PrimType& prim) { return prim.size() == 4; };
+  const auto size =
+      is_int(*lhs_prim)   ? rhs_prim->size()
+      : is_int(*rhs_prim) ? lhs_prim->size()
+                          : std::max(lhs_prim->size(), rhs_prim->size());
+  return std::make_unique<PrimType>(IntegerTypeOf(
+      size, lhs_prim->IsUnsigned() || rhs_prim->IsUnsigned()));
+}
+
 }
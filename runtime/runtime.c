@@ -0,0 +1,130 @@
+#include "runtime.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+enum {
+  kBufferSize = 1 << 16,
+  /// @brief The length of "-2147483648\n".
+  kMaxIntLength = 12,
+};
+
+static char buffer[kBufferSize];
+static size_t buffer_len = 0;
+static int is_flushed_at_exit = 0;
+
+static const struct __vitaminc_profiled_func* profiled_funcs = NULL;
+static const char* profile_path = NULL;
+
+/// @brief The digits of 00 to 99, so that two digits are converted at a time.
+static const char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static void FlushAtExit(void) {
+  __vitaminc_flush();
+}
+
+static int NumOfDigits(unsigned val) {
+  int num_of_digits = 1;
+  while (val >= 10) {
+    val /= 10;
+    ++num_of_digits;
+  }
+  return num_of_digits;
+}
+
+int __vitaminc_print_int(int val) {
+  if (!is_flushed_at_exit) {
+    atexit(FlushAtExit);
+    is_flushed_at_exit = 1;
+  }
+  if (buffer_len + kMaxIntLength > kBufferSize) {
+    __vitaminc_flush();
+  }
+
+  char* out = buffer + buffer_len;
+  // Negating in unsigned doesn't overflow on INT_MIN.
+  unsigned magnitude = (unsigned)val;
+  if (val < 0) {
+    *out++ = '-';
+    magnitude = 0U - magnitude;
+  }
+  const int num_of_digits = NumOfDigits(magnitude);
+  // The digits are written from the last one.
+  char* digit = out + num_of_digits;
+  while (magnitude >= 100) {
+    const unsigned pair = magnitude % 100 * 2;
+    magnitude /= 100;
+    *--digit = kDigitPairs[pair + 1];
+    *--digit = kDigitPairs[pair];
+  }
+  if (magnitude >= 10) {
+    const unsigned pair = magnitude * 2;
+    *--digit = kDigitPairs[pair + 1];
+    *--digit = kDigitPairs[pair];
+  } else {
+    *--digit = (char)('0' + magnitude);
+  }
+  out += num_of_digits;
+  *out++ = '\n';
+
+  const int len = (int)(out - (buffer + buffer_len));
+  buffer_len += (size_t)len;
+  return len;
+}
+
+int __vitaminc_flush(void) {
+  size_t written = 0;
+  while (written < buffer_len) {
+    const ssize_t len = write(STDOUT_FILENO, buffer + written,
+                              buffer_len - written);
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      buffer_len = 0;
+      return -1;
+    }
+    written += (size_t)len;
+  }
+  buffer_len = 0;
+  return 0;
+}
+
+static void WriteProfileAtExit(void) {
+  FILE* profile = fopen(profile_path, "w");
+  if (profile == NULL) {
+    return;
+  }
+  for (const struct __vitaminc_profiled_func* func = profiled_funcs;
+       func->counters != NULL; ++func) {
+    fputs(func->name, profile);
+    for (unsigned long long i = 0; i < func->num_of_counters; ++i) {
+      fprintf(profile, " %llu", func->counters[i]);
+    }
+    fputc('\n', profile);
+  }
+  fclose(profile);
+}
+
+void __vitaminc_profile_init(const struct __vitaminc_profiled_func* funcs,
+                             const char* path) {
+  // `main` may be called again by the program itself.
+  if (profiled_funcs != NULL) {
+    return;
+  }
+  profiled_funcs = funcs;
+  profile_path = path;
+  atexit(WriteProfileAtExit);
+}
@@ -0,0 +1,41 @@
+#ifndef VITAMINC_RUNTIME_H_
+#define VITAMINC_RUNTIME_H_
+
+// The runtime library of the programs compiled by vitaminc, which the driver
+// links into every executable. The builtins are lowered to direct calls to the
+// functions below.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief Writes `val` in decimal followed by a newline to the standard
+/// output. The output is buffered until `__vitaminc_flush` is called, the
+/// buffer is full, or the program exits normally.
+/// @return The number of characters written, same as `printf("%d\n", val)`.
+int __vitaminc_print_int(int val);
+
+/// @brief Writes the buffered output to the standard output.
+/// @return 0 on success; -1 if the output can't be written.
+int __vitaminc_flush(void);
+
+/// @brief The counters of a function compiled with `--profile-generate`.
+struct __vitaminc_profiled_func {
+  unsigned long long* counters;
+  unsigned long long num_of_counters;
+  const char* name;
+};
+
+/// @brief Writes the counters of `funcs` to `path` when the program exits
+/// normally, a line of the name of each function followed by its counts;
+/// called on the entry of `main` by a program compiled with
+/// `--profile-generate`.
+/// @param funcs Terminated by an entry whose `counters` is null.
+void __vitaminc_profile_init(const struct __vitaminc_profiled_func* funcs,
+                             const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // VITAMINC_RUNTIME_H_
@@ -1,8 +1,8 @@
 #!/usr/bin/env sh
 
-wget https://c9x.me/compile/release/qbe-1.1.tar.xz -O - | tar Jxf - &&
-  cd qbe-1.1/ &&
+wget https://c9x.me/compile/release/qbe-1.2.tar.xz -O - | tar Jxf - &&
+  cd qbe-1.2/ &&
   make &&
   sudo make install &&
   cd .. &&
-  rm -rf qbe-1.1/
+  rm -rf qbe-1.2/
@@ -1,7 +1,27 @@
 #include "ast.hpp"
 
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "casting.hpp"
+#include "stack_segment.hpp"
 #include "visitor.hpp"
 
+namespace {
+
+/// @brief Destroys the children of a node that can be nested in itself, e.g.,
+/// the body of an if statement in another; on a new segment of stack if the
+/// current one runs low, so that destroying a deeply nested tree doesn't
+/// overflow the stack.
+template <typename... Children>
+void DestroyChildren(Children&... children) {
+  WithSufficientStack([&] { ((children = Children{}), ...); });
+}
+
+}  // namespace
+
 void AstNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -132,6 +152,22 @@ void CompoundStmtNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+CompoundStmtNode::~CompoundStmtNode() {
+  // The statements of a nested compound statement are taken out before it's
+  // destroyed, so no destructor of a compound statement recurses into another.
+  auto stmts = std::move(this->stmts);
+  while (!stmts.empty()) {
+    auto stmt = std::move(stmts.back());
+    stmts.pop_back();
+    if (auto* compound_stmt = DynCast<CompoundStmtNode>(stmt.get())) {
+      stmts.insert(stmts.end(),
+                   std::make_move_iterator(compound_stmt->stmts.begin()),
+                   std::make_move_iterator(compound_stmt->stmts.end()));
+      compound_stmt->stmts.clear();
+    }
+  }
+}
+
 void TransUnitNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -156,6 +192,10 @@ void IfStmtNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+IfStmtNode::~IfStmtNode() {
+  DestroyChildren(predicate, then, or_else);
+}
+
 void WhileStmtNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -164,6 +204,10 @@ void WhileStmtNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+WhileStmtNode::~WhileStmtNode() {
+  DestroyChildren(predicate, loop_body);
+}
+
 void ForStmtNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -172,6 +216,10 @@ void ForStmtNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+ForStmtNode::~ForStmtNode() {
+  DestroyChildren(loop_init, predicate, step, loop_body);
+}
+
 void ReturnStmtNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -212,6 +260,10 @@ void SwitchStmtNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+SwitchStmtNode::~SwitchStmtNode() {
+  DestroyChildren(ctrl, stmt);
+}
+
 void LabeledStmtNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -220,7 +272,9 @@ void LabeledStmtNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
-LabeledStmtNode::~LabeledStmtNode() = default;
+LabeledStmtNode::~LabeledStmtNode() {
+  DestroyChildren(stmt);
+}
 
 void IdLabeledStmtNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
@@ -318,6 +372,10 @@ void ArrSubExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+ArrSubExprNode::~ArrSubExprNode() {
+  DestroyChildren(arr, index);
+}
+
 void CondExprNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -326,6 +384,10 @@ void CondExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+CondExprNode::~CondExprNode() {
+  DestroyChildren(predicate, then, or_else);
+}
+
 void FuncCallExprNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -334,6 +396,10 @@ void FuncCallExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+FuncCallExprNode::~FuncCallExprNode() {
+  DestroyChildren(func_expr, args);
+}
+
 void PostfixArithExprNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -342,6 +408,10 @@ void PostfixArithExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+PostfixArithExprNode::~PostfixArithExprNode() {
+  DestroyChildren(operand);
+}
+
 void RecordMemExprNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -350,6 +420,10 @@ void RecordMemExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+RecordMemExprNode::~RecordMemExprNode() {
+  DestroyChildren(expr);
+}
+
 void UnaryExprNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -358,6 +432,10 @@ void UnaryExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+UnaryExprNode::~UnaryExprNode() {
+  DestroyChildren(operand);
+}
+
 void BinaryExprNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -366,6 +444,16 @@ void BinaryExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
 
+BinaryExprNode::~BinaryExprNode() {
+  // The left operand of a binary expression in the chain is taken out before
+  // the expression is destroyed, so no destructor recurses into the chain.
+  auto lhs = std::move(this->lhs);
+  while (auto* bin_expr = DynCast<BinaryExprNode>(lhs.get())) {
+    lhs = std::move(bin_expr->lhs);
+  }
+  DestroyChildren(lhs, rhs);
+}
+
 void AssignmentExprNode::Accept(NonModifyingVisitor& v) const {
   v.Visit(*this);
 }
@@ -383,3 +471,7 @@ void SimpleAssignmentExprNode::Accept(NonModifyingVisitor& v) const {
 void SimpleAssignmentExprNode::Accept(ModifyingVisitor& v) {
   v.Visit(*this);
 }
+
+SimpleAssignmentExprNode::~SimpleAssignmentExprNode() {
+  DestroyChildren(lhs, rhs);
+}
@@ -0,0 +1,1149 @@
+#include "ast_serializer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+#include "casting.hpp"
+#include "location.hpp"
+#include "mapped_file.hpp"
+#include "operator.hpp"
+#include "stack_segment.hpp"
+#include "static_visitor.hpp"
+#include "type.hpp"
+
+namespace {
+
+constexpr auto kMagic = std::string_view{"VCAST\0\0\0", 8};
+/// @note Bump this whenever the format changes, so that files of previous
+/// versions are rejected instead of misread.
+constexpr auto kVersion = std::uint32_t{4};
+/// @brief The magic, the version, the checksum, the count and offset of the
+/// three sections, and the count of the source files, whose table follows.
+constexpr auto kHeaderSize =
+    kMagic.size() + sizeof(std::uint64_t) + 8 * sizeof(std::uint32_t);
+/// @brief The string index of the path and the size of a source file.
+constexpr auto kSourceFileSize = 2 * sizeof(std::uint32_t);
+/// @brief The kind and the location that every node starts with.
+constexpr auto kNodeHeaderSize = sizeof(std::uint8_t) + sizeof(std::uint32_t);
+
+[[noreturn]] void ThrowMalformed() {
+  throw std::runtime_error{"malformed AST file"};
+}
+
+/// @return The 64-bit FNV-1a hash of `bytes`, continued from `hash` if the
+/// bytes follow others; a corrupted or truncated file is told by it before
+/// it's decoded.
+std::uint64_t ChecksumOf(std::string_view bytes,
+                         std::uint64_t hash = 0xcbf29ce484222325) {
+  for (const auto c : bytes) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= std::uint64_t{0x100000001b3};
+  }
+  return hash;
+}
+
+/// @throw `std::runtime_error` if `val` doesn't fit in 32 bits.
+std::uint32_t ToU32(std::size_t val) {
+  if (val > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::runtime_error{"AST too large to serialize"};
+  }
+  return static_cast<std::uint32_t>(val);
+}
+
+/// @brief Appends fixed-width integers in little-endian.
+class ByteWriter {
+ public:
+  void WriteU8(std::uint8_t val) {
+    bytes_.push_back(static_cast<char>(val));
+  }
+  void WriteU32(std::uint32_t val) {
+    for (auto i = 0; i < 4; ++i) {
+      bytes_.push_back(static_cast<char>((val >> (8 * i)) & 0xFF));
+    }
+  }
+  void WriteU64(std::uint64_t val) {
+    WriteU32(static_cast<std::uint32_t>(val));
+    WriteU32(static_cast<std::uint32_t>(val >> 32));
+  }
+  void WriteBytes(std::string_view bytes) {
+    bytes_.append(bytes);
+  }
+
+  const std::string& bytes() const noexcept {
+    return bytes_;
+  }
+
+ private:
+  std::string bytes_{};
+};
+
+/// @brief Reads fixed-width integers in little-endian.
+/// @throw `std::runtime_error` on reading past the end.
+class ByteReader {
+ public:
+  explicit ByteReader(std::string_view bytes) : bytes_{bytes} {}
+
+  std::uint8_t ReadU8() {
+    Require_(1);
+    return static_cast<std::uint8_t>(bytes_[pos_++]);
+  }
+  std::uint8_t PeekU8() const {
+    Require_(1);
+    return static_cast<std::uint8_t>(bytes_[pos_]);
+  }
+  std::uint32_t ReadU32() {
+    Require_(4);
+    auto val = std::uint32_t{0};
+    for (auto i = 0; i < 4; ++i) {
+      val |= std::uint32_t{static_cast<std::uint8_t>(bytes_[pos_++])}
+             << (8 * i);
+    }
+    return val;
+  }
+  std::uint64_t ReadU64() {
+    const auto low = std::uint64_t{ReadU32()};
+    return low | (std::uint64_t{ReadU32()} << 32);
+  }
+  std::string_view ReadBytes(std::size_t len) {
+    Require_(len);
+    const auto bytes = bytes_.substr(pos_, len);
+    pos_ += len;
+    return bytes;
+  }
+
+  /// @brief Reads the u32 count of a list whose items take at least
+  /// `min_item_size` bytes each.
+  /// @throw `std::runtime_error` if the items can't fit in the rest of the
+  /// bytes, so that a corrupted count isn't used to allocate.
+  std::uint32_t ReadCount(std::size_t min_item_size) {
+    const auto count = ReadU32();
+    if (count > size_left() / min_item_size) {
+      ThrowMalformed();
+    }
+    return count;
+  }
+
+  bool IsAtEnd() const noexcept {
+    return pos_ == bytes_.size();
+  }
+
+  std::size_t size_left()  // NOLINT(readability-identifier-naming)
+      const noexcept {
+    return bytes_.size() - pos_;
+  }
+
+ private:
+  std::string_view bytes_;
+  std::size_t pos_{0};
+
+  void Require_(std::size_t len) const {
+    if (bytes_.size() - pos_ < len) {
+      ThrowMalformed();
+    }
+  }
+};
+
+/// @return The part of `file` from `offset` to the end.
+std::string_view SectionAt(std::string_view file, std::uint32_t offset) {
+  if (offset > file.size()) {
+    ThrowMalformed();
+  }
+  return file.substr(offset);
+}
+
+/// @brief Gives each distinct string an index, in the order they're first
+/// interned.
+class StringTable {
+ public:
+  std::uint32_t Intern(const std::string& str) {
+    const auto [it, is_new] = indices_.try_emplace(str, ToU32(strs_.size()));
+    if (is_new) {
+      // Keys of an unordered map are never moved.
+      strs_.push_back(&it->first);
+    }
+    return it->second;
+  }
+
+  std::uint32_t size() const {  // NOLINT(readability-identifier-naming)
+    return ToU32(strs_.size());
+  }
+
+  std::string Encode() const {
+    auto section = ByteWriter{};
+    auto offset = std::size_t{0};
+    for (const auto* str : strs_) {
+      section.WriteU32(ToU32(offset));
+      offset += str->size();
+    }
+    section.WriteU32(ToU32(offset));
+    for (const auto* str : strs_) {
+      section.WriteBytes(*str);
+    }
+    return section.bytes();
+  }
+
+ private:
+  std::unordered_map<std::string, std::uint32_t> indices_{};
+  std::vector<const std::string*> strs_{};
+};
+
+/// @brief Gives each distinct type an index; the types that a type refers to
+/// are interned before the type itself.
+/// @note A type is identified by its encoded record, which refers to the other
+/// types by index, so two types are the same if and only if their records are.
+class TypeTable {
+ public:
+  explicit TypeTable(StringTable& strings) : strings_{strings} {}
+
+  std::uint32_t Intern(const Type& type) {
+    auto record = ByteWriter{};
+    record.WriteU8(static_cast<std::uint8_t>(type.kind()));
+    switch (type.kind()) {
+      case TypeKind::kPrim:
+        record.WriteU8(
+            static_cast<std::uint8_t>(Cast<PrimType>(type).prim_type()));
+        break;
+      case TypeKind::kPtr:
+        record.WriteU32(Intern(Cast<PtrType>(type).base_type()));
+        break;
+      case TypeKind::kArr: {
+        const auto& arr_type = Cast<ArrType>(type);
+        record.WriteU32(Intern(arr_type.element_type()));
+        record.WriteU64(arr_type.len());
+      } break;
+      case TypeKind::kFunc: {
+        const auto& func_type = Cast<FuncType>(type);
+        record.WriteU32(Intern(func_type.return_type()));
+        record.WriteU32(ToU32(func_type.param_types().size()));
+        for (const auto& param_type : func_type.param_types()) {
+          record.WriteU32(Intern(*param_type));
+        }
+      } break;
+      case TypeKind::kStruct:
+      case TypeKind::kUnion: {
+        const auto& record_type = Cast<RecordType>(type);
+        record.WriteU32(strings_.Intern(record_type.id()));
+        record.WriteU32(ToU32(record_type.fields().size()));
+        for (const auto& field : record_type.fields()) {
+          record.WriteU32(strings_.Intern(field->id));
+          record.WriteU32(Intern(*field->type));
+        }
+      } break;
+    }
+    const auto [it, is_new] =
+        indices_.try_emplace(record.bytes(), ToU32(records_.size()));
+    if (is_new) {
+      records_.push_back(&it->first);
+    }
+    return it->second;
+  }
+
+  std::uint32_t size() const {  // NOLINT(readability-identifier-naming)
+    return ToU32(records_.size());
+  }
+
+  std::string Encode() const {
+    auto section = ByteWriter{};
+    auto offset = std::size_t{0};
+    for (const auto* record : records_) {
+      section.WriteU32(ToU32(offset));
+      offset += record->size();
+    }
+    for (const auto* record : records_) {
+      section.WriteBytes(*record);
+    }
+    return section.bytes();
+  }
+
+ private:
+  StringTable& strings_;
+  std::unordered_map<std::string, std::uint32_t> indices_{};
+  std::vector<const std::string*> records_{};
+};
+
+/// @brief Writes the nodes in pre-order.
+class AstSerializer : public StaticVisitor<AstSerializer> {
+ public:
+  using StaticVisitor::Visit;
+
+  AstSerializer(ByteWriter& nodes, StringTable& strings, TypeTable& types)
+      : nodes_{nodes}, strings_{strings}, types_{types} {}
+
+  std::uint32_t num_of_nodes()  // NOLINT(readability-identifier-naming)
+      const noexcept {
+    return num_of_nodes_;
+  }
+
+  void Visit(const DeclStmtNode& decl_stmt) {
+    WriteNode_(decl_stmt);
+    WriteList_(decl_stmt.decls);
+  }
+
+  void Visit(const VarDeclNode& decl) {
+    WriteDecl_(decl);
+    WriteOptional_(decl.init);
+  }
+
+  void Visit(const ArrDeclNode& arr_decl) {
+    WriteDecl_(arr_decl);
+    WriteList_(arr_decl.init_list);
+  }
+
+  void Visit(const RecordDeclNode& record_decl) {
+    WriteDecl_(record_decl);
+    WriteList_(record_decl.fields);
+  }
+
+  void Visit(const FieldNode& field) {
+    WriteDecl_(field);
+  }
+
+  void Visit(const RecordVarDeclNode& record_var_decl) {
+    WriteDecl_(record_var_decl);
+    WriteList_(record_var_decl.inits);
+  }
+
+  void Visit(const ParamNode& parameter) {
+    WriteDecl_(parameter);
+  }
+
+  void Visit(const FuncDefNode& func_def) {
+    WriteDecl_(func_def);
+    WriteList_(func_def.parameters);
+    WriteOptional_(func_def.body);
+  }
+
+  void Visit(const LoopInitNode& loop_init) {
+    WriteNode_(loop_init);
+    std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
+  }
+
+  void Visit(const CompoundStmtNode& compound_stmt) {
+    VisitBlocks_(
+        compound_stmt,
+        [this](const CompoundStmtNode& block) {
+          WriteNode_(block);
+          nodes_.WriteU32(ToU32(block.stmts.size()));
+        },
+        [](const CompoundStmtNode&) {});
+  }
+
+  void Visit(const ExternDeclNode& extern_decl) {
+    WriteNode_(extern_decl);
+    std::visit([this](auto&& decl) { Dispatch(*decl); }, extern_decl.decl);
+  }
+
+  void Visit(const TransUnitNode& trans_unit) {
+    WriteNode_(trans_unit);
+    WriteList_(trans_unit.extern_decls);
+  }
+
+  void Visit(const IfStmtNode& if_stmt) {
+    WriteNode_(if_stmt);
+    Dispatch(*if_stmt.predicate);
+    Dispatch(*if_stmt.then);
+    WriteOptional_(if_stmt.or_else);
+  }
+
+  void Visit(const WhileStmtNode& while_stmt) {
+    WriteNode_(while_stmt);
+    nodes_.WriteU8(while_stmt.is_do_while);
+    Dispatch(*while_stmt.predicate);
+    Dispatch(*while_stmt.loop_body);
+  }
+
+  void Visit(const ForStmtNode& for_stmt) {
+    WriteNode_(for_stmt);
+    Dispatch(*for_stmt.loop_init);
+    Dispatch(*for_stmt.predicate);
+    Dispatch(*for_stmt.step);
+    Dispatch(*for_stmt.loop_body);
+  }
+
+  void Visit(const ReturnStmtNode& ret_stmt) {
+    WriteNode_(ret_stmt);
+    Dispatch(*ret_stmt.expr);
+  }
+
+  void Visit(const GotoStmtNode& goto_stmt) {
+    WriteNode_(goto_stmt);
+    nodes_.WriteU32(strings_.Intern(goto_stmt.label));
+  }
+
+  void Visit(const BreakStmtNode& break_stmt) {
+    WriteNode_(break_stmt);
+  }
+
+  void Visit(const ContinueStmtNode& continue_stmt) {
+    WriteNode_(continue_stmt);
+  }
+
+  void Visit(const SwitchStmtNode& switch_stmt) {
+    WriteNode_(switch_stmt);
+    Dispatch(*switch_stmt.ctrl);
+    Dispatch(*switch_stmt.stmt);
+  }
+
+  void Visit(const IdLabeledStmtNode& id_labeled_stmt) {
+    WriteNode_(id_labeled_stmt);
+    nodes_.WriteU32(strings_.Intern(id_labeled_stmt.label));
+    Dispatch(*id_labeled_stmt.stmt);
+  }
+
+  void Visit(const CaseStmtNode& case_stmt) {
+    WriteNode_(case_stmt);
+    Dispatch(*case_stmt.expr);
+    Dispatch(*case_stmt.stmt);
+  }
+
+  void Visit(const DefaultStmtNode& default_stmt) {
+    WriteNode_(default_stmt);
+    Dispatch(*default_stmt.stmt);
+  }
+
+  void Visit(const ExprStmtNode& expr_stmt) {
+    WriteNode_(expr_stmt);
+    Dispatch(*expr_stmt.expr);
+  }
+
+  void Visit(const InitExprNode& init_expr) {
+    WriteExpr_(init_expr);
+    WriteList_(init_expr.des);
+    Dispatch(*init_expr.expr);
+  }
+
+  void Visit(const ArrDesNode& arr_des) {
+    WriteNode_(arr_des);
+    Dispatch(*arr_des.index);
+  }
+
+  void Visit(const IdDesNode& id_des) {
+    WriteNode_(id_des);
+    nodes_.WriteU32(strings_.Intern(id_des.id));
+  }
+
+  void Visit(const NullExprNode& null_expr) {
+    WriteExpr_(null_expr);
+  }
+
+  void Visit(const IdExprNode& id_expr) {
+    WriteExpr_(id_expr);
+    nodes_.WriteU32(strings_.Intern(id_expr.id));
+  }
+
+  void Visit(const IntConstExprNode& int_expr) {
+    WriteExpr_(int_expr);
+    nodes_.WriteU64(int_expr.val);
+  }
+
+  void Visit(const ArgExprNode& arg_expr) {
+    WriteExpr_(arg_expr);
+    Dispatch(*arg_expr.arg);
+  }
+
+  void Visit(const ArrSubExprNode& arr_sub_expr) {
+    WriteExpr_(arr_sub_expr);
+    Dispatch(*arr_sub_expr.arr);
+    Dispatch(*arr_sub_expr.index);
+  }
+
+  void Visit(const CondExprNode& cond_expr) {
+    WriteExpr_(cond_expr);
+    Dispatch(*cond_expr.predicate);
+    Dispatch(*cond_expr.then);
+    Dispatch(*cond_expr.or_else);
+  }
+
+  void Visit(const FuncCallExprNode& call_expr) {
+    WriteExpr_(call_expr);
+    Dispatch(*call_expr.func_expr);
+    WriteList_(call_expr.args);
+  }
+
+  void Visit(const PostfixArithExprNode& postfix_expr) {
+    WriteExpr_(postfix_expr);
+    nodes_.WriteU8(static_cast<std::uint8_t>(postfix_expr.op));
+    Dispatch(*postfix_expr.operand);
+  }
+
+  void Visit(const RecordMemExprNode& mem_expr) {
+    WriteExpr_(mem_expr);
+    nodes_.WriteU8(static_cast<std::uint8_t>(mem_expr.op));
+    nodes_.WriteU32(strings_.Intern(mem_expr.id));
+    Dispatch(*mem_expr.expr);
+  }
+
+  void Visit(const UnaryExprNode& unary_expr) {
+    WriteExpr_(unary_expr);
+    nodes_.WriteU8(static_cast<std::uint8_t>(unary_expr.op));
+    Dispatch(*unary_expr.operand);
+  }
+
+  void Visit(const BinaryExprNode& bin_expr) {
+    VisitLeftChain_(
+        bin_expr,
+        [this](const BinaryExprNode& expr) {
+          WriteExpr_(expr);
+          nodes_.WriteU8(static_cast<std::uint8_t>(expr.op));
+        },
+        [this](const BinaryExprNode& expr) { Dispatch(*expr.rhs); });
+  }
+
+  void Visit(const SimpleAssignmentExprNode& assign_expr) {
+    WriteExpr_(assign_expr);
+    Dispatch(*assign_expr.lhs);
+    Dispatch(*assign_expr.rhs);
+  }
+
+ private:
+  ByteWriter& nodes_;
+  StringTable& strings_;
+  TypeTable& types_;
+  std::uint32_t num_of_nodes_{0};
+
+  void WriteNode_(const AstNode& node) {
+    ++num_of_nodes_;
+    nodes_.WriteU8(static_cast<std::uint8_t>(node.kind));
+    nodes_.WriteU32(node.loc.offset);
+  }
+
+  void WriteDecl_(const DeclNode& decl) {
+    WriteNode_(decl);
+    nodes_.WriteU32(strings_.Intern(decl.id));
+    nodes_.WriteU32(types_.Intern(*decl.type));
+  }
+
+  void WriteExpr_(const ExprNode& expr) {
+    WriteNode_(expr);
+    nodes_.WriteU32(types_.Intern(*expr.type));
+  }
+
+  template <typename Node>
+  void WriteList_(const std::vector<std::unique_ptr<Node>>& nodes) {
+    nodes_.WriteU32(ToU32(nodes.size()));
+    for (const auto& node : nodes) {
+      Dispatch(*node);
+    }
+  }
+
+  template <typename Node>
+  void WriteOptional_(const std::unique_ptr<Node>& node) {
+    nodes_.WriteU8(node != nullptr);
+    if (node) {
+      Dispatch(*node);
+    }
+  }
+};
+
+/// @brief Reads the nodes in pre-order, as they're written by
+/// `AstSerializer`.
+class AstDeserializer {
+ public:
+  /// @throw `std::runtime_error` if the header is of another version or
+  /// malformed.
+  explicit AstDeserializer(std::string_view file) : file_{file} {
+    auto header = ByteReader{file};
+    if (header.ReadBytes(kMagic.size()) != kMagic ||
+        header.ReadU32() != kVersion) {
+      throw std::runtime_error{"AST file of another version"};
+    }
+    const auto checksum = header.ReadU64();
+    if (checksum != ChecksumOf(file.substr(kMagic.size() + sizeof(kVersion) +
+                                           sizeof(checksum)))) {
+      ThrowMalformed();
+    }
+    const auto num_of_strings = header.ReadU32();
+    const auto strings_offset = header.ReadU32();
+    const auto num_of_types = header.ReadU32();
+    const auto types_offset = header.ReadU32();
+    num_of_nodes_ = header.ReadU32();
+    nodes_ = ByteReader{SectionAt(file, header.ReadU32())};
+    const auto num_of_source_files = header.ReadCount(kSourceFileSize);
+    for (auto i = std::uint32_t{0}; i < num_of_source_files; ++i) {
+      const auto path_index = header.ReadU32();
+      source_files_.emplace_back(path_index, header.ReadU32());
+    }
+    // The counts are checked against the sizes of the sections before
+    // anything is allocated for them.
+    if (num_of_nodes_ > nodes_.size_left() / kNodeHeaderSize) {
+      ThrowMalformed();
+    }
+    ReadStrings_(SectionAt(file, strings_offset), num_of_strings);
+    ReadTypes_(SectionAt(file, types_offset), num_of_types);
+    if (source_files_.empty()) {
+      ThrowMalformed();
+    }
+  }
+
+  SerializedAst Deserialize() {
+    auto trans_unit = ReadNode_<TransUnitNode>();
+    if (num_of_nodes_ != 0 || !nodes_.IsAtEnd()) {
+      ThrowMalformed();
+    }
+    auto line_map = LineMap{};
+    for (const auto& [path_index, size] : source_files_) {
+      line_map.AddFile(std::string{StringAt_(path_index)}, size);
+    }
+    return {std::move(line_map), std::move(trans_unit)};
+  }
+
+ private:
+  std::string_view file_;
+  ByteReader nodes_{{}};
+  /// @note The strings are views into the file.
+  std::vector<std::string_view> strings_{};
+  /// @brief The decoded types, which are cloned into the nodes.
+  std::vector<std::unique_ptr<Type>> types_{};
+  /// @brief The string index of the path and the size of each source file.
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> source_files_{};
+  /// @brief The number of nodes that are not read yet.
+  std::uint32_t num_of_nodes_{0};
+
+  void ReadStrings_(std::string_view section, std::uint32_t num_of_strings) {
+    // One offset past the last string.
+    if (num_of_strings >= section.size() / 4) {
+      ThrowMalformed();
+    }
+    auto offsets = ByteReader{section};
+    const auto blob = section.substr(
+        std::min(section.size(), (std::size_t{num_of_strings} + 1) * 4));
+    auto begin = offsets.ReadU32();
+    strings_.reserve(num_of_strings);
+    for (auto i = std::uint32_t{0}; i < num_of_strings; ++i) {
+      const auto end = offsets.ReadU32();
+      if (begin > end || end > blob.size()) {
+        ThrowMalformed();
+      }
+      strings_.push_back(blob.substr(begin, end - begin));
+      begin = end;
+    }
+  }
+
+  void ReadTypes_(std::string_view section, std::uint32_t num_of_types) {
+    if (num_of_types > section.size() / 4) {
+      ThrowMalformed();
+    }
+    auto offsets = ByteReader{section};
+    const auto records =
+        section.substr(std::min(section.size(), std::size_t{num_of_types} * 4));
+    types_.reserve(num_of_types);
+    for (auto i = std::uint32_t{0}; i < num_of_types; ++i) {
+      const auto offset = offsets.ReadU32();
+      if (offset > records.size()) {
+        ThrowMalformed();
+      }
+      auto record = ByteReader{records.substr(offset)};
+      types_.push_back(ReadTypeRecord_(record));
+    }
+  }
+
+  std::unique_ptr<Type> ReadTypeRecord_(ByteReader& record) {
+    const auto kind = ToEnum_(record.ReadU8(), /* last */ TypeKind::kUnion);
+    switch (kind) {
+      case TypeKind::kPrim: {
+        const auto prim_type = record.ReadU8();
+        if (prim_type > static_cast<std::uint8_t>(PrimitiveType::kULong)) {
+          ThrowMalformed();
+        }
+        return std::make_unique<PrimType>(
+            static_cast<PrimitiveType>(prim_type));
+      }
+      case TypeKind::kPtr:
+        return std::make_unique<PtrType>(TypeAt_(record.ReadU32()));
+      case TypeKind::kArr: {
+        auto element_type = TypeAt_(record.ReadU32());
+        const auto len = record.ReadU64();
+        return std::make_unique<ArrType>(std::move(element_type), len);
+      }
+      case TypeKind::kFunc: {
+        auto return_type = TypeAt_(record.ReadU32());
+        auto param_types = std::vector<std::unique_ptr<Type>>{};
+        const auto num_of_params = record.ReadCount(/* index */ 4);
+        for (auto i = std::uint32_t{0}; i < num_of_params; ++i) {
+          param_types.push_back(TypeAt_(record.ReadU32()));
+        }
+        return std::make_unique<FuncType>(std::move(return_type),
+                                          std::move(param_types));
+      }
+      case TypeKind::kStruct:
+      case TypeKind::kUnion: {
+        auto id = std::string{StringAt_(record.ReadU32())};
+        auto fields = std::vector<std::unique_ptr<Field>>{};
+        const auto num_of_fields = record.ReadCount(/* id and type */ 8);
+        for (auto i = std::uint32_t{0}; i < num_of_fields; ++i) {
+          auto field_id = std::string{StringAt_(record.ReadU32())};
+          fields.push_back(std::make_unique<Field>(std::move(field_id),
+                                                   TypeAt_(record.ReadU32())));
+        }
+        if (kind == TypeKind::kStruct) {
+          return std::make_unique<StructType>(std::move(id), std::move(fields));
+        }
+        return std::make_unique<UnionType>(std::move(id), std::move(fields));
+      }
+    }
+    ThrowMalformed();
+  }
+
+  std::string_view StringAt_(std::uint32_t index) const {
+    if (index >= strings_.size()) {
+      ThrowMalformed();
+    }
+    return strings_[index];
+  }
+
+  std::unique_ptr<Type> TypeAt_(std::uint32_t index) const {
+    if (index >= types_.size()) {
+      ThrowMalformed();
+    }
+    return types_[index]->Clone();
+  }
+
+  std::string ReadString_() {
+    return std::string{StringAt_(nodes_.ReadU32())};
+  }
+
+  std::unique_ptr<Type> ReadType_() {
+    return TypeAt_(nodes_.ReadU32());
+  }
+
+  /// @throw `std::runtime_error` if the node read isn't a `Node`.
+  template <typename Node>
+  std::unique_ptr<Node> ReadNode_() {
+    return Downcast_<Node>(ReadAnyNode_());
+  }
+
+  template <typename Node>
+  static std::unique_ptr<Node> Downcast_(std::unique_ptr<AstNode> node) {
+    if (!Isa<Node>(*node)) {
+      ThrowMalformed();
+    }
+    return std::unique_ptr<Node>{static_cast<Node*>(node.release())};
+  }
+
+  template <typename Node>
+  std::unique_ptr<Node> ReadOptional_() {
+    return nodes_.ReadU8() ? ReadNode_<Node>() : nullptr;
+  }
+
+  /// @return The number of nodes in a list.
+  std::uint32_t ReadLength_() {
+    const auto num_of_nodes = nodes_.ReadCount(kNodeHeaderSize);
+    if (num_of_nodes > num_of_nodes_) {
+      ThrowMalformed();
+    }
+    return num_of_nodes;
+  }
+
+  template <typename Node>
+  std::vector<std::unique_ptr<Node>> ReadList_() {
+    auto nodes = std::vector<std::unique_ptr<Node>>{};
+    const auto num_of_nodes = ReadLength_();
+    nodes.reserve(num_of_nodes);
+    for (auto i = std::uint32_t{0}; i < num_of_nodes; ++i) {
+      nodes.push_back(ReadNode_<Node>());
+    }
+    return nodes;
+  }
+
+  /// @throw `std::runtime_error` if `val` is greater than `last`.
+  template <typename Enum>
+  static Enum ToEnum_(std::uint8_t val, Enum last) {
+    if (val > static_cast<std::uint8_t>(last)) {
+      ThrowMalformed();
+    }
+    return static_cast<Enum>(val);
+  }
+
+  template <typename Expr>
+  static std::unique_ptr<Expr> WithType_(std::unique_ptr<Expr> expr,
+                                         std::unique_ptr<Type> type) {
+    expr->type = std::move(type);
+    return expr;
+  }
+
+  /// @brief Reads the kind and the location of the next node, only if it's of
+  /// `kind`.
+  /// @return The location of the node; `std::nullopt` if it's not of `kind`.
+  std::optional<Location> ReadHeaderIf_(AstNodeKind kind) {
+    if (num_of_nodes_ == 0 ||
+        nodes_.PeekU8() != static_cast<std::uint8_t>(kind)) {
+      return std::nullopt;
+    }
+    --num_of_nodes_;
+    nodes_.ReadU8();
+    return Location{nodes_.ReadU32()};
+  }
+
+  std::unique_ptr<AstNode> ReadAnyNode_();
+  /// @brief Reads a compound statement whose header is read, entering the
+  /// nested compound statements with an explicit stack instead of recursion.
+  std::unique_ptr<CompoundStmtNode> ReadCompoundStmt_(Location loc);
+  /// @brief Reads a binary expression whose header is read, along with the
+  /// chain of binary expressions in its left operands, without recursion.
+  std::unique_ptr<ExprNode> ReadBinaryExpr_(Location loc);
+};
+
+std::unique_ptr<AstNode> AstDeserializer::ReadAnyNode_() {
+  // The nodes may be nested arbitrarily deep.
+  if (!HasSufficientStack()) {
+    return WithSufficientStack([this] { return ReadAnyNode_(); });
+  }
+  if (num_of_nodes_ == 0) {
+    ThrowMalformed();
+  }
+  --num_of_nodes_;
+  const auto kind =
+      ToEnum_(nodes_.ReadU8(), /* last */ AstNodeKind::kTransUnit);
+  const auto loc = Location{nodes_.ReadU32()};
+  switch (kind) {
+    case AstNodeKind::kVarDecl: {
+      auto id = ReadString_();
+      auto type = ReadType_();
+      auto init = ReadOptional_<ExprNode>();
+      return std::make_unique<VarDeclNode>(loc, std::move(id), std::move(type),
+                                           std::move(init));
+    }
+    case AstNodeKind::kArrDecl: {
+      auto id = ReadString_();
+      auto type = ReadType_();
+      auto init_list = ReadList_<InitExprNode>();
+      return std::make_unique<ArrDeclNode>(loc, std::move(id), std::move(type),
+                                           std::move(init_list));
+    }
+    case AstNodeKind::kRecordDecl: {
+      auto id = ReadString_();
+      auto type = ReadType_();
+      auto fields = ReadList_<FieldNode>();
+      return std::make_unique<RecordDeclNode>(
+          loc, std::move(id), std::move(type), std::move(fields));
+    }
+    case AstNodeKind::kField: {
+      auto id = ReadString_();
+      auto type = ReadType_();
+      return std::make_unique<FieldNode>(loc, std::move(id), std::move(type));
+    }
+    case AstNodeKind::kRecordVarDecl: {
+      auto id = ReadString_();
+      auto type = ReadType_();
+      auto inits = ReadList_<InitExprNode>();
+      return std::make_unique<RecordVarDeclNode>(
+          loc, std::move(id), std::move(type), std::move(inits));
+    }
+    case AstNodeKind::kParam: {
+      auto id = ReadString_();
+      auto type = ReadType_();
+      return std::make_unique<ParamNode>(loc, std::move(id), std::move(type));
+    }
+    case AstNodeKind::kFuncDef: {
+      auto id = ReadString_();
+      auto type = ReadType_();
+      auto parameters = ReadList_<ParamNode>();
+      auto body = ReadOptional_<CompoundStmtNode>();
+      return std::make_unique<FuncDefNode>(loc, std::move(id),
+                                           std::move(parameters),
+                                           std::move(body), std::move(type));
+    }
+    case AstNodeKind::kDeclStmt:
+      return std::make_unique<DeclStmtNode>(loc, ReadList_<DeclNode>());
+    case AstNodeKind::kCompoundStmt:
+      return ReadCompoundStmt_(loc);
+    case AstNodeKind::kIfStmt: {
+      auto predicate = ReadNode_<ExprNode>();
+      auto then = ReadNode_<StmtNode>();
+      auto or_else = ReadOptional_<StmtNode>();
+      return std::make_unique<IfStmtNode>(loc, std::move(predicate),
+                                          std::move(then), std::move(or_else));
+    }
+    case AstNodeKind::kWhileStmt: {
+      const auto is_do_while = nodes_.ReadU8() != 0;
+      auto predicate = ReadNode_<ExprNode>();
+      auto loop_body = ReadNode_<StmtNode>();
+      return std::make_unique<WhileStmtNode>(loc, std::move(predicate),
+                                             std::move(loop_body), is_do_while);
+    }
+    case AstNodeKind::kForStmt: {
+      auto loop_init = ReadNode_<LoopInitNode>();
+      auto predicate = ReadNode_<ExprNode>();
+      auto step = ReadNode_<ExprNode>();
+      auto loop_body = ReadNode_<StmtNode>();
+      return std::make_unique<ForStmtNode>(
+          loc, std::move(loop_init), std::move(predicate), std::move(step),
+          std::move(loop_body));
+    }
+    case AstNodeKind::kReturnStmt:
+      return std::make_unique<ReturnStmtNode>(loc, ReadNode_<ExprNode>());
+    case AstNodeKind::kGotoStmt:
+      return std::make_unique<GotoStmtNode>(loc, ReadString_());
+    case AstNodeKind::kBreakStmt:
+      return std::make_unique<BreakStmtNode>(loc);
+    case AstNodeKind::kContinueStmt:
+      return std::make_unique<ContinueStmtNode>(loc);
+    case AstNodeKind::kSwitchStmt: {
+      auto ctrl = ReadNode_<ExprNode>();
+      auto stmt = ReadNode_<StmtNode>();
+      return std::make_unique<SwitchStmtNode>(loc, std::move(ctrl),
+                                              std::move(stmt));
+    }
+    case AstNodeKind::kExprStmt:
+      return std::make_unique<ExprStmtNode>(loc, ReadNode_<ExprNode>());
+    case AstNodeKind::kIdLabeledStmt: {
+      auto label = ReadString_();
+      auto stmt = ReadNode_<StmtNode>();
+      return std::make_unique<IdLabeledStmtNode>(loc, std::move(label),
+                                                 std::move(stmt));
+    }
+    case AstNodeKind::kCaseStmt: {
+      auto expr = ReadNode_<ExprNode>();
+      auto stmt = ReadNode_<StmtNode>();
+      return std::make_unique<CaseStmtNode>(loc, std::move(expr),
+                                            std::move(stmt));
+    }
+    case AstNodeKind::kDefaultStmt:
+      return std::make_unique<DefaultStmtNode>(loc, ReadNode_<StmtNode>());
+    case AstNodeKind::kInitExpr: {
+      auto type = ReadType_();
+      auto des = ReadList_<DesNode>();
+      auto expr = ReadNode_<ExprNode>();
+      return WithType_(
+          std::make_unique<InitExprNode>(loc, std::move(des), std::move(expr)),
+          std::move(type));
+    }
+    case AstNodeKind::kNullExpr:
+      return WithType_(std::make_unique<NullExprNode>(loc), ReadType_());
+    case AstNodeKind::kIdExpr: {
+      auto type = ReadType_();
+      return WithType_(std::make_unique<IdExprNode>(loc, ReadString_()),
+                       std::move(type));
+    }
+    case AstNodeKind::kIntConstExpr: {
+      auto type = ReadType_();
+      const auto val = nodes_.ReadU64();
+      return WithType_(std::make_unique<IntConstExprNode>(loc, val),
+                       std::move(type));
+    }
+    case AstNodeKind::kArgExpr: {
+      auto type = ReadType_();
+      auto arg = ReadNode_<ExprNode>();
+      return WithType_(std::make_unique<ArgExprNode>(loc, std::move(arg)),
+                       std::move(type));
+    }
+    case AstNodeKind::kArrSubExpr: {
+      auto type = ReadType_();
+      auto arr = ReadNode_<ExprNode>();
+      auto index = ReadNode_<ExprNode>();
+      return WithType_(std::make_unique<ArrSubExprNode>(loc, std::move(arr),
+                                                        std::move(index)),
+                       std::move(type));
+    }
+    case AstNodeKind::kCondExpr: {
+      auto type = ReadType_();
+      auto predicate = ReadNode_<ExprNode>();
+      auto then = ReadNode_<ExprNode>();
+      auto or_else = ReadNode_<ExprNode>();
+      return WithType_(
+          std::make_unique<CondExprNode>(loc, std::move(predicate),
+                                         std::move(then), std::move(or_else)),
+          std::move(type));
+    }
+    case AstNodeKind::kFuncCallExpr: {
+      auto type = ReadType_();
+      auto func_expr = ReadNode_<ExprNode>();
+      auto args = ReadList_<ArgExprNode>();
+      return WithType_(std::make_unique<FuncCallExprNode>(
+                           loc, std::move(func_expr), std::move(args)),
+                       std::move(type));
+    }
+    case AstNodeKind::kPostfixArithExpr: {
+      auto type = ReadType_();
+      const auto op = ToEnum_(nodes_.ReadU8(), PostfixOperator::kArrow);
+      auto operand = ReadNode_<ExprNode>();
+      return WithType_(
+          std::make_unique<PostfixArithExprNode>(loc, op, std::move(operand)),
+          std::move(type));
+    }
+    case AstNodeKind::kRecordMemExpr: {
+      auto type = ReadType_();
+      const auto op = ToEnum_(nodes_.ReadU8(), PostfixOperator::kArrow);
+      auto id = ReadString_();
+      auto expr = ReadNode_<ExprNode>();
+      return WithType_(std::make_unique<RecordMemExprNode>(
+                           loc, op, std::move(expr), std::move(id)),
+                       std::move(type));
+    }
+    case AstNodeKind::kUnaryExpr: {
+      auto type = ReadType_();
+      const auto op = ToEnum_(nodes_.ReadU8(), UnaryOperator::kBitComp);
+      auto operand = ReadNode_<ExprNode>();
+      return WithType_(
+          std::make_unique<UnaryExprNode>(loc, op, std::move(operand)),
+          std::move(type));
+    }
+    case AstNodeKind::kBinaryExpr:
+      return ReadBinaryExpr_(loc);
+    case AstNodeKind::kSimpleAssignmentExpr: {
+      auto type = ReadType_();
+      auto lhs = ReadNode_<ExprNode>();
+      auto rhs = ReadNode_<ExprNode>();
+      return WithType_(std::make_unique<SimpleAssignmentExprNode>(
+                           loc, std::move(lhs), std::move(rhs)),
+                       std::move(type));
+    }
+    case AstNodeKind::kArrDes:
+      return std::make_unique<ArrDesNode>(loc, ReadNode_<ExprNode>());
+    case AstNodeKind::kIdDes:
+      return std::make_unique<IdDesNode>(loc, ReadString_());
+    case AstNodeKind::kLoopInit: {
+      auto clause = ReadAnyNode_();
+      if (Isa<DeclStmtNode>(*clause)) {
+        return std::make_unique<LoopInitNode>(
+            loc, Downcast_<DeclStmtNode>(std::move(clause)));
+      }
+      return std::make_unique<LoopInitNode>(
+          loc, Downcast_<ExprNode>(std::move(clause)));
+    }
+    case AstNodeKind::kExternDecl: {
+      auto decl = ReadAnyNode_();
+      if (Isa<FuncDefNode>(*decl)) {
+        return std::make_unique<ExternDeclNode>(
+            loc, Downcast_<FuncDefNode>(std::move(decl)));
+      }
+      return std::make_unique<ExternDeclNode>(
+          loc, Downcast_<DeclStmtNode>(std::move(decl)));
+    }
+    case AstNodeKind::kTransUnit:
+      return std::make_unique<TransUnitNode>(loc,
+                                             ReadList_<ExternDeclNode>());
+  }
+  ThrowMalformed();
+}
+
+std::unique_ptr<CompoundStmtNode> AstDeserializer::ReadCompoundStmt_(
+    Location loc) {
+  struct Block {
+    Location loc;
+    std::uint32_t num_of_stmts;
+    std::vector<std::unique_ptr<StmtNode>> stmts;
+  };
+  auto blocks = std::vector<Block>{};
+  blocks.push_back({loc, ReadLength_(), {}});
+  while (true) {
+    auto& block = blocks.back();
+    if (block.stmts.size() < block.num_of_stmts) {
+      if (const auto nested_loc = ReadHeaderIf_(AstNodeKind::kCompoundStmt)) {
+        blocks.push_back({*nested_loc, ReadLength_(), {}});
+      } else {
+        block.stmts.push_back(ReadNode_<StmtNode>());
+      }
+      continue;
+    }
+    auto compound_stmt =
+        std::make_unique<CompoundStmtNode>(block.loc, std::move(block.stmts));
+    blocks.pop_back();
+    if (blocks.empty()) {
+      return compound_stmt;
+    }
+    blocks.back().stmts.push_back(std::move(compound_stmt));
+  }
+}
+
+std::unique_ptr<ExprNode> AstDeserializer::ReadBinaryExpr_(Location loc) {
+  struct Operation {
+    Location loc;
+    std::unique_ptr<Type> type;
+    BinaryOperator op;
+  };
+  // The headers of the chain come first, from the outermost expression down.
+  auto chain = std::vector<Operation>{};
+  for (auto next_loc = std::optional<Location>{loc}; next_loc;
+       next_loc = ReadHeaderIf_(AstNodeKind::kBinaryExpr)) {
+    auto type = ReadType_();
+    const auto op = ToEnum_(nodes_.ReadU8(), BinaryOperator::kComma);
+    chain.push_back({*next_loc, std::move(type), op});
+  }
+  auto expr = ReadNode_<ExprNode>();
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+    auto rhs = ReadNode_<ExprNode>();
+    expr = WithType_(std::make_unique<BinaryExprNode>(
+                         it->loc, it->op, std::move(expr), std::move(rhs)),
+                     std::move(it->type));
+  }
+  return expr;
+}
+
+}  // namespace
+
+void SerializeAst(const TransUnitNode& trans_unit, const LineMap& line_map,
+                  std::ostream& output) {
+  auto strings = StringTable{};
+  auto types = TypeTable{strings};
+  auto nodes = ByteWriter{};
+  auto source_files = ByteWriter{};
+  const auto files = line_map.Files();
+  for (const auto& [path, size] : files) {
+    source_files.WriteU32(
+        strings.Intern(std::filesystem::absolute(path).string()));
+    source_files.WriteU32(size);
+  }
+  auto serializer = AstSerializer{nodes, strings, types};
+  serializer.Dispatch(trans_unit);
+
+  const auto string_section = strings.Encode();
+  const auto type_section = types.Encode();
+  // The checksum covers the rest of the header, which is written first.
+  auto header = ByteWriter{};
+  auto offset = kHeaderSize + source_files.bytes().size();
+  header.WriteU32(strings.size());
+  header.WriteU32(ToU32(offset));
+  offset += string_section.size();
+  header.WriteU32(types.size());
+  header.WriteU32(ToU32(offset));
+  offset += type_section.size();
+  header.WriteU32(serializer.num_of_nodes());
+  header.WriteU32(ToU32(offset));
+  header.WriteU32(ToU32(files.size()));
+  header.WriteBytes(source_files.bytes());
+
+  auto checksum = ChecksumOf(header.bytes());
+  for (const auto section : {std::string_view{string_section},
+                             std::string_view{type_section},
+                             std::string_view{nodes.bytes()}}) {
+    checksum = ChecksumOf(section, checksum);
+  }
+  auto prefix = ByteWriter{};
+  prefix.WriteBytes(kMagic);
+  prefix.WriteU32(kVersion);
+  prefix.WriteU64(checksum);
+  output << prefix.bytes() << header.bytes() << string_section << type_section
+         << nodes.bytes();
+}
+
+bool IsSerializedAst(const std::filesystem::path& path) {
+  auto input = std::ifstream{path, std::ios::binary};
+  auto magic = std::string(kMagic.size(), '\0');
+  return input.read(magic.data(), static_cast<std::streamsize>(magic.size())) &&
+         magic == kMagic;
+}
+
+SerializedAst DeserializeAst(const std::filesystem::path& path) {
+  const auto file = MappedFile{path};
+  if (!file.is_open()) {
+    throw std::runtime_error{"cannot map AST file"};
+  }
+  return AstDeserializer{file.bytes()}.Deserialize();
+}
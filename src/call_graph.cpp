@@ -0,0 +1,144 @@
+#include "call_graph.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+#include "casting.hpp"
+#include "expr_slot_visitor.hpp"
+
+const std::string* FuncNameOf(const ExprNode& expr) {
+  const auto* id_expr = DynCast<IdExprNode>(&expr);
+  return id_expr && id_expr->type->IsFunc() ? &id_expr->id : nullptr;
+}
+
+const std::string* CalleeOf(const FuncCallExprNode& call_expr) {
+  return FuncNameOf(*call_expr.func_expr);
+}
+
+CallGraph::CallGraph(const TransUnitNode& trans_unit) {
+  auto num_of_refs = std::unordered_map<std::string, std::size_t>{};
+  auto num_of_calls = std::unordered_map<std::string, std::size_t>{};
+  for (const auto& extern_decl : trans_unit.extern_decls) {
+    const auto* func_def =
+        std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl);
+    if (!func_def) {
+      continue;
+    }
+    const auto& caller = (*func_def)->id;
+    funcs_.push_back(caller);
+    auto& callees = callees_[caller];
+    // The slot of the function of a call is visited before the call itself.
+    ConstExprSlotVisitor{[&](const std::unique_ptr<ExprNode>& expr) {
+      if (const auto* call_expr = DynCast<FuncCallExprNode>(expr.get())) {
+        if (const auto* callee = CalleeOf(*call_expr)) {
+          ++num_of_calls[*callee];
+        }
+      } else if (const auto* func = FuncNameOf(*expr)) {
+        ++num_of_refs[*func];
+        if (std::find(callees.cbegin(), callees.cend(), *func) ==
+            callees.cend()) {
+          callees.push_back(*func);
+        }
+      }
+    }}.Dispatch(**func_def);
+  }
+  for (const auto& [func, num] : num_of_refs) {
+    if (num != num_of_calls[func]) {
+      address_taken_.insert(func);
+    }
+  }
+}
+
+const std::vector<std::string>& CallGraph::CalleesOf(
+    const std::string& func) const {
+  static const auto kNoCallees = std::vector<std::string>{};
+  const auto callees = callees_.find(func);
+  return callees != callees_.cend() ? callees->second : kNoCallees;
+}
+
+bool CallGraph::IsAddressTaken(const std::string& func) const {
+  return address_taken_.count(func) != 0;
+}
+
+std::unordered_set<std::string> CallGraph::ReachableFrom(
+    const std::vector<std::string>& roots) const {
+  auto reachable = std::unordered_set<std::string>{};
+  auto worklist = std::vector<std::string>{};
+  for (const auto& root : roots) {
+    if (callees_.count(root) != 0 && reachable.insert(root).second) {
+      worklist.push_back(root);
+    }
+  }
+  while (!worklist.empty()) {
+    const auto func = std::move(worklist.back());
+    worklist.pop_back();
+    for (const auto& callee : CalleesOf(func)) {
+      if (callees_.count(callee) != 0 && reachable.insert(callee).second) {
+        worklist.push_back(callee);
+      }
+    }
+  }
+  return reachable;
+}
+
+std::vector<std::string> CallGraph::LocalityOrder() const {
+  auto order = std::vector<std::string>{};
+  auto is_placed = std::unordered_set<std::string>{};
+  // Each function is paired with the index of its next callee to walk into;
+  // the stack is explicit, so that deep chains of calls don't overflow.
+  auto stack = std::vector<std::pair<const std::string*, std::size_t>>{};
+  const auto walk_from = [&](const std::string& root) {
+    if (!is_placed.insert(root).second) {
+      return;
+    }
+    order.push_back(root);
+    stack.emplace_back(&root, 0);
+    while (!stack.empty()) {
+      auto& [func, next] = stack.back();
+      const auto& callees = CalleesOf(*func);
+      if (next == callees.size()) {
+        stack.pop_back();
+        continue;
+      }
+      const auto& callee = callees.at(next++);
+      if (callees_.count(callee) != 0 && is_placed.insert(callee).second) {
+        order.push_back(callee);
+        stack.emplace_back(&callee, 0);
+      }
+    }
+  };
+  if (callees_.count("main") != 0) {
+    walk_from(*std::find(funcs_.cbegin(), funcs_.cend(), "main"));
+  }
+  for (const auto& func : funcs_) {
+    walk_from(func);
+  }
+  return order;
+}
+
+void OrderFuncsByCalls(TransUnitNode& trans_unit) {
+  const auto order = CallGraph{trans_unit}.LocalityOrder();
+  auto position = std::unordered_map<std::string, std::size_t>{};
+  for (auto i = std::size_t{0}, e = order.size(); i < e; ++i) {
+    position.emplace(order.at(i), i);
+  }
+  // The declarations keep their relative order, ahead of the functions.
+  std::stable_sort(
+      trans_unit.extern_decls.begin(), trans_unit.extern_decls.end(),
+      [&position](const auto& lhs, const auto& rhs) {
+        const auto position_of = [&position](const ExternDeclNode& decl) {
+          const auto* func_def =
+              std::get_if<std::unique_ptr<FuncDefNode>>(&decl.decl);
+          return func_def ? position.at((*func_def)->id) + 1 : 0;
+        };
+        return position_of(*lhs) < position_of(*rhs);
+      });
+}
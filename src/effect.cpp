@@ -0,0 +1,629 @@
+#include "effect.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+#include "call_graph.hpp"
+#include "casting.hpp"
+#include "operator.hpp"
+#include "stack_segment.hpp"
+#include "static_visitor.hpp"
+#include "type.hpp"
+
+namespace {
+
+/// @brief Joins the effects of the evaluation of a function body or an
+/// expression.
+/// @note In the body of a function, the objects of its own variables are told
+/// apart from the others, and the calls are recorded rather than joined, as
+/// the effects of the callees are yet to be known; in an expression, every
+/// object may be seen by others, and the callees are already analyzed.
+class EffectVisitor : public StaticVisitor<EffectVisitor> {
+ public:
+  using StaticVisitor::Visit;
+
+  /// @brief Analyzes the body of a function.
+  /// @param locals The parameters of the function, which the variables that
+  /// it declares are added to.
+  EffectVisitor(std::unordered_set<std::string>& locals,
+                std::unordered_set<std::string>& address_taken,
+                std::vector<std::string>& callees)
+      : locals_{&locals},
+        address_taken_{&address_taken},
+        callees_{&callees} {}
+
+  /// @brief Analyzes an expression, calling functions of known `effects`.
+  explicit EffectVisitor(
+      const std::unordered_map<std::string, Effect>& effects)
+      : effects_{&effects} {}
+
+  Effect effect() const noexcept {  // NOLINT(readability-identifier-naming)
+    return effect_;
+  }
+
+  void Visit(const DeclStmtNode& decl_stmt) {
+    for (const auto& decl : decl_stmt.decls) {
+      Dispatch(*decl);
+    }
+  }
+
+  void Visit(const VarDeclNode& decl) {
+    if (decl.init) {
+      Dispatch(*decl.init);
+    }
+    Declare_(decl.id);
+  }
+
+  void Visit(const ArrDeclNode& arr_decl) {
+    for (const auto& init : arr_decl.init_list) {
+      Dispatch(*init);
+    }
+    Declare_(arr_decl.id);
+  }
+
+  void Visit(const RecordVarDeclNode& record_var_decl) {
+    for (const auto& init : record_var_decl.inits) {
+      Dispatch(*init);
+    }
+    Declare_(record_var_decl.id);
+  }
+
+  void Visit(const LoopInitNode& loop_init) {
+    std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
+  }
+
+  void Visit(const CompoundStmtNode& compound_stmt) {
+    VisitBlocks_(
+        compound_stmt, [](const CompoundStmtNode&) {},
+        [](const CompoundStmtNode&) {});
+  }
+
+  void Visit(const IfStmtNode& if_stmt) {
+    Dispatch(*if_stmt.predicate);
+    Dispatch(*if_stmt.then);
+    if (if_stmt.or_else) {
+      Dispatch(*if_stmt.or_else);
+    }
+  }
+
+  void Visit(const WhileStmtNode& while_stmt) {
+    RaiseIfEndless_(*while_stmt.predicate);
+    Dispatch(*while_stmt.predicate);
+    Dispatch(*while_stmt.loop_body);
+  }
+
+  void Visit(const ForStmtNode& for_stmt) {
+    RaiseIfEndless_(*for_stmt.predicate);
+    Dispatch(*for_stmt.loop_init);
+    Dispatch(*for_stmt.predicate);
+    Dispatch(*for_stmt.step);
+    Dispatch(*for_stmt.loop_body);
+  }
+
+  void Visit(const ReturnStmtNode& ret_stmt) {
+    Dispatch(*ret_stmt.expr);
+  }
+
+  void Visit(const GotoStmtNode&) {
+    // A jump backward may loop forever.
+    Raise_(Effect::kSideEffecting);
+  }
+
+  void Visit(const SwitchStmtNode& switch_stmt) {
+    Dispatch(*switch_stmt.ctrl);
+    Dispatch(*switch_stmt.stmt);
+  }
+
+  void Visit(const LabeledStmtNode& labeled_stmt) {
+    Dispatch(*labeled_stmt.stmt);
+  }
+
+  void Visit(const CaseStmtNode& case_stmt) {
+    Dispatch(*case_stmt.expr);
+    Dispatch(*case_stmt.stmt);
+  }
+
+  void Visit(const ExprStmtNode& expr_stmt) {
+    Dispatch(*expr_stmt.expr);
+  }
+
+  void Visit(const InitExprNode& init_expr) {
+    Dispatch(*init_expr.expr);
+  }
+
+  void Visit(const ArgExprNode& arg_expr) {
+    Dispatch(*arg_expr.arg);
+  }
+
+  void Visit(const IdExprNode& id_expr) {
+    // The address of a function is a constant.
+    if (!id_expr.type->IsFunc()) {
+      Read_(id_expr);
+    }
+  }
+
+  void Visit(const ArrSubExprNode& arr_sub_expr) {
+    Dispatch(*arr_sub_expr.arr);
+    Dispatch(*arr_sub_expr.index);
+    Read_(arr_sub_expr);
+  }
+
+  void Visit(const CondExprNode& cond_expr) {
+    Dispatch(*cond_expr.predicate);
+    Dispatch(*cond_expr.then);
+    Dispatch(*cond_expr.or_else);
+  }
+
+  void Visit(const FuncCallExprNode& call_expr) {
+    Dispatch(*call_expr.func_expr);
+    for (const auto& arg : call_expr.args) {
+      Dispatch(*arg);
+    }
+    const auto* callee = CalleeOf(call_expr);
+    if (!callee) {
+      Raise_(Effect::kSideEffecting);
+    } else if (callees_) {
+      callees_->push_back(*callee);
+    } else {
+      const auto it = effects_->find(*callee);
+      Raise_(it != effects_->cend() ? it->second : Effect::kSideEffecting);
+    }
+  }
+
+  void Visit(const PostfixArithExprNode& postfix_expr) {
+    Dispatch(*postfix_expr.operand);
+    if (postfix_expr.op == PostfixOperator::kIncr ||
+        postfix_expr.op == PostfixOperator::kDecr) {
+      Write_(*postfix_expr.operand);
+    }
+  }
+
+  void Visit(const RecordMemExprNode& mem_expr) {
+    Dispatch(*mem_expr.expr);
+    Read_(mem_expr);
+  }
+
+  void Visit(const UnaryExprNode& unary_expr) {
+    Dispatch(*unary_expr.operand);
+    switch (unary_expr.op) {
+      case UnaryOperator::kIncr:
+      case UnaryOperator::kDecr:
+        Write_(*unary_expr.operand);
+        break;
+      case UnaryOperator::kDeref:
+        Read_(unary_expr);
+        break;
+      case UnaryOperator::kAddr:
+        if (const auto* id_expr =
+                DynCast<IdExprNode>(unary_expr.operand.get());
+            id_expr && address_taken_) {
+          address_taken_->insert(id_expr->id);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  void Visit(const BinaryExprNode& bin_expr) {
+    VisitLeftChain_(
+        bin_expr, [](const BinaryExprNode&) {},
+        [this](const BinaryExprNode& expr) { Dispatch(*expr.rhs); });
+  }
+
+  void Visit(const SimpleAssignmentExprNode& assign_expr) {
+    Dispatch(*assign_expr.lhs);
+    Dispatch(*assign_expr.rhs);
+    Write_(*assign_expr.lhs);
+  }
+
+ private:
+  /// @note Only set when analyzing the body of a function.
+  std::unordered_set<std::string>* locals_ = nullptr;
+  std::unordered_set<std::string>* address_taken_ = nullptr;
+  std::vector<std::string>* callees_ = nullptr;
+  /// @note Only set when analyzing an expression.
+  const std::unordered_map<std::string, Effect>* effects_ = nullptr;
+
+  Effect effect_ = Effect::kPure;
+
+  void Raise_(Effect effect) {
+    effect_ = std::max(effect_, effect);
+  }
+
+  void Declare_(const std::string& id) {
+    if (locals_) {
+      locals_->insert(id);
+    }
+  }
+
+  /// @return Whether `expr` designates an object of a variable of the function
+  /// whose body is analyzed, which no one else can see unless its address is
+  /// taken.
+  bool IsLocal_(const ExprNode& expr) const {
+    if (!locals_) {
+      return false;
+    }
+    if (const auto* id_expr = DynCast<IdExprNode>(&expr)) {
+      return locals_->count(id_expr->id) != 0;
+    }
+    if (const auto* arr_sub_expr = DynCast<ArrSubExprNode>(&expr)) {
+      return arr_sub_expr->arr->type->IsArr() && IsLocal_(*arr_sub_expr->arr);
+    }
+    if (const auto* mem_expr = DynCast<RecordMemExprNode>(&expr)) {
+      return mem_expr->op == PostfixOperator::kDot && IsLocal_(*mem_expr->expr);
+    }
+    return false;
+  }
+
+  void Read_(const ExprNode& expr) {
+    if (!IsLocal_(expr)) {
+      Raise_(Effect::kReadOnly);
+    }
+  }
+
+  void Write_(const ExprNode& expr) {
+    if (!IsLocal_(expr)) {
+      Raise_(Effect::kSideEffecting);
+    }
+  }
+
+  /// @brief A loop on a constant condition may only be left by a jump, if at
+  /// all.
+  void RaiseIfEndless_(const ExprNode& predicate) {
+    const auto* int_const = DynCast<IntConstExprNode>(&predicate);
+    if (Isa<NullExprNode>(predicate) || (int_const && int_const->val != 0)) {
+      Raise_(Effect::kSideEffecting);
+    }
+  }
+};
+
+/// @brief Collects the variables that a loop declares or modifies, and whether
+/// it has a label that may be jumped to from outside.
+class LoopScanner : public StaticVisitor<LoopScanner> {
+ public:
+  using StaticVisitor::Visit;
+
+  /// @brief The variables that may change while the loop runs.
+  std::unordered_set<std::string> variants{};
+  bool has_label = false;
+
+  void Visit(const DeclStmtNode& decl_stmt) {
+    for (const auto& decl : decl_stmt.decls) {
+      variants.insert(decl->id);
+      Dispatch(*decl);
+    }
+  }
+
+  void Visit(const VarDeclNode& decl) {
+    if (decl.init) {
+      Dispatch(*decl.init);
+    }
+  }
+
+  void Visit(const ArrDeclNode& arr_decl) {
+    for (const auto& init : arr_decl.init_list) {
+      Dispatch(*init);
+    }
+  }
+
+  void Visit(const RecordVarDeclNode& record_var_decl) {
+    for (const auto& init : record_var_decl.inits) {
+      Dispatch(*init);
+    }
+  }
+
+  void Visit(const LoopInitNode& loop_init) {
+    std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
+  }
+
+  void Visit(const CompoundStmtNode& compound_stmt) {
+    VisitBlocks_(
+        compound_stmt, [](const CompoundStmtNode&) {},
+        [](const CompoundStmtNode&) {});
+  }
+
+  void Visit(const IfStmtNode& if_stmt) {
+    Dispatch(*if_stmt.predicate);
+    Dispatch(*if_stmt.then);
+    if (if_stmt.or_else) {
+      Dispatch(*if_stmt.or_else);
+    }
+  }
+
+  void Visit(const WhileStmtNode& while_stmt) {
+    Dispatch(*while_stmt.predicate);
+    Dispatch(*while_stmt.loop_body);
+  }
+
+  void Visit(const ForStmtNode& for_stmt) {
+    Dispatch(*for_stmt.loop_init);
+    Dispatch(*for_stmt.predicate);
+    Dispatch(*for_stmt.step);
+    Dispatch(*for_stmt.loop_body);
+  }
+
+  void Visit(const ReturnStmtNode& ret_stmt) {
+    Dispatch(*ret_stmt.expr);
+  }
+
+  void Visit(const SwitchStmtNode& switch_stmt) {
+    Dispatch(*switch_stmt.ctrl);
+    // The cases of a switch in the loop are jumped to from within the loop.
+    ++switch_depth_;
+    Dispatch(*switch_stmt.stmt);
+    --switch_depth_;
+  }
+
+  void Visit(const IdLabeledStmtNode& id_labeled_stmt) {
+    has_label = true;
+    Dispatch(*id_labeled_stmt.stmt);
+  }
+
+  void Visit(const CaseStmtNode& case_stmt) {
+    has_label = has_label || switch_depth_ == 0;
+    Dispatch(*case_stmt.stmt);
+  }
+
+  void Visit(const DefaultStmtNode& default_stmt) {
+    has_label = has_label || switch_depth_ == 0;
+    Dispatch(*default_stmt.stmt);
+  }
+
+  void Visit(const ExprStmtNode& expr_stmt) {
+    Dispatch(*expr_stmt.expr);
+  }
+
+  void Visit(const InitExprNode& init_expr) {
+    Dispatch(*init_expr.expr);
+  }
+
+  void Visit(const ArgExprNode& arg_expr) {
+    Dispatch(*arg_expr.arg);
+  }
+
+  void Visit(const ArrSubExprNode& arr_sub_expr) {
+    Dispatch(*arr_sub_expr.arr);
+    Dispatch(*arr_sub_expr.index);
+  }
+
+  void Visit(const CondExprNode& cond_expr) {
+    Dispatch(*cond_expr.predicate);
+    Dispatch(*cond_expr.then);
+    Dispatch(*cond_expr.or_else);
+  }
+
+  void Visit(const FuncCallExprNode& call_expr) {
+    Dispatch(*call_expr.func_expr);
+    for (const auto& arg : call_expr.args) {
+      Dispatch(*arg);
+    }
+  }
+
+  void Visit(const PostfixArithExprNode& postfix_expr) {
+    Dispatch(*postfix_expr.operand);
+    Modify_(*postfix_expr.operand);
+  }
+
+  void Visit(const RecordMemExprNode& mem_expr) {
+    Dispatch(*mem_expr.expr);
+  }
+
+  void Visit(const UnaryExprNode& unary_expr) {
+    Dispatch(*unary_expr.operand);
+    if (unary_expr.op == UnaryOperator::kIncr ||
+        unary_expr.op == UnaryOperator::kDecr) {
+      Modify_(*unary_expr.operand);
+    }
+  }
+
+  void Visit(const BinaryExprNode& bin_expr) {
+    VisitLeftChain_(
+        bin_expr, [](const BinaryExprNode&) {},
+        [this](const BinaryExprNode& expr) { Dispatch(*expr.rhs); });
+  }
+
+  void Visit(const SimpleAssignmentExprNode& assign_expr) {
+    Dispatch(*assign_expr.lhs);
+    Dispatch(*assign_expr.rhs);
+    Modify_(*assign_expr.lhs);
+  }
+
+ private:
+  int switch_depth_ = 0;
+
+  /// @note Only a variable as a whole is of interest; an element or a member
+  /// is never an argument that is hoisted.
+  void Modify_(const ExprNode& expr) {
+    if (const auto* id_expr = DynCast<IdExprNode>(&expr)) {
+      variants.insert(id_expr->id);
+    }
+  }
+};
+
+}  // namespace
+
+EffectAnalysis::EffectAnalysis(const TransUnitNode& trans_unit) {
+  // The body of each function is analyzed once; then only the effects of the
+  // callees are joined until none changes. Every function starts as pure, so
+  // the effects only rise.
+  struct Summary {
+    Effect effect;
+    std::vector<std::string> callees;
+  };
+  auto summaries = std::unordered_map<std::string, Summary>{};
+  for (const auto& extern_decl : trans_unit.extern_decls) {
+    const auto* func_def =
+        std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl);
+    if (!func_def || !(*func_def)->body) {
+      continue;
+    }
+    const auto& id = (*func_def)->id;
+    auto locals = std::unordered_set<std::string>{};
+    for (const auto& parameter : (*func_def)->parameters) {
+      // An array parameter is a pointer to the array of the caller.
+      if (!parameter->type->IsArr()) {
+        locals.insert(parameter->id);
+      }
+    }
+    auto& summary = summaries[id];
+    auto visitor = EffectVisitor{locals, address_taken_[id], summary.callees};
+    visitor.Dispatch(*(*func_def)->body);
+    summary.effect = visitor.effect();
+    effects_.emplace(id, Effect::kPure);
+  }
+  for (auto is_changed = true; is_changed;) {
+    is_changed = false;
+    for (const auto& [id, summary] : summaries) {
+      auto effect = summary.effect;
+      for (const auto& callee : summary.callees) {
+        effect = std::max(effect, EffectOfFunc(callee));
+      }
+      if (effect != effects_.at(id)) {
+        effects_.at(id) = effect;
+        is_changed = true;
+      }
+    }
+  }
+}
+
+Effect EffectAnalysis::EffectOfFunc(const std::string& func) const {
+  const auto it = effects_.find(func);
+  return it != effects_.cend() ? it->second : Effect::kSideEffecting;
+}
+
+Effect EffectAnalysis::EffectOf(const ExprNode& expr) const {
+  auto visitor = EffectVisitor{effects_};
+  visitor.Dispatch(expr);
+  return visitor.effect();
+}
+
+std::vector<const FuncCallExprNode*> EffectAnalysis::HoistableCallsOf(
+    const StmtNode& loop, const std::string& func) const {
+  const auto* while_stmt = DynCast<WhileStmtNode>(&loop);
+  const auto* for_stmt = DynCast<ForStmtNode>(&loop);
+  if ((!while_stmt || while_stmt->is_do_while) && !for_stmt) {
+    return {};
+  }
+  // The loop is scanned only once a call in its predicate may be hoisted, so
+  // that nested loops aren't scanned over and over.
+  auto scanner = std::optional<LoopScanner>{};
+  const auto scanned = [&]() -> const LoopScanner& {
+    if (!scanner) {
+      scanner.emplace();
+      if (while_stmt) {
+        scanner->Dispatch(*while_stmt);
+      } else {
+        // The initialization runs before the hoisted calls.
+        scanner->Dispatch(*for_stmt->predicate);
+        scanner->Dispatch(*for_stmt->step);
+        scanner->Dispatch(*for_stmt->loop_body);
+      }
+    }
+    return *scanner;
+  };
+  const auto address_taken = address_taken_.find(func);
+
+  /// @return Whether the value of `expr` is the same each time the loop
+  /// evaluates it. A division isn't, as it may trap where the loop wouldn't
+  /// have divided.
+  const auto is_invariant = [&](const auto& self,
+                                const ExprNode& expr) -> bool {
+    if (!HasSufficientStack()) {
+      return WithSufficientStack([&] { return self(self, expr); });
+    }
+    if (Isa<IntConstExprNode>(expr)) {
+      return true;
+    }
+    if (const auto* id_expr = DynCast<IdExprNode>(&expr)) {
+      const auto& type = *id_expr->type;
+      return type.IsFunc() ||
+             ((Isa<PrimType>(type) || type.IsPtr()) &&
+              scanned().variants.count(id_expr->id) == 0 &&
+              (address_taken == address_taken_.cend() ||
+               address_taken->second.count(id_expr->id) == 0));
+    }
+    if (const auto* unary_expr = DynCast<UnaryExprNode>(&expr)) {
+      return (unary_expr->op == UnaryOperator::kPos ||
+              unary_expr->op == UnaryOperator::kNeg ||
+              unary_expr->op == UnaryOperator::kNot ||
+              unary_expr->op == UnaryOperator::kBitComp) &&
+             self(self, *unary_expr->operand);
+    }
+    if (const auto* bin_expr = DynCast<BinaryExprNode>(&expr)) {
+      return bin_expr->op != BinaryOperator::kDiv &&
+             bin_expr->op != BinaryOperator::kMod &&
+             bin_expr->op != BinaryOperator::kLand &&
+             bin_expr->op != BinaryOperator::kLor &&
+             bin_expr->op != BinaryOperator::kComma &&
+             self(self, *bin_expr->lhs) && self(self, *bin_expr->rhs);
+    }
+    if (const auto* call_expr = DynCast<FuncCallExprNode>(&expr)) {
+      const auto* callee = CalleeOf(*call_expr);
+      // A record is passed and returned through memory.
+      return callee && EffectOfFunc(*callee) == Effect::kPure &&
+             !Isa<RecordType>(*call_expr->type) &&
+             std::all_of(call_expr->args.cbegin(), call_expr->args.cend(),
+                         [&](const auto& arg) {
+                           return !Isa<RecordType>(*arg->arg->type) &&
+                                  self(self, *arg->arg);
+                         });
+    }
+    return false;
+  };
+
+  auto calls = std::vector<const FuncCallExprNode*>{};
+  /// @brief Collects the hoistable calls that are always evaluated along with
+  /// `expr`.
+  const auto collect = [&](const auto& self, const ExprNode& expr) -> void {
+    if (!HasSufficientStack()) {
+      WithSufficientStack([&] { self(self, expr); });
+      return;
+    }
+    if (const auto* call_expr = DynCast<FuncCallExprNode>(&expr)) {
+      if (is_invariant(is_invariant, *call_expr)) {
+        calls.push_back(call_expr);
+        return;
+      }
+      self(self, *call_expr->func_expr);
+      for (const auto& arg : call_expr->args) {
+        self(self, *arg->arg);
+      }
+    } else if (const auto* bin_expr = DynCast<BinaryExprNode>(&expr)) {
+      self(self, *bin_expr->lhs);
+      // The right operand of a logical operator may be skipped.
+      if (bin_expr->op != BinaryOperator::kLand &&
+          bin_expr->op != BinaryOperator::kLor) {
+        self(self, *bin_expr->rhs);
+      }
+    } else if (const auto* cond_expr = DynCast<CondExprNode>(&expr)) {
+      self(self, *cond_expr->predicate);
+    } else if (const auto* unary_expr = DynCast<UnaryExprNode>(&expr)) {
+      self(self, *unary_expr->operand);
+    } else if (const auto* postfix_expr =
+                   DynCast<PostfixArithExprNode>(&expr)) {
+      self(self, *postfix_expr->operand);
+    } else if (const auto* arr_sub_expr = DynCast<ArrSubExprNode>(&expr)) {
+      self(self, *arr_sub_expr->arr);
+      self(self, *arr_sub_expr->index);
+    } else if (const auto* mem_expr = DynCast<RecordMemExprNode>(&expr)) {
+      self(self, *mem_expr->expr);
+    } else if (const auto* assign_expr =
+                   DynCast<SimpleAssignmentExprNode>(&expr)) {
+      self(self, *assign_expr->lhs);
+      self(self, *assign_expr->rhs);
+    }
+  };
+  collect(collect, while_stmt ? *while_stmt->predicate : *for_stmt->predicate);
+  if (calls.empty() || scanned().has_label) {
+    return {};
+  }
+  return calls;
+}
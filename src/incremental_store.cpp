@@ -0,0 +1,227 @@
+#include "incremental_store.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+
+namespace {
+
+/// @note Bump this whenever the format of the store or the generated IR
+/// changes, so that stores of previous versions are discarded.
+constexpr auto kStoreHeader = std::string_view{"vitaminc-store 4"};
+
+/// @brief 64-bit FNV-1a, which is fast on short texts and good enough to tell
+/// declarations apart.
+class Hasher {
+ public:
+  void Add(std::string_view text) {
+    for (const auto c : text) {
+      AddByte_(static_cast<unsigned char>(c));
+    }
+    // Delimits the texts, so that ("ab", "c") and ("a", "bc") differ.
+    AddByte_(0);
+  }
+
+  /// @brief Adds the text as a sequence of tokens; runs of whitespace are
+  /// treated as a single space, so that reformatting a declaration doesn't
+  /// change its fingerprint.
+  void AddTokens(std::string_view text) {
+    auto in_space = false;
+    for (const auto c : text) {
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        in_space = true;
+        continue;
+      }
+      if (in_space) {
+        AddByte_(' ');
+        in_space = false;
+      }
+      AddByte_(static_cast<unsigned char>(c));
+    }
+    AddByte_(0);
+  }
+
+  IncrementalStore::Fingerprint Get() const {
+    return hash_;
+  }
+
+ private:
+  static constexpr auto kOffsetBasis = std::uint64_t{0xcbf29ce484222325};
+  static constexpr auto kPrime = std::uint64_t{0x100000001b3};
+  std::uint64_t hash_{kOffsetBasis};
+
+  void AddByte_(unsigned char byte) {
+    hash_ ^= byte;
+    hash_ *= kPrime;
+  }
+};
+
+/// @brief Slices the source text by locations.
+class SourceText {
+ public:
+  explicit SourceText(std::string_view text) : text_{text} {}
+
+  std::size_t OffsetOf(const Location& loc) const {
+    return std::min(static_cast<std::size_t>(loc.offset), text_.size());
+  }
+
+  std::string_view Slice(std::size_t begin, std::size_t end) const {
+    return text_.substr(begin, end - begin);
+  }
+
+  std::size_t size() const {  // NOLINT(readability-identifier-naming)
+    return text_.size();
+  }
+
+ private:
+  std::string_view text_;
+};
+
+/// @return All identifiers in the text; keywords are included, but they never
+/// name a declaration.
+std::set<std::string_view> IdentifiersIn(std::string_view text) {
+  auto ids = std::set<std::string_view>{};
+  for (auto i = std::size_t{0}; i < text.size();) {
+    const auto c = static_cast<unsigned char>(text[i]);
+    if (!std::isalpha(c) && c != '_') {
+      // Skips the whole number, so that its suffix isn't taken as an
+      // identifier.
+      do {
+        ++i;
+      } while (std::isdigit(c) && i < text.size() &&
+               std::isalnum(static_cast<unsigned char>(text[i])));
+      continue;
+    }
+    auto end = i;
+    while (end < text.size() &&
+           (std::isalnum(static_cast<unsigned char>(text[end])) ||
+            text[end] == '_')) {
+      ++end;
+    }
+    ids.insert(text.substr(i, end - i));
+    i = end;
+  }
+  return ids;
+}
+
+}  // namespace
+
+IncrementalStore::IncrementalStore(std::filesystem::path path)
+    : path_{std::move(path)} {
+  auto input = std::ifstream{path_, std::ios::binary};
+  auto header = std::string{};
+  if (!std::getline(input, header) || header != kStoreHeader) {
+    return;
+  }
+  auto fingerprint = Fingerprint{};
+  auto size = std::size_t{};
+  while (input >> std::hex >> fingerprint >> std::dec >> size &&
+         input.get() == '\n') {
+    auto ir = std::string(size, '\0');
+    if (!input.read(ir.data(), static_cast<std::streamsize>(size))) {
+      // A truncated store can't be trusted at all.
+      prev_irs_.clear();
+      return;
+    }
+    prev_irs_.emplace(fingerprint, std::move(ir));
+  }
+}
+
+void IncrementalStore::FingerprintDecls(const TransUnitNode& trans_unit,
+                                        std::string_view source) {
+  const auto text = SourceText{source};
+  const auto& extern_decls = trans_unit.extern_decls;
+  // A top-level declaration spans until the next one begins.
+  auto decl_texts = std::vector<std::string_view>{};
+  for (auto i = std::size_t{0}, e = extern_decls.size(); i < e; ++i) {
+    const auto begin = text.OffsetOf(extern_decls.at(i)->loc);
+    const auto end = i + 1 < e ? text.OffsetOf(extern_decls.at(i + 1)->loc)
+                               : text.size();
+    decl_texts.push_back(text.Slice(begin, std::max(begin, end)));
+  }
+
+  // What a function refers to from other declarations is only their interface:
+  // the signature of a function and the whole of any other declaration.
+  auto interfaces = std::map<std::string_view, std::string_view>{};
+  for (auto i = std::size_t{0}, e = extern_decls.size(); i < e; ++i) {
+    const auto& decl = extern_decls.at(i)->decl;
+    if (const auto* func_def = std::get_if<std::unique_ptr<FuncDefNode>>(&decl)) {
+      const auto begin = text.OffsetOf(extern_decls.at(i)->loc);
+      const auto body_begin = text.OffsetOf((*func_def)->body->loc);
+      interfaces[(*func_def)->id] =
+          text.Slice(begin, std::max(begin, body_begin));
+    } else {
+      for (const auto& var_decl :
+           std::get<std::unique_ptr<DeclStmtNode>>(decl)->decls) {
+        interfaces[var_decl->id] = decl_texts.at(i);
+      }
+    }
+  }
+
+  fingerprints_.clear();
+  for (auto i = std::size_t{0}, e = extern_decls.size(); i < e; ++i) {
+    if (!std::holds_alternative<std::unique_ptr<FuncDefNode>>(
+            extern_decls.at(i)->decl)) {
+      fingerprints_.emplace_back(std::nullopt);
+      continue;
+    }
+    auto hasher = Hasher{};
+    hasher.AddTokens(decl_texts.at(i));
+    // The identifiers are ordered, so is the hashing of the interfaces.
+    for (const auto id : IdentifiersIn(decl_texts.at(i))) {
+      if (auto it = interfaces.find(id); it != interfaces.cend()) {
+        hasher.Add(id);
+        hasher.AddTokens(it->second);
+      }
+    }
+    fingerprints_.emplace_back(hasher.Get());
+  }
+}
+
+const std::string* IncrementalStore::ReusableIrOf(std::size_t index) const {
+  if (const auto& fingerprint = fingerprints_.at(index)) {
+    if (auto it = prev_irs_.find(*fingerprint); it != prev_irs_.cend()) {
+      return &it->second;
+    }
+  }
+  return nullptr;
+}
+
+void IncrementalStore::Update(std::size_t index, std::string ir) {
+  irs_[index] = std::move(ir);
+}
+
+void IncrementalStore::Save() const {
+  auto output = std::ofstream{path_, std::ios::binary};
+  output << kStoreHeader << '\n';
+  for (auto i = std::size_t{0}, e = fingerprints_.size(); i < e; ++i) {
+    if (!fingerprints_.at(i)) {
+      continue;
+    }
+    const std::string* ir = nullptr;
+    if (auto it = irs_.find(i); it != irs_.cend()) {
+      ir = &it->second;
+    } else {
+      ir = ReusableIrOf(i);
+    }
+    if (ir) {
+      output << std::hex << *fingerprints_.at(i) << std::dec << ' '
+             << ir->size() << '\n'
+             << *ir;
+    }
+  }
+}
@@ -0,0 +1,356 @@
+#include "lexer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+/// @note Identifiers consist of letters, decimal digits, and the underscore
+/// character; the first character cannot be a digit.
+bool IsIdStart(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool IsIdChar(char c) {
+  return IsIdStart(c) || IsDigit(c);
+}
+
+#if defined(__SSE2__)
+
+constexpr auto kChunkSize = std::size_t{16};
+
+__m128i LoadChunk(std::string_view text, std::size_t pos) {
+  return _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+          text.data() + pos));
+}
+
+/// @return The bytes of `chunk` which are in [lo, hi] set to all ones.
+/// @note Only meant for ASCII bounds; bytes above 127 are negative and never
+/// in range.
+__m128i InRange(__m128i chunk, char lo, char hi) {
+  return _mm_and_si128(
+      _mm_cmpgt_epi8(chunk, _mm_set1_epi8(static_cast<char>(lo - 1))),
+      _mm_cmplt_epi8(chunk, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+__m128i Equal(__m128i chunk, char c) {
+  return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+}
+
+int SpaceMask(__m128i chunk) {
+  return _mm_movemask_epi8(_mm_or_si128(
+      _mm_or_si128(Equal(chunk, ' '), Equal(chunk, '\t')),
+      _mm_or_si128(Equal(chunk, '\r'), Equal(chunk, '\n'))));
+}
+
+int DigitMask(__m128i chunk) {
+  return _mm_movemask_epi8(InRange(chunk, '0', '9'));
+}
+
+int IdCharMask(__m128i chunk) {
+  return _mm_movemask_epi8(
+      _mm_or_si128(_mm_or_si128(InRange(chunk, 'a', 'z'),
+                                InRange(chunk, 'A', 'Z')),
+                   _mm_or_si128(InRange(chunk, '0', '9'), Equal(chunk, '_'))));
+}
+
+#endif  // __SSE2__
+
+/// @brief Skips the run of characters which satisfy `is_in_run`, starting from
+/// `pos`.
+/// @param run_mask Computes the bitmask of the characters of a chunk which
+/// satisfy `is_in_run`.
+/// @return The position of the first character not in the run.
+template <typename RunMask, typename IsInRun>
+std::size_t SkipRun(std::string_view text, std::size_t pos,
+                    [[maybe_unused]] RunMask run_mask, IsInRun is_in_run) {
+#if defined(__SSE2__)
+  for (; pos + kChunkSize <= text.size(); pos += kChunkSize) {
+    const auto not_in_run =
+        ~static_cast<unsigned>(run_mask(LoadChunk(text, pos))) & 0xFFFFU;
+    if (not_in_run) {
+      return pos + __builtin_ctz(not_in_run);
+    }
+  }
+#endif
+  while (pos < text.size() && is_in_run(text[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+std::size_t SkipSpaces(std::string_view text, std::size_t pos) {
+#if defined(__SSE2__)
+  return SkipRun(text, pos, SpaceMask, IsSpace);
+#else
+  return SkipRun(text, pos, nullptr, IsSpace);
+#endif
+}
+
+std::size_t SkipDigits(std::string_view text, std::size_t pos) {
+#if defined(__SSE2__)
+  return SkipRun(text, pos, DigitMask, IsDigit);
+#else
+  return SkipRun(text, pos, nullptr, IsDigit);
+#endif
+}
+
+std::size_t SkipIdChars(std::string_view text, std::size_t pos) {
+#if defined(__SSE2__)
+  return SkipRun(text, pos, IdCharMask, IsIdChar);
+#else
+  return SkipRun(text, pos, nullptr, IsIdChar);
+#endif
+}
+
+/// @return The position of the "*/" that ends the block comment; `npos` if the
+/// comment is unterminated.
+std::size_t FindBlockCommentEnd(std::string_view text, std::size_t pos) {
+#if defined(__SSE2__)
+  // A '*' at the last byte of a chunk pairs with a '/' that is loaded as the
+  // last byte of the shifted chunk, so one extra byte has to be readable.
+  for (; pos + kChunkSize + 1 <= text.size(); pos += kChunkSize) {
+    const auto star = Equal(LoadChunk(text, pos), '*');
+    const auto slash = Equal(LoadChunk(text, pos + 1), '/');
+    if (const auto mask = _mm_movemask_epi8(_mm_and_si128(star, slash))) {
+      return pos + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+  }
+#endif
+  return text.find("*/", pos);
+}
+
+TokenKind KeywordKindOf(std::string_view id) {
+  switch (id.size()) {
+    case 2:
+      if (id == "do") return TokenKind::kDo;
+      if (id == "if") return TokenKind::kIf;
+      break;
+    case 3:
+      if (id == "for") return TokenKind::kFor;
+      if (id == "int") return TokenKind::kInt;
+      break;
+    case 4:
+      if (id == "case") return TokenKind::kCase;
+      if (id == "char") return TokenKind::kChar;
+      if (id == "else") return TokenKind::kElse;
+      if (id == "goto") return TokenKind::kGoto;
+      if (id == "long") return TokenKind::kLong;
+      break;
+    case 5:
+      if (id == "break") return TokenKind::kBreak;
+      if (id == "short") return TokenKind::kShort;
+      if (id == "union") return TokenKind::kUnion;
+      if (id == "while") return TokenKind::kWhile;
+      break;
+    case 6:
+      if (id == "return") return TokenKind::kReturn;
+      if (id == "signed") return TokenKind::kSigned;
+      if (id == "struct") return TokenKind::kStruct;
+      if (id == "switch") return TokenKind::kSwitch;
+      break;
+    case 7:
+      if (id == "default") return TokenKind::kDefault;
+      break;
+    case 8:
+      if (id == "continue") return TokenKind::kContinue;
+      if (id == "unsigned") return TokenKind::kUnsigned;
+      break;
+    default:
+      break;
+  }
+  return TokenKind::kId;
+}
+
+struct Punctuator {
+  TokenKind kind;
+  std::size_t length;
+};
+
+/// @return The longest punctuator starting at `pos`; `kInvalid` if none.
+Punctuator PunctuatorAt(std::string_view text, std::size_t pos) {
+  const auto next = pos + 1 < text.size() ? text[pos + 1] : '\0';
+  const auto one = [](TokenKind kind) { return Punctuator{kind, 1}; };
+  const auto two = [](TokenKind kind) { return Punctuator{kind, 2}; };
+  switch (text[pos]) {
+    case ';':
+      return one(TokenKind::kSemicolon);
+    case ':':
+      return one(TokenKind::kColon);
+    case ',':
+      return one(TokenKind::kComma);
+    case '.':
+      return one(TokenKind::kDot);
+    case '-':
+      if (next == '>') return two(TokenKind::kArrow);
+      if (next == '-') return two(TokenKind::kDecr);
+      return one(TokenKind::kMinus);
+    case '+':
+      if (next == '+') return two(TokenKind::kIncr);
+      return one(TokenKind::kPlus);
+    case '*':
+      return one(TokenKind::kStar);
+    case '/':
+      return one(TokenKind::kDiv);
+    case '%':
+      return one(TokenKind::kMod);
+    case '&':
+      if (next == '&') return two(TokenKind::kLogicAnd);
+      return one(TokenKind::kAmpersand);
+    case '!':
+      if (next == '=') return two(TokenKind::kNe);
+      return one(TokenKind::kExclamation);
+    case '?':
+      return one(TokenKind::kQuestion);
+    case '^':
+      return one(TokenKind::kXor);
+    case '|':
+      if (next == '|') return two(TokenKind::kLogicOr);
+      return one(TokenKind::kOr);
+    case '~':
+      return one(TokenKind::kTilde);
+    case '=':
+      if (next == '=') return two(TokenKind::kEq);
+      return one(TokenKind::kAssign);
+    case '<':
+      if (next == '<') return two(TokenKind::kShiftLeft);
+      if (next == '=') return two(TokenKind::kLe);
+      return one(TokenKind::kLt);
+    case '>':
+      if (next == '>') return two(TokenKind::kShiftRight);
+      if (next == '=') return two(TokenKind::kGe);
+      return one(TokenKind::kGt);
+    case '(':
+      return one(TokenKind::kLeftParen);
+    case ')':
+      return one(TokenKind::kRightParen);
+    case '{':
+      return one(TokenKind::kLeftCurly);
+    case '}':
+      return one(TokenKind::kRightCurly);
+    case '[':
+      return one(TokenKind::kLeftSquare);
+    case ']':
+      return one(TokenKind::kRightSquare);
+    case '#':
+      if (next == '#') return two(TokenKind::kHashHash);
+      return one(TokenKind::kHash);
+    default:
+      return one(TokenKind::kInvalid);
+  }
+}
+
+/// @return The position one past the closing quote of the string literal that
+/// starts at `pos`; `npos` if the literal is unterminated.
+std::size_t FindStringEnd(std::string_view text, std::size_t pos) {
+  for (++pos; pos < text.size() && text[pos] != '\n'; ++pos) {
+    if (text[pos] == '"') {
+      return pos + 1;
+    }
+    if (text[pos] == '\\') {
+      ++pos;
+    }
+  }
+  return std::string_view::npos;
+}
+
+/// @return The length of the backslash and the newline it escapes at `pos`;
+/// 0 if there's none.
+std::size_t EscapedNewlineLengthAt(std::string_view text, std::size_t pos) {
+  if (text.compare(pos, 2, "\\\n") == 0) {
+    return 2;
+  }
+  if (text.compare(pos, 3, "\\\r\n") == 0) {
+    return 3;
+  }
+  return 0;
+}
+
+}  // namespace
+
+TokenBuffer Lex(std::string source) {
+  auto owned_source = std::make_unique<const std::string>(std::move(source));
+  auto tokens = LexInPlace(*owned_source);
+  tokens.owned_source_ = std::move(owned_source);
+  return tokens;
+}
+
+TokenBuffer LexInPlace(std::string_view source) {
+  auto tokens = TokenBuffer{source};
+  const auto text = source;
+  // A rough estimate to avoid most of the reallocations.
+  const auto expected_num_of_tokens = text.size() / 4;
+  tokens.kinds_.reserve(expected_num_of_tokens);
+  tokens.offsets_.reserve(expected_num_of_tokens);
+  tokens.lengths_.reserve(expected_num_of_tokens);
+
+  auto pos = std::size_t{0};
+  while (pos < text.size()) {
+    const auto c = text[pos];
+    if (IsSpace(c)) {
+      pos = SkipSpaces(text, pos);
+    } else if (IsIdStart(c)) {
+      const auto end = SkipIdChars(text, pos);
+      tokens.Push_(KeywordKindOf(text.substr(pos, end - pos)), pos, end - pos);
+      pos = end;
+    } else if (IsDigit(c)) {
+      const auto end = SkipDigits(text, pos);
+      tokens.Push_(TokenKind::kNum, pos, end - pos);
+      pos = end;
+    } else if (text.compare(pos, 2, "/*") == 0) {
+      const auto end = FindBlockCommentEnd(text, pos + 2);
+      pos = end == std::string_view::npos ? text.size() : end + 2;
+    } else if (text.compare(pos, 2, "//") == 0) {
+      const auto end = text.find('\n', pos + 2);
+      pos = end == std::string_view::npos ? text.size() : end + 1;
+    } else if (c == '"') {
+      const auto end = FindStringEnd(text, pos);
+      if (end == std::string_view::npos) {
+        tokens.Push_(TokenKind::kInvalid, pos, 1);
+        ++pos;
+      } else {
+        tokens.Push_(TokenKind::kString, pos, end - pos);
+        pos = end;
+      }
+    } else if (const auto newline_length = EscapedNewlineLengthAt(text, pos)) {
+      pos += newline_length;
+    } else {
+      const auto [kind, length] = PunctuatorAt(text, pos);
+      tokens.Push_(kind, pos, length);
+      pos += length;
+    }
+  }
+  tokens.Push_(TokenKind::kEof, text.size(), 0);
+  return tokens;
+}
+
+std::optional<std::uint64_t> DecimalValueOf(std::string_view digits) noexcept {
+  constexpr auto kMax = std::numeric_limits<std::uint64_t>::max();
+  auto val = std::uint64_t{0};
+  for (const auto digit : digits) {
+    const auto digit_val = static_cast<std::uint64_t>(digit - '0');
+    if (val > (kMax - digit_val) / 10) {
+      return std::nullopt;
+    }
+    val = val * 10 + digit_val;
+  }
+  return val;
+}
@@ -0,0 +1,1679 @@
+#include "llvm_ir_generator.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+#include "casting.hpp"
+#include "operator.hpp"
+#include "thread_pool.hpp"
+#include "type.hpp"
+#include "visit_profiler.hpp"
+
+using llvm_ir::Operand;
+using llvm_ir::PointerKind;
+
+namespace {
+
+constexpr auto kIndentStr = "\t";
+
+/// @brief The target that the records are passed for.
+constexpr auto kTargetDecls =
+    "target datalayout = "
+    "\"e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-"
+    "S128\"\n"
+    "target triple = \"x86_64-pc-linux-gnu\"\n";
+
+//
+// The states below only live through the generation of a single top-level
+// declaration. They are thread-local, so that the functions can be generated
+// in parallel.
+//
+
+/// @brief Whether the pointers are typed; see `PointerKind::kTyped`.
+thread_local auto
+    is_ptr_typed  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = false;
+
+/// @brief Numbers the values and the labels of a function; they share a
+/// namespace in LLVM IR.
+thread_local auto
+    next_num  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = 0;
+
+int NextNum() {
+  return next_num++;
+}
+
+/// @brief The instructions of the function that is being generated, which
+/// begin in the entry block after the allocations.
+thread_local auto
+    body  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::string{};
+
+/// @brief The allocations of the function; they are all placed in the entry
+/// block, so that `opt` promotes them to registers.
+thread_local auto
+    allocas  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::string{};
+
+/// @brief Whether the current block already ends with a terminator, after
+/// which LLVM doesn't allow any instruction.
+thread_local auto
+    is_block_terminated  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = false;
+
+thread_local auto
+    is_memcpy_used  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = false;
+
+/// @brief The return type of the function that is being generated.
+thread_local auto
+    return_type_of_func  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = static_cast<const Type*>(nullptr);
+
+/// @brief The address of each object, by its id.
+thread_local auto
+    id_to_addr  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::map<std::string, std::string>{};
+
+/// @brief The label of each user-defined label, which may be jumped to before
+/// it's defined.
+thread_local auto
+    user_labels  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::map<std::string, int>{};
+
+/// @brief The value of an expression. An lvalue also has the address of the
+/// object it's loaded from, which is stored to by the upper level nodes.
+struct Value {
+  /// @brief Nothing for an aggregate, whose value is the address of `obj`.
+  std::optional<Operand> val{};
+  std::optional<std::string> obj{};
+};
+
+/// @brief Every expression has a value, which is propagated to its upper level
+/// node.
+class PrevExprValueRecorder {
+ public:
+  void Record(Value value) {
+    value_ = std::move(value);
+  }
+
+  /// @note The value can only be gotten once. This is to reduce the
+  /// possibility of getting an obsolete value.
+  Value ValueOfPrevExpr() {
+    assert(value_);
+    auto value = std::move(*value_);
+    value_.reset();
+    return value;
+  }
+
+ private:
+  std::optional<Value> value_{};
+};
+
+thread_local auto
+    value_recorder  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = PrevExprValueRecorder{};
+
+struct LabelPair {
+  int entry;
+  int exit;
+};
+
+/// @note Blocks that allows jumping within or out of it should add its labels
+/// to this list.
+thread_local auto
+    labels_of_jumpable_blocks  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::vector<LabelPair>{};
+
+struct CaseInfo {
+  /// @note This is a non-owning pointer that points to the expression of the
+  /// case.
+  const ExprNode* expr = nullptr;
+  int label;
+};
+
+struct SwitchInfo {
+  std::vector<CaseInfo> case_infos{};
+  std::optional<int> default_label{};
+  int exit_label;
+};
+
+/// @note To allow nested switch statements, the information is stacked.
+thread_local auto
+    switch_infos  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::vector<SwitchInfo>{};
+
+/// @brief The pointer to the returned record, which the caller passes as the
+/// first argument; empty if the record is returned in registers.
+thread_local auto
+    ret_ptr  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::string{};
+
+//
+// Types
+//
+
+constexpr auto kEightBytes = std::size_t{8};
+
+/// @return The type of the pointers, which all point to bytes if they are
+/// typed.
+std::string_view PtrIrType() {
+  return is_ptr_typed ? "i8*" : "ptr";
+}
+
+/// @return The type of the values of `type`. As in QBE, the integers narrower
+/// than `int` are kept extended to an `i32`; the value of an aggregate, such
+/// as a record, is its address.
+std::string_view ValueTypeOf(const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  if (!prim_type) {
+    return PtrIrType();
+  }
+  return prim_type->size() == 8 ? "i64" : "i32";
+}
+
+/// @return The type that an object of `type` is loaded or stored as.
+std::string_view MemTypeOf(const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  if (!prim_type) {
+    return PtrIrType();
+  }
+  switch (prim_type->size()) {
+    case 1:
+      return "i8";
+    case 2:
+      return "i16";
+    case 8:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return "i64";
+    default:
+      return "i32";
+  }
+}
+
+/// @return Whether the value of `type` is the address of its object, which is
+/// never loaded as a whole.
+bool IsAggregate(const Type& type) {
+  return Isa<RecordType>(type) || type.IsArr();
+}
+
+/// @brief The type of the integers narrower than `int` after the integer
+/// promotions.
+const auto
+    kPromotedType  // NOLINT(cert-err58-cpp): PrimType doesn't throw.
+    = PrimType{PrimitiveType::kInt};
+
+/// @brief The type that pointers are converted to for arithmetic.
+const auto
+    kAddrType  // NOLINT(cert-err58-cpp): PrimType doesn't throw.
+    = PrimType{PrimitiveType::kULong};
+
+/// @return The type that the operands of `bin_expr` are converted to before
+/// the operation.
+std::unique_ptr<Type> OperandTypeOf(const BinaryExprNode& bin_expr) {
+  const auto* lhs_prim = DynCast<PrimType>(bin_expr.lhs->type.get());
+  const auto* rhs_prim = DynCast<PrimType>(bin_expr.rhs->type.get());
+  if (!lhs_prim || !rhs_prim || !lhs_prim->IsInteger() ||
+      !rhs_prim->IsInteger()) {
+    return bin_expr.lhs->type->Clone();
+  }
+  if (bin_expr.op == BinaryOperator::kShl ||
+      bin_expr.op == BinaryOperator::kShr) {
+    return std::make_unique<PrimType>(Promote(lhs_prim->prim_type()));
+  }
+  return std::make_unique<PrimType>(
+      CommonTypeOf(lhs_prim->prim_type(), rhs_prim->prim_type()));
+}
+
+bool IsComparison(BinaryOperator op) {
+  switch (op) {
+    case BinaryOperator::kGt:
+    case BinaryOperator::kGte:
+    case BinaryOperator::kLt:
+    case BinaryOperator::kLte:
+    case BinaryOperator::kEq:
+    case BinaryOperator::kNeq:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// @param type The type of the operands, which are converted to the same type
+/// beforehand.
+/// @return The instruction of `op`; the condition of `icmp` for a comparison.
+/// @note The signed arithmetic is marked as not to overflow, which C leaves
+/// undefined, so that `opt` can reason about the loops.
+std::string_view InstrOf(BinaryOperator op, const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  // Pointers are compared as unsigned integers.
+  const auto is_unsigned = !prim_type || prim_type->IsUnsigned();
+  switch (op) {
+    case BinaryOperator::kAdd:
+      return is_unsigned ? "add" : "add nsw";
+    case BinaryOperator::kSub:
+      return is_unsigned ? "sub" : "sub nsw";
+    case BinaryOperator::kMul:
+      return is_unsigned ? "mul" : "mul nsw";
+    case BinaryOperator::kDiv:
+      return is_unsigned ? "udiv" : "sdiv";
+    case BinaryOperator::kMod:
+      return is_unsigned ? "urem" : "srem";
+    case BinaryOperator::kGt:
+      return is_unsigned ? "ugt" : "sgt";
+    case BinaryOperator::kGte:
+      return is_unsigned ? "uge" : "sge";
+    case BinaryOperator::kLt:
+      return is_unsigned ? "ult" : "slt";
+    case BinaryOperator::kLte:
+      return is_unsigned ? "ule" : "sle";
+    case BinaryOperator::kEq:
+      return "eq";
+    case BinaryOperator::kNeq:
+      return "ne";
+    case BinaryOperator::kAnd:
+      return "and";
+    case BinaryOperator::kXor:
+      return "xor";
+    case BinaryOperator::kOr:
+      return "or";
+    case BinaryOperator::kShl:
+      return "shl";
+    // NOTE: Signed integers are shifted arithmetically, as QbeIrGenerator
+    // does; unsigned integers are shifted logically.
+    default:
+      return is_unsigned ? "lshr" : "ashr";
+  }
+}
+
+/// @return The function of the runtime library that the builtin `id` is
+/// lowered to; empty if `id` isn't a builtin.
+/// @note The runtime library is linked by the driver; see runtime/runtime.h.
+std::string_view RuntimeFuncOf(std::string_view id) {
+  if (id == "__builtin_print") {
+    return "__vitaminc_print_int";
+  }
+  if (id == "__builtin_flush") {
+    return "__vitaminc_flush";
+  }
+  return {};
+}
+
+//
+// The System V ABI
+//
+
+constexpr auto kNumOfArgRegs = std::size_t{6};
+constexpr auto kNumOfRecordRegs = std::size_t{2};
+
+/// @return Whether a record of `type` is returned in memory, to which the
+/// caller passes a pointer as the first argument.
+bool IsReturnedInMemory(const Type& type) {
+  return Isa<RecordType>(type) && type.size() > kNumOfRecordRegs * kEightBytes;
+}
+
+/// @return The number of eightbytes of a record of `type`, each of which is
+/// passed or returned as an `i64`.
+std::size_t NumOfPiecesOf(const Type& type) {
+  return (type.size() + kEightBytes - 1) / kEightBytes;
+}
+
+/// @return The type that a value of `type` is returned as.
+std::string_view RetTypeOf(const Type& type) {
+  if (!Isa<RecordType>(type)) {
+    return ValueTypeOf(type);
+  }
+  if (IsReturnedInMemory(type)) {
+    return "void";
+  }
+  return NumOfPiecesOf(type) == 1 ? "i64" : "{ i64, i64 }";
+}
+
+/// @return The type of the pointer to the record of `type` that is passed in
+/// memory; typed pointers have to point to the type of the attribute.
+std::string InMemoryPtrTypeOf(const Type& type) {
+  return is_ptr_typed ? fmt::format("[{} x i8]*", type.size())
+                      : std::string{PtrIrType()};
+}
+
+/// @return The type of the parameter `attr`, which is `byval` or `sret`, of
+/// the record of `type` that is passed in memory.
+std::string InMemoryParamTypeOf(std::string_view attr, const Type& type) {
+  return fmt::format("{} {}([{} x i8]) align {}", InMemoryPtrTypeOf(type),
+                     attr, type.size(),
+                     std::max(type.alignment(), kEightBytes));
+}
+
+enum class Passing : std::uint8_t {
+  /// @brief An integer or a pointer, which is passed as its value.
+  kValue,
+  /// @brief A record that is passed in registers, one `i64` per eightbyte.
+  kPieces,
+  /// @brief A record that is passed in memory, which the callee owns a copy
+  /// of.
+  kByVal,
+};
+
+/// @brief Classifies the arguments by the System V ABI. Every member of a
+/// record is an integer or a pointer, so a record of up to 16 bytes is passed
+/// in as many registers as its eightbytes, if they are all available.
+class ArgClassifier {
+ public:
+  explicit ArgClassifier(bool is_returned_in_memory)
+      : num_of_used_regs_{is_returned_in_memory ? std::size_t{1} : 0} {}
+
+  Passing Classify(const Type& type) {
+    if (!Isa<RecordType>(type)) {
+      num_of_used_regs_ = std::min(num_of_used_regs_ + 1, kNumOfArgRegs);
+      return Passing::kValue;
+    }
+    const auto num_of_pieces = NumOfPiecesOf(type);
+    if (num_of_pieces <= kNumOfRecordRegs &&
+        num_of_used_regs_ + num_of_pieces <= kNumOfArgRegs) {
+      num_of_used_regs_ += num_of_pieces;
+      return Passing::kPieces;
+    }
+    return Passing::kByVal;
+  }
+
+ private:
+  std::size_t num_of_used_regs_;
+};
+
+/// @return The types of the parameters of `func_type`, which the records
+/// passed in memory are spelled with the attributes of if `has_attrs`.
+std::vector<std::string> ParamTypesOf(const FuncType& func_type,
+                                      bool has_attrs) {
+  const auto& ret_type = func_type.return_type();
+  auto params = std::vector<std::string>{};
+  const auto in_memory_param_type_of = [has_attrs](std::string_view attr,
+                                                   const Type& type) {
+    return has_attrs ? InMemoryParamTypeOf(attr, type)
+                     : InMemoryPtrTypeOf(type);
+  };
+  if (IsReturnedInMemory(ret_type)) {
+    params.push_back(in_memory_param_type_of("sret", ret_type));
+  }
+  auto classifier = ArgClassifier{IsReturnedInMemory(ret_type)};
+  for (const auto& param_type : func_type.param_types()) {
+    switch (classifier.Classify(*param_type)) {
+      case Passing::kValue:
+        params.emplace_back(ValueTypeOf(*param_type));
+        break;
+      case Passing::kPieces:
+        params.insert(params.end(), NumOfPiecesOf(*param_type), "i64");
+        break;
+      case Passing::kByVal:
+        params.push_back(in_memory_param_type_of("byval", *param_type));
+        break;
+    }
+  }
+  return params;
+}
+
+/// @return The declaration of the function `symbol` of `func_type`.
+std::string DeclOf(const std::string& symbol, const FuncType& func_type) {
+  return fmt::format("declare {} @{}({})\n",
+                     RetTypeOf(func_type.return_type()), symbol,
+                     fmt::join(ParamTypesOf(func_type, true), ", "));
+}
+
+/// @return The type of the pointer to a function whose return type is
+/// `ret_type` and whose parameters are of `param_types`.
+std::string FuncPtrTypeOf(const Type& ret_type,
+                          const std::vector<std::string>& param_types) {
+  return fmt::format("{} ({})*", RetTypeOf(ret_type),
+                     fmt::join(param_types, ", "));
+}
+
+/// @return The address of the function `symbol` of `func_type` as a pointer;
+/// a typed one is cast from the pointer to the function.
+std::string FuncAddrOf(const std::string& symbol, const FuncType& func_type) {
+  if (!is_ptr_typed) {
+    return fmt::format("@{}", symbol);
+  }
+  return fmt::format(
+      "bitcast ({} @{} to i8*)",
+      FuncPtrTypeOf(func_type.return_type(), ParamTypesOf(func_type, false)),
+      symbol);
+}
+
+//
+// Instructions
+//
+
+std::string LabelOf(int label) {
+  return fmt::format("L.{}", label);
+}
+
+/// @brief Writes a single instruction with newline. If the current block is
+/// already terminated, the instruction can't be reached; a new block is begun
+/// for it.
+template <typename... T>
+void WriteInstr(fmt::format_string<T...> format, T&&... args) {
+  if (is_block_terminated) {
+    fmt::format_to(std::back_inserter(body), "{}:\n", LabelOf(NextNum()));
+    is_block_terminated = false;
+  }
+  body += kIndentStr;
+  fmt::format_to(std::back_inserter(body), format, std::forward<T>(args)...);
+  body += '\n';
+}
+
+/// @brief Writes an instruction that ends the current block.
+template <typename... T>
+void WriteTerminator(fmt::format_string<T...> format, T&&... args) {
+  WriteInstr(format, std::forward<T>(args)...);
+  is_block_terminated = true;
+}
+
+/// @brief Writes an instruction that produces a value.
+/// @return The name of the value.
+template <typename... T>
+std::string WriteValueInstr(fmt::format_string<T...> format, T&&... args) {
+  auto res = fmt::format("%.{}", NextNum());
+  WriteInstr("{} = {}", res, fmt::format(format, std::forward<T>(args)...));
+  return res;
+}
+
+/// @brief Writes the definition of a label with newline. LLVM doesn't allow a
+/// block to fall through to the next one, so the jump is explicit.
+void WriteLabel(int label) {
+  if (!is_block_terminated) {
+    WriteTerminator("br label %{}", LabelOf(label));
+  }
+  fmt::format_to(std::back_inserter(body), "{}:\n", LabelOf(label));
+  is_block_terminated = false;
+}
+
+void WriteJmp(int label) {
+  WriteTerminator("br label %{}", LabelOf(label));
+}
+
+unsigned BitsOf(std::string_view type) {
+  if (type == "i8") {
+    return 8;  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+  }
+  if (type == "i16") {
+    return 16;  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+  }
+  if (type == "i32") {
+    return 32;  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+  }
+  return 64;  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+}
+
+/// @return The value of the low `bits` of `imm` as a signed integer.
+std::int64_t SignExtend(std::int64_t imm, unsigned bits) {
+  switch (bits) {
+    case 8:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return static_cast<std::int8_t>(imm);
+    case 16:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return static_cast<std::int16_t>(imm);
+    case 32:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return static_cast<std::int32_t>(imm);
+    default:
+      return imm;
+  }
+}
+
+/// @return The value of the low `bits` of `imm` as an unsigned integer.
+std::int64_t ZeroExtend(std::int64_t imm, unsigned bits) {
+  switch (bits) {
+    case 8:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return static_cast<std::uint8_t>(imm);
+    case 16:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return static_cast<std::uint16_t>(imm);
+    case 32:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return static_cast<std::uint32_t>(imm);
+    default:
+      return imm;
+  }
+}
+
+/// @return The spelling of `val` as an operand of `type`.
+std::string ReprOf(const Operand& val, std::string_view type) {
+  if (!val.IsImm()) {
+    return val.name;
+  }
+  if (type == PtrIrType()) {
+    return val.imm == 0
+               ? "null"
+               : fmt::format("inttoptr (i64 {} to {})", val.imm, type);
+  }
+  return std::to_string(SignExtend(val.imm, BitsOf(type)));
+}
+
+/// @brief Writes the conversion `op` of `val` from `from` to `to`.
+/// @note Constants are converted in place.
+Operand WriteCast(std::string_view op, const Operand& val,
+                  std::string_view from, std::string_view to) {
+  if (val.IsImm()) {
+    if (op == "sext") {
+      return Operand::OfImm(SignExtend(val.imm, BitsOf(from)));
+    }
+    if (op == "zext") {
+      return Operand::OfImm(ZeroExtend(val.imm, BitsOf(from)));
+    }
+    if (op == "trunc") {
+      return Operand::OfImm(SignExtend(val.imm, BitsOf(to)));
+    }
+    return val;
+  }
+  return Operand::OfName(
+      WriteValueInstr("{} {} {} to {}", op, from, val.name, to));
+}
+
+/// @return The name of a new allocation of `type`.
+/// @note A typed allocation is cast to a pointer to bytes, as all the
+/// addresses are.
+std::string WriteAlloca(std::string_view type, std::size_t alignment) {
+  auto addr = fmt::format("%.{}", NextNum());
+  if (!is_ptr_typed || type == "i8") {
+    fmt::format_to(std::back_inserter(allocas),
+                   "{}{} = alloca {}, align {}\n", kIndentStr, addr, type,
+                   alignment);
+    return addr;
+  }
+  fmt::format_to(std::back_inserter(allocas),
+                 "{0}{1}.0 = alloca {2}, align {3}\n"
+                 "{0}{1} = bitcast {2}* {1}.0 to i8*\n",
+                 kIndentStr, addr, type, alignment);
+  return addr;
+}
+
+/// @return The name of a new allocation for an object of `type`.
+std::string WriteAllocaOf(const Type& type) {
+  if (IsAggregate(type)) {
+    return WriteAlloca(fmt::format("[{} x i8]", type.size()),
+                       type.alignment());
+  }
+  return WriteAlloca(MemTypeOf(type), type.alignment());
+}
+
+/// @return The name of a new allocation of `num_of_pieces` eightbytes, which
+/// a record is passed in.
+std::string WriteAllocaOfPieces(std::size_t num_of_pieces) {
+  return WriteAlloca(fmt::format("[{} x i8]", num_of_pieces * kEightBytes),
+                     kEightBytes);
+}
+
+/// @return The address `offset` bytes after `addr`.
+std::string AddressAt(const std::string& addr, std::int64_t offset) {
+  if (offset == 0) {
+    return addr;
+  }
+  return WriteValueInstr("getelementptr inbounds i8, {} {}, i64 {}",
+                         PtrIrType(), addr, offset);
+}
+
+/// @return The operand of the address `addr` that `type` is loaded from or
+/// stored to; a typed pointer to bytes is cast to a pointer to `type`.
+std::string PtrOperandOf(std::string_view type, const std::string& addr) {
+  if (!is_ptr_typed || type == "i8") {
+    return fmt::format("{} {}", PtrIrType(), addr);
+  }
+  return fmt::format("{}* {}", type,
+                     WriteValueInstr("bitcast i8* {} to {}*", addr, type));
+}
+
+std::string WriteLoadOf(std::string_view type, const std::string& addr) {
+  return WriteValueInstr("load {}, {}", type, PtrOperandOf(type, addr));
+}
+
+void WriteStoreOf(std::string_view type, const std::string& val,
+                  const std::string& addr) {
+  WriteInstr("store {} {}, {}", type, val, PtrOperandOf(type, addr));
+}
+
+Operand WriteLoad(const Type& type, const std::string& addr) {
+  const auto mem_type = MemTypeOf(type);
+  const auto val = Operand::OfName(WriteLoadOf(mem_type, addr));
+  const auto value_type = ValueTypeOf(type);
+  if (mem_type == value_type) {
+    return val;
+  }
+  // The narrower integers are extended to a word.
+  return WriteCast(Cast<PrimType>(type).IsUnsigned() ? "zext" : "sext", val,
+                   mem_type, value_type);
+}
+
+void WriteStore(const Type& type, const Operand& val,
+                const std::string& addr) {
+  const auto mem_type = MemTypeOf(type);
+  const auto value_type = ValueTypeOf(type);
+  const auto stored = mem_type == value_type
+                          ? val
+                          : WriteCast("trunc", val, value_type, mem_type);
+  WriteStoreOf(mem_type, ReprOf(stored, mem_type), addr);
+}
+
+/// @return The name of the intrinsic that copies bytes, which is named after
+/// the types of its pointers.
+std::string_view MemcpyName() {
+  return is_ptr_typed ? "llvm.memcpy.p0i8.p0i8.i64" : "llvm.memcpy.p0.p0.i64";
+}
+
+void WriteMemcpy(const std::string& dst, const std::string& src,
+                 std::size_t size) {
+  is_memcpy_used = true;
+  WriteInstr("call void @{0}({1} {2}, {1} {3}, i64 {4}, i1 false)",
+             MemcpyName(), PtrIrType(), dst, src, size);
+}
+
+/// @return The address `addr` of a record of `type` as the pointer that it's
+/// passed in memory with.
+std::string InMemoryArgOf(const Type& type, const std::string& addr) {
+  if (!is_ptr_typed) {
+    return addr;
+  }
+  return WriteCast("bitcast", Operand::OfName(addr), PtrIrType(),
+                   InMemoryPtrTypeOf(type))
+      .name;
+}
+
+/// @return The pointer `param` to a record of `type` that is passed in memory
+/// as an address.
+std::string InMemoryParamOf(const Type& type, const std::string& param) {
+  if (!is_ptr_typed) {
+    return param;
+  }
+  return WriteCast("bitcast", Operand::OfName(param), InMemoryPtrTypeOf(type),
+                   PtrIrType())
+      .name;
+}
+
+/// @brief Loads the eightbytes of the record of `size` bytes at `addr`, which
+/// are passed or returned in registers. The record is copied to a zeroed
+/// allocation first, so that no byte after it is read.
+std::vector<std::string> WriteLoadOfPieces(const std::string& addr,
+                                           std::size_t size) {
+  const auto num_of_pieces = (size + kEightBytes - 1) / kEightBytes;
+  const auto pieces_addr = WriteAllocaOfPieces(num_of_pieces);
+  auto piece_addrs = std::vector<std::string>{};
+  for (auto i = std::size_t{0}; i < num_of_pieces; ++i) {
+    piece_addrs.push_back(AddressAt(
+        pieces_addr, static_cast<std::int64_t>(i * kEightBytes)));
+    WriteStoreOf("i64", "0", piece_addrs.back());
+  }
+  WriteMemcpy(pieces_addr, addr, size);
+  auto pieces = std::vector<std::string>{};
+  for (const auto& piece_addr : piece_addrs) {
+    pieces.push_back(WriteLoadOf("i64", piece_addr));
+  }
+  return pieces;
+}
+
+/// @brief Stores the eightbytes `pieces` of a record to a new allocation.
+/// @return The address of the record.
+std::string WriteStoreOfPieces(const std::vector<std::string>& pieces) {
+  const auto addr = WriteAllocaOfPieces(pieces.size());
+  for (auto i = std::size_t{0}, e = pieces.size(); i < e; ++i) {
+    WriteStoreOf("i64", pieces.at(i),
+                 AddressAt(addr, static_cast<std::int64_t>(i * kEightBytes)));
+  }
+  return addr;
+}
+
+/// @return The comparison of `lhs` and `rhs` of `type` by `cond`, extended to
+/// an `i32`.
+Operand WriteCmp(std::string_view cond, std::string_view type,
+                 const Operand& lhs, const Operand& rhs) {
+  const auto res = WriteValueInstr("icmp {} {} {}, {}", cond, type,
+                                   ReprOf(lhs, type), ReprOf(rhs, type));
+  return WriteCast("zext", Operand::OfName(res), "i1", "i32");
+}
+
+/// @brief Jumps to `label` if `val` of `type` is non-zero; to `else_label`
+/// otherwise.
+void WriteJnz(const Operand& val, const Type& type, int label,
+              int else_label) {
+  const auto value_type = ValueTypeOf(type);
+  const auto is_non_zero =
+      WriteValueInstr("icmp ne {} {}, {}", value_type, ReprOf(val, value_type),
+                      ReprOf(Operand::OfImm(0), value_type));
+  WriteTerminator("br i1 {}, label %{}, label %{}", is_non_zero,
+                  LabelOf(label), LabelOf(else_label));
+}
+
+/// @brief Returns the default value of the function, which is what falling
+/// off its end returns; `main` has to return 0.
+void WriteDefaultRet() {
+  assert(return_type_of_func);
+  const auto ret_type = RetTypeOf(*return_type_of_func);
+  if (ret_type == "void") {
+    WriteTerminator("ret void");
+  } else if (Isa<RecordType>(*return_type_of_func)) {
+    WriteTerminator("ret {} zeroinitializer", ret_type);
+  } else {
+    WriteTerminator("ret {} {}", ret_type,
+                    ReprOf(Operand::OfImm(0), ret_type));
+  }
+}
+
+/// @return The value of `value`; the address of an aggregate.
+Operand OperandOf(const Value& value) {
+  if (!value.val) {
+    assert(value.obj);
+    return Operand::OfName(*value.obj);
+  }
+  return *value.val;
+}
+
+/// @return The value of the object of `type` at `obj`: its address if it's an
+/// aggregate; loaded from it otherwise.
+Value ValueOfObject(const Type& type, const std::string& obj) {
+  if (IsAggregate(type)) {
+    return {std::nullopt, obj};
+  }
+  return {WriteLoad(type, obj), obj};
+}
+
+int UserLabelOf(const std::string& label) {
+  if (auto it = user_labels.find(label); it != user_labels.end()) {
+    return it->second;
+  }
+  return user_labels[label] = NextNum();
+}
+
+}  // namespace
+
+void LlvmIrGenerator::Visit(const DeclStmtNode& decl_stmt) {
+  for (const auto& decl : decl_stmt.decls) {
+    Dispatch(*decl);
+  }
+}
+
+void LlvmIrGenerator::Visit(const VarDeclNode& decl) {
+  const auto addr = WriteAllocaOf(*decl.type);
+  if (decl.init) {
+    Dispatch(*decl.init);
+    const auto init = value_recorder.ValueOfPrevExpr();
+    WriteStoreOf_(OperandOf(init), *decl.init->type, *decl.type, addr);
+  }
+  id_to_addr[decl.id] = addr;
+}
+
+void LlvmIrGenerator::Visit(const ArrDeclNode& arr_decl) {
+  const auto* arr_type = DynCast<ArrType>(arr_decl.type.get());
+  assert(arr_type);
+  const auto addr = WriteAllocaOf(*arr_type);
+  id_to_addr[arr_decl.id] = addr;
+
+  const auto& element_type = arr_type->element_type();
+  const auto element_size = static_cast<std::int64_t>(element_type.size());
+  for (auto i = std::size_t{0}, e = arr_type->len(); i < e; ++i) {
+    if (i < arr_decl.init_list.size()) {
+      const auto& init = arr_decl.init_list.at(i);
+      Dispatch(*init);
+      const auto val = OperandOf(value_recorder.ValueOfPrevExpr());
+      WriteStoreOf_(val, *init->type, element_type,
+                    AddressAt(addr, static_cast<std::int64_t>(i) *
+                                        element_size));
+    } else if (!IsAggregate(element_type)) {
+      // set remaining elements as 0
+      WriteStore(element_type, Operand::OfImm(0),
+                 AddressAt(addr, static_cast<std::int64_t>(i) * element_size));
+    }
+  }
+}
+
+void LlvmIrGenerator::Visit(const RecordDeclNode& record_decl) {
+  /* Do nothing because this node only declares a type. */
+}
+
+void LlvmIrGenerator::Visit(const FieldNode& field) {
+  /* Do nothing because this node only declares a member type in a record. */
+}
+
+void LlvmIrGenerator::Visit(const RecordVarDeclNode& record_var_decl) {
+  const auto addr = WriteAllocaOf(*record_var_decl.type);
+  id_to_addr[record_var_decl.id] = addr;
+
+  const auto* record_type = DynCast<RecordType>(record_var_decl.type.get());
+  assert(record_type);
+  for (auto i = std::size_t{0}, e = record_var_decl.inits.size(),
+            slot_count = record_type->SlotCount();
+       i < slot_count && i < e; ++i) {
+    const auto& init = record_var_decl.inits.at(i);
+    Dispatch(*init);
+    const auto val = OperandOf(value_recorder.ValueOfPrevExpr());
+    const auto offset = static_cast<std::int64_t>(record_type->OffsetOf(i));
+    WriteStoreOf_(val, *init->type, *record_type->fields().at(i)->type,
+                  AddressAt(addr, offset));
+  }
+}
+
+void LlvmIrGenerator::Visit(const ParamNode& parameter) {
+  /* Do nothing; how a parameter is passed depends on the ones before it, so
+   * they are received together by ReceiveParams_. */
+}
+
+std::string LlvmIrGenerator::ReceiveParams_(const FuncDefNode& func_def) {
+  auto params = std::vector<std::string>{};
+  if (IsReturnedInMemory(*return_type_of_func)) {
+    const auto param = fmt::format("%.{}", NextNum());
+    params.push_back(fmt::format(
+        "{} {}", InMemoryParamTypeOf("sret", *return_type_of_func), param));
+    ret_ptr = InMemoryParamOf(*return_type_of_func, param);
+  }
+  auto classifier = ArgClassifier{!ret_ptr.empty()};
+  for (const auto& parameter : func_def.parameters) {
+    Dispatch(*parameter);
+    const auto& type = *parameter->type;
+    switch (classifier.Classify(type)) {
+      case Passing::kValue: {
+        const auto val = fmt::format("%.{}", NextNum());
+        params.push_back(fmt::format("{} {}", ValueTypeOf(type), val));
+        const auto addr = WriteAllocaOf(type);
+        WriteStore(type, Operand::OfName(val), addr);
+        id_to_addr[parameter->id] = addr;
+      } break;
+      case Passing::kPieces: {
+        auto pieces = std::vector<std::string>{};
+        for (auto i = std::size_t{0}, e = NumOfPiecesOf(type); i < e; ++i) {
+          pieces.push_back(fmt::format("%.{}", NextNum()));
+          params.push_back(fmt::format("i64 {}", pieces.back()));
+        }
+        id_to_addr[parameter->id] = WriteStoreOfPieces(pieces);
+      } break;
+      case Passing::kByVal: {
+        // A record passed in memory is a copy that the function owns, which
+        // is used in place.
+        const auto param = fmt::format("%.{}", NextNum());
+        params.push_back(
+            fmt::format("{} {}", InMemoryParamTypeOf("byval", type), param));
+        id_to_addr[parameter->id] = InMemoryParamOf(type, param);
+      } break;
+    }
+  }
+  return fmt::format("{}", fmt::join(params, ", "));
+}
+
+void LlvmIrGenerator::Visit(const FuncDefNode& func_def) {
+  const auto& func_type = Cast<FuncType>(*func_def.type);
+  return_type_of_func = &func_type.return_type();
+  const auto params = ReceiveParams_(func_def);
+  Dispatch(*func_def.body);
+  if (!is_block_terminated) {
+    WriteDefaultRet();
+  }
+  defined_funcs_.insert(func_def.id);
+  ReferTo_(func_def.id, func_type);
+  WriteFunction_(fmt::format("define {} @{}({})",
+                             RetTypeOf(*return_type_of_func), func_def.id,
+                             params));
+}
+
+void LlvmIrGenerator::WriteFunction_(const std::string& header) {
+  if (is_memcpy_used) {
+    referred_funcs_.emplace(
+        MemcpyName(), fmt::format("declare void @{0}({1}, {1}, i64, i1)\n",
+                                  MemcpyName(), PtrIrType()));
+  }
+  const auto function =
+      fmt::format("{} {{\nentry:\n{}{}}}\n\n", header, allocas, body);
+  output_ << function;
+  if (profiler()) {
+    VisitProfiler::CountBytes(function.size());
+  }
+}
+
+void LlvmIrGenerator::Visit(const LoopInitNode& loop_init) {
+  std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
+}
+
+void LlvmIrGenerator::Visit(const CompoundStmtNode& compound_stmt) {
+  VisitBlocks_(
+      compound_stmt, [](const CompoundStmtNode&) {},
+      [](const CompoundStmtNode&) {});
+}
+
+void LlvmIrGenerator::Visit(const ExternDeclNode& extern_decl) {
+  if (const auto* func_def =
+          std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl.decl)) {
+    Dispatch(**func_def);
+  }
+}
+
+void LlvmIrGenerator::Visit(const TransUnitNode& trans_unit) {
+  BeginModule();
+  if (thread_pool_) {
+    GenerateInParallel_(trans_unit);
+  } else {
+    for (const auto& extern_decl : trans_unit.extern_decls) {
+      GenerateExternDecl(*extern_decl);
+    }
+  }
+  FinishModule();
+}
+
+void LlvmIrGenerator::GenerateExternDecl(const ExternDeclNode& extern_decl) {
+  ResetStates_();
+  Dispatch(extern_decl);
+}
+
+void LlvmIrGenerator::BeginModule() {
+  output_ << kTargetDecls << '\n';
+}
+
+void LlvmIrGenerator::FinishModule() {
+  for (const auto& [symbol, decl] : referred_funcs_) {
+    if (defined_funcs_.count(symbol) == 0) {
+      output_ << decl;
+    }
+  }
+}
+
+void LlvmIrGenerator::GenerateInParallel_(const TransUnitNode& trans_unit) {
+  // Each function is generated into its own buffer, which are then
+  // concatenated in order; the output is the same as the serial one.
+  auto outputs =
+      std::vector<std::ostringstream>(trans_unit.extern_decls.size());
+  auto generators = std::vector<std::unique_ptr<LlvmIrGenerator>>{};
+  auto generations = std::vector<std::future<void>>{};
+  for (auto i = std::size_t{0}, e = outputs.size(); i < e; ++i) {
+    generators.push_back(std::make_unique<LlvmIrGenerator>(
+        outputs.at(i), nullptr, pointer_kind_));
+    generators.back()->SetProfiler(profiler());
+    generations.push_back(thread_pool_->Submit(
+        [&generator = *generators.back(),
+         &extern_decl = *trans_unit.extern_decls.at(i)] {
+          generator.GenerateExternDecl(extern_decl);
+        }));
+  }
+  for (auto& generation : generations) {
+    generation.get();
+  }
+  for (auto i = std::size_t{0}, e = outputs.size(); i < e; ++i) {
+    output_ << outputs.at(i).str();
+    referred_funcs_.merge(generators.at(i)->referred_funcs_);
+    defined_funcs_.merge(generators.at(i)->defined_funcs_);
+  }
+}
+
+void LlvmIrGenerator::ReferTo_(const std::string& symbol,
+                               const FuncType& func_type) {
+  if (referred_funcs_.count(symbol) == 0) {
+    referred_funcs_.emplace(symbol, DeclOf(symbol, func_type));
+  }
+}
+
+void LlvmIrGenerator::Visit(const IfStmtNode& if_stmt) {
+  Dispatch(*if_stmt.predicate);
+  const auto predicate = value_recorder.ValueOfPrevExpr();
+  const auto then_label = NextNum();
+  const auto end_label = NextNum();
+  const auto else_label = if_stmt.or_else ? NextNum() : end_label;
+
+  WriteJnz(*predicate.val, *if_stmt.predicate->type, then_label, else_label);
+  WriteLabel(then_label);
+  Dispatch(*if_stmt.then);
+  if (if_stmt.or_else) {
+    // Skip the "else" part after executing "then".
+    WriteJmp(end_label);
+    WriteLabel(else_label);
+    Dispatch(*if_stmt.or_else);
+  }
+  WriteLabel(end_label);
+}
+
+void LlvmIrGenerator::Visit(const WhileStmtNode& while_stmt) {
+  const auto body_label = NextNum();
+  const auto pred_label = NextNum();
+  const auto end_label = NextNum();
+
+  if (!while_stmt.is_do_while) {
+    WriteLabel(pred_label);
+    Dispatch(*while_stmt.predicate);
+    WriteJnz(*value_recorder.ValueOfPrevExpr().val,
+             *while_stmt.predicate->type, body_label, end_label);
+  }
+  WriteLabel(body_label);
+  labels_of_jumpable_blocks.push_back({pred_label, end_label});
+  Dispatch(*while_stmt.loop_body);
+  labels_of_jumpable_blocks.pop_back();
+  if (!while_stmt.is_do_while) {
+    WriteJmp(pred_label);
+  } else {
+    WriteLabel(pred_label);
+    Dispatch(*while_stmt.predicate);
+    WriteJnz(*value_recorder.ValueOfPrevExpr().val,
+             *while_stmt.predicate->type, body_label, end_label);
+  }
+  WriteLabel(end_label);
+}
+
+void LlvmIrGenerator::Visit(const ForStmtNode& for_stmt) {
+  const auto pred_label = NextNum();
+  const auto body_label = NextNum();
+  const auto step_label = NextNum();
+  const auto end_label = NextNum();
+
+  Dispatch(*for_stmt.loop_init);
+  WriteLabel(pred_label);
+  Dispatch(*for_stmt.predicate);
+  if (!Isa<NullExprNode>(*for_stmt.predicate)) {
+    WriteJnz(*value_recorder.ValueOfPrevExpr().val, *for_stmt.predicate->type,
+             body_label, end_label);
+  }
+  WriteLabel(body_label);
+  labels_of_jumpable_blocks.push_back({step_label, end_label});
+  Dispatch(*for_stmt.loop_body);
+  labels_of_jumpable_blocks.pop_back();
+  WriteLabel(step_label);
+  Dispatch(*for_stmt.step);
+  WriteJmp(pred_label);
+  WriteLabel(end_label);
+}
+
+void LlvmIrGenerator::Visit(const ReturnStmtNode& ret_stmt) {
+  Dispatch(*ret_stmt.expr);
+  assert(return_type_of_func);
+  if (Isa<NullExprNode>(*ret_stmt.expr)) {
+    WriteDefaultRet();
+    return;
+  }
+  const auto ret = value_recorder.ValueOfPrevExpr();
+  const auto& ret_type = *return_type_of_func;
+  if (IsReturnedInMemory(ret_type)) {
+    WriteMemcpy(ret_ptr, *ret.obj, ret_type.size());
+    WriteTerminator("ret void");
+    return;
+  }
+  if (Isa<RecordType>(ret_type)) {
+    const auto pieces = WriteLoadOfPieces(*ret.obj, ret_type.size());
+    if (pieces.size() == 1) {
+      WriteTerminator("ret i64 {}", pieces.front());
+      return;
+    }
+    const auto first = WriteValueInstr(
+        "insertvalue {{ i64, i64 }} undef, i64 {}, 0", pieces.front());
+    const auto both = WriteValueInstr(
+        "insertvalue {{ i64, i64 }} {}, i64 {}, 1", first, pieces.back());
+    WriteTerminator("ret {{ i64, i64 }} {}", both);
+    return;
+  }
+  const auto val = ConvertTo_(*ret.val, *ret_stmt.expr->type, ret_type);
+  const auto value_type = ValueTypeOf(ret_type);
+  WriteTerminator("ret {} {}", value_type, ReprOf(val, value_type));
+}
+
+void LlvmIrGenerator::Visit(const GotoStmtNode& goto_stmt) {
+  WriteJmp(UserLabelOf(goto_stmt.label));
+}
+
+void LlvmIrGenerator::Visit(const BreakStmtNode& break_stmt) {
+  assert(!labels_of_jumpable_blocks.empty());
+  WriteJmp(labels_of_jumpable_blocks.back().exit);
+}
+
+void LlvmIrGenerator::Visit(const ContinueStmtNode& continue_stmt) {
+  assert(!labels_of_jumpable_blocks.empty());
+  WriteJmp(labels_of_jumpable_blocks.back().entry);
+}
+
+void LlvmIrGenerator::Visit(const SwitchStmtNode& switch_stmt) {
+  // As in QbeIrGenerator, the cases are generated first, followed by the
+  // conditions that match the controlling expression against them; `opt`
+  // turns the conditions into a jump table when it pays off.
+  Dispatch(*switch_stmt.ctrl);
+  const auto ctrl = *value_recorder.ValueOfPrevExpr().val;
+  const auto cond_label = NextNum();
+  WriteJmp(cond_label);
+
+  const auto exit_label = NextNum();
+  switch_infos.push_back({{}, std::nullopt, exit_label});
+  labels_of_jumpable_blocks.push_back({exit_label, exit_label});
+  Dispatch(*switch_stmt.stmt);
+  labels_of_jumpable_blocks.pop_back();
+  WriteJmp(exit_label);
+  GenerateConditions_(switch_stmt, cond_label, ctrl);
+  WriteLabel(exit_label);
+  switch_infos.pop_back();
+}
+
+void LlvmIrGenerator::GenerateConditions_(const SwitchStmtNode& switch_stmt,
+                                          int first_cond_label,
+                                          const Operand& ctrl) {
+  const auto& switch_info = switch_infos.back();
+  WriteLabel(first_cond_label);
+  // The case expressions are converted to the promoted type of the
+  // controlling expression, whose value is already extended to it.
+  const auto& ctrl_type = *switch_stmt.ctrl->type;
+  const auto& promoted_type = ctrl_type.size() < 4 ? kPromotedType : ctrl_type;
+  for (auto i = std::size_t{0}, e = switch_info.case_infos.size(); i < e;
+       ++i) {
+    const auto& case_info = switch_info.case_infos.at(i);
+    Dispatch(*case_info.expr);
+    const auto expr = ConvertTo_(*value_recorder.ValueOfPrevExpr().val,
+                                 *case_info.expr->type, promoted_type);
+    const auto match =
+        WriteCmp("eq", ValueTypeOf(promoted_type), ctrl, expr);
+    const auto is_last_cond = i == e - 1;
+    // If no case matches, jump to the default case; to the exit if no default
+    // case exists.
+    const auto next_label = !is_last_cond ? NextNum()
+                            : switch_info.default_label
+                                ? *switch_info.default_label
+                                : switch_info.exit_label;
+    WriteJnz(match, kPromotedType, case_info.label, next_label);
+    if (!is_last_cond) {
+      WriteLabel(next_label);
+    }
+  }
+  if (switch_info.case_infos.empty()) {
+    WriteJmp(switch_info.default_label.value_or(switch_info.exit_label));
+  }
+}
+
+void LlvmIrGenerator::Visit(const IdLabeledStmtNode& id_labeled_stmt) {
+  WriteLabel(UserLabelOf(id_labeled_stmt.label));
+  Dispatch(*id_labeled_stmt.stmt);
+}
+
+void LlvmIrGenerator::Visit(const CaseStmtNode& case_stmt) {
+  assert(!switch_infos.empty());
+  // The evaluation of the case expression is done in the condition part.
+  const auto case_label = NextNum();
+  switch_infos.back().case_infos.push_back({case_stmt.expr.get(), case_label});
+  WriteLabel(case_label);
+  Dispatch(*case_stmt.stmt);
+}
+
+void LlvmIrGenerator::Visit(const DefaultStmtNode& default_stmt) {
+  assert(!switch_infos.empty());
+  const auto default_label = NextNum();
+  switch_infos.back().default_label = default_label;
+  WriteLabel(default_label);
+  Dispatch(*default_stmt.stmt);
+}
+
+void LlvmIrGenerator::Visit(const ExprStmtNode& expr_stmt) {
+  Dispatch(*expr_stmt.expr);
+}
+
+void LlvmIrGenerator::Visit(const InitExprNode& init_expr) {
+  Dispatch(*init_expr.expr);
+}
+
+void LlvmIrGenerator::Visit(const ArrDesNode& arr_des) {}
+
+void LlvmIrGenerator::Visit(const IdDesNode& id_des) {}
+
+void LlvmIrGenerator::Visit(const NullExprNode& null_expr) {
+  /* do nothing */
+}
+
+void LlvmIrGenerator::Visit(const IdExprNode& id_expr) {
+  // If the id is a function, the result is the address of the function.
+  if (id_expr.type->IsFunc()) {
+    const auto& func_type = Cast<FuncType>(*id_expr.type);
+    ReferTo_(id_expr.id, func_type);
+    value_recorder.Record({Operand::OfName(FuncAddrOf(id_expr.id, func_type))});
+    return;
+  }
+  assert(id_to_addr.count(id_expr.id) != 0);
+  value_recorder.Record(
+      ValueOfObject(*id_expr.type, id_to_addr.at(id_expr.id)));
+}
+
+void LlvmIrGenerator::Visit(const IntConstExprNode& int_expr) {
+  value_recorder.Record(
+      {Operand::OfImm(static_cast<std::int64_t>(int_expr.val))});
+}
+
+void LlvmIrGenerator::Visit(const ArgExprNode& arg_expr) {
+  Dispatch(*arg_expr.arg);
+}
+
+void LlvmIrGenerator::Visit(const ArrSubExprNode& arr_sub_expr) {
+  Dispatch(*arr_sub_expr.arr);
+  const auto arr = value_recorder.ValueOfPrevExpr();
+  Dispatch(*arr_sub_expr.index);
+  const auto index =
+      ConvertTo_(*value_recorder.ValueOfPrevExpr().val,
+                 *arr_sub_expr.index->type, PrimType{PrimitiveType::kLong});
+
+  const auto* arr_type = DynCast<ArrType>(arr_sub_expr.arr->type.get());
+  assert(arr_type);
+  const auto& element_type = arr_type->element_type();
+  const auto element_size = static_cast<std::int64_t>(element_type.size());
+  assert(arr.obj);
+  // NOTE: The offset is in bytes, as all the addresses point to bytes, so
+  // that they're i8 GEPs whether the pointers are typed or not.
+  const auto addr =
+      index.IsImm()
+          ? AddressAt(*arr.obj, index.imm * element_size)
+          : WriteValueInstr(
+                "getelementptr inbounds i8, {} {}, i64 {}", PtrIrType(),
+                *arr.obj,
+                WriteValueInstr("mul nsw i64 {}, {}", index.name,
+                                element_size));
+  value_recorder.Record(ValueOfObject(element_type, addr));
+}
+
+void LlvmIrGenerator::Visit(const CondExprNode& cond_expr) {
+  Dispatch(*cond_expr.predicate);
+  const auto predicate = value_recorder.ValueOfPrevExpr();
+  // The second operand is evaluated only if the first compares unequal to 0;
+  // the third operand is evaluated only if the first compares equal to 0; the
+  // result is the value of the second or third operand (whichever is
+  // evaluated).
+  const auto second_label = NextNum();
+  const auto third_label = NextNum();
+  const auto end_label = NextNum();
+  WriteJnz(*predicate.val, *cond_expr.predicate->type, second_label,
+           third_label);
+  const auto& res_type = *cond_expr.type;
+  const auto res_value_type = ValueTypeOf(res_type);
+  // The result is passed through an allocation, which `opt` turns into a phi.
+  const auto res_addr = WriteAlloca(res_value_type, kEightBytes);
+  const auto store_res = [&](const ExprNode& expr) {
+    const auto val = ConvertTo_(OperandOf(value_recorder.ValueOfPrevExpr()),
+                                *expr.type, res_type);
+    WriteStoreOf(res_value_type, ReprOf(val, res_value_type), res_addr);
+  };
+  WriteLabel(second_label);
+  Dispatch(*cond_expr.then);
+  store_res(*cond_expr.then);
+  WriteJmp(end_label);
+  WriteLabel(third_label);
+  Dispatch(*cond_expr.or_else);
+  store_res(*cond_expr.or_else);
+  WriteLabel(end_label);
+  const auto res = WriteLoadOf(res_value_type, res_addr);
+  if (IsAggregate(res_type)) {
+    value_recorder.Record({std::nullopt, res});
+  } else {
+    value_recorder.Record({Operand::OfName(res)});
+  }
+}
+
+void LlvmIrGenerator::Visit(const FuncCallExprNode& call_expr) {
+  const auto* func_type = DynCast<FuncType>(call_expr.func_expr->type.get());
+  if (const auto* ptr_type =
+          DynCast<PtrType>(call_expr.func_expr->type.get())) {
+    func_type = DynCast<FuncType>(&ptr_type->base_type());
+  }
+  assert(func_type);
+
+  // A function that is named is called directly; others through their
+  // addresses.
+  auto callee = std::string{};
+  auto is_direct = false;
+  const auto* id_expr = DynCast<IdExprNode>(call_expr.func_expr.get());
+  if (id_expr && id_expr->type->IsFunc()) {
+    const auto runtime_func = RuntimeFuncOf(id_expr->id);
+    const auto symbol =
+        runtime_func.empty() ? id_expr->id : std::string{runtime_func};
+    ReferTo_(symbol, *func_type);
+    callee = fmt::format("@{}", symbol);
+    is_direct = true;
+  } else {
+    Dispatch(*call_expr.func_expr);
+    callee = ReprOf(*value_recorder.ValueOfPrevExpr().val, PtrIrType());
+  }
+
+  const auto& ret_type = *call_expr.type;
+  auto args = std::vector<std::string>{};
+  // The types of the arguments, which a typed callee is cast to a pointer to
+  // a function of.
+  auto arg_types = std::vector<std::string>{};
+  auto ret_addr = std::string{};
+  if (IsReturnedInMemory(ret_type)) {
+    ret_addr = WriteAllocaOf(ret_type);
+    args.push_back(fmt::format("{} {}", InMemoryParamTypeOf("sret", ret_type),
+                               InMemoryArgOf(ret_type, ret_addr)));
+    arg_types.push_back(InMemoryPtrTypeOf(ret_type));
+  }
+
+  /// @return The type that the `i`-th argument is passed as.
+  const auto param_type_of = [&](std::size_t i) -> const Type& {
+    const auto& param_types = func_type->param_types();
+    return i < param_types.size() ? *param_types.at(i)
+                                  : *call_expr.args.at(i)->type;
+  };
+  // Evaluate the arguments, which are converted to the types of the
+  // parameters.
+  auto classifier = ArgClassifier{!ret_addr.empty()};
+  for (auto i = std::size_t{0}, e = call_expr.args.size(); i < e; ++i) {
+    const auto& arg = call_expr.args.at(i);
+    Dispatch(*arg);
+    const auto& param_type = param_type_of(i);
+    const auto val = OperandOf(value_recorder.ValueOfPrevExpr());
+    switch (classifier.Classify(param_type)) {
+      case Passing::kValue: {
+        const auto value_type = ValueTypeOf(param_type);
+        args.push_back(fmt::format(
+            "{} {}", value_type,
+            ReprOf(ConvertTo_(val, *arg->type, param_type), value_type)));
+        arg_types.emplace_back(value_type);
+      } break;
+      case Passing::kPieces:
+        for (const auto& piece :
+             WriteLoadOfPieces(val.name, param_type.size())) {
+          args.push_back(fmt::format("i64 {}", piece));
+          arg_types.emplace_back("i64");
+        }
+        break;
+      case Passing::kByVal:
+        args.push_back(fmt::format("{} {}",
+                                   InMemoryParamTypeOf("byval", param_type),
+                                   InMemoryArgOf(param_type, val.name)));
+        arg_types.push_back(InMemoryPtrTypeOf(param_type));
+        break;
+    }
+  }
+  if (is_ptr_typed) {
+    // An address is cast to the function that it's called as; so is a
+    // function that is called with more arguments than it's declared with.
+    const auto func_ptr_type = FuncPtrTypeOf(ret_type, arg_types);
+    if (!is_direct) {
+      callee = WriteCast("bitcast", Operand::OfName(callee), PtrIrType(),
+                         func_ptr_type)
+                   .name;
+    } else if (call_expr.args.size() > func_type->param_types().size()) {
+      callee = fmt::format(
+          "bitcast ({} {} to {})",
+          FuncPtrTypeOf(ret_type, ParamTypesOf(*func_type, false)), callee,
+          func_ptr_type);
+    }
+  }
+
+  const auto call = fmt::format("call {} {}({})", RetTypeOf(ret_type), callee,
+                                fmt::join(args, ", "));
+  if (IsReturnedInMemory(ret_type)) {
+    WriteInstr("{}", call);
+    value_recorder.Record({std::nullopt, ret_addr});
+  } else if (Isa<RecordType>(ret_type)) {
+    // A record returned in registers is stored to the caller, and the result
+    // is its address.
+    const auto res = WriteValueInstr("{}", call);
+    auto pieces = std::vector<std::string>{res};
+    if (NumOfPiecesOf(ret_type) != 1) {
+      pieces = {WriteValueInstr("extractvalue {{ i64, i64 }} {}, 0", res),
+                WriteValueInstr("extractvalue {{ i64, i64 }} {}, 1", res)};
+    }
+    value_recorder.Record({std::nullopt, WriteStoreOfPieces(pieces)});
+  } else {
+    value_recorder.Record({Operand::OfName(WriteValueInstr("{}", call))});
+  }
+}
+
+void LlvmIrGenerator::Visit(const PostfixArithExprNode& postfix_expr) {
+  // The result of the postfix ++ operator is the value of the operand. As a
+  // side effect, the value of the operand object is incremented; the postfix
+  // -- operator is analogous.
+  Dispatch(*postfix_expr.operand);
+  const auto operand = value_recorder.ValueOfPrevExpr();
+  assert(operand.obj);
+  const auto arith_op = postfix_expr.op == PostfixOperator::kIncr
+                            ? BinaryOperator::kAdd
+                            : BinaryOperator::kSub;
+  const auto& type = *postfix_expr.operand->type;
+  WriteStore(type, WriteIncrOrDecr_(arith_op, *operand.val, type),
+             *operand.obj);
+  value_recorder.Record({operand.val});
+}
+
+void LlvmIrGenerator::Visit(const RecordMemExprNode& mem_expr) {
+  Dispatch(*mem_expr.expr);
+  const auto record = value_recorder.ValueOfPrevExpr();
+  const auto* record_type = DynCast<RecordType>(mem_expr.expr->type.get());
+  assert(record_type && record.obj);
+  const auto addr = AddressAt(
+      *record.obj,
+      static_cast<std::int64_t>(record_type->OffsetOf(mem_expr.id)));
+  value_recorder.Record(ValueOfObject(*mem_expr.type, addr));
+}
+
+void LlvmIrGenerator::Visit(const UnaryExprNode& unary_expr) {
+  Dispatch(*unary_expr.operand);
+  auto operand = value_recorder.ValueOfPrevExpr();
+  const auto& operand_type = *unary_expr.operand->type;
+  switch (unary_expr.op) {
+    case UnaryOperator::kIncr:
+    case UnaryOperator::kDecr: {
+      // Equivalent to i += 1 or i -= 1.
+      assert(operand.obj);
+      const auto arith_op = unary_expr.op == UnaryOperator::kIncr
+                                ? BinaryOperator::kAdd
+                                : BinaryOperator::kSub;
+      const auto res = WriteIncrOrDecr_(arith_op, *operand.val, operand_type);
+      WriteStore(operand_type, res, *operand.obj);
+      value_recorder.Record({res});
+    } break;
+    case UnaryOperator::kNeg:
+    case UnaryOperator::kBitComp: {
+      const auto& type = *unary_expr.type;
+      const auto value_type = ValueTypeOf(type);
+      const auto val = ReprOf(ConvertTo_(*operand.val, operand_type, type),
+                              value_type);
+      value_recorder.Record({Operand::OfName(
+          unary_expr.op == UnaryOperator::kNeg
+              ? WriteValueInstr("sub {} 0, {}", value_type, val)
+              : WriteValueInstr("xor {} {}, -1", value_type, val))});
+    } break;
+    case UnaryOperator::kNot:
+      // The expression !E is equivalent to (0 == E).
+      value_recorder.Record({WriteCmp("eq", ValueTypeOf(operand_type),
+                                      *operand.val, Operand::OfImm(0))});
+      break;
+    case UnaryOperator::kAddr:
+      if (operand_type.IsFunc()) {
+        // No-op; the function itself already evaluates to the address.
+        value_recorder.Record(std::move(operand));
+        break;
+      }
+      assert(operand.obj);
+      value_recorder.Record({Operand::OfName(*operand.obj)});
+      break;
+    case UnaryOperator::kDeref:
+      if (operand_type.IsPtr() &&
+          Cast<PtrType>(operand_type).base_type().IsFunc()) {
+        // No-op; the function itself also evaluates to the address.
+        value_recorder.Record(std::move(operand));
+        break;
+      }
+      // The result might yet be another pointer if the operand is a pointer to
+      // a pointer.
+      value_recorder.Record(
+          ValueOfObject(*unary_expr.type, ReprOf(*operand.val, PtrIrType())));
+      break;
+    default:
+      // The unary plus does nothing.
+      value_recorder.Record(std::move(operand));
+      break;
+  }
+}
+
+void LlvmIrGenerator::Visit(const BinaryExprNode& bin_expr) {
+  VisitLeftChain_(
+      bin_expr, [](const BinaryExprNode&) {},
+      [this](const BinaryExprNode& expr) { GenerateBinaryExpr_(expr); });
+}
+
+void LlvmIrGenerator::GenerateBinaryExpr_(const BinaryExprNode& bin_expr) {
+  const auto lhs = value_recorder.ValueOfPrevExpr();
+  if (bin_expr.op == BinaryOperator::kComma) {
+    // The value of the left operand is discarded.
+    Dispatch(*bin_expr.rhs);
+    return;
+  }
+
+  if (bin_expr.op == BinaryOperator::kLand ||
+      bin_expr.op == BinaryOperator::kLor) {
+    // (&& operator) If the first operand compares equal to 0, the second
+    // operand is not evaluated. (|| operator) If the first operand compares
+    // unequal to 0, the second operand is not evaluated.
+    const auto rhs_label = NextNum();
+    const auto short_circuit_label = NextNum();
+    const auto end_label = NextNum();
+    const auto is_land = bin_expr.op == BinaryOperator::kLand;
+    WriteJnz(*lhs.val, *bin_expr.lhs->type,
+             is_land ? rhs_label : short_circuit_label,
+             is_land ? short_circuit_label : rhs_label);
+    const auto res_addr = WriteAlloca("i32", 4);
+    WriteLabel(rhs_label);
+    Dispatch(*bin_expr.rhs);
+    const auto rhs = WriteCmp("ne", ValueTypeOf(*bin_expr.rhs->type),
+                              *value_recorder.ValueOfPrevExpr().val,
+                              Operand::OfImm(0));
+    WriteStoreOf("i32", ReprOf(rhs, "i32"), res_addr);
+    WriteJmp(end_label);
+    WriteLabel(short_circuit_label);
+    WriteStoreOf("i32", is_land ? "0" : "1", res_addr);
+    WriteLabel(end_label);
+    value_recorder.Record(
+        {Operand::OfName(WriteLoadOf("i32", res_addr))});
+    return;
+  }
+
+  Dispatch(*bin_expr.rhs);
+  const auto rhs = value_recorder.ValueOfPrevExpr();
+  // The operands are converted to a common type; the shift amount to that of
+  // the left operand, as LLVM requires. The arithmetic on pointers is done on
+  // their addresses.
+  const auto operand_type = OperandTypeOf(bin_expr);
+  const auto is_cmp = IsComparison(bin_expr.op);
+  const auto& arith_type = is_cmp || operand_type->IsPrim()
+                               ? *operand_type
+                               : static_cast<const Type&>(kAddrType);
+  const auto value_type = ValueTypeOf(arith_type);
+  const auto lhs_val = ConvertTo_(*lhs.val, *bin_expr.lhs->type, arith_type);
+  const auto rhs_val = ConvertTo_(*rhs.val, *bin_expr.rhs->type, arith_type);
+  const auto instr = InstrOf(bin_expr.op, arith_type);
+  if (is_cmp) {
+    value_recorder.Record({WriteCmp(instr, value_type, lhs_val, rhs_val)});
+    return;
+  }
+  const auto res = Operand::OfName(WriteValueInstr(
+      "{} {} {}, {}", instr, value_type, ReprOf(lhs_val, value_type),
+      ReprOf(rhs_val, value_type)));
+  value_recorder.Record({ConvertTo_(res, arith_type, *bin_expr.type)});
+}
+
+void LlvmIrGenerator::Visit(const SimpleAssignmentExprNode& assign_expr) {
+  Dispatch(*assign_expr.lhs);
+  const auto lhs = value_recorder.ValueOfPrevExpr();
+  Dispatch(*assign_expr.rhs);
+  const auto rhs = value_recorder.ValueOfPrevExpr();
+  assert(lhs.obj);
+  const auto& lhs_type = *assign_expr.lhs->type;
+  if (Isa<RecordType>(lhs_type)) {
+    // The value of the assignment is the assigned record.
+    WriteStoreOf_(OperandOf(rhs), *assign_expr.rhs->type, lhs_type, *lhs.obj);
+    value_recorder.Record({std::nullopt, *lhs.obj});
+    return;
+  }
+  // The value of the assignment is that of the left operand after the
+  // assignment, i.e., converted to its type.
+  const auto val = ConvertTo_(*rhs.val, *assign_expr.rhs->type, lhs_type);
+  WriteStore(lhs_type, val, *lhs.obj);
+  value_recorder.Record({val});
+}
+
+void LlvmIrGenerator::ResetStates_() {
+  is_ptr_typed = pointer_kind_ == PointerKind::kTyped;
+  next_num = 0;
+  body.clear();
+  allocas.clear();
+  is_block_terminated = false;
+  is_memcpy_used = false;
+  return_type_of_func = nullptr;
+  id_to_addr.clear();
+  user_labels.clear();
+  value_recorder = PrevExprValueRecorder{};
+  labels_of_jumpable_blocks.clear();
+  switch_infos.clear();
+  ret_ptr.clear();
+}
+
+Operand LlvmIrGenerator::ConvertTo_(const Operand& val, const Type& from,
+                                    const Type& to) {
+  const auto from_type = ValueTypeOf(from);
+  const auto to_type = ValueTypeOf(to);
+  if (from_type == PtrIrType() || to_type == PtrIrType()) {
+    if (from_type == to_type || !(from.IsPtr() || to.IsPtr())) {
+      // Between the aggregates and the functions, which are all addresses.
+      return val;
+    }
+    // A pointer is converted as an address, which is an unsigned long.
+    if (from_type == PtrIrType()) {
+      return ConvertTo_(WriteCast("ptrtoint", val, PtrIrType(), "i64"),
+                        kAddrType, to);
+    }
+    return WriteCast("inttoptr", ConvertTo_(val, from, kAddrType), "i64",
+                     PtrIrType());
+  }
+  const auto& from_prim = Cast<PrimType>(from);
+  const auto& to_prim = Cast<PrimType>(to);
+  auto res = val;
+  if (from_type != to_type) {
+    res = WriteCast(from_type == "i64"     ? "trunc"
+                    : from_prim.IsUnsigned() ? "zext"
+                                             : "sext",
+                    val, from_type, to_type);
+  }
+  if (to_prim.size() < 4) {
+    // The integers narrower than a word are kept extended to a word, so they
+    // are truncated and extended again unless the value is preserved.
+    const auto is_to_unsigned = to_prim.IsUnsigned();
+    const auto is_value_preserved =
+        from_prim.size() < to_prim.size()
+            ? from_prim.IsUnsigned() || !is_to_unsigned
+            : from_prim.size() == to_prim.size() &&
+                  from_prim.IsUnsigned() == is_to_unsigned;
+    if (!is_value_preserved) {
+      const auto mem_type = MemTypeOf(to);
+      res = WriteCast(is_to_unsigned ? "zext" : "sext",
+                      WriteCast("trunc", res, to_type, mem_type), mem_type,
+                      to_type);
+    }
+  }
+  return res;
+}
+
+Operand LlvmIrGenerator::WriteIncrOrDecr_(BinaryOperator op,
+                                          const Operand& val,
+                                          const Type& type) {
+  const auto value_type = ValueTypeOf(type);
+  if (value_type == PtrIrType()) {
+    // `add` doesn't take a pointer, which is moved with `getelementptr`.
+    return Operand::OfName(WriteValueInstr(
+        "getelementptr i8, {} {}, i64 {}", value_type,
+        ReprOf(val, value_type), op == BinaryOperator::kAdd ? 1 : -1));
+  }
+  const auto res = Operand::OfName(WriteValueInstr(
+      "{} {} {}, 1", InstrOf(op, type), value_type, ReprOf(val, value_type)));
+  // The narrower integers are promoted, and wrap around to their own type.
+  return type.size() < 4 ? ConvertTo_(res, kPromotedType, type) : res;
+}
+
+void LlvmIrGenerator::WriteStoreOf_(const Operand& val, const Type& from,
+                                    const Type& to, const std::string& addr) {
+  if (Isa<RecordType>(to)) {
+    // Initialized from another record, which is copied as a whole.
+    WriteMemcpy(addr, ReprOf(val, PtrIrType()), to.size());
+    return;
+  }
+  WriteStore(to, ConvertTo_(val, from, to), addr);
+}
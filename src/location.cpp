@@ -0,0 +1,86 @@
+#include "location.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+Location LineMap::AddFile(std::filesystem::path path) {
+  auto ec = std::error_code{};
+  const auto size = std::filesystem::file_size(path, ec);
+  return AddFile(std::move(path),
+                 ec ? 0
+                    : static_cast<std::uint32_t>(std::min<std::uintmax_t>(
+                          size, std::numeric_limits<std::uint32_t>::max())));
+}
+
+Location LineMap::AddFile(std::filesystem::path path, std::uint32_t size) {
+  // The end of the previous file is a location in it, so this file starts
+  // one past it.
+  const auto begin =
+      files_.empty() ? 0 : files_.back().begin + files_.back().size + 1;
+  files_.emplace_back(std::move(path), begin, size);
+  return Location{begin};
+}
+
+LineColumn LineMap::Resolve(Location loc) const {
+  const auto& file = FileOf_(loc);
+  std::call_once(file.is_built, [&file]() { file.Build(); });
+  const auto offset = std::min(loc.offset - file.begin, file.size);
+  // The last line that starts at or before the offset.
+  const auto it = std::prev(std::upper_bound(file.line_starts.cbegin(),
+                                             file.line_starts.cend(), offset));
+  return LineColumn{static_cast<int>(it - file.line_starts.cbegin()) + 1,
+                    static_cast<int>(offset - *it) + 1};
+}
+
+const std::filesystem::path& LineMap::PathOf(Location loc) const {
+  return FileOf_(loc).path;
+}
+
+std::string LineMap::Describe(Location loc) const {
+  const auto line_column = Resolve(loc);
+  return PathOf(loc).string() + ":" + std::to_string(line_column.line) + ":" +
+         std::to_string(line_column.column);
+}
+
+std::vector<std::pair<std::filesystem::path, std::uint32_t>> LineMap::Files()
+    const {
+  auto files = std::vector<std::pair<std::filesystem::path, std::uint32_t>>{};
+  for (const auto& file : files_) {
+    files.emplace_back(file.path, file.size);
+  }
+  return files;
+}
+
+const LineMap::File& LineMap::FileOf_(Location loc) const {
+  assert(!files_.empty());
+  // The last file that starts at or before the location.
+  const auto it = std::upper_bound(
+      files_.cbegin(), files_.cend(), loc.offset,
+      [](std::uint32_t offset, const File& file) {
+        return offset < file.begin;
+      });
+  return *std::prev(it);
+}
+
+void LineMap::File::Build() const {
+  auto input = std::ifstream{path, std::ios::binary};
+  line_starts.push_back(0);
+  auto offset = std::uint32_t{0};
+  for (auto it = std::istreambuf_iterator<char>{input};
+       it != std::istreambuf_iterator<char>{} && offset < size; ++it) {
+    ++offset;
+    if (*it == '\n') {
+      line_starts.push_back(offset);
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <filesystem>
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+  const auto fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return;
+  }
+  struct stat file_stat {};
+  if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    if (size_ == 0) {
+      is_open_ = true;
+    } else if (auto* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+               data != MAP_FAILED) {
+      data_ = data;
+      is_open_ = true;
+    } else {
+      size_ = 0;
+    }
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
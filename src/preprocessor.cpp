@@ -0,0 +1,951 @@
+#include "preprocessor.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lexer.hpp"
+#include "location.hpp"
+#include "mapped_file.hpp"
+#include "stack_segment.hpp"
+
+struct SourceFile {
+  explicit SourceFile(std::filesystem::path file_path)
+      : path{std::move(file_path)},
+        mapping{path},
+        tokens{LexInPlace(mapping.bytes())} {
+    const auto text = tokens.source();
+    const auto& offsets = tokens.offsets();
+    const auto& lengths = tokens.lengths();
+    starts_line.reserve(tokens.size());
+    starts_line.push_back(true);
+    for (auto i = std::size_t{1}; i < tokens.size(); ++i) {
+      const auto gap_begin = offsets.at(i - 1) + lengths.at(i - 1);
+      const auto gap = text.substr(gap_begin, offsets.at(i) - gap_begin);
+      starts_line.push_back(HasNewline(gap));
+    }
+  }
+
+  std::filesystem::path path;
+  MappedFile mapping;
+  TokenBuffer tokens;
+  /// @brief Whether each token is the first of its line, which is where a
+  /// directive may start.
+  std::vector<bool> starts_line{};
+  /// @brief The macro that guards the whole file; empty if there's none. A
+  /// guarded file is skipped if the macro is defined.
+  std::string_view guard{};
+  bool is_pragma_once{false};
+
+ private:
+  /// @note Escaped newlines don't end a line.
+  static bool HasNewline(std::string_view gap) {
+    for (auto pos = gap.find('\n'); pos != std::string_view::npos;
+         pos = gap.find('\n', pos + 1)) {
+      const auto prev = pos > 0 && gap[pos - 1] == '\r' ? pos - 1 : pos;
+      if (prev == 0 || gap[prev - 1] != '\\') {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+namespace {
+
+constexpr auto kMaxIncludeDepth = std::size_t{200};
+
+/// @return The file at `path`, which is only read and lexed the first time it's
+/// loaded in the process; `nullptr` if the file can't be read.
+/// @note Not thread-safe; the preprocessing runs on a single thread.
+SourceFile* LoadSourceFile(const std::filesystem::path& path) {
+  static auto
+      files  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+      = std::unordered_map<std::string, std::unique_ptr<SourceFile>>{};
+  auto ec = std::error_code{};
+  auto key = std::filesystem::weakly_canonical(path, ec).string();
+  if (ec) {
+    key = path.string();
+  }
+  if (auto it = files.find(key); it != files.cend()) {
+    return it->second.get();
+  }
+  auto file = std::make_unique<SourceFile>(path);
+  if (!file->mapping.is_open()) {
+    return nullptr;
+  }
+  return files.emplace(std::move(key), std::move(file)).first->second.get();
+}
+
+/// @note Keywords can be macro names as well.
+bool IsIdentifier(TokenKind kind) {
+  return kind == TokenKind::kId ||
+         (kind >= TokenKind::kBreak && kind <= TokenKind::kWhile);
+}
+
+/// @return Whether `rhs` immediately follows `lhs` in the same text.
+bool IsAdjacent(std::string_view lhs, std::string_view rhs) {
+  return lhs.data() + lhs.size() == rhs.data();
+}
+
+/// @brief Evaluates the controlling expression of `#if` and `#elif`, after
+/// `defined` is resolved and the macros are expanded.
+/// @note The remaining identifiers are taken as 0.
+class ConditionEvaluator {
+ public:
+  explicit ConditionEvaluator(std::vector<PpToken> tokens)
+      : tokens_{std::move(tokens)} {}
+
+  /// @throw `std::runtime_error` if the expression is malformed.
+  std::int64_t Evaluate() {
+    const auto val = Conditional_();
+    if (pos_ != tokens_.size()) {
+      throw std::runtime_error{"missing binary operator before token \"" +
+                               std::string{tokens_.at(pos_).text} + "\""};
+    }
+    return val;
+  }
+
+ private:
+  std::vector<PpToken> tokens_;
+  std::size_t pos_{0};
+  /// @brief Whether the operands being evaluated are skipped by `&&`, `||` or
+  /// `?:`, in which division by zero is not an error.
+  int num_of_unevaluated_{0};
+
+  TokenKind Peek_() const {
+    return pos_ < tokens_.size() ? tokens_.at(pos_).kind : TokenKind::kEof;
+  }
+
+  void Expect_(TokenKind kind, const char* what) {
+    if (Peek_() != kind) {
+      throw std::runtime_error{std::string{"expected "} + what +
+                               " in expression"};
+    }
+    ++pos_;
+  }
+
+  std::int64_t Conditional_() {
+    // The operands may be nested arbitrarily deep, e.g., in parentheses.
+    if (!HasSufficientStack()) {
+      return WithSufficientStack([this] { return Conditional_(); });
+    }
+    const auto predicate = Binary_(/* min_precedence */ 1);
+    if (Peek_() != TokenKind::kQuestion) {
+      return predicate;
+    }
+    ++pos_;
+    num_of_unevaluated_ += predicate == 0;
+    const auto then = Conditional_();
+    num_of_unevaluated_ -= predicate == 0;
+    Expect_(TokenKind::kColon, "':'");
+    num_of_unevaluated_ += predicate != 0;
+    const auto or_else = Conditional_();
+    num_of_unevaluated_ -= predicate != 0;
+    return predicate ? then : or_else;
+  }
+
+  /// @return The precedence of the binary operator; 0 if `kind` isn't one.
+  static int PrecedenceOf(TokenKind kind) {
+    switch (kind) {
+      case TokenKind::kLogicOr:
+        return 1;
+      case TokenKind::kLogicAnd:
+        return 2;
+      case TokenKind::kOr:
+        return 3;
+      case TokenKind::kXor:
+        return 4;
+      case TokenKind::kAmpersand:
+        return 5;
+      case TokenKind::kEq:
+      case TokenKind::kNe:
+        return 6;
+      case TokenKind::kLt:
+      case TokenKind::kGt:
+      case TokenKind::kLe:
+      case TokenKind::kGe:
+        return 7;
+      case TokenKind::kShiftLeft:
+      case TokenKind::kShiftRight:
+        return 8;
+      case TokenKind::kPlus:
+      case TokenKind::kMinus:
+        return 9;
+      case TokenKind::kStar:
+      case TokenKind::kDiv:
+      case TokenKind::kMod:
+        return 10;
+      default:
+        return 0;
+    }
+  }
+
+  std::int64_t Binary_(int min_precedence) {
+    auto lhs = Unary_();
+    while (true) {
+      const auto op = Peek_();
+      const auto precedence = PrecedenceOf(op);
+      if (precedence == 0 || precedence < min_precedence) {
+        return lhs;
+      }
+      ++pos_;
+      // The right operand of `&&` and `||` isn't evaluated if the left one
+      // decides the result.
+      const auto is_short_circuited =
+          (op == TokenKind::kLogicAnd && lhs == 0) ||
+          (op == TokenKind::kLogicOr && lhs != 0);
+      num_of_unevaluated_ += is_short_circuited;
+      const auto rhs = Binary_(precedence + 1);
+      num_of_unevaluated_ -= is_short_circuited;
+      lhs = Apply_(op, lhs, rhs);
+    }
+  }
+
+  std::int64_t Apply_(TokenKind op, std::int64_t lhs, std::int64_t rhs) const {
+    // Wraps around on overflow instead of being undefined.
+    const auto ulhs = static_cast<std::uint64_t>(lhs);
+    const auto urhs = static_cast<std::uint64_t>(rhs);
+    switch (op) {
+      case TokenKind::kLogicOr:
+        return lhs || rhs;
+      case TokenKind::kLogicAnd:
+        return lhs && rhs;
+      case TokenKind::kOr:
+        return lhs | rhs;
+      case TokenKind::kXor:
+        return lhs ^ rhs;
+      case TokenKind::kAmpersand:
+        return lhs & rhs;
+      case TokenKind::kEq:
+        return lhs == rhs;
+      case TokenKind::kNe:
+        return lhs != rhs;
+      case TokenKind::kLt:
+        return lhs < rhs;
+      case TokenKind::kGt:
+        return lhs > rhs;
+      case TokenKind::kLe:
+        return lhs <= rhs;
+      case TokenKind::kGe:
+        return lhs >= rhs;
+      case TokenKind::kShiftLeft:
+        return static_cast<std::int64_t>(ulhs << (urhs & 63));
+      case TokenKind::kShiftRight:
+        return lhs >> (urhs & 63);
+      case TokenKind::kPlus:
+        return static_cast<std::int64_t>(ulhs + urhs);
+      case TokenKind::kMinus:
+        return static_cast<std::int64_t>(ulhs - urhs);
+      case TokenKind::kStar:
+        return static_cast<std::int64_t>(ulhs * urhs);
+      case TokenKind::kDiv:
+      case TokenKind::kMod:
+        if (rhs == 0) {
+          if (num_of_unevaluated_ > 0) {
+            return 0;
+          }
+          throw std::runtime_error{"division by zero in expression"};
+        }
+        if (rhs == -1) {
+          // Avoids the overflow of the minimum divided by -1.
+          return op == TokenKind::kDiv
+                     ? static_cast<std::int64_t>(std::uint64_t{0} - ulhs)
+                     : 0;
+        }
+        return op == TokenKind::kDiv ? lhs / rhs : lhs % rhs;
+      default:
+        return 0;
+    }
+  }
+
+  std::int64_t Unary_() {
+    if (!HasSufficientStack()) {
+      return WithSufficientStack([this] { return Unary_(); });
+    }
+    switch (Peek_()) {
+      case TokenKind::kPlus:
+        ++pos_;
+        return Unary_();
+      case TokenKind::kMinus:
+        ++pos_;
+        return static_cast<std::int64_t>(std::uint64_t{0} -
+                                         static_cast<std::uint64_t>(Unary_()));
+      case TokenKind::kExclamation:
+        ++pos_;
+        return !Unary_();
+      case TokenKind::kTilde:
+        ++pos_;
+        return ~Unary_();
+      case TokenKind::kLeftParen: {
+        ++pos_;
+        const auto val = Conditional_();
+        Expect_(TokenKind::kRightParen, "')'");
+        return val;
+      }
+      case TokenKind::kNum:
+        return Number_();
+      case TokenKind::kEof:
+        throw std::runtime_error{"expected value in expression"};
+      default:
+        if (IsIdentifier(Peek_())) {
+          ++pos_;
+          return 0;
+        }
+        throw std::runtime_error{"token \"" +
+                                 std::string{tokens_.at(pos_).text} +
+                                 "\" is not valid in expression"};
+    }
+  }
+
+  /// @note The lexer splits "0x1F" into "0" and "x1F", and "1UL" into "1" and
+  /// "UL"; such adjacent identifiers are taken as part of the number.
+  std::int64_t Number_() {
+    const auto digits = tokens_.at(pos_++).text;
+    auto suffix = std::string_view{};
+    if (pos_ < tokens_.size() && tokens_.at(pos_).kind == TokenKind::kId &&
+        IsAdjacent(digits, tokens_.at(pos_).text)) {
+      suffix = tokens_.at(pos_++).text;
+    }
+    auto val = std::uint64_t{0};
+    if (digits == "0" && !suffix.empty() &&
+        (suffix.front() == 'x' || suffix.front() == 'X')) {
+      suffix.remove_prefix(1);
+      auto num_of_digits = 0;
+      while (!suffix.empty() && std::isxdigit(static_cast<unsigned char>(
+                                    suffix.front()))) {
+        const auto c = static_cast<char>(
+            std::tolower(static_cast<unsigned char>(suffix.front())));
+        val = val * 16 + static_cast<std::uint64_t>(
+                             c <= '9' ? c - '0' : c - 'a' + 10);
+        suffix.remove_prefix(1);
+        ++num_of_digits;
+      }
+      if (num_of_digits == 0) {
+        throw std::runtime_error{"invalid hexadecimal constant"};
+      }
+    } else {
+      const auto base = digits.size() > 1 && digits.front() == '0' ? 8U : 10U;
+      for (const auto digit : digits) {
+        if (static_cast<unsigned>(digit - '0') >= base) {
+          throw std::runtime_error{"invalid digit in octal constant"};
+        }
+        val = val * base + static_cast<std::uint64_t>(digit - '0');
+      }
+    }
+    if (suffix.find_first_not_of("uUlL") != std::string_view::npos) {
+      throw std::runtime_error{"invalid suffix on integer constant"};
+    }
+    return static_cast<std::int64_t>(val);
+  }
+};
+
+}  // namespace
+
+Preprocessor::Preprocessor(const std::filesystem::path& path,
+                           std::vector<std::filesystem::path> include_dirs,
+                           LineMap& line_map)
+    : include_dirs_{std::move(include_dirs)}, line_map_{line_map} {
+  auto* file = LoadSourceFile(path);
+  if (file == nullptr) {
+    std::cerr << "cannot open input file" << '\n';
+    std::exit(0);
+  }
+  EnterFile_(*file);
+}
+
+void Preprocessor::Define(std::string_view name, std::string_view value) {
+  const auto text = Store_(std::string{value});
+  const auto tokens = LexInPlace(text);
+  auto body = std::vector<Token>{};
+  for (auto i = std::size_t{0}; i + 1 < tokens.size(); ++i) {
+    body.push_back(Token{tokens.kinds().at(i), tokens.TextOf(i), Location{0},
+                         /* hide_set */ nullptr});
+  }
+  macros_.insert_or_assign(Store_(std::string{name}),
+                           Macro{/* is_function_like */ false, {},
+                                 /* is_variadic */ false, std::move(body)});
+  has_directives_ = true;
+}
+
+PpToken Preprocessor::Next() {
+  while (true) {
+    const auto token = NextUnexpanded_();
+    if (IsIdentifier(token.kind) && TryExpand_(token)) {
+      continue;
+    }
+    return PpToken{token.kind, token.text, token.loc};
+  }
+}
+
+Preprocessor::Token Preprocessor::NextUnexpanded_() {
+  if (!pending_.empty()) {
+    const auto token = pending_.back();
+    pending_.pop_back();
+    return token;
+  }
+  if (!is_reading_files_) {
+    return Token{TokenKind::kEof, {}, Location{0}, /* hide_set */ nullptr};
+  }
+  return NextFromFiles_();
+}
+
+Preprocessor::Token Preprocessor::NextFromFiles_() {
+  while (true) {
+    auto& frame = frames_.back();
+    auto& file = *frame.file;
+    const auto i = frame.next;
+    const auto kind = file.tokens.kinds().at(i);
+    const auto offset = file.tokens.offsets().at(i);
+    const auto loc = Location{frame.base.offset + offset};
+    if (kind == TokenKind::kEof) {
+      if (conds_.size() > frame.num_of_outer_conds) {
+        Error_(conds_.back().loc, "unterminated conditional directive");
+      }
+      if (frame.guard_state == GuardState::kAfterGuard) {
+        file.guard = frame.guard;
+      }
+      if (frames_.size() == 1) {
+        // The EOF token is the last one and is returned repeatedly.
+        return Token{kind, {}, loc, /* hide_set */ nullptr};
+      }
+      frames_.pop_back();
+      continue;
+    }
+    ++frame.next;
+    if (kind == TokenKind::kHash && file.starts_line.at(i)) {
+      directive_loc_ = loc;
+      HandleDirective_();
+      continue;
+    }
+    if (!IsTaking_()) {
+      continue;
+    }
+    SeeNonGuard_();
+    return Token{kind, file.tokens.TextOf(i), loc, /* hide_set */ nullptr};
+  }
+}
+
+bool Preprocessor::TryExpand_(const Token& token) {
+  const auto it = macros_.find(token.text);
+  if (it == macros_.cend() ||
+      (token.hide_set && std::binary_search(token.hide_set->cbegin(),
+                                            token.hide_set->cend(),
+                                            token.text))) {
+    return false;
+  }
+  const auto& macro = it->second;
+  auto args = std::vector<std::vector<Token>>{};
+  if (macro.is_function_like) {
+    auto read_args = ReadArgs_(token, macro);
+    if (!read_args) {
+      return false;
+    }
+    args = std::move(*read_args);
+  }
+  const auto result = Substitute_(macro, args, token);
+  pending_.insert(pending_.cend(), result.crbegin(), result.crend());
+  return true;
+}
+
+auto Preprocessor::ReadArgs_(const Token& name, const Macro& macro)
+    -> std::optional<std::vector<std::vector<Token>>> {
+  const auto left_paren = NextUnexpanded_();
+  if (left_paren.kind != TokenKind::kLeftParen) {
+    // Not an invocation; the name is an ordinary identifier.
+    pending_.push_back(left_paren);
+    return std::nullopt;
+  }
+  auto args = std::vector<std::vector<Token>>(1);
+  auto depth = 0;
+  while (true) {
+    const auto token = NextUnexpanded_();
+    if (token.kind == TokenKind::kEof) {
+      Error_(name.loc, "unterminated argument list invoking macro \"" +
+                           std::string{name.text} + "\"");
+    }
+    if (depth == 0 && token.kind == TokenKind::kRightParen) {
+      break;
+    }
+    // The variable arguments are taken as a whole, commas included.
+    if (depth == 0 && token.kind == TokenKind::kComma &&
+        !(macro.is_variadic && args.size() == macro.params.size())) {
+      args.emplace_back();
+      continue;
+    }
+    if (token.kind == TokenKind::kLeftParen) {
+      ++depth;
+    } else if (token.kind == TokenKind::kRightParen) {
+      --depth;
+    }
+    args.back().push_back(token);
+  }
+  if (macro.params.empty() && args.size() == 1 && args.front().empty()) {
+    args.clear();
+  } else if (macro.is_variadic && args.size() + 1 == macro.params.size()) {
+    // The variable arguments may be omitted.
+    args.emplace_back();
+  }
+  if (args.size() != macro.params.size()) {
+    Error_(name.loc, "macro \"" + std::string{name.text} + "\" requires " +
+                         std::to_string(macro.params.size()) +
+                         " arguments, but " + std::to_string(args.size()) +
+                         " given");
+  }
+  return args;
+}
+
+std::vector<Preprocessor::Token> Preprocessor::Substitute_(
+    const Macro& macro, const std::vector<std::vector<Token>>& args,
+    const Token& name) {
+  const auto* hide_set = Extend_(name.hide_set, name.text);
+  const auto param_index_of =
+      [&macro](const Token& token) -> std::optional<std::size_t> {
+    if (!macro.is_function_like || !IsIdentifier(token.kind)) {
+      return std::nullopt;
+    }
+    const auto it =
+        std::find(macro.params.cbegin(), macro.params.cend(), token.text);
+    if (it == macro.params.cend()) {
+      return std::nullopt;
+    }
+    return static_cast<std::size_t>(it - macro.params.cbegin());
+  };
+  // Tokens of the body are located at the name; those of the arguments keep
+  // their own locations.
+  const auto from_body = [&](const Token& token) {
+    return Token{token.kind, token.text, name.loc, hide_set};
+  };
+  const auto from_arg = [&](const Token& token) {
+    return Token{token.kind, token.text, token.loc,
+                 Extend_(token.hide_set, name.text)};
+  };
+
+  auto result = std::vector<Token>{};
+  // Whether the left operand of the next `##` is an empty argument, in which
+  // case the right operand is taken as is.
+  auto is_lhs_empty = false;
+  const auto& body = macro.body;
+  for (auto i = std::size_t{0}; i < body.size(); ++i) {
+    const auto& token = body.at(i);
+    const auto is_pasted = i + 1 < body.size() &&
+                           body.at(i + 1).kind == TokenKind::kHashHash;
+    if (token.kind == TokenKind::kHashHash) {
+      // The operands are validated on definition.
+      const auto& rhs_token = body.at(++i);
+      auto rhs = std::vector<Token>{};
+      if (const auto index = param_index_of(rhs_token)) {
+        for (const auto& arg_token : args.at(*index)) {
+          rhs.push_back(from_arg(arg_token));
+        }
+      } else {
+        rhs.push_back(from_body(rhs_token));
+      }
+      if (!rhs.empty()) {
+        auto it = rhs.cbegin();
+        if (!is_lhs_empty) {
+          result.back() = Paste_(result.back(), *it++, name.loc);
+        }
+        result.insert(result.cend(), it, rhs.cend());
+      }
+      is_lhs_empty = is_lhs_empty && rhs.empty();
+      continue;
+    }
+    if (token.kind == TokenKind::kHash && i + 1 < body.size()) {
+      if (const auto index = param_index_of(body.at(i + 1))) {
+        result.push_back(Stringize_(args.at(*index), name.loc));
+        ++i;
+        is_lhs_empty = false;
+        continue;
+      }
+    }
+    if (const auto index = param_index_of(token)) {
+      const auto& arg = args.at(*index);
+      // An operand of `##` isn't expanded.
+      const auto expanded = is_pasted ? arg : ExpandAll_(arg);
+      for (const auto& arg_token : expanded) {
+        result.push_back(from_arg(arg_token));
+      }
+      is_lhs_empty = expanded.empty();
+      continue;
+    }
+    result.push_back(from_body(token));
+    is_lhs_empty = false;
+  }
+  return result;
+}
+
+std::vector<Preprocessor::Token> Preprocessor::ExpandAll_(
+    std::vector<Token> tokens) {
+  auto outer_pending = std::move(pending_);
+  const auto outer_is_reading_files = is_reading_files_;
+  pending_.assign(tokens.crbegin(), tokens.crend());
+  is_reading_files_ = false;
+  auto result = std::vector<Token>{};
+  while (true) {
+    const auto token = NextUnexpanded_();
+    if (token.kind == TokenKind::kEof) {
+      break;
+    }
+    if (!(IsIdentifier(token.kind) && TryExpand_(token))) {
+      result.push_back(token);
+    }
+  }
+  pending_ = std::move(outer_pending);
+  is_reading_files_ = outer_is_reading_files;
+  return result;
+}
+
+Preprocessor::Token Preprocessor::Paste_(const Token& lhs, const Token& rhs,
+                                         Location loc) {
+  const auto text = Store_(std::string{lhs.text} + std::string{rhs.text});
+  const auto tokens = LexInPlace(text);
+  // A valid token and the EOF.
+  if (tokens.size() != 2 || tokens.lengths().front() != text.size()) {
+    Error_(loc, "pasting \"" + std::string{lhs.text} + "\" and \"" +
+                    std::string{rhs.text} + "\" does not give a valid token");
+  }
+  return Token{tokens.kinds().front(), text, lhs.loc, lhs.hide_set};
+}
+
+Preprocessor::Token Preprocessor::Stringize_(const std::vector<Token>& tokens,
+                                             Location loc) {
+  auto text = std::string{"\""};
+  for (auto i = std::size_t{0}; i < tokens.size(); ++i) {
+    const auto spelling = tokens.at(i).text;
+    if (i > 0 && !IsAdjacent(tokens.at(i - 1).text, spelling)) {
+      text += ' ';
+    }
+    if (tokens.at(i).kind == TokenKind::kString) {
+      for (const auto c : spelling) {
+        if (c == '"' || c == '\\') {
+          text += '\\';
+        }
+        text += c;
+      }
+    } else {
+      text += spelling;
+    }
+  }
+  text += '"';
+  return Token{TokenKind::kString, Store_(std::move(text)), loc,
+               /* hide_set */ nullptr};
+}
+
+const Preprocessor::HideSet* Preprocessor::Extend_(const HideSet* hide_set,
+                                                   std::string_view name) {
+  auto [it, is_new] =
+      extended_hide_sets_.try_emplace(std::pair{hide_set, name}, nullptr);
+  if (is_new) {
+    auto extended = hide_set ? *hide_set : HideSet{};
+    if (const auto pos =
+            std::lower_bound(extended.cbegin(), extended.cend(), name);
+        pos == extended.cend() || *pos != name) {
+      extended.insert(pos, name);
+    }
+    it->second = &hide_sets_.emplace_back(std::move(extended));
+  }
+  return it->second;
+}
+
+std::string_view Preprocessor::Store_(std::string text) {
+  return texts_.emplace_back(std::move(text));
+}
+
+std::vector<Preprocessor::Token> Preprocessor::ReadLine_() {
+  auto& frame = frames_.back();
+  const auto& file = *frame.file;
+  auto line = std::vector<Token>{};
+  while (file.tokens.kinds().at(frame.next) != TokenKind::kEof &&
+         !file.starts_line.at(frame.next)) {
+    const auto i = frame.next++;
+    line.push_back(
+        Token{file.tokens.kinds().at(i), file.tokens.TextOf(i),
+              Location{frame.base.offset + file.tokens.offsets().at(i)},
+              /* hide_set */ nullptr});
+  }
+  return line;
+}
+
+void Preprocessor::HandleDirective_() {
+  auto line = ReadLine_();
+  if (line.empty()) {
+    // The null directive.
+    return;
+  }
+  const auto directive = line.front().text;
+  line.erase(line.cbegin());
+  auto& frame = frames_.back();
+  // The number of if-sections in the file, which are closed by the file.
+  const auto num_of_inner_conds = conds_.size() - frame.num_of_outer_conds;
+
+  // The conditional directives are handled even in skipped groups, so that the
+  // end of the groups can be found.
+  if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+    if (!IsTaking_()) {
+      conds_.push_back(Conditional{/* is_taking */ false,
+                                   /* has_taken */ true,
+                                   /* has_else */ false, directive_loc_});
+      return;
+    }
+    auto val = false;
+    if (directive == "if") {
+      SeeNonGuard_();
+      val = Evaluate_(line);
+    } else {
+      if (line.size() != 1 || !IsIdentifier(line.front().kind)) {
+        Error_(directive_loc_,
+               "expected a macro name after #" + std::string{directive});
+      }
+      const auto name = line.front().text;
+      val = (macros_.count(name) != 0) == (directive == "ifdef");
+      if (directive == "ifndef" && frame.guard_state == GuardState::kStart) {
+        frame.guard_state = GuardState::kInGuard;
+        frame.guard = name;
+      } else {
+        SeeNonGuard_();
+      }
+    }
+    conds_.push_back(Conditional{/* is_taking */ val, /* has_taken */ val,
+                                 /* has_else */ false, directive_loc_});
+    return;
+  }
+  if (directive == "elif" || directive == "else" || directive == "endif") {
+    if (num_of_inner_conds == 0) {
+      Error_(directive_loc_, "#" + std::string{directive} + " without #if");
+    }
+    // Anything but the `#endif` of the guard means the `#ifndef` isn't one.
+    if (frame.guard_state == GuardState::kInGuard && num_of_inner_conds == 1) {
+      frame.guard_state = directive == "endif" ? GuardState::kAfterGuard
+                                               : GuardState::kNoGuard;
+    }
+    if (directive == "endif") {
+      conds_.pop_back();
+      return;
+    }
+    auto& cond = conds_.back();
+    if (cond.has_else) {
+      Error_(directive_loc_, "#" + std::string{directive} + " after #else");
+    }
+    if (directive == "else") {
+      cond.has_else = true;
+      cond.is_taking = !cond.has_taken;
+    } else {
+      cond.is_taking = !cond.has_taken && Evaluate_(line);
+    }
+    cond.has_taken = cond.has_taken || cond.is_taking;
+    return;
+  }
+  if (!IsTaking_()) {
+    return;
+  }
+  SeeNonGuard_();
+
+  if (directive == "define") {
+    HandleDefine_(line);
+  } else if (directive == "undef") {
+    if (line.size() != 1 || !IsIdentifier(line.front().kind)) {
+      Error_(directive_loc_, "expected a macro name after #undef");
+    }
+    macros_.erase(line.front().text);
+    has_directives_ = true;
+  } else if (directive == "include") {
+    HandleInclude_(line);
+  } else if (directive == "pragma") {
+    // Other pragmas are ignored.
+    if (line.size() == 1 && line.front().text == "once") {
+      frame.file->is_pragma_once = true;
+    }
+  } else if (directive == "error") {
+    auto message = std::string{"#error"};
+    for (const auto& token : line) {
+      message += ' ';
+      message += token.text;
+    }
+    Error_(directive_loc_, message);
+  } else if (directive == "line") {
+    // Lines are resolved from the offsets; nothing to do.
+  } else {
+    Error_(directive_loc_,
+           "invalid preprocessing directive #" + std::string{directive});
+  }
+}
+
+void Preprocessor::HandleDefine_(const std::vector<Token>& line) {
+  if (line.empty() || !IsIdentifier(line.front().kind)) {
+    Error_(directive_loc_, "expected a macro name after #define");
+  }
+  const auto name = line.front().text;
+  auto macro = Macro{/* is_function_like */ false, {}, /* is_variadic */ false,
+                     {}};
+  auto i = std::size_t{1};
+  // The parameter list follows the name without any whitespace.
+  if (i < line.size() && line.at(i).kind == TokenKind::kLeftParen &&
+      IsAdjacent(name, line.at(i).text)) {
+    macro.is_function_like = true;
+    ++i;
+    const auto is_ellipsis = [&line](std::size_t j) {
+      return j + 2 < line.size() && line.at(j).kind == TokenKind::kDot &&
+             line.at(j + 1).kind == TokenKind::kDot &&
+             line.at(j + 2).kind == TokenKind::kDot;
+    };
+    if (i < line.size() && line.at(i).kind == TokenKind::kRightParen) {
+      ++i;
+    } else {
+      while (true) {
+        if (is_ellipsis(i)) {
+          macro.params.emplace_back("__VA_ARGS__");
+          macro.is_variadic = true;
+          i += 3;
+        } else if (i < line.size() && IsIdentifier(line.at(i).kind)) {
+          macro.params.push_back(line.at(i++).text);
+        } else {
+          Error_(directive_loc_, "expected a parameter name in macro \"" +
+                                     std::string{name} + "\"");
+        }
+        if (i < line.size() && line.at(i).kind == TokenKind::kRightParen &&
+            ++i) {
+          break;
+        }
+        if (macro.is_variadic || i >= line.size() ||
+            line.at(i).kind != TokenKind::kComma) {
+          Error_(directive_loc_,
+                 "expected ',' or ')' in the parameters of macro \"" +
+                     std::string{name} + "\"");
+        }
+        ++i;
+      }
+    }
+  }
+  macro.body.assign(line.cbegin() + static_cast<std::ptrdiff_t>(i),
+                    line.cend());
+  const auto& body = macro.body;
+  if (!body.empty() && (body.front().kind == TokenKind::kHashHash ||
+                        body.back().kind == TokenKind::kHashHash)) {
+    Error_(directive_loc_,
+           "'##' cannot appear at either end of a macro expansion");
+  }
+  if (macro.is_function_like) {
+    for (auto j = std::size_t{0}; j < body.size(); ++j) {
+      if (body.at(j).kind == TokenKind::kHash &&
+          (j + 1 == body.size() ||
+           std::find(macro.params.cbegin(), macro.params.cend(),
+                     body.at(j + 1).text) == macro.params.cend())) {
+        Error_(directive_loc_, "'#' is not followed by a macro parameter");
+      }
+    }
+  }
+  macros_.insert_or_assign(name, std::move(macro));
+  has_directives_ = true;
+}
+
+void Preprocessor::HandleInclude_(const std::vector<Token>& line) {
+  auto name = std::string_view{};
+  auto is_quoted = false;
+  if (line.size() == 1 && line.front().kind == TokenKind::kString) {
+    name = line.front().text.substr(1, line.front().text.size() - 2);
+    is_quoted = true;
+  } else if (line.size() >= 2 && line.front().kind == TokenKind::kLt &&
+             line.back().kind == TokenKind::kGt) {
+    // The name is spelled as is between the brackets.
+    const auto* begin = line.front().text.data() + 1;
+    name = std::string_view{
+        begin, static_cast<std::size_t>(line.back().text.data() - begin)};
+  } else {
+    Error_(directive_loc_, "#include expects \"FILENAME\" or <FILENAME>");
+  }
+
+  auto* file = static_cast<SourceFile*>(nullptr);
+  if (is_quoted) {
+    file = LoadSourceFile(frames_.back().file->path.parent_path() / name);
+  }
+  for (auto it = include_dirs_.cbegin(); !file && it != include_dirs_.cend();
+       ++it) {
+    file = LoadSourceFile(*it / name);
+  }
+  if (!file) {
+    Error_(directive_loc_, "cannot find include file " + std::string{name});
+  }
+  if (frames_.size() >= kMaxIncludeDepth) {
+    Error_(directive_loc_, "#include nested too deeply");
+  }
+  has_directives_ = true;
+  // Neither file is scanned again.
+  if ((file->is_pragma_once && entered_.count(file)) ||
+      (!file->guard.empty() && macros_.count(file->guard))) {
+    return;
+  }
+  EnterFile_(*file);
+}
+
+void Preprocessor::EnterFile_(SourceFile& file) {
+  entered_.insert(&file);
+  auto [it, is_new] = bases_.try_emplace(&file, Location{0});
+  if (is_new) {
+    it->second = line_map_.AddFile(
+        file.path, static_cast<std::uint32_t>(file.tokens.source().size()));
+  }
+  frames_.push_back(Frame{&file, /* next */ 0, it->second, conds_.size(),
+                          GuardState::kStart, /* guard */ {}});
+}
+
+bool Preprocessor::Evaluate_(const std::vector<Token>& line) {
+  // `defined` is resolved before the macros are expanded.
+  auto tokens = std::vector<Token>{};
+  for (auto i = std::size_t{0}; i < line.size(); ++i) {
+    if (line.at(i).text != "defined") {
+      tokens.push_back(line.at(i));
+      continue;
+    }
+    const auto has_paren = i + 1 < line.size() &&
+                           line.at(i + 1).kind == TokenKind::kLeftParen;
+    const auto name_index = has_paren ? i + 2 : i + 1;
+    if (name_index >= line.size() ||
+        !IsIdentifier(line.at(name_index).kind) ||
+        (has_paren && (name_index + 1 >= line.size() ||
+                       line.at(name_index + 1).kind !=
+                           TokenKind::kRightParen))) {
+      Error_(directive_loc_, "expected a macro name after \"defined\"");
+    }
+    const auto is_defined = macros_.count(line.at(name_index).text) != 0;
+    tokens.push_back(Token{TokenKind::kNum, is_defined ? "1" : "0",
+                           line.at(i).loc, /* hide_set */ nullptr});
+    i = has_paren ? name_index + 1 : name_index;
+  }
+
+  auto expr = std::vector<PpToken>{};
+  for (const auto& token : ExpandAll_(std::move(tokens))) {
+    expr.push_back(PpToken{token.kind, token.text, token.loc});
+  }
+  try {
+    return ConditionEvaluator{std::move(expr)}.Evaluate() != 0;
+  } catch (const std::runtime_error& e) {
+    Error_(directive_loc_, e.what());
+  }
+}
+
+void Preprocessor::SeeNonGuard_() {
+  auto& frame = frames_.back();
+  if (frame.guard_state == GuardState::kStart ||
+      frame.guard_state == GuardState::kAfterGuard) {
+    frame.guard_state = GuardState::kNoGuard;
+  }
+}
+
+void Preprocessor::Error_(Location loc, const std::string& message) const {
+  std::cerr << line_map_.Describe(loc) << ": " << message << std::endl;
+  std::exit(0);
+}
@@ -0,0 +1,260 @@
+#include "profile.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+#include "operator.hpp"
+#include "static_visitor.hpp"
+
+namespace {
+
+/// @brief Numbers the sites of a function in preorder.
+class SiteNumberer : public StaticVisitor<SiteNumberer> {
+ public:
+  using StaticVisitor::Visit;
+
+  SiteNumberer(std::unordered_map<const AstNode*, std::size_t>& sites,
+               std::size_t& size)
+      : sites_{sites}, size_{size} {}
+
+  void Visit(const DeclStmtNode& decl_stmt) {
+    for (const auto& decl : decl_stmt.decls) {
+      Dispatch(*decl);
+    }
+  }
+
+  void Visit(const VarDeclNode& decl) {
+    if (decl.init) {
+      Dispatch(*decl.init);
+    }
+  }
+
+  void Visit(const ArrDeclNode& arr_decl) {
+    for (const auto& init : arr_decl.init_list) {
+      Dispatch(*init);
+    }
+  }
+
+  void Visit(const RecordVarDeclNode& record_var_decl) {
+    for (const auto& init : record_var_decl.inits) {
+      Dispatch(*init);
+    }
+  }
+
+  void Visit(const LoopInitNode& loop_init) {
+    std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
+  }
+
+  void Visit(const CompoundStmtNode& compound_stmt) {
+    VisitBlocks_(
+        compound_stmt, [](const CompoundStmtNode&) {},
+        [](const CompoundStmtNode&) {});
+  }
+
+  void Visit(const IfStmtNode& if_stmt) {
+    // The `then` arm is counted at the next site.
+    AddSites_(if_stmt, 2);
+    Dispatch(*if_stmt.predicate);
+    Dispatch(*if_stmt.then);
+    if (if_stmt.or_else) {
+      Dispatch(*if_stmt.or_else);
+    }
+  }
+
+  void Visit(const WhileStmtNode& while_stmt) {
+    AddSites_(while_stmt, 1);
+    Dispatch(*while_stmt.predicate);
+    Dispatch(*while_stmt.loop_body);
+  }
+
+  void Visit(const ForStmtNode& for_stmt) {
+    AddSites_(for_stmt, 1);
+    Dispatch(*for_stmt.loop_init);
+    Dispatch(*for_stmt.predicate);
+    Dispatch(*for_stmt.step);
+    Dispatch(*for_stmt.loop_body);
+  }
+
+  void Visit(const ReturnStmtNode& ret_stmt) {
+    Dispatch(*ret_stmt.expr);
+  }
+
+  void Visit(const SwitchStmtNode& switch_stmt) {
+    Dispatch(*switch_stmt.ctrl);
+    Dispatch(*switch_stmt.stmt);
+  }
+
+  void Visit(const LabeledStmtNode& labeled_stmt) {
+    Dispatch(*labeled_stmt.stmt);
+  }
+
+  void Visit(const CaseStmtNode& case_stmt) {
+    AddSites_(case_stmt, 1);
+    Dispatch(*case_stmt.expr);
+    Dispatch(*case_stmt.stmt);
+  }
+
+  void Visit(const DefaultStmtNode& default_stmt) {
+    AddSites_(default_stmt, 1);
+    Dispatch(*default_stmt.stmt);
+  }
+
+  void Visit(const ExprStmtNode& expr_stmt) {
+    Dispatch(*expr_stmt.expr);
+  }
+
+  void Visit(const InitExprNode& init_expr) {
+    for (const auto& des : init_expr.des) {
+      Dispatch(*des);
+    }
+    Dispatch(*init_expr.expr);
+  }
+
+  void Visit(const ArrDesNode& arr_des) {
+    Dispatch(*arr_des.index);
+  }
+
+  void Visit(const ArgExprNode& arg_expr) {
+    Dispatch(*arg_expr.arg);
+  }
+
+  void Visit(const ArrSubExprNode& arr_sub_expr) {
+    Dispatch(*arr_sub_expr.arr);
+    Dispatch(*arr_sub_expr.index);
+  }
+
+  void Visit(const CondExprNode& cond_expr) {
+    // The second operand is counted at the next site.
+    AddSites_(cond_expr, 2);
+    Dispatch(*cond_expr.predicate);
+    Dispatch(*cond_expr.then);
+    Dispatch(*cond_expr.or_else);
+  }
+
+  void Visit(const FuncCallExprNode& call_expr) {
+    Dispatch(*call_expr.func_expr);
+    for (const auto& arg : call_expr.args) {
+      Dispatch(*arg);
+    }
+  }
+
+  void Visit(const PostfixArithExprNode& postfix_expr) {
+    Dispatch(*postfix_expr.operand);
+  }
+
+  void Visit(const RecordMemExprNode& mem_expr) {
+    Dispatch(*mem_expr.expr);
+  }
+
+  void Visit(const UnaryExprNode& unary_expr) {
+    Dispatch(*unary_expr.operand);
+  }
+
+  void Visit(const BinaryExprNode& bin_expr) {
+    // The operators of a chain are numbered from the outermost one, as they
+    // would be by recursion.
+    VisitLeftChain_(
+        bin_expr,
+        [this](const BinaryExprNode& expr) {
+          // The right operand is counted at the next site.
+          if (expr.op == BinaryOperator::kLand ||
+              expr.op == BinaryOperator::kLor) {
+            AddSites_(expr, 2);
+          }
+        },
+        [this](const BinaryExprNode& expr) { Dispatch(*expr.rhs); });
+  }
+
+  void Visit(const SimpleAssignmentExprNode& assign_expr) {
+    Dispatch(*assign_expr.lhs);
+    Dispatch(*assign_expr.rhs);
+  }
+
+ private:
+  std::unordered_map<const AstNode*, std::size_t>& sites_;
+  std::size_t& size_;
+
+  void AddSites_(const AstNode& node, std::size_t num_of_sites) {
+    sites_.emplace(&node, size_);
+    size_ += num_of_sites;
+  }
+};
+
+}  // namespace
+
+ProfileSites::ProfileSites(const FuncDefNode& func_def) {
+  if (func_def.body) {
+    SiteNumberer{sites_, size_}.Dispatch(*func_def.body);
+  }
+}
+
+Profile Profile::Read(const std::filesystem::path& path) {
+  auto input = std::ifstream{path};
+  if (!input) {
+    throw std::runtime_error{
+        fmt::format("cannot read profile '{}'", path.string())};
+  }
+  auto profile = Profile{};
+  auto line = std::string{};
+  while (std::getline(input, line)) {
+    auto fields = std::istringstream{line};
+    auto func = std::string{};
+    if (!(fields >> func)) {
+      continue;
+    }
+    auto counts = std::vector<std::uint64_t>{};
+    auto count = std::uint64_t{0};
+    while (fields >> count) {
+      counts.push_back(count);
+    }
+    if (counts.empty() || !fields.eof()) {
+      throw std::runtime_error{
+          fmt::format("malformed profile '{}'", path.string())};
+    }
+    profile.counts_.insert_or_assign(std::move(func), std::move(counts));
+  }
+  return profile;
+}
+
+const std::vector<std::uint64_t>* Profile::CountsOf(
+    const std::string& func, const ProfileSites& sites) const {
+  const auto it = counts_.find(func);
+  return it != counts_.end() && it->second.size() == sites.size()
+             ? &it->second
+             : nullptr;
+}
+
+std::optional<std::uint64_t> Profile::EntryCountOf(
+    const std::string& func) const {
+  const auto it = counts_.find(func);
+  if (it == counts_.end()) {
+    return std::nullopt;
+  }
+  return it->second.at(ProfileSites::kEntry);
+}
+
+void PlaceColdFuncsLast(TransUnitNode& trans_unit, const Profile& profile) {
+  std::stable_partition(
+      trans_unit.extern_decls.begin(), trans_unit.extern_decls.end(),
+      [&profile](const auto& extern_decl) {
+        const auto* func_def =
+            std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl);
+        return !func_def || !(*func_def)->body ||
+               profile.EntryCountOf((*func_def)->id) != 0;
+      });
+}
@@ -0,0 +1,143 @@
+#include "qbe/ir_stats.hpp"
+
+#include <fmt/core.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace qbe {
+
+namespace {
+
+bool StartsWith(std::string_view str, std::string_view prefix) {
+  return str.substr(0, prefix.size()) == prefix;
+}
+
+/// @return The operation of the instruction `instr`, e.g., "loadw" of
+/// "%.2 =w loadw %.1".
+std::string_view OpOf(std::string_view instr) {
+  // The instructions that define a temporary are of the form
+  // "%temp =type op operands".
+  if (StartsWith(instr, "%")) {
+    const auto type_pos = instr.find(" =");
+    if (type_pos == std::string_view::npos) {
+      return {};
+    }
+    const auto op_pos = instr.find(' ', type_pos + 2);
+    if (op_pos == std::string_view::npos) {
+      return {};
+    }
+    instr.remove_prefix(op_pos + 1);
+  }
+  return instr.substr(0, instr.find(' '));
+}
+
+void Count(FuncStats& stats, std::string_view instr) {
+  ++stats.num_of_instrs;
+  const auto op = OpOf(instr);
+  if (StartsWith(op, "alloc")) {
+    ++stats.num_of_allocs;
+    const auto size = instr.substr(instr.rfind(' ') + 1);
+    stats.stack_bytes += std::stoull(std::string{size});
+  } else if (StartsWith(op, "load")) {
+    ++stats.num_of_loads;
+  } else if (StartsWith(op, "store")) {
+    ++stats.num_of_stores;
+  } else if (op == "call") {
+    ++stats.num_of_calls;
+  } else if (op == "jmp" || op == "jnz") {
+    ++stats.num_of_branches;
+  }
+}
+
+}  // namespace
+
+FuncStats& FuncStats::operator+=(const FuncStats& other) {
+  num_of_instrs += other.num_of_instrs;
+  num_of_allocs += other.num_of_allocs;
+  stack_bytes += other.stack_bytes;
+  num_of_loads += other.num_of_loads;
+  num_of_stores += other.num_of_stores;
+  num_of_calls += other.num_of_calls;
+  num_of_blocks += other.num_of_blocks;
+  num_of_branches += other.num_of_branches;
+  return *this;
+}
+
+void IrStats::Collect(std::istream& ir) {
+  // The function whose body is being read.
+  auto func = std::optional<FuncStats>{};
+  auto line = std::string{};
+  while (std::getline(ir, line)) {
+    const auto text = std::string_view{line};
+    if (!func) {
+      // e.g., "function w $main() {", after an "export" line.
+      if (StartsWith(text, "function ")) {
+        const auto name_pos = text.find('$') + 1;
+        func = FuncStats{
+            std::string{text.substr(name_pos, text.find('(') - name_pos)}};
+      }
+      continue;
+    }
+    if (text == "}") {
+      funcs_.push_back(std::move(*func));
+      func.reset();
+    } else if (StartsWith(text, "@")) {
+      ++func->num_of_blocks;
+    } else if (StartsWith(text, "\t")) {
+      Count(*func, text.substr(1));
+    }
+  }
+}
+
+FuncStats IrStats::Total_() const {
+  auto total = FuncStats{"(total)"};
+  for (const auto& func : funcs_) {
+    total += func;
+  }
+  return total;
+}
+
+void IrStats::WriteTable(std::ostream& output) const {
+  output << fmt::format("codegen stats of {}:\n", file_);
+  output << fmt::format(
+      "  {:<24} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8}\n",
+      "function", "instrs", "allocs", "stack", "loads", "stores", "calls",
+      "blocks", "branches");
+  const auto write_row = [&output](const FuncStats& func) {
+    output << fmt::format(
+        "  {:<24} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8}\n",
+        func.name, func.num_of_instrs, func.num_of_allocs, func.stack_bytes,
+        func.num_of_loads, func.num_of_stores, func.num_of_calls,
+        func.num_of_blocks, func.num_of_branches);
+  };
+  for (const auto& func : funcs_) {
+    write_row(func);
+  }
+  write_row(Total_());
+}
+
+void IrStats::WriteJson(std::ostream& output) const {
+  const auto to_json = [](const FuncStats& func) {
+    return fmt::format(
+        "{{\"name\": \"{}\", \"instrs\": {}, \"allocs\": {}, "
+        "\"stack_bytes\": {}, \"loads\": {}, \"stores\": {}, \"calls\": {}, "
+        "\"blocks\": {}, \"branches\": {}}}",
+        func.name, func.num_of_instrs, func.num_of_allocs, func.stack_bytes,
+        func.num_of_loads, func.num_of_stores, func.num_of_calls,
+        func.num_of_blocks, func.num_of_branches);
+  };
+  output << fmt::format("{{\"file\": \"{}\", \"functions\": [", file_);
+  for (auto i = std::size_t{0}; i < funcs_.size(); ++i) {
+    output << fmt::format("{}\n  {}", i == 0 ? "" : ",",
+                          to_json(funcs_.at(i)));
+  }
+  output << fmt::format("\n], \"total\": {}}}\n", to_json(Total_()));
+}
+
+}  // namespace qbe
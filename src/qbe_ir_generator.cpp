@@ -1,13 +1,20 @@
 #include "qbe_ir_generator.hpp"
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <future>
+#include <ios>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -15,9 +22,14 @@
 #include <vector>
 
 #include "ast.hpp"
+#include "casting.hpp"
+#include "incremental_store.hpp"
 #include "operator.hpp"
+#include "profile.hpp"
 #include "qbe/sigil.hpp"
+#include "thread_pool.hpp"
 #include "type.hpp"
+#include "visit_profiler.hpp"
 
 // Since compiler-generated sigils are used more frequently, we include them
 // directly.
@@ -26,20 +38,64 @@ namespace user_defined = qbe::user_defined;
 
 namespace {
 
-/// @brief Returns the next local number and increment it by 1. The first number
-/// will be 1.
-int NextLocalNum() {
-  /// @brief temporary index under a scope
-  static int next_local_num = 1;
-  return next_local_num++;
+/// @return The QBE base type of the temporaries that hold the values of
+/// `type`. The value of an aggregate, such as a record, is its address.
+std::string_view BaseTypeOf(const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  return !prim_type || prim_type->size() == 8 ? "l" : "w";
+}
+
+/// @return Whether the value of `type` is the address of its object, which is
+/// never loaded as a whole.
+bool IsAggregate(const Type& type) {
+  return Isa<RecordType>(type) || type.IsArr();
 }
 
-int NextLabelNum() {
-  static int next_label_num = 1;
-  return next_label_num++;
+/// @return The instruction that loads an object of `type`; the integers
+/// narrower than a word are extended to a word by their signedness.
+std::string_view LoadOpOf(const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  if (!prim_type) {
+    return "loadl";
+  }
+  switch (prim_type->size()) {
+    case 1:
+      return prim_type->IsUnsigned() ? "loadub" : "loadsb";
+    case 2:
+      return prim_type->IsUnsigned() ? "loaduh" : "loadsh";
+    case 8:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return "loadl";
+    default:
+      return "loadw";
+  }
+}
+
+/// @return The instruction that stores an object of `type`.
+std::string_view StoreOpOf(const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  if (!prim_type) {
+    return "storel";
+  }
+  switch (prim_type->size()) {
+    case 1:
+      return "storeb";
+    case 2:
+      return "storeh";
+    case 8:  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+      return "storel";
+    default:
+      return "storew";
+  }
 }
 
-std::string GetBinaryOperator(BinaryOperator op) {
+/// @param type The type of the operands, which are converted to the same type
+/// beforehand.
+std::string GetBinaryOperator(BinaryOperator op, const Type& type) {
+  const auto base_type = BaseTypeOf(type);
+  const auto* prim_type = DynCast<PrimType>(&type);
+  // Pointers are compared as unsigned integers.
+  const auto is_unsigned = !prim_type || prim_type->IsUnsigned();
+  const auto* sign = is_unsigned ? "u" : "s";
   switch (op) {
     case BinaryOperator::kAdd:
       return "add";
@@ -48,22 +104,21 @@ std::string GetBinaryOperator(BinaryOperator op) {
     case BinaryOperator::kMul:
       return "mul";
     case BinaryOperator::kDiv:
-      return "div";
+      return is_unsigned ? "udiv" : "div";
     case BinaryOperator::kMod:
-      return "rem";
-    // TODO: update comparison instructions with no data type, such as "gt".
+      return is_unsigned ? "urem" : "rem";
     case BinaryOperator::kGt:
-      return "csgtw";
+      return fmt::format("c{}gt{}", sign, base_type);
     case BinaryOperator::kGte:
-      return "csgew";
+      return fmt::format("c{}ge{}", sign, base_type);
     case BinaryOperator::kLt:
-      return "csltw";
+      return fmt::format("c{}lt{}", sign, base_type);
     case BinaryOperator::kLte:
-      return "cslew";
+      return fmt::format("c{}le{}", sign, base_type);
     case BinaryOperator::kEq:
-      return "ceqw";
+      return fmt::format("ceq{}", base_type);
     case BinaryOperator::kNeq:
-      return "cnew";
+      return fmt::format("cne{}", base_type);
     case BinaryOperator::kAnd:
       return "and";
     case BinaryOperator::kXor:
@@ -74,25 +129,36 @@ std::string GetBinaryOperator(BinaryOperator op) {
       return "shl";
     // NOTE: Arithmetic shift right (sar) is akin to dividing by a power of two
     // for non-negative numbers. For negatives, it's implementation-defined, so
-    // we opt for arithmetic shifting.
+    // we opt for arithmetic shifting. Unsigned integers are shifted logically.
     case BinaryOperator::kShr:
-      return "sar";
+      return is_unsigned ? "shr" : "sar";
     default:
       return "Unknown";
   }
 }
 
-auto id_to_num  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables):
-                // Accessible only within this translation unit; declaring as a
-                // data member introduces unnecessary dependency.
-    = std::map<std::string, int>{};
-
-auto
-    reg_num_to_id_num  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables):
-                       // Accessible only within this translation unit;
-                       // declaring as a data member introduces unnecessary
-                       // dependency.
-    = std::map<int, int>{};
+/// @brief The type of the integers narrower than `int` after the integer
+/// promotions.
+const auto
+    kPromotedType  // NOLINT(cert-err58-cpp): PrimType doesn't throw.
+    = PrimType{PrimitiveType::kInt};
+
+/// @return The type that the operands of `bin_expr` are converted to before
+/// the operation.
+std::unique_ptr<Type> OperandTypeOf(const BinaryExprNode& bin_expr) {
+  const auto* lhs_prim = DynCast<PrimType>(bin_expr.lhs->type.get());
+  const auto* rhs_prim = DynCast<PrimType>(bin_expr.rhs->type.get());
+  if (!lhs_prim || !rhs_prim || !lhs_prim->IsInteger() ||
+      !rhs_prim->IsInteger()) {
+    return bin_expr.lhs->type->Clone();
+  }
+  if (bin_expr.op == BinaryOperator::kShl ||
+      bin_expr.op == BinaryOperator::kShr) {
+    return std::make_unique<PrimType>(Promote(lhs_prim->prim_type()));
+  }
+  return std::make_unique<PrimType>(
+      CommonTypeOf(lhs_prim->prim_type(), rhs_prim->prim_type()));
+}
 
 /// @brief Every expression generates a temporary. The local number of such
 /// temporary should be stored, so can propagate to later uses.
@@ -116,93 +182,489 @@ class PrevExprNumRecorder {
   int num_of_prev_expr_ = kNoRecord;
 };
 
-auto
-    num_recorder  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables):
-                  // Accessible only within this translation unit; declaring as
-                  // a data member introduces unnecessary dependency.
-    = PrevExprNumRecorder{};
+/// @brief Numbers the values computed within a single basic block, so that
+/// pure computations and loads can reuse an earlier result instead of being
+/// recomputed.
+/// @note The table only holds facts about the current block; it has to be
+/// cleared whenever a new block begins.
+class LocalValueTable {
+ public:
+  /// @brief The width of a value in memory, which is part of a memory fact.
+  using Width = std::string_view;
+
+  /// @return The temporary that `num` is known to be a copy of; `num` itself
+  /// if no such temporary exists.
+  int Canonical(int num) const {
+    if (auto it = canonical_nums_.find(num); it != canonical_nums_.end()) {
+      return it->second;
+    }
+    return num;
+  }
+
+  /// @brief Records that `num` holds the same value as `origin`.
+  void RecordCopy(int num, int origin) {
+    canonical_nums_[num] = Canonical(origin);
+  }
+
+  /// @param key An expression whose operands are canonical temporaries.
+  /// @return The temporary that already holds the value of `key`.
+  std::optional<int> LookUpExpr(const std::string& key) const {
+    if (auto it = exprs_.find(key); it != exprs_.end()) {
+      return it->second;
+    }
+    return std::nullopt;
+  }
+
+  void RecordExpr(std::string key, int num) {
+    exprs_.emplace(std::move(key), num);
+  }
+
+  /// @brief Marks `num` as the base address of a stack slot, which never
+  /// overlaps with any other slot.
+  void RecordSlot(int num) {
+    roots_[num] = num;
+  }
+
+  /// @brief Marks `num` as an address derived from `base`, e.g., the address
+  /// of an array element.
+  void RecordDerivedAddr(int num, int base) {
+    if (auto root = RootOf(base)) {
+      roots_[Canonical(num)] = *root;
+    }
+  }
+
+  /// @return The temporary that holds the value last loaded from or stored to
+  /// `addr_num`, as long as it has the same `width`.
+  std::optional<int> LookUpMem(int addr_num, Width width) const {
+    if (auto it = mems_.find(Canonical(addr_num));
+        it != mems_.end() && it->second.width == width) {
+      return it->second.num;
+    }
+    return std::nullopt;
+  }
+
+  /// @brief Records that `num` is the value loaded from `addr_num`.
+  void RecordLoad(int addr_num, int num, Width width) {
+    mems_[Canonical(addr_num)] = MemFact{num, width, RootOf(addr_num)};
+  }
+
+  /// @brief Invalidates every memory fact that the store may alias, then
+  /// records the stored value if it is held by a temporary.
+  void RecordStore(int addr_num, std::optional<int> num, Width width) {
+    const auto root = RootOf(addr_num);
+    if (!root) {
+      // A store through an unknown pointer may write to any object.
+      mems_.clear();
+    } else {
+      for (auto it = mems_.begin(); it != mems_.end();) {
+        if (!it->second.root || it->second.root == root) {
+          it = mems_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    if (num) {
+      mems_[Canonical(addr_num)] = MemFact{*num, width, root};
+    }
+  }
+
+  /// @brief Invalidates every memory fact, e.g., after calling a function that
+  /// may write through any pointer it can reach.
+  void ClobberMem() {
+    mems_.clear();
+  }
+
+  /// @brief Forgets everything; called when a new block begins.
+  void Clear() {
+    canonical_nums_.clear();
+    roots_.clear();
+    exprs_.clear();
+    mems_.clear();
+  }
+
+ private:
+  struct MemFact {
+    int num;
+    Width width;
+    /// @brief The slot the address points into, if known.
+    std::optional<int> root;
+  };
+
+  std::map<int, int> canonical_nums_{};
+  std::map<int, int> roots_{};
+  std::map<std::string, int> exprs_{};
+  std::map<int, MemFact> mems_{};
+
+  std::optional<int> RootOf(int num) const {
+    if (auto it = roots_.find(Canonical(num)); it != roots_.end()) {
+      return it->second;
+    }
+    return std::nullopt;
+  }
+};
+
+/// @return The memory width of a load or store instruction, e.g., "w" for
+/// `loadw` and `storew`. The loads of the narrower integers also tell their
+/// extension, e.g., "sb" for `loadsb`, which a store never forwards to.
+/// @note `mem_op` must be a string literal, which the width refers to.
+LocalValueTable::Width WidthOf(std::string_view mem_op) {
+  constexpr auto kLoad = std::string_view{"load"};
+  constexpr auto kStore = std::string_view{"store"};
+  const auto is_load = mem_op.substr(0, kLoad.size()) == kLoad;
+  return mem_op.substr(is_load ? kLoad.size() : kStore.size());
+}
+
+/// @return The function of the runtime library that the builtin `id` is
+/// lowered to; empty if `id` isn't a builtin.
+/// @note The runtime library is linked by the driver; see runtime/runtime.h.
+std::string_view RuntimeFuncOf(std::string_view id) {
+  if (id == "__builtin_print") {
+    return "__vitaminc_print_int";
+  }
+  if (id == "__builtin_flush") {
+    return "__vitaminc_flush";
+  }
+  return {};
+}
+
+/// @return The aggregate type of `record_type`, which is named after its tag.
+user_defined::AggregateType AggregateTypeOf(const RecordType& record_type) {
+  return user_defined::AggregateType{fmt::format(
+      "{}_{}", record_type.IsStruct() ? "struct" : "union", record_type.id())};
+}
+
+/// @return The type of a value of `type` that is passed to a function. Records
+/// are passed by value as their aggregate types.
+std::string AbiTypeOf(const Type& type) {
+  if (const auto* record_type = DynCast<RecordType>(&type)) {
+    return fmt::format("{}", AggregateTypeOf(*record_type));
+  }
+  return std::string{BaseTypeOf(type)};
+}
+
+/// @return The instruction that allocates a stack slot for an object of
+/// `type`; QBE aligns the slots to 4, 8 or 16 bytes.
+std::string AllocOf(const Type& type) {
+  return fmt::format("alloc{}", std::max(type.alignment(), std::size_t{4}));
+}
+
+/// @return The QBE type of the integers of `size` bytes.
+char UnitOf(std::size_t size) {
+  switch (size) {
+    case 1:
+      return 'b';
+    case 2:
+      return 'h';
+    case 4:
+      return 'w';
+    default:
+      return 'l';
+  }
+}
+
+// The globals of the instrumentation are prefixed as the runtime library is,
+// so that they don't collide with those of the program.
+constexpr auto kProfileFuncsName = std::string_view{"__vitaminc_profile_funcs"};
+constexpr auto kProfilePathName = std::string_view{"__vitaminc_profile_path"};
+
+/// @return The counters of the sites of `func`, 8 bytes each.
+user_defined::GlobalPointer CountersOf(std::string_view func) {
+  return user_defined::GlobalPointer{
+      fmt::format("__vitaminc_profile_counters.{}", func)};
+}
 
 struct LabelViewPair {
   BlockLabel entry;
   BlockLabel exit;
+  /// @brief Whether the block is a loop rather than a `switch`.
+  bool is_loop = false;
+};
+
+struct CaseInfo {
+  /// @note This is a non-owning pointer that points to the expression of the
+  /// case.
+  const ExprNode* expr = nullptr;
+  BlockLabel label;
+  /// @note This is a non-owning pointer that points to the case itself, which
+  /// is a profile site.
+  const CaseStmtNode* case_stmt = nullptr;
+};
+
+struct SwitchInfo {
+  std::vector<CaseInfo> case_infos{};
+  std::optional<BlockLabel> default_label;
+  /// @note This is a non-owning pointer.
+  const DefaultStmtNode* default_stmt = nullptr;
+  BlockLabel exit_label;
+
+  explicit SwitchInfo(BlockLabel exit_label,
+                      std::optional<BlockLabel> default_label = std::nullopt)
+      : default_label{std::move(default_label)},
+        exit_label{std::move(exit_label)} {}
 };
 
-/// @note Blocks that allows jumping within or out of it should add its labels
-/// to this list.
-auto
-    label_views_of_jumpable_blocks  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-    = std::vector<LabelViewPair>{};
+/// @return The statement that `stmt` ends with, looking into the compound
+/// statements.
+const StmtNode& LastStmtOf(const StmtNode& stmt) {
+  const auto* last = &stmt;
+  while (const auto* compound_stmt = DynCast<CompoundStmtNode>(last)) {
+    if (compound_stmt->stmts.empty()) {
+      break;
+    }
+    last = compound_stmt->stmts.back().get();
+  }
+  return *last;
+}
+
+/// @return Whether `predicate` holds when a pointer is null, or doesn't hold
+/// when it's null; `std::nullopt` if it doesn't test a pointer against null.
+std::optional<bool> IsNullTest(const ExprNode& predicate) {
+  if (predicate.type->IsPtr()) {
+    return false;
+  }
+  if (const auto* unary_expr = DynCast<UnaryExprNode>(&predicate);
+      unary_expr && unary_expr->op == UnaryOperator::kNot &&
+      unary_expr->operand->type->IsPtr()) {
+    return true;
+  }
+  if (const auto* bin_expr = DynCast<BinaryExprNode>(&predicate);
+      bin_expr && (bin_expr->op == BinaryOperator::kEq ||
+                   bin_expr->op == BinaryOperator::kNeq)) {
+    const auto is_null = [](const ExprNode& expr) {
+      const auto* int_expr = DynCast<IntConstExprNode>(&expr);
+      return int_expr && int_expr->val == 0;
+    };
+    if ((bin_expr->lhs->type->IsPtr() && is_null(*bin_expr->rhs)) ||
+        (bin_expr->rhs->type->IsPtr() && is_null(*bin_expr->lhs))) {
+      return bin_expr->op == BinaryOperator::kEq;
+    }
+  }
+  return std::nullopt;
+}
+
+/// @brief Predicts statically whether an arm of an `if` statement rarely runs,
+/// as is the case if:
+/// - it leaves the enclosing loop with a `return` or a `break`, since a loop
+/// more often iterates than exits;
+/// - it returns a negative constant, as an error does;
+/// - it runs when a pointer is null.
+/// @param runs_if_null Whether the arm runs when the pointer that the predicate
+/// tests is null.
+/// @param label_views The blocks that enclose the `if` statement.
+bool IsRarelyRun(const StmtNode& arm, bool runs_if_null,
+                 const std::vector<LabelViewPair>& label_views) {
+  if (runs_if_null) {
+    return true;
+  }
+  const auto& last = LastStmtOf(arm);
+  if (Isa<BreakStmtNode>(last)) {
+    return !label_views.empty() && label_views.back().is_loop;
+  }
+  const auto* ret_stmt = DynCast<ReturnStmtNode>(&last);
+  if (!ret_stmt) {
+    return false;
+  }
+  const auto is_in_loop =
+      std::any_of(label_views.cbegin(), label_views.cend(),
+                  [](const auto& label_view) { return label_view.is_loop; });
+  if (is_in_loop) {
+    return true;
+  }
+  if (const auto* unary_expr = DynCast<UnaryExprNode>(ret_stmt->expr.get());
+      unary_expr && unary_expr->op == UnaryOperator::kNeg) {
+    const auto* int_expr = DynCast<IntConstExprNode>(unary_expr->operand.get());
+    return int_expr && int_expr->val > 0;
+  }
+  return false;
+}
+
+/// @brief Where the two arms of a branch are placed.
+struct ArmLayout {
+  /// @brief The first arm is moved after the other blocks of the function.
+  bool is_first_cold = false;
+  /// @brief The second arm is moved after the other blocks of the function.
+  bool is_second_cold = false;
+  /// @brief The second arm is placed before the first.
+  bool is_second_first = false;
+};
+
+/// @brief Lays out the arms of the branch at `site` by the `counts` of the
+/// profile: an arm that never runs while the branch does is moved out of line,
+/// and the arm that runs more is placed first.
+/// @param site The site of the branch, whose first arm is counted at the next
+/// site.
+ArmLayout ArmLayoutByProfile(const std::vector<std::uint64_t>& counts,
+                             std::size_t site, bool has_second_arm) {
+  const auto count = counts.at(site);
+  const auto first_count = counts.at(site + 1);
+  const auto second_count = count > first_count ? count - first_count : 0;
+  return ArmLayout{
+      .is_first_cold = count != 0 && first_count == 0,
+      .is_second_cold = has_second_arm && count != 0 && second_count == 0,
+      .is_second_first = has_second_arm && second_count > first_count};
+}
 
 }  // namespace
 
+/// @brief The states that live through the generation of a single top-level
+/// declaration. Each declaration is generated with a context of its own, so
+/// that its output depends neither on the declarations generated before it nor
+/// on the thread that generates it.
+struct QbeIrGenerator::FuncContext {
+  /// @param file_scope_id_to_num The numbers of the file-scope declarations,
+  /// which are seen by the declaration.
+  explicit FuncContext(std::map<std::string, int> file_scope_id_to_num)
+      : id_to_num{std::move(file_scope_id_to_num)} {}
+
+  /// @brief temporary index under a scope
+  int next_local_num = 1;
+  int next_label_num = 1;
+  std::map<std::string, int> id_to_num;
+  std::map<int, int> reg_num_to_id_num{};
+  PrevExprNumRecorder num_recorder{};
+  LocalValueTable value_table{};
+  /// @brief The return type of the function that is being generated.
+  const Type* return_type_of_func = nullptr;
+  /// @brief The name of the function that is being generated.
+  std::string func_id{};
+  /// @brief The sites of the function; only numbered if the function is
+  /// instrumented or laid out by a profile.
+  std::optional<ProfileSites> profile_sites{};
+  /// @brief The counts of `profile_sites`; `nullptr` if the function isn't laid
+  /// out by a profile.
+  const std::vector<std::uint64_t>* profile_counts = nullptr;
+  /// @brief The temporaries that hold the results of the calls hoisted out of
+  /// the loops, which are evaluated before the loops.
+  std::map<const FuncCallExprNode*, int> hoisted_calls{};
+  /// @brief The blocks that are written after the other blocks of the
+  /// function.
+  std::string cold_blocks{};
+  bool is_writing_cold_blocks = false;
+  /// @note Blocks that allows jumping within or out of it should add its labels
+  /// to this list.
+  std::vector<LabelViewPair> label_views_of_jumpable_blocks{};
+  /// @brief The shared states passed around during the generation of a switch.
+  /// @note To allow nested switch statements, the information is stacked.
+  std::vector<std::shared_ptr<SwitchInfo>> switch_infos{};
+
+  /// @brief Returns the next local number and increment it by 1. The first
+  /// number will be 1.
+  int NextLocalNum() {
+    return next_local_num++;
+  }
+
+  int NextLabelNum() {
+    return next_label_num++;
+  }
+
+  /// @return The canonical temporary of `num`; used to format operands so that
+  /// equivalent computations are spelled the same.
+  FuncScopeTemp ValueOf(int num) const {
+    return FuncScopeTemp{value_table.Canonical(num)};
+  }
+
+  /// @brief The label of the next condition depends on whether we've already
+  /// handled the last one and whether there is a default label.
+  BlockLabel NextCondLabel(bool is_last_cond,
+                           const std::optional<BlockLabel>& default_label) {
+    if (is_last_cond && default_label) {
+      return *default_label;
+    }
+    if (is_last_cond) {
+      return switch_infos.back()->exit_label;
+    }
+    return {"switch_cond", NextLabelNum()};
+  }
+};
+
+QbeIrGenerator::QbeIrGenerator(std::ostream& output, ThreadPool* thread_pool,
+                               IncrementalStore* store)
+    : output_{output}, thread_pool_{thread_pool}, store_{store} {}
+
+QbeIrGenerator::~QbeIrGenerator() = default;
+
 void QbeIrGenerator::Visit(const DeclStmtNode& decl_stmt) {
   // TODO: code generation for global variables, VarDeclNode, ArrDeclNode,
   // RecordVarDeclNode
   for (const auto& decl : decl_stmt.decls) {
-    decl->Accept(*this);
+    Dispatch(*decl);
   }
 }
 
 void QbeIrGenerator::Visit(const VarDeclNode& decl) {
-  int id_num = NextLocalNum();
-  WriteInstr_("{} =l alloc{} {}", FuncScopeTemp{id_num}, decl.type->size(),
+  int id_num = ctx_->NextLocalNum();
+  WriteInstr_("{} =l {} {}", FuncScopeTemp{id_num}, AllocOf(*decl.type),
               decl.type->size());
-  if (decl.init) {
-    decl.init->Accept(*this);
-    int init_num = num_recorder.NumOfPrevExpr();
+  ctx_->value_table.RecordSlot(id_num);
+  if (decl.init && Isa<RecordType>(*decl.type)) {
+    // Initialized from another record, which is copied as a whole.
+    Dispatch(*decl.init);
+    WriteBlit_(ctx_->num_recorder.NumOfPrevExpr(), id_num, decl.type->size());
+  } else if (decl.init) {
+    Dispatch(*decl.init);
+    int init_num = ctx_->num_recorder.NumOfPrevExpr();
     // A pointer declaration may have two options for its right hand side:
     if (decl.init->type->IsPtr() || decl.init->type->IsFunc()) {
       // 1. int* a = &b; rhs is a reference of integer. We need to store b's
       // address to a, where we need to map b's reg_num back to its id_num.
-      if (dynamic_cast<UnaryExprNode*>((decl.init).get())) {
-        WriteInstr_("storel {}, {}",
-                    FuncScopeTemp{reg_num_to_id_num.at(init_num)},
-                    FuncScopeTemp{id_num});
+      if (Isa<UnaryExprNode>(*decl.init)) {
+        WriteStore_("storel", ctx_->reg_num_to_id_num.at(init_num), id_num);
       } else {
         // 2. int* a = c; c itself stores the address of another integer. We can
         // directly use the address c currently holds.
-        WriteInstr_("storel {}, {}", FuncScopeTemp{init_num},
-                    FuncScopeTemp{id_num});
+        WriteStore_("storel", init_num, id_num);
       }
     } else {
-      WriteInstr_("storew {}, {}", FuncScopeTemp{init_num},
-                  FuncScopeTemp{id_num});
+      WriteStore_(StoreOpOf(*decl.type),
+                  ConvertForStore_(init_num, *decl.init->type, *decl.type),
+                  id_num);
     }
   }
   // Set up the number of the id so we know were to load it back.
-  id_to_num[decl.id] = id_num;
+  ctx_->id_to_num[decl.id] = id_num;
 }
 
 void QbeIrGenerator::Visit(const ArrDeclNode& arr_decl) {
-  int base_addr_num = NextLocalNum();
+  int base_addr_num = ctx_->NextLocalNum();
   assert(arr_decl.type->IsArr());
-  const auto* arr_type = dynamic_cast<ArrType*>((arr_decl.type).get());
+  const auto* arr_type = DynCast<ArrType>(arr_decl.type.get());
   auto element_size = arr_type->element_type().size();
-  WriteInstr_("{} =l alloc{} {}", FuncScopeTemp{base_addr_num}, element_size,
-              arr_decl.type->size());
-  id_to_num[arr_decl.id] = base_addr_num;
+  WriteInstr_("{} =l {} {}", FuncScopeTemp{base_addr_num},
+              AllocOf(*arr_decl.type), arr_decl.type->size());
+  ctx_->value_table.RecordSlot(base_addr_num);
+  ctx_->id_to_num[arr_decl.id] = base_addr_num;
 
   for (auto i = std::size_t{0}, e = arr_type->len(); i < e; ++i) {
     if (i < arr_decl.init_list.size()) {
       auto& arr_init = arr_decl.init_list.at(i);
-      arr_init->Accept(*this);
+      Dispatch(*arr_init);
     }
 
-    const int offset = NextLocalNum();
-    WriteInstr_("{} =l extsw {}", FuncScopeTemp{offset}, i * element_size);
+    const int offset =
+        WritePureInstr_("l", "extsw", fmt::format("{}", i * element_size));
 
     // res_addr = base_addr + offset
-    const int res_addr_num = NextLocalNum();
-    WriteInstr_("{} =l add {}, {}", FuncScopeTemp{res_addr_num},
-                FuncScopeTemp{base_addr_num}, FuncScopeTemp{offset});
+    const int res_addr_num = WritePureInstr_(
+        "l", "add",
+        fmt::format("{}, {}", ctx_->ValueOf(base_addr_num),
+                    ctx_->ValueOf(offset)));
+    ctx_->value_table.RecordDerivedAddr(res_addr_num, base_addr_num);
 
+    const auto& element_type = arr_type->element_type();
     if (i < arr_decl.init_list.size()) {
-      int init_val_num = num_recorder.NumOfPrevExpr();
-      WriteInstr_("storew {}, {}", FuncScopeTemp{init_val_num},
-                  FuncScopeTemp{res_addr_num});
-    } else {
+      int init_val_num = ctx_->num_recorder.NumOfPrevExpr();
+      WriteStore_(StoreOpOf(element_type),
+                  ConvertForStore_(init_val_num,
+                                   *arr_decl.init_list.at(i)->type,
+                                   element_type),
+                  res_addr_num);
+    } else if (!IsAggregate(element_type)) {
       // set remaining elements as 0
-      WriteInstr_("storew 0, {}", FuncScopeTemp{res_addr_num});
+      const auto store_op = StoreOpOf(element_type);
+      WriteInstr_("{} 0, {}", store_op, ctx_->ValueOf(res_addr_num));
+      ctx_->value_table.RecordStore(res_addr_num, std::nullopt,
+                                    WidthOf(store_op));
     }
   }
 }
@@ -216,13 +678,13 @@ void QbeIrGenerator::Visit(const FieldNode& field) {
 }
 
 void QbeIrGenerator::Visit(const RecordVarDeclNode& record_var_decl) {
-  const auto base_addr = NextLocalNum();
-  // TODO: support different data types. We have `int` type for now.
-  WriteInstr_("{} =l alloc4 {}", FuncScopeTemp{base_addr},
-              record_var_decl.type->size());
-  id_to_num[record_var_decl.id] = base_addr;
+  const auto base_addr = ctx_->NextLocalNum();
+  WriteInstr_("{} =l {} {}", FuncScopeTemp{base_addr},
+              AllocOf(*record_var_decl.type), record_var_decl.type->size());
+  ctx_->value_table.RecordSlot(base_addr);
+  ctx_->id_to_num[record_var_decl.id] = base_addr;
 
-  auto* record_type = dynamic_cast<RecordType*>(record_var_decl.type.get());
+  auto* record_type = DynCast<RecordType>(record_var_decl.type.get());
   assert(record_type);
   // NOTE: This predicate will make sure that we don't initialize members that
   // exceed the total number of members in a record. Also, it gurantees
@@ -231,59 +693,65 @@ void QbeIrGenerator::Visit(const RecordVarDeclNode& record_var_decl) {
             slot_count = record_type->SlotCount();
        i < slot_count && i < e; ++i) {
     const auto& init = record_var_decl.inits.at(i);
-    init->Accept(*this);
-    const auto init_num = num_recorder.NumOfPrevExpr();
+    Dispatch(*init);
+    const auto init_num = ctx_->num_recorder.NumOfPrevExpr();
 
     // res_addr = base_addr + offset
-    const int res_addr_num = NextLocalNum();
     const auto offset = record_type->OffsetOf(i);
-    WriteInstr_("{} =l add {}, {}", FuncScopeTemp{res_addr_num},
-                FuncScopeTemp{base_addr}, offset);
-    WriteInstr_("storew {}, {}", FuncScopeTemp{init_num},
-                FuncScopeTemp{res_addr_num});
+    const int res_addr_num = WritePureInstr_(
+        "l", "add", fmt::format("{}, {}", ctx_->ValueOf(base_addr), offset));
+    ctx_->value_table.RecordDerivedAddr(res_addr_num, base_addr);
+    const auto& field_type = *record_type->fields().at(i)->type;
+    WriteStore_(StoreOpOf(field_type),
+                ConvertForStore_(init_num, *init->type, field_type),
+                res_addr_num);
   }
 }
 
 void QbeIrGenerator::Visit(const ParamNode& parameter) {
-  int id_num = NextLocalNum();
+  int id_num = ctx_->NextLocalNum();
   // TODO: support different data types
-  if (parameter.type->IsPtr()) {
-    Write_("l %.{}", id_num);
-  } else {
-    Write_("w %.{}", id_num);
-  }
-  id_to_num[parameter.id] = id_num;
+  Write_("{} %.{}", AbiTypeOf(*parameter.type), id_num);
+  ctx_->id_to_num[parameter.id] = id_num;
 }
 
 void QbeIrGenerator::AllocMemForParams_(
     const std::vector<std::unique_ptr<ParamNode>>& parameters) {
   for (const auto& parameter : parameters) {
-    int id_num = id_to_num.at(parameter->id);
-    int reg_num = NextLocalNum();
-    WriteInstr_("{} =l alloc{} {}", FuncScopeTemp{reg_num},
-                parameter->type->size(), parameter->type->size());
-    if (parameter->type->IsPtr()) {
-      WriteInstr_("storel {}, {}", FuncScopeTemp{id_num},
-                  FuncScopeTemp{reg_num});
-    } else {
-      WriteInstr_("storew {}, {}", FuncScopeTemp{id_num},
-                  FuncScopeTemp{reg_num});
+    int id_num = ctx_->id_to_num.at(parameter->id);
+    if (Isa<RecordType>(*parameter->type)) {
+      // A record argument is the address of a copy that the function owns,
+      // which is used in place.
+      continue;
     }
+    int reg_num = ctx_->NextLocalNum();
+    WriteInstr_("{} =l {} {}", FuncScopeTemp{reg_num},
+                AllocOf(*parameter->type), parameter->type->size());
+    ctx_->value_table.RecordSlot(reg_num);
+    WriteStore_(StoreOpOf(*parameter->type), id_num, reg_num);
     // Update to store the new number.
-    id_to_num[parameter->id] = reg_num;
+    ctx_->id_to_num[parameter->id] = reg_num;
   }
 }
 
 void QbeIrGenerator::Visit(const FuncDefNode& func_def) {
-  int label_num = NextLabelNum();
+  // A prototype has nothing to generate; QBE doesn't declare the functions it
+  // calls.
+  if (!func_def.body) {
+    return;
+  }
+  int label_num = ctx_->NextLabelNum();
   // Parameter allocations go after the start label and before the body.
   auto start_label = BlockLabel{"start", label_num};
   auto body_label = BlockLabel{"body", label_num};
 
   Write_("export\n");
-  Write_("function w ${}(", func_def.id);
+  const auto& return_type = Cast<FuncType>(*func_def.type).return_type();
+  ctx_->return_type_of_func = &return_type;
+  ctx_->func_id = func_def.id;
+  Write_("function {} ${}(", AbiTypeOf(return_type), func_def.id);
   for (const auto& parameter : func_def.parameters) {
-    parameter->Accept(*this);
+    Dispatch(*parameter);
     if (parameter != func_def.parameters.back()) {
       Write_(", ");
     }
@@ -292,13 +760,37 @@ void QbeIrGenerator::Visit(const FuncDefNode& func_def) {
   WriteLabel_(start_label);
   AllocMemForParams_(func_def.parameters);
   WriteLabel_(body_label);
-  func_def.body->Accept(*this);
+  if (!profile_path_.empty() || profile_) {
+    ctx_->profile_sites.emplace(func_def);
+    ctx_->profile_counts =
+        profile_ ? profile_->CountsOf(func_def.id, *ctx_->profile_sites)
+                 : nullptr;
+  }
+  if (!profile_path_.empty()) {
+    if (func_def.id == "main") {
+      WriteInstr_("call $__vitaminc_profile_init(l {}, l {})",
+                  user_defined::GlobalPointer{kProfileFuncsName},
+                  user_defined::GlobalPointer{kProfilePathName});
+    }
+    WriteCounterIncr_(ProfileSites::kEntry);
+  }
+  Dispatch(*func_def.body);
+  if (!ctx_->cold_blocks.empty()) {
+    // The other blocks return before the cold ones, as they would if they fell
+    // off the end of the function.
+    WriteInstr_("ret");
+    // Already counted by the profiler when they were written.
+    output_ << ctx_->cold_blocks;
+  }
   Write_("}}\n");
+  if (!profile_path_.empty()) {
+    Write_("data {} = align 8 {{ z {} }}\n", CountersOf(func_def.id),
+           ctx_->profile_sites->size() * 8);
+  }
 }
 
 void QbeIrGenerator::Visit(const LoopInitNode& loop_init) {
-  std::visit([this](auto&& clause) { clause->Accept(*this); },
-             loop_init.clause);
+  std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
 }
 
 void QbeIrGenerator::Visit(const CompoundStmtNode& compound_stmt) {
@@ -306,34 +798,175 @@ void QbeIrGenerator::Visit(const CompoundStmtNode& compound_stmt) {
   // because it doesn't know whether it is a if statement body or a function.
   // Thus, by moving label creation to an upper level, each block can have its
   // correct starting label.
-  for (const auto& stmt : compound_stmt.stmts) {
-    stmt->Accept(*this);
-  }
+  VisitBlocks_(
+      compound_stmt, [](const CompoundStmtNode&) {},
+      [](const CompoundStmtNode&) {});
 }
 
 void QbeIrGenerator::Visit(const ExternDeclNode& extern_decl) {
-  std::visit([this](auto&& extern_decl) { extern_decl->Accept(*this); },
+  // Records declared at file scope have aggregate types, with which they are
+  // passed to and returned from functions.
+  if (const auto* decl_stmt =
+          std::get_if<std::unique_ptr<DeclStmtNode>>(&extern_decl.decl)) {
+    for (const auto& decl : (*decl_stmt)->decls) {
+      const auto* record_decl = DynCast<RecordDeclNode>(decl.get());
+      if (!record_decl || record_decl->id.empty() ||
+          record_decl->type->size() == 0) {
+        continue;
+      }
+      // NOTE: Every member is an integer or a pointer, which are of the same
+      // class in the ABI; so units of the alignment describe the same size,
+      // alignment and class as the members and their padding do.
+      const auto& record_type = Cast<RecordType>(*record_decl->type);
+      Write_("type {} = {{ {} {} }}\n", AggregateTypeOf(record_type),
+             UnitOf(record_type.alignment()),
+             record_type.size() / record_type.alignment());
+    }
+  }
+  std::visit([this](auto&& extern_decl) { Dispatch(*extern_decl); },
              extern_decl.decl);
 }
 
 void QbeIrGenerator::Visit(const TransUnitNode& trans_unit) {
-  // Generate the data of builtin functions.
-  Write_("data {} = align 1 {{ b \"%d\\012\\000\", }}\n",
-         user_defined::GlobalPointer{"__builtin_print_format"});
+  if (thread_pool_) {
+    GenerateInParallel_(trans_unit);
+  } else {
+    for (auto i = std::size_t{0}, e = trans_unit.extern_decls.size(); i < e;
+         ++i) {
+      const auto& extern_decl = *trans_unit.extern_decls.at(i);
+      if (!store_ || std::holds_alternative<std::unique_ptr<DeclStmtNode>>(
+                         extern_decl.decl)) {
+        GenerateExternDecl(extern_decl);
+      } else if (const auto* ir = store_->ReusableIrOf(i)) {
+        Write_("{}", *ir);
+      } else {
+        // The function is generated separately to have its IR recorded.
+        auto output = std::ostringstream{};
+        GenerateSeparately_(extern_decl, output);
+        store_->Update(i, output.str());
+        Write_("{}", output.str());
+      }
+    }
+  }
+  if (!profile_path_.empty()) {
+    WriteProfileTable_(trans_unit);
+  }
+}
 
-  for (const auto& extern_decl : trans_unit.extern_decls) {
-    extern_decl->Accept(*this);
+void QbeIrGenerator::GenerateExternDecl(const ExternDeclNode& extern_decl) {
+  ctx_ = std::make_unique<FuncContext>(*file_scope_id_to_num_);
+  Dispatch(extern_decl);
+  if (std::holds_alternative<std::unique_ptr<DeclStmtNode>>(extern_decl.decl)) {
+    *file_scope_id_to_num_ = std::move(ctx_->id_to_num);
+  }
+  ctx_.reset();
+}
+
+void QbeIrGenerator::GenerateSeparately_(const ExternDeclNode& extern_decl,
+                                         std::ostream& output) {
+  QbeIrGenerator code_generator{output};
+  code_generator.SetProfiler(profiler());
+  code_generator.InstrumentForProfile(profile_path_);
+  code_generator.UseProfile(profile_);
+  code_generator.UseEffects(effects_);
+  code_generator.file_scope_id_to_num_ = file_scope_id_to_num_;
+  code_generator.GenerateExternDecl(extern_decl);
+}
+
+void QbeIrGenerator::GenerateInParallel_(const TransUnitNode& trans_unit) {
+  // Each declaration is generated into its own buffer, which are then
+  // concatenated in order; the output is the same as the serial one.
+  auto outputs =
+      std::vector<std::ostringstream>(trans_unit.extern_decls.size());
+  // The file-scope declarations are generated first, so that the functions see
+  // all of them.
+  auto func_indices = std::vector<std::size_t>{};
+  for (auto i = std::size_t{0}, e = outputs.size(); i < e; ++i) {
+    const auto& extern_decl = *trans_unit.extern_decls.at(i);
+    if (std::holds_alternative<std::unique_ptr<FuncDefNode>>(
+            extern_decl.decl)) {
+      func_indices.push_back(i);
+      continue;
+    }
+    GenerateSeparately_(extern_decl, outputs.at(i));
+  }
+
+  auto generated_func_indices = std::vector<std::size_t>{};
+  auto generations = std::vector<std::future<void>>{};
+  for (const auto i : func_indices) {
+    if (const auto* ir = store_ ? store_->ReusableIrOf(i) : nullptr) {
+      outputs.at(i) << *ir;
+      continue;
+    }
+    generated_func_indices.push_back(i);
+    generations.push_back(thread_pool_->Submit(
+        [this, &output = outputs.at(i),
+         &extern_decl = *trans_unit.extern_decls.at(i)] {
+          GenerateSeparately_(extern_decl, output);
+        }));
+  }
+  for (auto& generation : generations) {
+    generation.get();
+  }
+  if (store_) {
+    for (const auto i : generated_func_indices) {
+      store_->Update(i, outputs.at(i).str());
+    }
+  }
+  for (const auto& output : outputs) {
+    output_ << output.str();
   }
 }
 
 void QbeIrGenerator::Visit(const IfStmtNode& if_stmt) {
-  if_stmt.predicate->Accept(*this);
-  int predicate_num = num_recorder.NumOfPrevExpr();
-  int label_num = NextLabelNum();
+  const auto site =
+      ctx_->profile_sites ? ctx_->profile_sites->SiteOf(if_stmt) : 0;
+  if (!profile_path_.empty()) {
+    WriteCounterIncr_(site);
+  }
+  Dispatch(*if_stmt.predicate);
+  int predicate_num = ctx_->num_recorder.NumOfPrevExpr();
+  int label_num = ctx_->NextLabelNum();
   auto then_label = BlockLabel{"if_then", label_num};
   auto else_label = BlockLabel{"if_else", label_num};
   auto end_label = BlockLabel{"if_end", label_num};
 
+  // With a profile, an arm that never runs while the statement does is moved
+  // out of line, and the arm that runs more is placed first. Without one, an
+  // arm that is predicted to rarely run is moved out of line, unless both are.
+  auto is_then_cold = false;
+  auto is_else_cold = false;
+  auto is_else_first = false;
+  if (ctx_->profile_counts) {
+    const auto layout =
+        ArmLayoutByProfile(*ctx_->profile_counts, site,
+                           /* has_second_arm */ if_stmt.or_else != nullptr);
+    is_then_cold = layout.is_first_cold;
+    is_else_cold = layout.is_second_cold;
+    is_else_first = layout.is_second_first;
+  } else {
+    const auto null_test = IsNullTest(*if_stmt.predicate);
+    const auto& label_views = ctx_->label_views_of_jumpable_blocks;
+    const auto is_then_rare =
+        IsRarelyRun(*if_stmt.then, null_test == true, label_views);
+    const auto is_else_rare =
+        if_stmt.or_else &&
+        IsRarelyRun(*if_stmt.or_else, null_test == false, label_views);
+    is_then_cold = is_then_rare && !is_else_rare;
+    is_else_cold = is_else_rare && !is_then_rare;
+  }
+  const auto write_then = [&] {
+    WriteLabel_(then_label);
+    if (!profile_path_.empty()) {
+      WriteCounterIncr_(site + 1);
+    }
+    Dispatch(*if_stmt.then);
+  };
+  const auto write_else = [&] {
+    WriteLabel_(else_label);
+    Dispatch(*if_stmt.or_else);
+  };
+
   // Jumps to "then" if the predicate is true (non-zero), else jumps to "else".
   // If no "else" exists, falls through to "end".
   // If "else" exists, a second jump is needed after executing "then" to skip
@@ -347,93 +980,174 @@ void QbeIrGenerator::Visit(const IfStmtNode& if_stmt) {
     Write_("{}\n", end_label);
   }
 
-  WriteLabel_(then_label);
-  if_stmt.then->Accept(*this);
-  if (if_stmt.or_else) {
-    // Skip the "else" part after executing "then".
-    WriteInstr_("jmp {}\n", end_label);
-    WriteLabel_(else_label);
-    if_stmt.or_else->Accept(*this);
+  if (is_then_cold) {
+    WriteColdBlocks_([&] {
+      write_then();
+      WriteInstr_("jmp {}", end_label);
+    });
+    if (if_stmt.or_else) {
+      write_else();
+    }
+  } else if (is_else_cold) {
+    write_then();
+    WriteColdBlocks_([&] {
+      write_else();
+      WriteInstr_("jmp {}", end_label);
+    });
+  } else if (is_else_first) {
+    write_else();
+    WriteInstr_("jmp {}", end_label);
+    write_then();
+  } else {
+    write_then();
+    if (if_stmt.or_else) {
+      // Skip the "else" part after executing "then".
+      WriteInstr_("jmp {}\n", end_label);
+      write_else();
+    }
   }
   WriteLabel_(end_label);
 }
 
 void QbeIrGenerator::Visit(const WhileStmtNode& while_stmt) {
-  int label_num = NextLabelNum();
+  const auto site =
+      ctx_->profile_sites ? ctx_->profile_sites->SiteOf(while_stmt) : 0;
+  int label_num = ctx_->NextLabelNum();
   const auto label_prefix =
       std::string{while_stmt.is_do_while ? "do_" : "while_"};
   auto body_label = BlockLabel{label_prefix + "body", label_num};
   auto pred_label = BlockLabel{label_prefix + "pred", label_num};
   auto end_label = BlockLabel{label_prefix + "end", label_num};
+  // When instrumented, the jump back to the body goes through a block that
+  // counts it.
+  const auto back_label = profile_path_.empty()
+                              ? body_label
+                              : BlockLabel{label_prefix + "back", label_num};
+
+  const auto write_test = [&](const BlockLabel& true_label) {
+    Dispatch(*while_stmt.predicate);
+    int predicate_num = ctx_->num_recorder.NumOfPrevExpr();
+    WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{predicate_num}, true_label,
+                end_label);
+  };
 
   // A while statement's predicate is evaluated "before" the body statement,
   // whereas a do-while statement's predicate is evaluated "after" the body
-  // statement. In the generated code for a while statement, there is an
-  // unconditional jump at the end of the body to jump back to the predicate.
-  // For a do-while statement, it only needs one conditional jump.
+  // statement. Both are generated with the predicate after the body, so that
+  // each iteration takes a single conditional jump back to the body; a while
+  // statement additionally tests the predicate once before entering the body.
+  // With a profile, a while statement that never jumps back to its body is
+  // generated with the predicate before the body only, since its copy after
+  // the body would never be taken.
+  const auto is_rotated =
+      while_stmt.is_do_while || !ctx_->profile_counts ||
+      ctx_->profile_counts->at(site) != 0;
   if (!while_stmt.is_do_while) {
-    WriteLabel_(pred_label);
-    while_stmt.predicate->Accept(*this);
-    int predicate_num = num_recorder.NumOfPrevExpr();
-    WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{predicate_num}, body_label,
-                end_label);
+    HoistCalls_(while_stmt);
+    if (!is_rotated) {
+      WriteLabel_(pred_label);
+    }
+    write_test(body_label);
   }
   WriteLabel_(body_label);
-  label_views_of_jumpable_blocks.push_back(
-      {.entry = pred_label, .exit = end_label});
-  while_stmt.loop_body->Accept(*this);
-  label_views_of_jumpable_blocks.pop_back();
-  if (!while_stmt.is_do_while) {
-    WriteInstr_("jmp {}", pred_label);
-  } else {
+  ctx_->label_views_of_jumpable_blocks.push_back(
+      {.entry = pred_label, .exit = end_label, .is_loop = true});
+  Dispatch(*while_stmt.loop_body);
+  ctx_->label_views_of_jumpable_blocks.pop_back();
+  if (is_rotated) {
     WriteLabel_(pred_label);
-    while_stmt.predicate->Accept(*this);
-    int predicate_num = num_recorder.NumOfPrevExpr();
-    WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{predicate_num}, body_label,
-                end_label);
+    write_test(back_label);
+    if (!profile_path_.empty()) {
+      WriteBackEdge_(back_label, site, body_label);
+    }
+  } else {
+    WriteInstr_("jmp {}", pred_label);
   }
   WriteLabel_(end_label);
 }
 
 void QbeIrGenerator::Visit(const ForStmtNode& for_stmt) {
-  int label_num = NextLabelNum();
+  const auto site =
+      ctx_->profile_sites ? ctx_->profile_sites->SiteOf(for_stmt) : 0;
+  int label_num = ctx_->NextLabelNum();
 
   // A for loop consists of three clauses: loop initialization, predicate, and a
   // step: for (init; pred; step) { body; }
 
-  auto pred_label = BlockLabel{"for_pred", label_num};
   auto body_label = BlockLabel{"for_body", label_num};
+  auto pred_label = BlockLabel{"for_pred", label_num};
   auto step_label = BlockLabel{"for_step", label_num};
   auto end_label = BlockLabel{"for_end", label_num};
+  // When instrumented, the jump back to the body goes through a block that
+  // counts it.
+  const auto back_label = profile_path_.empty()
+                              ? body_label
+                              : BlockLabel{"for_back", label_num};
 
   // A for statement's loop initialization is the first clause to execute,
   // whereas a for statement's predicate specifies evaluation made before each
   // iteration. A step is an operation that is performed after each iteration.
-  // Skip predicate generation if it is a null expression.
+  // As a while statement, the predicate is tested once before entering the
+  // body, and then after each step, which jumps back to the body, unless the
+  // profile shows that it never does. Skip predicate generation if it is a
+  // null expression.
   WriteComment_("loop init");
-  for_stmt.loop_init->Accept(*this);
-  WriteLabel_(pred_label);
-  for_stmt.predicate->Accept(*this);
-  if (!dynamic_cast<NullExprNode*>((for_stmt.predicate).get())) {
-    int predicate_num = num_recorder.NumOfPrevExpr();
-    WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{predicate_num}, body_label,
+  Dispatch(*for_stmt.loop_init);
+  HoistCalls_(for_stmt);
+  const auto has_predicate = !Isa<NullExprNode>(*for_stmt.predicate);
+  const auto is_rotated =
+      !has_predicate || !ctx_->profile_counts ||
+      ctx_->profile_counts->at(site) != 0;
+  const auto write_test = [&](const BlockLabel& true_label) {
+    Dispatch(*for_stmt.predicate);
+    int predicate_num = ctx_->num_recorder.NumOfPrevExpr();
+    WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{predicate_num}, true_label,
                 end_label);
+  };
+  if (!is_rotated) {
+    WriteLabel_(pred_label);
+  }
+  if (has_predicate) {
+    write_test(body_label);
   }
   WriteLabel_(body_label);
-  label_views_of_jumpable_blocks.push_back(
-      {.entry = step_label, .exit = end_label});
-  for_stmt.loop_body->Accept(*this);
-  label_views_of_jumpable_blocks.pop_back();
+  ctx_->label_views_of_jumpable_blocks.push_back(
+      {.entry = step_label, .exit = end_label, .is_loop = true});
+  Dispatch(*for_stmt.loop_body);
+  ctx_->label_views_of_jumpable_blocks.pop_back();
   WriteLabel_(step_label);
-  for_stmt.step->Accept(*this);
-  WriteInstr_("jmp {}", pred_label);
+  Dispatch(*for_stmt.step);
+  if (!is_rotated) {
+    WriteInstr_("jmp {}", pred_label);
+  } else if (has_predicate) {
+    write_test(back_label);
+  } else {
+    WriteInstr_("jmp {}", back_label);
+  }
+  if (!profile_path_.empty()) {
+    WriteBackEdge_(back_label, site, body_label);
+  }
   WriteLabel_(end_label);
 }
 
+void QbeIrGenerator::HoistCalls_(const StmtNode& loop) {
+  if (!effects_) {
+    return;
+  }
+  for (const auto* call_expr :
+       effects_->HoistableCallsOf(loop, ctx_->func_id)) {
+    Dispatch(*call_expr);
+    ctx_->hoisted_calls.emplace(call_expr, ctx_->num_recorder.NumOfPrevExpr());
+  }
+}
+
 void QbeIrGenerator::Visit(const ReturnStmtNode& ret_stmt) {
-  ret_stmt.expr->Accept(*this);
-  int ret_num = num_recorder.NumOfPrevExpr();
-  WriteInstr_("ret {}", FuncScopeTemp{ret_num});
+  Dispatch(*ret_stmt.expr);
+  int ret_num = ctx_->num_recorder.NumOfPrevExpr();
+  assert(ctx_->return_type_of_func);
+  WriteInstr_("ret {}",
+              ctx_->ValueOf(ConvertTo_(ret_num, *ret_stmt.expr->type,
+                                 *ctx_->return_type_of_func)));
 }
 
 void QbeIrGenerator::Visit(const GotoStmtNode& goto_stmt) {
@@ -441,56 +1155,17 @@ void QbeIrGenerator::Visit(const GotoStmtNode& goto_stmt) {
 }
 
 void QbeIrGenerator::Visit(const BreakStmtNode& break_stmt) {
-  assert(!label_views_of_jumpable_blocks.empty());
-  WriteInstr_("jmp {}", BlockLabel{label_views_of_jumpable_blocks.back().exit});
+  assert(!ctx_->label_views_of_jumpable_blocks.empty());
+  WriteInstr_("jmp {}",
+              BlockLabel{ctx_->label_views_of_jumpable_blocks.back().exit});
 }
 
 void QbeIrGenerator::Visit(const ContinueStmtNode& continue_stmt) {
-  assert(!label_views_of_jumpable_blocks.empty());
+  assert(!ctx_->label_views_of_jumpable_blocks.empty());
   WriteInstr_("jmp {}",
-              BlockLabel{label_views_of_jumpable_blocks.back().entry});
+              BlockLabel{ctx_->label_views_of_jumpable_blocks.back().entry});
 }
 
-namespace {
-
-struct CaseInfo {
-  /// @note This is a non-owning pointer that points to the expression of the
-  /// case.
-  const ExprNode* expr = nullptr;
-  BlockLabel label;
-};
-
-struct SwitchInfo {
-  std::vector<CaseInfo> case_infos{};
-  std::optional<BlockLabel> default_label;
-  BlockLabel exit_label;
-
-  explicit SwitchInfo(BlockLabel exit_label,
-                      std::optional<BlockLabel> default_label = std::nullopt)
-      : default_label{std::move(default_label)},
-        exit_label{std::move(exit_label)} {}
-};
-
-/// @brief The shared states passed around during the generation of a switch.
-/// @note To allow nested switch statements, the information is stacked.
-auto switch_infos  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-    = std::vector<std::shared_ptr<SwitchInfo>>{};
-
-/// @brief The label of the next condition depends on whether we've already
-/// handled the last one and whether there is a default label.
-BlockLabel GetNextCondLabel(bool is_last_cond,
-                            const std::optional<BlockLabel>& default_label) {
-  if (is_last_cond && default_label) {
-    return *default_label;
-  }
-  if (is_last_cond) {
-    return switch_infos.back()->exit_label;
-  }
-  return {"switch_cond", NextLabelNum()};
-}
-
-}  // namespace
-
 void QbeIrGenerator::Visit(const SwitchStmtNode& switch_stmt) {
   // The structure of a switch statement, including the labeled statements
   // inside, is represented in the following pseudo IR:
@@ -543,87 +1218,133 @@ void QbeIrGenerator::Visit(const SwitchStmtNode& switch_stmt) {
   // (2) Evaluation of case expressions is done in the condition part.
 
   WriteComment_("switch");
-  switch_stmt.ctrl->Accept(*this);
-  const auto ctrl_num = num_recorder.NumOfPrevExpr();
-  auto cond_label = BlockLabel{"switch_cond", NextLabelNum()};
+  Dispatch(*switch_stmt.ctrl);
+  const auto ctrl_num = ctx_->num_recorder.NumOfPrevExpr();
+  auto cond_label = BlockLabel{"switch_cond", ctx_->NextLabelNum()};
   WriteInstr_("jmp {}", cond_label);
 
-  switch_infos.push_back(
-      std::make_shared<SwitchInfo>(BlockLabel{"switch_exit", NextLabelNum()}));
+  ctx_->switch_infos.push_back(
+      std::make_shared<SwitchInfo>(
+          BlockLabel{"switch_exit", ctx_->NextLabelNum()}));
   GenerateCases_(switch_stmt);
   GenerateConditions_(switch_stmt, cond_label, ctrl_num);
 
-  WriteLabel_(switch_infos.back()->exit_label);
-  switch_infos.pop_back();
+  WriteLabel_(ctx_->switch_infos.back()->exit_label);
+  ctx_->switch_infos.pop_back();
 }
 
 void QbeIrGenerator::GenerateCases_(const SwitchStmtNode& switch_stmt) {
-  auto this_switch_info = switch_infos.back();
-  label_views_of_jumpable_blocks.push_back(
+  auto this_switch_info = ctx_->switch_infos.back();
+  ctx_->label_views_of_jumpable_blocks.push_back(
       {// FIXME: The break statement only jumps to the exit label; there's no
        // appropriate entry label to set here.
        .entry = this_switch_info->exit_label,
        .exit = this_switch_info->exit_label}
 
   );
-  switch_stmt.stmt->Accept(*this);
-  label_views_of_jumpable_blocks.pop_back();
-  WriteLabel_(BlockLabel{"switch_bottom", NextLabelNum()});
+  Dispatch(*switch_stmt.stmt);
+  ctx_->label_views_of_jumpable_blocks.pop_back();
+  WriteLabel_(BlockLabel{"switch_bottom", ctx_->NextLabelNum()});
   WriteInstr_("jmp {}", this_switch_info->exit_label);
 }
 
 void QbeIrGenerator::GenerateConditions_(const SwitchStmtNode& switch_stmt,
                                          const BlockLabel& first_cond_label,
                                          int ctrl_num) {
-  auto this_switch_info = switch_infos.back();
+  auto this_switch_info = ctx_->switch_infos.back();
+  auto& case_infos = this_switch_info->case_infos;
+  // With a profile, the case that is matched the most is tested first.
+  if (ctx_->profile_counts) {
+    const auto count_of = [this](const CaseInfo& case_info) {
+      return ctx_->profile_counts->at(
+          ctx_->profile_sites->SiteOf(*case_info.case_stmt));
+    };
+    std::stable_sort(case_infos.begin(), case_infos.end(),
+                     [&count_of](const auto& lhs, const auto& rhs) {
+                       return count_of(lhs) > count_of(rhs);
+                     });
+  }
+  // When instrumented, each case that is matched, and the default, is jumped
+  // to through a block that counts it.
+  const auto is_instrumented = !profile_path_.empty();
+  auto default_label = this_switch_info->default_label;
+  if (is_instrumented && default_label) {
+    default_label = BlockLabel{"switch_hit", ctx_->NextLabelNum()};
+  }
   auto cond_label = first_cond_label;
-  for (auto i = std::size_t{0}, e = this_switch_info->case_infos.size(); i < e;
-       ++i) {
+  for (auto i = std::size_t{0}, e = case_infos.size(); i < e; ++i) {
     WriteLabel_(cond_label);
-    const auto& case_info = this_switch_info->case_infos.at(i);
-    case_info.expr->Accept(*this);
-    const auto expr_num = num_recorder.NumOfPrevExpr();
-    const auto match_num = NextLocalNum();
-    WriteInstr_("{} =w ceqw {}, {}", FuncScopeTemp{match_num},
-                FuncScopeTemp{ctrl_num}, FuncScopeTemp{expr_num});
+    const auto& case_info = case_infos.at(i);
+    Dispatch(*case_info.expr);
+    // The case expression is converted to the promoted type of the
+    // controlling expression, whose value is already extended to it.
+    const auto& ctrl_type = *switch_stmt.ctrl->type;
+    const auto& promoted_type =
+        ctrl_type.size() < 4 ? kPromotedType : ctrl_type;
+    const auto expr_num = ConvertTo_(ctx_->num_recorder.NumOfPrevExpr(),
+                                     *case_info.expr->type, promoted_type);
+    const auto match_num = ctx_->NextLocalNum();
+    WriteInstr_("{} =w {} {}, {}", FuncScopeTemp{match_num},
+                GetBinaryOperator(BinaryOperator::kEq, promoted_type),
+                FuncScopeTemp{ctrl_num}, ctx_->ValueOf(expr_num));
     const auto is_last_cond = i == e - 1;
-    cond_label =
-        GetNextCondLabel(is_last_cond, this_switch_info->default_label);
-    WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{match_num}, case_info.label,
+    cond_label = ctx_->NextCondLabel(is_last_cond, default_label);
+    if (!is_instrumented) {
+      WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{match_num},
+                  case_info.label, cond_label);
+      continue;
+    }
+    auto hit_label = BlockLabel{"switch_hit", ctx_->NextLabelNum()};
+    WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{match_num}, hit_label,
                 cond_label);
+    WriteLabel_(hit_label);
+    WriteCounterIncr_(ctx_->profile_sites->SiteOf(*case_info.case_stmt));
+    WriteInstr_("jmp {}", case_info.label);
+  }
+  if (is_instrumented && default_label) {
+    WriteLabel_(*default_label);
+    WriteCounterIncr_(
+        ctx_->profile_sites->SiteOf(*this_switch_info->default_stmt));
+    WriteInstr_("jmp {}", *this_switch_info->default_label);
   }
 }
 
 void QbeIrGenerator::Visit(const IdLabeledStmtNode& id_labeled_stmt) {
   WriteLabel_(user_defined::BlockLabel{id_labeled_stmt.label});
-  id_labeled_stmt.stmt->Accept(*this);
+  Dispatch(*id_labeled_stmt.stmt);
 }
 
 void QbeIrGenerator::Visit(const CaseStmtNode& case_stmt) {
-  assert(!switch_infos.empty());
+  assert(!ctx_->switch_infos.empty());
   // The evaluation of the case expression is done in the condition part.
-  auto case_label = BlockLabel{"switch_case", NextLabelNum()};
-  switch_infos.back()->case_infos.push_back(
-      CaseInfo{case_stmt.expr.get(), case_label});
-  auto& this_case_info = switch_infos.back()->case_infos.back();
+  auto case_label = BlockLabel{"switch_case", ctx_->NextLabelNum()};
+  ctx_->switch_infos.back()->case_infos.push_back(
+      CaseInfo{case_stmt.expr.get(), case_label, &case_stmt});
+  auto& this_case_info = ctx_->switch_infos.back()->case_infos.back();
   WriteLabel_(this_case_info.label);
-  case_stmt.stmt->Accept(*this);
+  Dispatch(*case_stmt.stmt);
 }
 
 void QbeIrGenerator::Visit(const DefaultStmtNode& default_stmt) {
-  assert(!switch_infos.empty());
-  auto default_label = BlockLabel{"switch_default", NextLabelNum()};
+  assert(!ctx_->switch_infos.empty());
+  auto default_label = BlockLabel{"switch_default", ctx_->NextLabelNum()};
   WriteLabel_(default_label);
-  switch_infos.back()->default_label = default_label;
-  default_stmt.stmt->Accept(*this);
+  ctx_->switch_infos.back()->default_label = default_label;
+  ctx_->switch_infos.back()->default_stmt = &default_stmt;
+  Dispatch(*default_stmt.stmt);
 }
 
 void QbeIrGenerator::Visit(const ExprStmtNode& expr_stmt) {
-  expr_stmt.expr->Accept(*this);
+  // The value of the statement is unused.
+  if (effects_ &&
+      effects_->EffectOf(*expr_stmt.expr) != Effect::kSideEffecting) {
+    return;
+  }
+  Dispatch(*expr_stmt.expr);
 }
 
 void QbeIrGenerator::Visit(const InitExprNode& init_expr) {
-  init_expr.expr->Accept(*this);
+  Dispatch(*init_expr.expr);
 }
 
 void QbeIrGenerator::Visit(const ArrDesNode& arr_des) {}
@@ -637,145 +1358,241 @@ void QbeIrGenerator::Visit(const NullExprNode& null_expr) {
 void QbeIrGenerator::Visit(const IdExprNode& id_expr) {
   // If the id is a function, the result is the address of the function.
   if (id_expr.type->IsFunc()) {
-    int res_num = NextLocalNum();
     // The function name is already a function pointer.
-    WriteInstr_("{} =l copy {}", FuncScopeTemp{res_num},
-                user_defined::GlobalPointer{id_expr.id});
-    num_recorder.Record(res_num);
+    const int res_num = WritePureInstr_(
+        "l", "copy",
+        fmt::format("{}", user_defined::GlobalPointer{id_expr.id}));
+    ctx_->num_recorder.Record(res_num);
     return;
   }
-  assert(id_to_num.count(id_expr.id) != 0);
+  assert(ctx_->id_to_num.count(id_expr.id) != 0);
   /// @brief Plays the role of a "pointer". Its value has to be loaded to
   /// the register before use.
-  int id_num = id_to_num.at(id_expr.id);
-  int reg_num = NextLocalNum();
-  if (id_expr.type->IsPtr() || id_expr.type->IsFunc()) {
-    WriteInstr_("{} =l loadl {}", FuncScopeTemp{reg_num},
-                FuncScopeTemp{id_num});
-  } else {
-    WriteInstr_("{} =w loadw {}", FuncScopeTemp{reg_num},
-                FuncScopeTemp{id_num});
+  int id_num = ctx_->id_to_num.at(id_expr.id);
+  if (IsAggregate(*id_expr.type)) {
+    // A record or an array is never loaded as a whole; its value is its
+    // address.
+    ctx_->num_recorder.Record(id_num);
+    ctx_->reg_num_to_id_num[id_num] = id_num;
+    return;
   }
-  num_recorder.Record(reg_num);
+  int reg_num = WriteLoad_(BaseTypeOf(*id_expr.type), LoadOpOf(*id_expr.type),
+                           id_num);
+  ctx_->num_recorder.Record(reg_num);
   // Map the temporary reg_num to id_num, so that upper level nodes can store
   // value to id_num instead of reg_num.
-  reg_num_to_id_num[reg_num] = id_num;
+  ctx_->reg_num_to_id_num[reg_num] = id_num;
 }
 
 void QbeIrGenerator::Visit(const IntConstExprNode& int_expr) {
-  int num = NextLocalNum();
-  WriteInstr_("{} =w copy {}", FuncScopeTemp{num}, int_expr.val);
-  num_recorder.Record(num);
+  // A value beyond `long` is written as the negative `long` of the same bits.
+  int num = WritePureInstr_(BaseTypeOf(*int_expr.type), "copy",
+                            fmt::format("{}", static_cast<std::int64_t>(
+                                                  int_expr.val)));
+  ctx_->num_recorder.Record(num);
 }
 
 void QbeIrGenerator::Visit(const ArgExprNode& arg_expr) {
-  arg_expr.arg->Accept(*this);
+  Dispatch(*arg_expr.arg);
 }
 
 void QbeIrGenerator::Visit(const ArrSubExprNode& arr_sub_expr) {
-  arr_sub_expr.arr->Accept(*this);
-  const int reg_num = num_recorder.NumOfPrevExpr();
+  Dispatch(*arr_sub_expr.arr);
+  const int reg_num = ctx_->num_recorder.NumOfPrevExpr();
   // address of the first element
-  const int base_addr = reg_num_to_id_num.at(reg_num);
-  arr_sub_expr.index->Accept(*this);
-  const int index_num = num_recorder.NumOfPrevExpr();
+  const int base_addr = ctx_->reg_num_to_id_num.at(reg_num);
+  Dispatch(*arr_sub_expr.index);
+  const int index_num = ctx_->num_recorder.NumOfPrevExpr();
 
   // extend word to long
-  const int extended_num = NextLocalNum();
-  WriteInstr_("{} =l extsw {}", FuncScopeTemp{extended_num},
-              FuncScopeTemp{index_num});
+  const int extended_num = ConvertTo_(index_num, *arr_sub_expr.index->type,
+                                      PrimType{PrimitiveType::kLong});
 
   // offset = index number * element size
   // e.g. int a[3]
   // a[1]'s offset = 1 * 4 (int size)
-  const int offset = NextLocalNum();
-  const auto* arr_type = dynamic_cast<ArrType*>((arr_sub_expr.arr->type).get());
+  const auto* arr_type = DynCast<ArrType>(arr_sub_expr.arr->type.get());
   assert(arr_type);
-  WriteInstr_("{} =l mul {}, {}", FuncScopeTemp{offset},
-              FuncScopeTemp{extended_num}, arr_type->element_type().size());
+  const int offset = WritePureInstr_(
+      "l", "mul",
+      fmt::format("{}, {}", ctx_->ValueOf(extended_num),
+                  arr_type->element_type().size()));
 
   // res_addr = base_addr + offset
-  const int res_addr_num = NextLocalNum();
-  WriteInstr_("{} =l add {}, {}", FuncScopeTemp{res_addr_num},
-              FuncScopeTemp{base_addr}, FuncScopeTemp{offset});
-
+  const int res_addr_num = WritePureInstr_(
+      "l", "add",
+      fmt::format("{}, {}", ctx_->ValueOf(base_addr), ctx_->ValueOf(offset)));
+  ctx_->value_table.RecordDerivedAddr(res_addr_num, base_addr);
+
+  const auto& element_type = arr_type->element_type();
+  if (IsAggregate(element_type)) {
+    ctx_->reg_num_to_id_num[res_addr_num] = res_addr_num;
+    ctx_->num_recorder.Record(res_addr_num);
+    return;
+  }
   // load value from res_addr
-  const int res_num = NextLocalNum();
-  WriteInstr_("{} =w loadw {}", FuncScopeTemp{res_num},
-              FuncScopeTemp{res_addr_num});
-  reg_num_to_id_num[res_num] = res_addr_num;
-  num_recorder.Record(res_num);
+  const int res_num = WriteLoad_(BaseTypeOf(element_type),
+                                 LoadOpOf(element_type), res_addr_num);
+  ctx_->reg_num_to_id_num[res_num] = res_addr_num;
+  ctx_->num_recorder.Record(res_num);
 }
 
 void QbeIrGenerator::Visit(const CondExprNode& cond_expr) {
-  cond_expr.predicate->Accept(*this);
-  const int first_num = num_recorder.NumOfPrevExpr();
+  const auto site =
+      ctx_->profile_sites ? ctx_->profile_sites->SiteOf(cond_expr) : 0;
+  if (!profile_path_.empty()) {
+    WriteCounterIncr_(site);
+  }
+  Dispatch(*cond_expr.predicate);
+  const int first_num = ctx_->num_recorder.NumOfPrevExpr();
   // The second operand is evaluated only if the first compares unequal to
   // 0; the third operand is evaluated only if the first compares equal to
   // 0; the result is the value of the second or third operand (whichever is
   // evaluated).
-  const int label_num = NextLabelNum();
+  const int label_num = ctx_->NextLabelNum();
   auto second_label = BlockLabel{"cond_second", label_num};
   auto third_label = BlockLabel{"cond_third", label_num};
   auto end_label = BlockLabel{"cond_end", label_num};
-  const int first_res = NextLocalNum();
+  const int first_res = ctx_->NextLocalNum();
   WriteInstr_("{} =w {} {}, 0", FuncScopeTemp{first_res},
-              GetBinaryOperator(BinaryOperator::kNeq),
+              GetBinaryOperator(BinaryOperator::kNeq,
+                                *cond_expr.predicate->type),
               FuncScopeTemp{first_num});
   WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{first_res}, second_label,
               third_label);
-  const int res_num = NextLocalNum();
-  WriteLabel_(second_label);
-  cond_expr.then->Accept(*this);
-  const int second_num = num_recorder.NumOfPrevExpr();
-  WriteInstr_("{} =w copy {}", FuncScopeTemp{res_num},
-              FuncScopeTemp{second_num});
-  WriteInstr_("jmp {}", end_label);
-  WriteLabel_(third_label);
-  cond_expr.or_else->Accept(*this);
-  const int third_num = num_recorder.NumOfPrevExpr();
-  WriteInstr_("{} =w copy {}", FuncScopeTemp{res_num},
-              FuncScopeTemp{third_num});
+  const int res_num = ctx_->NextLocalNum();
+  const auto& res_type = *cond_expr.type;
+  // Each operand jumps to the end, unless it's placed right before it.
+  const auto write_operand = [&](const BlockLabel& label,
+                                 const ExprNode& operand, bool is_last) {
+    WriteLabel_(label);
+    if (!profile_path_.empty() && &operand == cond_expr.then.get()) {
+      WriteCounterIncr_(site + 1);
+    }
+    Dispatch(operand);
+    const int num =
+        ConvertTo_(ctx_->num_recorder.NumOfPrevExpr(), *operand.type, res_type);
+    WriteInstr_("{} ={} copy {}", FuncScopeTemp{res_num},
+                BaseTypeOf(res_type), ctx_->ValueOf(num));
+    if (!is_last) {
+      WriteInstr_("jmp {}", end_label);
+    }
+  };
+  const auto write_second = [&](bool is_last) {
+    write_operand(second_label, *cond_expr.then, is_last);
+  };
+  const auto write_third = [&](bool is_last) {
+    write_operand(third_label, *cond_expr.or_else, is_last);
+  };
+  // With a profile, the operands are laid out as the arms of an if statement.
+  const auto layout = ctx_->profile_counts
+                          ? ArmLayoutByProfile(*ctx_->profile_counts, site,
+                                               /* has_second_arm */ true)
+                          : ArmLayout{};
+  if (layout.is_first_cold) {
+    WriteColdBlocks_([&] { write_second(/* is_last */ false); });
+    write_third(/* is_last */ true);
+  } else if (layout.is_second_cold) {
+    write_second(/* is_last */ true);
+    WriteColdBlocks_([&] { write_third(/* is_last */ false); });
+  } else if (layout.is_second_first) {
+    write_third(/* is_last */ false);
+    write_second(/* is_last */ true);
+  } else {
+    write_second(/* is_last */ false);
+    write_third(/* is_last */ true);
+  }
   WriteLabel_(end_label);
-  num_recorder.Record(res_num);
+  ctx_->num_recorder.Record(res_num);
 }
 
 void QbeIrGenerator::Visit(const FuncCallExprNode& call_expr) {
-  call_expr.func_expr->Accept(*this);
-  const int func_num = num_recorder.NumOfPrevExpr();
+  if (const auto it = ctx_->hoisted_calls.find(&call_expr);
+      it != ctx_->hoisted_calls.cend()) {
+    ctx_->num_recorder.Record(it->second);
+    return;
+  }
+  Dispatch(*call_expr.func_expr);
+  const int func_num = ctx_->num_recorder.NumOfPrevExpr();
 
-  // Evaluate the arguments.
+  const auto* func_type = DynCast<FuncType>(call_expr.func_expr->type.get());
+  if (const auto* ptr_type =
+          DynCast<PtrType>(call_expr.func_expr->type.get())) {
+    func_type = DynCast<FuncType>(&ptr_type->base_type());
+  }
+  assert(func_type);
+  /// @return The type that the `i`-th argument is passed as.
+  const auto param_type_of = [&](std::size_t i) -> const Type& {
+    const auto& param_types = func_type->param_types();
+    return i < param_types.size() ? *param_types.at(i)
+                                  : *call_expr.args.at(i)->type;
+  };
+
+  // Evaluate the arguments, which are converted to the types of the
+  // parameters.
   std::vector<int> arg_nums{};
-  for (const auto& arg : call_expr.args) {
-    arg->Accept(*this);
-    const int arg_num = num_recorder.NumOfPrevExpr();
-    arg_nums.push_back(arg_num);
+  for (auto i = std::size_t{0}, e = call_expr.args.size(); i < e; ++i) {
+    const auto& arg = call_expr.args.at(i);
+    Dispatch(*arg);
+    arg_nums.push_back(ConvertTo_(ctx_->num_recorder.NumOfPrevExpr(),
+                                  *arg->type, param_type_of(i)));
+  }
+
+  const auto* id_expr = DynCast<IdExprNode>(call_expr.func_expr.get());
+  const auto effect = effects_ && id_expr && id_expr->type->IsFunc()
+                          ? effects_->EffectOfFunc(id_expr->id)
+                          : Effect::kSideEffecting;
+  // A pure call is reused as any pure computation is, unless it's passed or
+  // returns a record, which is in memory.
+  if (effect == Effect::kPure && !Isa<RecordType>(*call_expr.type) &&
+      std::none_of(call_expr.args.cbegin(), call_expr.args.cend(),
+                   [](const auto& arg) {
+                     return Isa<RecordType>(*arg->type);
+                   })) {
+    auto args = std::string{};
+    for (auto i = size_t{0}, e = arg_nums.size(); i < e; ++i) {
+      args += fmt::format("{}{} {}", i == 0 ? "" : ", ",
+                          AbiTypeOf(param_type_of(i)),
+                          ctx_->ValueOf(arg_nums.at(i)));
+    }
+    ctx_->num_recorder.Record(WritePureInstr_(
+        AbiTypeOf(*call_expr.type), "call",
+        fmt::format("{}({})", ctx_->ValueOf(func_num), args)));
+    return;
   }
 
-  const int res_num = NextLocalNum();
+  const int res_num = ctx_->NextLocalNum();
   Write_(kIndentStr);
-  if (const auto* id_expr =
-          dynamic_cast<IdExprNode*>(call_expr.func_expr.get());
-      id_expr && id_expr->id == "__builtin_print") {
-    Write_("{} =w call $printf(", FuncScopeTemp{res_num});
-    Write_("l {}, ", user_defined::GlobalPointer{"__builtin_print_format"});
+  if (const auto runtime_func =
+          id_expr ? RuntimeFuncOf(id_expr->id) : std::string_view{};
+      !runtime_func.empty()) {
+    // NOTE: The builtins only read their arguments, so loaded values can still
+    // be reused after the call.
+    Write_("{} =w call {}(", FuncScopeTemp{res_num},
+           user_defined::GlobalPointer{runtime_func});
   } else {
-    // Call the function through its address.
-    Write_("{} =w call {}(", FuncScopeTemp{res_num}, FuncScopeTemp{func_num});
+    // Call the function through its address. A returned record is copied to
+    // the caller, and the result is its address.
+    Write_("{} ={} call {}(", FuncScopeTemp{res_num},
+           AbiTypeOf(*call_expr.type), ctx_->ValueOf(func_num));
+    // The callee may write to any object whose address has escaped, unless
+    // it's known to write none.
+    if (effect == Effect::kSideEffecting) {
+      ctx_->value_table.ClobberMem();
+    }
   }
   // Traverse the argument number along with the argument to get the type.
   for (auto i = size_t{0}, e = arg_nums.size(); i < e; ++i) {
-    if (call_expr.args.at(i)->type->IsPtr()) {
-      Write_("l %.{}", arg_nums.at(i));
-    } else {
-      Write_("w %.{}", arg_nums.at(i));
-    }
+    Write_("{} {}", AbiTypeOf(param_type_of(i)), ctx_->ValueOf(arg_nums.at(i)));
     if (i != e - 1) {
       Write_(", ");
     }
   }
   Write_(")\n");
-  num_recorder.Record(res_num);
+  if (Isa<RecordType>(*call_expr.type)) {
+    ctx_->reg_num_to_id_num[res_num] = res_num;
+  }
+  ctx_->num_recorder.Record(res_num);
 }
 
 void QbeIrGenerator::Visit(const PostfixArithExprNode& postfix_expr) {
@@ -785,137 +1602,139 @@ void QbeIrGenerator::Visit(const PostfixArithExprNode& postfix_expr) {
   // The postfix -- operator is analogous to the postfix ++ operator, except
   // that the value of the operand is decremented (that is, the value 1 of the
   // appropriate type is subtracted from it).
-  postfix_expr.operand->Accept(*this);
-  const int expr_num = num_recorder.NumOfPrevExpr();
-  num_recorder.Record(expr_num);
+  Dispatch(*postfix_expr.operand);
+  const int expr_num = ctx_->num_recorder.NumOfPrevExpr();
+  ctx_->num_recorder.Record(expr_num);
 
-  const int res_num = NextLocalNum();
   const auto arith_op = postfix_expr.op == PostfixOperator::kIncr
                             ? BinaryOperator::kAdd
                             : BinaryOperator::kSub;
 
   // TODO: support pointer arithmetic
-  WriteInstr_("{} =w {} {}, 1", FuncScopeTemp{res_num},
-              GetBinaryOperator(arith_op), FuncScopeTemp{expr_num});
-  const auto* id_expr = dynamic_cast<IdExprNode*>((postfix_expr.operand).get());
+  const auto& type = *postfix_expr.operand->type;
+  const int res_num = WriteIncrOrDecr_(arith_op, expr_num, type);
+  const auto* id_expr = DynCast<IdExprNode>(postfix_expr.operand.get());
   assert(id_expr);
-  WriteInstr_("storew {}, {}", FuncScopeTemp{res_num},
-              FuncScopeTemp{id_to_num.at(id_expr->id)});
+  WriteStore_(StoreOpOf(type), res_num, ctx_->id_to_num.at(id_expr->id));
 }
 
 void QbeIrGenerator::Visit(const RecordMemExprNode& mem_expr) {
-  mem_expr.expr->Accept(*this);
-  const auto num = num_recorder.NumOfPrevExpr();
-  const auto id_num = reg_num_to_id_num.at(num);
-  auto* record_type = dynamic_cast<RecordType*>(mem_expr.expr->type.get());
+  Dispatch(*mem_expr.expr);
+  const auto num = ctx_->num_recorder.NumOfPrevExpr();
+  const auto id_num = ctx_->reg_num_to_id_num.at(num);
+  auto* record_type = DynCast<RecordType>(mem_expr.expr->type.get());
   assert(record_type);
 
-  const auto res_addr_num = NextLocalNum();
-  WriteInstr_("{} =l add {}, {}", FuncScopeTemp{res_addr_num},
-              FuncScopeTemp{id_num}, record_type->OffsetOf(mem_expr.id));
+  const auto res_addr_num = WritePureInstr_(
+      "l", "add",
+      fmt::format("{}, {}", ctx_->ValueOf(id_num),
+                  record_type->OffsetOf(mem_expr.id)));
+  ctx_->value_table.RecordDerivedAddr(res_addr_num, id_num);
 
-  const int res_num = NextLocalNum();
-  WriteInstr_("{} =w loadw {}", FuncScopeTemp{res_num},
-              FuncScopeTemp{res_addr_num});
-  reg_num_to_id_num[res_num] = res_addr_num;
-  num_recorder.Record(res_num);
+  if (IsAggregate(*mem_expr.type)) {
+    ctx_->reg_num_to_id_num[res_addr_num] = res_addr_num;
+    ctx_->num_recorder.Record(res_addr_num);
+    return;
+  }
+  const int res_num = WriteLoad_(BaseTypeOf(*mem_expr.type),
+                                 LoadOpOf(*mem_expr.type), res_addr_num);
+  ctx_->reg_num_to_id_num[res_num] = res_addr_num;
+  ctx_->num_recorder.Record(res_num);
 }
 
 void QbeIrGenerator::Visit(const UnaryExprNode& unary_expr) {
-  unary_expr.operand->Accept(*this);
+  Dispatch(*unary_expr.operand);
   switch (unary_expr.op) {
     case UnaryOperator::kIncr:
     case UnaryOperator::kDecr: {
       // Equivalent to i += 1 or i -= 1.
-      const int expr_num = num_recorder.NumOfPrevExpr();
-      const int res_num = NextLocalNum();
+      const int expr_num = ctx_->num_recorder.NumOfPrevExpr();
       const auto arith_op = unary_expr.op == UnaryOperator::kIncr
                                 ? BinaryOperator::kAdd
                                 : BinaryOperator::kSub;
-      WriteInstr_("{} =w {} {}, 1", FuncScopeTemp{res_num},
-                  GetBinaryOperator(arith_op), FuncScopeTemp{expr_num});
-      const auto* id_expr =
-          dynamic_cast<IdExprNode*>((unary_expr.operand).get());
+      const auto& type = *unary_expr.operand->type;
+      const int res_num = WriteIncrOrDecr_(arith_op, expr_num, type);
+      const auto* id_expr = DynCast<IdExprNode>(unary_expr.operand.get());
       assert(id_expr);
-      WriteInstr_("storew {}, {}", FuncScopeTemp{res_num},
-                  FuncScopeTemp{id_to_num.at(id_expr->id)});
-      num_recorder.Record(res_num);
+      WriteStore_(StoreOpOf(type), res_num, ctx_->id_to_num.at(id_expr->id));
+      ctx_->num_recorder.Record(res_num);
     } break;
     case UnaryOperator::kPos:
       // Do nothing.
       break;
     case UnaryOperator::kNeg: {
-      const int expr_num = num_recorder.NumOfPrevExpr();
-      const int res_num = NextLocalNum();
-      WriteInstr_("{} =w neg {}", FuncScopeTemp{res_num},
-                  FuncScopeTemp{expr_num});
-      num_recorder.Record(res_num);
+      const int expr_num =
+          ConvertTo_(ctx_->num_recorder.NumOfPrevExpr(),
+                     *unary_expr.operand->type, *unary_expr.type);
+      const int res_num =
+          WritePureInstr_(BaseTypeOf(*unary_expr.type), "neg",
+                          fmt::format("{}", ctx_->ValueOf(expr_num)));
+      ctx_->num_recorder.Record(res_num);
     } break;
     case UnaryOperator::kNot: {
       // Is 0 if the value of its operand compares unequal to 0, 1 if the value
       // of its operand compares equal to 0.
       // The expression !E is equivalent to (0 == E).
-      const int expr_num = num_recorder.NumOfPrevExpr();
-      const int res_num = NextLocalNum();
-      WriteInstr_("{} =w {} {}, 0", FuncScopeTemp{res_num},
-                  GetBinaryOperator(BinaryOperator::kEq),
-                  FuncScopeTemp{expr_num});
-      num_recorder.Record(res_num);
+      const int expr_num = ctx_->num_recorder.NumOfPrevExpr();
+      const int res_num = WritePureInstr_(
+          "w",
+          GetBinaryOperator(BinaryOperator::kEq, *unary_expr.operand->type),
+          fmt::format("{}, 0", ctx_->ValueOf(expr_num)));
+      ctx_->num_recorder.Record(res_num);
     } break;
     case UnaryOperator::kBitComp: {
-      const int expr_num = num_recorder.NumOfPrevExpr();
-      const int res_num = NextLocalNum();
+      const int expr_num =
+          ConvertTo_(ctx_->num_recorder.NumOfPrevExpr(),
+                     *unary_expr.operand->type, *unary_expr.type);
       // Exclusive or with all ones to flip the bits.
-      WriteInstr_("{} =w xor {}, -1", FuncScopeTemp{res_num},
-                  FuncScopeTemp{expr_num});
-      num_recorder.Record(res_num);
+      const int res_num =
+          WritePureInstr_(BaseTypeOf(*unary_expr.type), "xor",
+                          fmt::format("{}, -1", ctx_->ValueOf(expr_num)));
+      ctx_->num_recorder.Record(res_num);
     } break;
     case UnaryOperator::kAddr: {
       if (unary_expr.operand->type->IsFunc()) {
         // No-op; the function itself already evaluates to the address.
         break;
       }
-      const auto* id_expr =
-          dynamic_cast<IdExprNode*>((unary_expr.operand).get());
+      const auto* id_expr = DynCast<IdExprNode>(unary_expr.operand.get());
       // NOTE: The operand of the address-of operator must be an lvalue, and we
       // do not support arrays now, so it must have been backed by an id.
       assert(id_expr);
       // The address of the id is the id itself.
-      const int reg_num = num_recorder.NumOfPrevExpr();
-      const int id_num = reg_num_to_id_num.at(reg_num);
+      const int reg_num = ctx_->num_recorder.NumOfPrevExpr();
+      const int id_num = ctx_->reg_num_to_id_num.at(reg_num);
       // Since each expression has to generate a temporary, we need to copy the
       // id to a new temporary, and update the mapping.
-      const int res_num = NextLocalNum();
+      const int res_num = ctx_->NextLocalNum();
       WriteInstr_("{} =l copy {}", FuncScopeTemp{res_num},
                   FuncScopeTemp{id_num});
-      reg_num_to_id_num[res_num] = id_num;
-      num_recorder.Record(res_num);
+      ctx_->value_table.RecordCopy(res_num, id_num);
+      ctx_->reg_num_to_id_num[res_num] = id_num;
+      ctx_->num_recorder.Record(res_num);
     } break;
     case UnaryOperator::kDeref: {
       // Is function pointer.
       if (unary_expr.operand->type->IsPtr() &&
-          dynamic_cast<PtrType*>((unary_expr.operand->type).get())
-              ->base_type()
-              .IsFunc()) {
+          Cast<PtrType>(*unary_expr.operand->type).base_type().IsFunc()) {
         // No-op; the function itself also evaluates to the address.
         break;
       }
 
       // Lhs can use res_num to map to the address, which reg_num currently
       // holds.
-      const int reg_num = num_recorder.NumOfPrevExpr();
-      const int res_num = NextLocalNum();
+      const int reg_num = ctx_->num_recorder.NumOfPrevExpr();
+      if (IsAggregate(*unary_expr.type)) {
+        ctx_->num_recorder.Record(reg_num);
+        ctx_->reg_num_to_id_num[reg_num] = reg_num;
+        break;
+      }
       // The result might yet be another pointer if the operand is a pointer to
       // a pointer.
-      if (unary_expr.type->IsPtr()) {
-        WriteInstr_("{} =l loadl {}", FuncScopeTemp{res_num},
-                    FuncScopeTemp{reg_num});
-      } else {
-        WriteInstr_("{} =w loadw {}", FuncScopeTemp{res_num},
-                    FuncScopeTemp{reg_num});
-      }
-      num_recorder.Record(res_num);
-      reg_num_to_id_num[res_num] = reg_num;
+      const int res_num = WriteLoad_(BaseTypeOf(*unary_expr.type),
+                                     LoadOpOf(*unary_expr.type), reg_num);
+      ctx_->num_recorder.Record(res_num);
+      ctx_->reg_num_to_id_num[res_num] = reg_num;
     } break;
     default:
       break;
@@ -923,19 +1742,51 @@ void QbeIrGenerator::Visit(const UnaryExprNode& unary_expr) {
 }
 
 void QbeIrGenerator::Visit(const BinaryExprNode& bin_expr) {
-  bin_expr.lhs->Accept(*this);
+  if (bin_expr.op == BinaryOperator::kComma && effects_) {
+    GenerateCommaExpr_(bin_expr);
+    return;
+  }
+  VisitLeftChain_(
+      bin_expr, [](const BinaryExprNode&) {},
+      [this](const BinaryExprNode& expr) { GenerateBinaryExpr_(expr); });
+}
+
+void QbeIrGenerator::GenerateCommaExpr_(const BinaryExprNode& bin_expr) {
+  // The operands of a chain of comma operators, in the order of evaluation.
+  auto operands = std::vector<const ExprNode*>{bin_expr.rhs.get()};
+  const auto* comma_expr = &bin_expr;
+  while (const auto* lhs = DynCast<BinaryExprNode>(comma_expr->lhs.get())) {
+    if (lhs->op != BinaryOperator::kComma) {
+      break;
+    }
+    comma_expr = lhs;
+    operands.push_back(comma_expr->rhs.get());
+  }
+  operands.push_back(comma_expr->lhs.get());
+  std::reverse(operands.begin(), operands.end());
+  // The values of all but the last operand are unused.
+  for (auto i = std::size_t{0}, e = operands.size() - 1; i < e; ++i) {
+    if (effects_->EffectOf(*operands.at(i)) == Effect::kSideEffecting) {
+      Dispatch(*operands.at(i));
+    }
+  }
+  Dispatch(*operands.back());
+  ctx_->num_recorder.Record(ctx_->num_recorder.NumOfPrevExpr());
+}
 
+void QbeIrGenerator::GenerateBinaryExpr_(const BinaryExprNode& bin_expr) {
   if (bin_expr.op == BinaryOperator::kComma) {
     // For the comma operator, the value of its left operand is not used and can
     // be eliminated if it has no side effects or if its definition is
-    // immediately dead. However, we leave these optimizations to QBE.
-    bin_expr.rhs->Accept(*this);
-    const int right_num = num_recorder.NumOfPrevExpr();
-    num_recorder.Record(right_num);
+    // immediately dead. Without the effect analysis, we leave these
+    // optimizations to QBE.
+    Dispatch(*bin_expr.rhs);
+    const int right_num = ctx_->num_recorder.NumOfPrevExpr();
+    ctx_->num_recorder.Record(right_num);
     return;
   }
 
-  const int left_num = num_recorder.NumOfPrevExpr();
+  const int left_num = ctx_->num_recorder.NumOfPrevExpr();
   // Due to the lack of direct support for logical operators in QBE, we
   // implement logical expressions using comparison and jump instructions.
   if (bin_expr.op == BinaryOperator::kLand ||
@@ -943,66 +1794,298 @@ void QbeIrGenerator::Visit(const BinaryExprNode& bin_expr) {
     // The && operator shall yield 1 if both of its operands compare unequal to
     // 0; otherwise, it yields 0; The || operator shall yield 1 if either of its
     // operands compare unequal to 0; otherwise, it yields 0.
-    const int label_num = NextLabelNum();
+    const auto site =
+        ctx_->profile_sites ? ctx_->profile_sites->SiteOf(bin_expr) : 0;
+    if (!profile_path_.empty()) {
+      WriteCounterIncr_(site);
+    }
+    const int label_num = ctx_->NextLabelNum();
     auto rhs_label = BlockLabel{"logic_rhs", label_num};
     // Early exit after evaluating the first operand.
     auto short_circuit_label = BlockLabel{"short_circuit", label_num};
     auto end_label = BlockLabel{"logic_end", label_num};
-    const int left_res = NextLocalNum();
+    const int left_res = ctx_->NextLocalNum();
     // NOTE: (&& operator) If the first operand compares equal to 0, the second
     // operand is not evaluated. (|| operator)  If the first operand compares
     // unequal to 0, the second operand is not evaluated.
     WriteInstr_("{} =w {} {}, 0", FuncScopeTemp{left_res},
-                bin_expr.op == BinaryOperator::kLand
-                    ? GetBinaryOperator(BinaryOperator::kNeq)
-                    : GetBinaryOperator(BinaryOperator::kEq),
+                GetBinaryOperator(bin_expr.op == BinaryOperator::kLand
+                                      ? BinaryOperator::kNeq
+                                      : BinaryOperator::kEq,
+                                  *bin_expr.lhs->type),
                 FuncScopeTemp{left_num});
     WriteInstr_("jnz {}, {}, {}", FuncScopeTemp{left_res}, rhs_label,
                 short_circuit_label);
-    WriteLabel_(rhs_label);
-    const int res_num = NextLocalNum();
-    bin_expr.rhs->Accept(*this);
-    const int right_num = num_recorder.NumOfPrevExpr();
-    WriteInstr_("{} =w {} {}, 0", FuncScopeTemp{res_num},
-                GetBinaryOperator(BinaryOperator::kNeq),
-                FuncScopeTemp{right_num});
-    WriteInstr_("jmp {}", end_label);
-    WriteLabel_(short_circuit_label);
-    WriteInstr_("{} =w copy {}", FuncScopeTemp{res_num},
-                bin_expr.op == BinaryOperator::kLand ? 0 : 1);
+    const int res_num = ctx_->NextLocalNum();
+    // Each block jumps to the end, unless it's placed right before it.
+    const auto write_rhs = [&](bool is_last) {
+      WriteLabel_(rhs_label);
+      if (!profile_path_.empty()) {
+        WriteCounterIncr_(site + 1);
+      }
+      Dispatch(*bin_expr.rhs);
+      const int right_num = ctx_->num_recorder.NumOfPrevExpr();
+      WriteInstr_("{} =w {} {}, 0", FuncScopeTemp{res_num},
+                  GetBinaryOperator(BinaryOperator::kNeq, *bin_expr.rhs->type),
+                  FuncScopeTemp{right_num});
+      if (!is_last) {
+        WriteInstr_("jmp {}", end_label);
+      }
+    };
+    const auto write_short_circuit = [&](bool is_last) {
+      WriteLabel_(short_circuit_label);
+      WriteInstr_("{} =w copy {}", FuncScopeTemp{res_num},
+                  bin_expr.op == BinaryOperator::kLand ? 0 : 1);
+      if (!is_last) {
+        WriteInstr_("jmp {}", end_label);
+      }
+    };
+    // With a profile, the right operand and the short circuit are laid out as
+    // the arms of an if statement, except that the short circuit, which is
+    // only a copy, is never placed first.
+    const auto layout = ctx_->profile_counts
+                            ? ArmLayoutByProfile(*ctx_->profile_counts, site,
+                                                 /* has_second_arm */ true)
+                            : ArmLayout{};
+    if (layout.is_first_cold) {
+      WriteColdBlocks_([&] { write_rhs(/* is_last */ false); });
+      write_short_circuit(/* is_last */ true);
+    } else if (layout.is_second_cold) {
+      write_rhs(/* is_last */ true);
+      WriteColdBlocks_([&] { write_short_circuit(/* is_last */ false); });
+    } else {
+      write_rhs(/* is_last */ false);
+      write_short_circuit(/* is_last */ true);
+    }
     WriteLabel_(end_label);
-    num_recorder.Record(res_num);
+    ctx_->num_recorder.Record(res_num);
   } else {
-    const int num = NextLocalNum();
-    // TODO: use the correct instruction for specific data type:
-    // 1. signed or unsigned: currently only supports signed integers.
-    // 2. QBE base data type 'w' | 'l' | 's' | 'd': currently only supports
-    // 'w'.
-    bin_expr.rhs->Accept(*this);
-    const int right_num = num_recorder.NumOfPrevExpr();
-    WriteInstr_("{} =w {} {}, {}", FuncScopeTemp{num},
-                GetBinaryOperator(bin_expr.op), FuncScopeTemp{left_num},
-                FuncScopeTemp{right_num});
-    num_recorder.Record(num);
+    Dispatch(*bin_expr.rhs);
+    const int right_num = ctx_->num_recorder.NumOfPrevExpr();
+    // The operands are converted to a common type, except that the shift
+    // amount is always a word.
+    const auto operand_type = OperandTypeOf(bin_expr);
+    const auto is_shift = bin_expr.op == BinaryOperator::kShl ||
+                          bin_expr.op == BinaryOperator::kShr;
+    const int lhs_num =
+        ConvertTo_(left_num, *bin_expr.lhs->type, *operand_type);
+    const int rhs_num =
+        ConvertTo_(right_num, *bin_expr.rhs->type,
+                   is_shift ? static_cast<const Type&>(kPromotedType)
+                            : *operand_type);
+    const int num = WritePureInstr_(
+        BaseTypeOf(*bin_expr.type),
+        GetBinaryOperator(bin_expr.op, *operand_type),
+        fmt::format("{}, {}", ctx_->ValueOf(lhs_num), ctx_->ValueOf(rhs_num)));
+    ctx_->num_recorder.Record(num);
   }
 }
 
 void QbeIrGenerator::Visit(const SimpleAssignmentExprNode& assign_expr) {
-  assign_expr.lhs->Accept(*this);
-  int lhs_num = num_recorder.NumOfPrevExpr();
-  assign_expr.rhs->Accept(*this);
-  int rhs_num = num_recorder.NumOfPrevExpr();
-  if (assign_expr.lhs->type->IsPtr()) {
-    // Assign pointer address to another pointer.
-    WriteInstr_("storel {}, {}", FuncScopeTemp{rhs_num},
-                FuncScopeTemp{reg_num_to_id_num.at(lhs_num)});
+  Dispatch(*assign_expr.lhs);
+  int lhs_num = ctx_->num_recorder.NumOfPrevExpr();
+  Dispatch(*assign_expr.rhs);
+  int rhs_num = ctx_->num_recorder.NumOfPrevExpr();
+  if (Isa<RecordType>(*assign_expr.lhs->type)) {
+    // The value of the assignment is the assigned record.
+    const auto lhs_addr = ctx_->reg_num_to_id_num.at(lhs_num);
+    WriteBlit_(rhs_num, lhs_addr, assign_expr.lhs->type->size());
+    ctx_->num_recorder.Record(lhs_addr);
+    return;
+  }
+  // The value of the assignment is that of the left operand after the
+  // assignment, i.e., converted to its type.
+  const auto& lhs_type = *assign_expr.lhs->type;
+  const int val_num = ConvertTo_(rhs_num, *assign_expr.rhs->type, lhs_type);
+  WriteStore_(StoreOpOf(lhs_type), val_num,
+              ctx_->reg_num_to_id_num.at(lhs_num));
+  ctx_->num_recorder.Record(val_num);
+}
+
+void QbeIrGenerator::WriteLabel_(const user_defined::BlockLabel& label) {
+  Write_("{}\n", label);
+  ctx_->value_table.Clear();
+}
+
+void QbeIrGenerator::WriteLabel_(const BlockLabel& label) {
+  Write_("{}\n", label);
+  ctx_->value_table.Clear();
+}
+
+int QbeIrGenerator::WritePureInstr_(std::string_view type, std::string_view op,
+                                    const std::string& operands) {
+  const int num = ctx_->NextLocalNum();
+  auto key = fmt::format("{} {} {}", type, op, operands);
+  if (auto prev_num = ctx_->value_table.LookUpExpr(key)) {
+    // NOTE: Copy to a new temporary instead of reusing the previous one, so
+    // that each expression still owns its temporary. QBE eliminates the copy.
+    WriteInstr_("{} ={} copy {}", FuncScopeTemp{num}, type,
+                FuncScopeTemp{*prev_num});
+    ctx_->value_table.RecordCopy(num, *prev_num);
+  } else {
+    WriteInstr_("{} ={} {} {}", FuncScopeTemp{num}, type, op, operands);
+    ctx_->value_table.RecordExpr(std::move(key), num);
+  }
+  return num;
+}
+
+int QbeIrGenerator::WriteLoad_(std::string_view type, std::string_view load_op,
+                               int addr_num) {
+  const int num = ctx_->NextLocalNum();
+  const auto width = WidthOf(load_op);
+  if (auto prev_num = ctx_->value_table.LookUpMem(addr_num, width)) {
+    WriteInstr_("{} ={} copy {}", FuncScopeTemp{num}, type,
+                ctx_->ValueOf(*prev_num));
+    ctx_->value_table.RecordCopy(num, *prev_num);
   } else {
-    WriteInstr_("storew {}, {}", FuncScopeTemp{rhs_num},
-                FuncScopeTemp{reg_num_to_id_num.at(lhs_num)});
+    WriteInstr_("{} ={} {} {}", FuncScopeTemp{num}, type, load_op,
+                ctx_->ValueOf(addr_num));
+    ctx_->value_table.RecordLoad(addr_num, num, width);
+  }
+  return num;
+}
+
+void QbeIrGenerator::WriteStore_(std::string_view store_op, int val_num,
+                                 int addr_num) {
+  WriteInstr_("{} {}, {}", store_op, ctx_->ValueOf(val_num),
+              ctx_->ValueOf(addr_num));
+  ctx_->value_table.RecordStore(addr_num, val_num, WidthOf(store_op));
+}
+
+void QbeIrGenerator::WriteBlit_(int src_addr_num, int dst_addr_num,
+                                std::size_t size) {
+  WriteInstr_("blit {}, {}, {}", ctx_->ValueOf(src_addr_num),
+              ctx_->ValueOf(dst_addr_num), size);
+  ctx_->value_table.RecordStore(dst_addr_num, std::nullopt, WidthOf("storew"));
+}
+
+int QbeIrGenerator::ConvertTo_(int num, const Type& from, const Type& to) {
+  const auto* from_prim = DynCast<PrimType>(&from);
+  if (!from_prim || !from_prim->IsInteger()) {
+    // Pointers are truncated implicitly when used as words.
+    return num;
+  }
+  const auto* to_prim = DynCast<PrimType>(&to);
+  if (!to.IsPtr() && (!to_prim || !to_prim->IsInteger())) {
+    return num;
+  }
+  if (BaseTypeOf(from) == "w" && BaseTypeOf(to) == "l") {
+    return WritePureInstr_("l", from_prim->IsUnsigned() ? "extuw" : "extsw",
+                           fmt::format("{}", ctx_->ValueOf(num)));
+  }
+  // A long is truncated implicitly when used as a word, so only the integers
+  // narrower than a word are to be extended again.
+  if (!to_prim || to_prim->size() >= 4) {
+    return num;
+  }
+  const auto is_to_unsigned = to_prim->IsUnsigned();
+  const auto is_value_preserved =
+      from_prim->size() < to_prim->size()
+          ? from_prim->IsUnsigned() || !is_to_unsigned
+          : from_prim->size() == to_prim->size() &&
+                from_prim->IsUnsigned() == is_to_unsigned;
+  if (is_value_preserved) {
+    return num;
+  }
+  return WritePureInstr_(
+      "w",
+      fmt::format("ext{}{}", is_to_unsigned ? 'u' : 's',
+                  to_prim->size() == 1 ? 'b' : 'h'),
+      fmt::format("{}", ctx_->ValueOf(num)));
+}
+
+int QbeIrGenerator::ConvertForStore_(int num, const Type& from,
+                                     const Type& to) {
+  return BaseTypeOf(to) == "l" ? ConvertTo_(num, from, to) : num;
+}
+
+int QbeIrGenerator::WriteIncrOrDecr_(BinaryOperator op, int num,
+                                     const Type& type) {
+  const int res_num =
+      WritePureInstr_(BaseTypeOf(type), GetBinaryOperator(op, type),
+                      fmt::format("{}, 1", ctx_->ValueOf(num)));
+  // The narrower integers are promoted, and wrap around to their own type.
+  return type.size() < 4 ? ConvertTo_(res_num, kPromotedType, type) : res_num;
+}
+
+void QbeIrGenerator::WriteCounterIncr_(std::size_t site) {
+  // The counters are never accessed by the program itself, so the values of
+  // the block are kept.
+  const auto addr_num = ctx_->NextLocalNum();
+  WriteInstr_("{} =l add {}, {}", FuncScopeTemp{addr_num},
+              CountersOf(ctx_->func_id), site * 8);
+  const auto count_num = ctx_->NextLocalNum();
+  WriteInstr_("{} =l loadl {}", FuncScopeTemp{count_num},
+              FuncScopeTemp{addr_num});
+  const auto incr_num = ctx_->NextLocalNum();
+  WriteInstr_("{} =l add {}, 1", FuncScopeTemp{incr_num},
+              FuncScopeTemp{count_num});
+  WriteInstr_("storel {}, {}", FuncScopeTemp{incr_num},
+              FuncScopeTemp{addr_num});
+}
+
+void QbeIrGenerator::WriteBackEdge_(const BlockLabel& back_label,
+                                    std::size_t site,
+                                    const BlockLabel& body_label) {
+  WriteLabel_(back_label);
+  WriteCounterIncr_(site);
+  WriteInstr_("jmp {}", body_label);
+}
+
+template <typename Write>
+void QbeIrGenerator::WriteColdBlocks_(Write&& write) {
+  // The cold blocks nested in cold blocks are already out of line.
+  if (ctx_->is_writing_cold_blocks) {
+    write();
+    return;
+  }
+  ctx_->is_writing_cold_blocks = true;
+  write();
+  ctx_->is_writing_cold_blocks = false;
+}
+
+void QbeIrGenerator::WriteProfileTable_(const TransUnitNode& trans_unit) {
+  auto funcs = std::string{};
+  for (const auto& extern_decl : trans_unit.extern_decls) {
+    const auto* func_def =
+        std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl);
+    if (!func_def || !(*func_def)->body) {
+      continue;
+    }
+    const auto& id = (*func_def)->id;
+    const auto name = user_defined::GlobalPointer{
+        fmt::format("__vitaminc_profile_name.{}", id)};
+    Write_("data {} = {{ b \"{}\", b 0 }}\n", name, id);
+    funcs += fmt::format("l {}, l {}, l {}, ", CountersOf(id),
+                         ProfileSites{**func_def}.size(), name);
+  }
+  Write_("data {} = {{ {}l 0 }}\n",
+         user_defined::GlobalPointer{kProfileFuncsName}, funcs);
+  // The path is written byte by byte, so that nothing in it has to be escaped.
+  auto path = std::string{};
+  for (const auto c : profile_path_) {
+    path += fmt::format("b {}, ", static_cast<unsigned char>(c));
   }
-  num_recorder.Record(rhs_num);
+  Write_("data {} = {{ {}b 0 }}\n",
+         user_defined::GlobalPointer{kProfilePathName}, path);
 }
 
 void QbeIrGenerator::VWrite_(fmt::string_view format, fmt::format_args args) {
-  fmt::vprint(output_, format, args);
+  // Out of top-level declarations, e.g., the table of the profile, nothing is
+  // cold.
+  const auto is_cold = ctx_ && ctx_->is_writing_cold_blocks;
+  if (!profiler() && !is_cold) {
+    fmt::vprint(output_, format, args);
+    return;
+  }
+  auto buffer = fmt::memory_buffer{};
+  fmt::vformat_to(std::back_inserter(buffer), format, args);
+  if (is_cold) {
+    ctx_->cold_blocks.append(buffer.data(), buffer.size());
+  } else {
+    output_.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  }
+  if (profiler()) {
+    VisitProfiler::CountBytes(buffer.size());
+  }
 }
@@ -1,7 +1,11 @@
 #include "scope.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -22,6 +26,15 @@ void ScopeStack::PushScope(ScopeKind kind) {
 void ScopeStack::PopScope() {
   ThrowIfNotInScope_();
   scopes_.pop_back();
+  // The index of the popped scope is the last one, if it has any entry.
+  if (!scopes_with_symbols_.empty() &&
+      scopes_with_symbols_.back() == scopes_.size()) {
+    scopes_with_symbols_.pop_back();
+  }
+  if (!scopes_with_types_.empty() &&
+      scopes_with_types_.back() == scopes_.size()) {
+    scopes_with_types_.pop_back();
+  }
 }
 
 ScopeKind ScopeStack::CurrentScopeKind() {
@@ -29,6 +42,12 @@ ScopeKind ScopeStack::CurrentScopeKind() {
   return scopes_.back().kind;
 }
 
+ScopeStack::Mark ScopeStack::MarkOfTopScope() const {
+  ThrowIfNotInScope_();
+  return {scopes_.back().symbol_table->NumOfEntries(),
+          scopes_.back().type_table->NumOfEntries()};
+}
+
 void ScopeStack::MergeWithNextScope() {
   ThrowIfNotInScope_();
   should_merge_with_next_scope_ = true;
@@ -41,7 +60,19 @@ std::shared_ptr<Entry> ScopeStack::AddEntry_(
   ThrowIfNotInScope_();
   for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
     if (it->kind == kind) {
-      return ((*it).*table)->Add(std::move(entry));
+      auto& entries = (*it).*table;
+      if (entries->NumOfEntries() == 0) {
+        // The scope may be below others, e.g., the one of a function for a
+        // label in a block.
+        auto& scopes_with_entries = ScopesWithEntries_<Entry>(*this);
+        const auto index =
+            static_cast<std::size_t>(scopes_.rend() - it) - std::size_t{1};
+        scopes_with_entries.insert(
+            std::lower_bound(scopes_with_entries.begin(),
+                             scopes_with_entries.end(), index),
+            index);
+      }
+      return entries->Add(std::move(entry));
     }
   }
   throw NotInSuchKindOfScopeError{""};
@@ -50,14 +81,30 @@ std::shared_ptr<Entry> ScopeStack::AddEntry_(
 template <typename Entry>
 std::shared_ptr<Entry> ScopeStack::LookUpEntry_(
     const std::string& id,
-    std::unique_ptr<TableTemplate<Entry>> Scope::*table) const {
+    std::unique_ptr<TableTemplate<Entry>> Scope::*table,
+    std::optional<std::size_t> num_of_visible_entries) const {
   ThrowIfNotInScope_();
   // Iterates backward since we're using the container as a stack.
-  for (auto it = scopes_.crbegin(); it != scopes_.crend(); ++it) {
-    if (auto entry = ((*it).*table)->Probe(id)) {
+  const auto& scopes_with_entries = ScopesWithEntries_<Entry>(*this);
+  for (auto it = scopes_with_entries.crbegin();
+       it != scopes_with_entries.crend(); ++it) {
+    const auto& entries = scopes_[*it].*table;
+    const auto is_top_most = *it == scopes_.size() - 1;
+    if (auto entry = is_top_most && num_of_visible_entries
+                         ? entries->ProbeFirst(id, *num_of_visible_entries)
+                         : entries->Probe(id)) {
       return entry;
     }
   }
+  if (enclosing_) {
+    if constexpr (std::is_same_v<Entry, SymbolEntry>) {
+      return enclosing_->LookUpEntry_<Entry>(
+          id, table, mark_of_enclosing_.num_of_symbols);
+    } else {
+      return enclosing_->LookUpEntry_<Entry>(id, table,
+                                             mark_of_enclosing_.num_of_types);
+    }
+  }
   return nullptr;
 }
 
@@ -0,0 +1,110 @@
+#include "stack_segment.hpp"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <new>
+
+namespace {
+
+/// @brief The room kept at the end of a stack for the calls made in between
+/// two checks, e.g., the writing of the IR of a node.
+constexpr auto kRedZoneSize = std::size_t{256} * 1024;
+constexpr auto kSegmentSize = std::size_t{4} * 1024 * 1024;
+/// @brief The size of stack assumed to be left below the first check of a
+/// thread whose stack can't be looked up; every platform provides at least
+/// this much to its threads.
+constexpr auto kAssumedStackSize = std::size_t{512} * 1024;
+
+/// @brief The lowest address that the stack in use may grow to before a new
+/// segment is needed; `0` if not looked up yet.
+/// @note The stack grows downwards on every platform that we target.
+thread_local auto
+    stack_limit  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::uintptr_t{0};
+
+/// @brief The call to run on the segment that is being switched to.
+struct SegmentCall {
+  const std::function<void()>* func;
+  std::exception_ptr exception;
+  ucontext_t caller;
+};
+
+thread_local SegmentCall*
+    segment_call  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = nullptr;
+
+std::uintptr_t CurrentStackAddress() noexcept {
+  // The address of a local is on the current stack.
+  auto local = char{};
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  return reinterpret_cast<std::uintptr_t>(&local);
+}
+
+std::uintptr_t LimitOfThreadStack() noexcept {
+#ifdef __GLIBC__
+  auto attr = pthread_attr_t{};
+  if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+    void* addr = nullptr;
+    auto size = std::size_t{0};
+    const auto has_stack = pthread_attr_getstack(&attr, &addr, &size) == 0;
+    pthread_attr_destroy(&attr);
+    if (has_stack) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+      return reinterpret_cast<std::uintptr_t>(addr) + kRedZoneSize;
+    }
+  }
+#endif
+  return CurrentStackAddress() - kAssumedStackSize + kRedZoneSize;
+}
+
+/// @brief The entry of a segment; returning from it resumes the caller.
+void RunSegmentCall() {
+  auto* call = segment_call;
+  // Exceptions can't be unwound across segments, so they're carried over.
+  try {
+    (*call->func)();
+  } catch (...) {
+    call->exception = std::current_exception();
+  }
+}
+
+}  // namespace
+
+bool HasSufficientStack() noexcept {
+  if (stack_limit == 0) {
+    stack_limit = LimitOfThreadStack();
+  }
+  return CurrentStackAddress() > stack_limit;
+}
+
+void RunOnNewStackSegment(const std::function<void()>& func) {
+  auto* segment = mmap(nullptr, kSegmentSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (segment == MAP_FAILED) {
+    throw std::bad_alloc{};
+  }
+  auto call = SegmentCall{&func, nullptr, {}};
+  auto callee = ucontext_t{};
+  getcontext(&callee);
+  callee.uc_stack.ss_sp = segment;
+  callee.uc_stack.ss_size = kSegmentSize;
+  callee.uc_link = &call.caller;
+  makecontext(&callee, RunSegmentCall, 0);
+
+  const auto caller_limit = stack_limit;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  stack_limit = reinterpret_cast<std::uintptr_t>(segment) + kRedZoneSize;
+  segment_call = &call;
+  swapcontext(&call.caller, &callee);
+  stack_limit = caller_limit;
+  munmap(segment, kSegmentSize);
+  if (call.exception) {
+    std::rethrow_exception(call.exception);
+  }
+}
@@ -1,5 +1,6 @@
 #include "symbol.hpp"
 
+#include <cstddef>
 #include <map>
 #include <memory>
 #include <string>
@@ -9,16 +10,27 @@ template <typename Entry>
 std::shared_ptr<Entry> TableTemplate<Entry>::Add(std::unique_ptr<Entry> entry) {
   const std::string& id = entry->id;  // to reference id after moved
   if (!Probe(id)) {
-    entries_.insert({id, std::shared_ptr<Entry>{std::move(entry)}});
+    const auto order = entries_.size();
+    entries_.insert({id, {std::shared_ptr<Entry>{std::move(entry)}, order}});
   }
-  return entries_.at(id);
+  return entries_.at(id).first;
 }
 
 template <typename Entry>
 std::shared_ptr<Entry> TableTemplate<Entry>::Probe(
     const std::string& id) const {
   if (entries_.count(id)) {
-    return entries_.at(id);
+    return entries_.at(id).first;
+  }
+  return nullptr;
+}
+
+template <typename Entry>
+std::shared_ptr<Entry> TableTemplate<Entry>::ProbeFirst(
+    const std::string& id, std::size_t num_of_entries) const {
+  if (auto it = entries_.find(id);
+      it != entries_.cend() && it->second.second < num_of_entries) {
+    return it->second.first;
   }
   return nullptr;
 }
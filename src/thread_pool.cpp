@@ -0,0 +1,91 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+ThreadPool::ThreadPool(std::size_t num_of_workers) {
+  if (num_of_workers == 0) {
+    num_of_workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (auto i = std::size_t{0}; i < num_of_workers; ++i) {
+    queues_.push_back(std::make_unique<TaskQueue>());
+  }
+  for (auto i = std::size_t{0}; i < num_of_workers; ++i) {
+    workers_.emplace_back([this, i] { RunWorker_(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    auto lock = std::lock_guard{mutex_};
+    is_stopping_ = true;
+  }
+  has_pending_task_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task) {
+  auto packaged_task = Task{std::move(task)};
+  auto future = packaged_task.get_future();
+  auto& queue = *queues_.at(next_queue_++ % queues_.size());
+  {
+    // The task is counted before it's visible to the workers; otherwise, one
+    // may pop it and decrement the count first, which then wraps around.
+    auto lock = std::lock_guard{mutex_};
+    ++num_of_pending_tasks_;
+    auto queue_lock = std::lock_guard{queue.mutex};
+    queue.tasks.push_back(std::move(packaged_task));
+  }
+  has_pending_task_.notify_one();
+  return future;
+}
+
+void ThreadPool::RunWorker_(std::size_t index) {
+  while (true) {
+    if (auto task = PopTask_(index)) {
+      (*task)();
+      continue;
+    }
+    auto lock = std::unique_lock{mutex_};
+    has_pending_task_.wait(
+        lock, [this] { return num_of_pending_tasks_ > 0 || is_stopping_; });
+    // Pending tasks are drained before stopping.
+    if (is_stopping_ && num_of_pending_tasks_ == 0) {
+      return;
+    }
+  }
+}
+
+std::optional<ThreadPool::Task> ThreadPool::PopTask_(std::size_t index) {
+  auto task = std::optional<Task>{};
+  for (auto i = std::size_t{0}, e = queues_.size(); i < e && !task; ++i) {
+    auto& queue = *queues_.at((index + i) % e);
+    auto lock = std::lock_guard{queue.mutex};
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    // The owner takes the most recently submitted task while the thieves take
+    // the oldest one, so that they rarely contend for the same end.
+    if (i == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+  }
+  if (task) {
+    auto lock = std::lock_guard{mutex_};
+    --num_of_pending_tasks_;
+  }
+  return task;
+}
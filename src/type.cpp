@@ -10,12 +10,66 @@
 #include <utility>
 #include <vector>
 
+#include "casting.hpp"
+
+bool IsUnsigned(PrimitiveType prim_type) noexcept {
+  switch (prim_type) {
+    case PrimitiveType::kUChar:
+    case PrimitiveType::kUShort:
+    case PrimitiveType::kUInt:
+    case PrimitiveType::kULong:
+      return true;
+    default:
+      return false;
+  }
+}
+
+PrimitiveType IntegerTypeOf(std::size_t size, bool is_unsigned) noexcept {
+  switch (size) {
+    case 1:
+      return is_unsigned ? PrimitiveType::kUChar : PrimitiveType::kChar;
+    case 2:
+      return is_unsigned ? PrimitiveType::kUShort : PrimitiveType::kShort;
+    case 4:
+      return is_unsigned ? PrimitiveType::kUInt : PrimitiveType::kInt;
+    default:
+      return is_unsigned ? PrimitiveType::kULong : PrimitiveType::kLong;
+  }
+}
+
+PrimitiveType Promote(PrimitiveType prim_type) noexcept {
+  if (prim_type == PrimitiveType::kUnknown) {
+    return prim_type;
+  }
+  // Every value of the narrower types is representable by `int`.
+  const auto size = PrimType{prim_type}.size();
+  return size < 4 ? PrimitiveType::kInt : prim_type;
+}
+
+PrimitiveType CommonTypeOf(PrimitiveType lhs, PrimitiveType rhs) noexcept {
+  if (lhs == PrimitiveType::kUnknown || rhs == PrimitiveType::kUnknown) {
+    return PrimitiveType::kUnknown;
+  }
+  lhs = Promote(lhs);
+  rhs = Promote(rhs);
+  const auto lhs_size = PrimType{lhs}.size();
+  const auto rhs_size = PrimType{rhs}.size();
+  // The rank of an integer type follows its size. The type of the greater
+  // rank is the common type, unless only the other is unsigned and of the same
+  // rank, in which case the unsigned one is; a signed type of a greater rank
+  // always represents every value of an unsigned type of a lesser rank here.
+  if (lhs_size != rhs_size) {
+    return lhs_size > rhs_size ? lhs : rhs;
+  }
+  return IntegerTypeOf(lhs_size, IsUnsigned(lhs) || IsUnsigned(rhs));
+}
+
 bool Type::IsEqual(PrimitiveType that) const noexcept {
   return IsEqual(PrimType{that});
 }
 
 bool PrimType::IsEqual(const Type& that) const noexcept {
-  if (const auto* that_prim = dynamic_cast<const PrimType*>(&that)) {
+  if (const auto* that_prim = DynCast<PrimType>(&that)) {
     return that_prim->prim_type_ == prim_type_;
   }
   return false;
@@ -23,16 +77,44 @@ bool PrimType::IsEqual(const Type& that) const noexcept {
 
 std::size_t PrimType::size() const {
   switch (prim_type_) {
+    case PrimitiveType::kChar:
+    case PrimitiveType::kUChar:
+      return 1;
+    case PrimitiveType::kShort:
+    case PrimitiveType::kUShort:
+      return 2;
+    case PrimitiveType::kLong:
+    case PrimitiveType::kULong:
+      return 8;  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
     case PrimitiveType::kInt:
+    case PrimitiveType::kUInt:
     default:
       return 4;
   }
 }
 
+std::size_t PrimType::alignment() const {
+  return size();
+}
+
 std::string PrimType::ToString() const {
   switch (prim_type_) {
     case PrimitiveType::kInt:
       return "int";
+    case PrimitiveType::kChar:
+      return "char";
+    case PrimitiveType::kShort:
+      return "short";
+    case PrimitiveType::kLong:
+      return "long";
+    case PrimitiveType::kUChar:
+      return "unsigned char";
+    case PrimitiveType::kUShort:
+      return "unsigned short";
+    case PrimitiveType::kUInt:
+      return "unsigned int";
+    case PrimitiveType::kULong:
+      return "unsigned long";
     default:
       return "unknown";
   }
@@ -42,8 +124,15 @@ std::unique_ptr<Type> PrimType::Clone() const {
   return std::make_unique<PrimType>(prim_type_);
 }
 
+bool PrimType::ConvertibleHook_(const Type& that) const noexcept {
+  if (const auto* that_prim = DynCast<PrimType>(&that)) {
+    return IsInteger() && that_prim->IsInteger();
+  }
+  return false;
+}
+
 bool PtrType::IsEqual(const Type& that) const noexcept {
-  if (const auto* that_ptr = dynamic_cast<const PtrType*>(&that)) {
+  if (const auto* that_ptr = DynCast<PtrType>(&that)) {
     return that_ptr->base_type_->IsEqual(*base_type_);
   }
   return false;
@@ -53,10 +142,14 @@ std::size_t PtrType::size() const {
   return 8;  // NOLINT(cppcoreguidelines-avoid-magic-numbers)
 }
 
+std::size_t PtrType::alignment() const {
+  return size();
+}
+
 std::string PtrType::ToString() const {
   // For function pointer types, the '*' is placed between the return type and
   // the parameter list.
-  if (const auto* base_func = dynamic_cast<const FuncType*>(base_type_.get())) {
+  if (const auto* base_func = DynCast<FuncType>(base_type_.get())) {
     auto str = base_func->return_type().ToString() + " (*)(";
     for (auto i = std::size_t{0}, e = base_func->param_types().size(); i < e;
          ++i) {
@@ -76,7 +169,7 @@ std::unique_ptr<Type> PtrType::Clone() const {
 }
 
 bool ArrType::IsEqual(const Type& that) const noexcept {
-  if (const auto* that_arr = dynamic_cast<const ArrType*>(&that)) {
+  if (const auto* that_arr = DynCast<ArrType>(&that)) {
     // For two array types to be compatible, both shall have compatible element
     // types, and if both size specifiers are present, and are integer constant
     // expressions, then both size specifiers shall have the same constant
@@ -92,6 +185,10 @@ std::size_t ArrType::size() const {
   return element_type_->size() * len_;
 }
 
+std::size_t ArrType::alignment() const {
+  return element_type_->alignment();
+}
+
 std::string ArrType::ToString() const {
   return element_type_->ToString() + "[" + std::to_string(len_) + "]";
 }
@@ -105,7 +202,7 @@ std::size_t ArrType::len() const {
 }
 
 bool FuncType::IsEqual(const Type& that) const noexcept {
-  if (const auto* that_func = dynamic_cast<const FuncType*>(&that)) {
+  if (const auto* that_func = DynCast<FuncType>(&that)) {
     if (that_func->param_types_.size() != param_types_.size()) {
       return false;
     }
@@ -124,7 +221,7 @@ bool FuncType::IsEqual(const Type& that) const noexcept {
 
 bool FuncType::ConvertibleHook_(const Type& that) const noexcept {
   // A function type can be implicitly converted to a pointer to the function.
-  if (const auto* that_ptr = dynamic_cast<const PtrType*>(&that)) {
+  if (const auto* that_ptr = DynCast<PtrType>(&that)) {
     return this->IsConvertibleTo(that_ptr->base_type());
   }
   return false;
@@ -135,6 +232,10 @@ std::size_t FuncType::size() const {
   return pointer_size;
 }
 
+std::size_t FuncType::alignment() const {
+  return size();
+}
+
 std::string FuncType::ToString() const {
   auto str = return_type_->ToString() + " (";
   for (auto i = std::size_t{0}, e = param_types_.size(); i < e; ++i) {
@@ -157,67 +258,84 @@ std::unique_ptr<Type> FuncType::Clone() const {
                                     std::move(cloned_param_types));
 }
 
-std::string StructType::id() const noexcept {
-  return id_;
+namespace {
+
+/// @return `offset` rounded up to a multiple of `alignment`.
+std::size_t AlignTo(std::size_t offset, std::size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
 }
 
-bool StructType::IsMember(const std::string& id) const noexcept {
-  for (const auto& field : fields_) {
-    if (field->id == id) {
-      return true;
-    }
-  }
+/// @brief The type of the members that are not found.
+const auto
+    kUnknownType  // NOLINT(cert-err58-cpp): PrimType doesn't throw.
+    = PrimType{PrimitiveType::kUnknown};
 
-  return false;
-}
+}  // namespace
 
-std::unique_ptr<Type> StructType::MemberType(
-    const std::string& id) const noexcept {
-  for (const auto& field : fields_) {
-    if (field->id == id) {
-      return field->type->Clone();
+RecordLayout::RecordLayout(const std::vector<std::unique_ptr<Field>>& fields,
+                           bool is_union)
+    : size{0}, alignment{1} {
+  offsets.reserve(fields.size());
+  indices.reserve(fields.size());
+  for (auto i = std::size_t{0}, e = fields.size(); i < e; ++i) {
+    const auto& type = *fields.at(i)->type;
+    alignment = std::max(alignment, type.alignment());
+    if (is_union) {
+      offsets.push_back(0);
+      size = std::max(size, type.size());
+    } else {
+      offsets.push_back(AlignTo(size, type.alignment()));
+      size = offsets.back() + type.size();
     }
+    // The first member wins if ids collide, which the type checker reports.
+    indices.emplace(fields.at(i)->id, i);
   }
+  // The tail padding makes each element of an array of records aligned.
+  size = AlignTo(size, alignment);
+}
 
-  return std::make_unique<PrimType>(PrimitiveType::kUnknown);
+std::string StructType::id() const noexcept {
+  return id_;
 }
 
-std::size_t StructType::OffsetOf(const std::string& id) const {
-  std::size_t offset = 0;
-  for (auto i = std::size_t{0}, e = fields_.size(); i < e; ++i) {
-    const auto& field = fields_.at(i);
-    if (field->id == id) {
-      return offset;
-    }
+bool StructType::IsMember(const std::string& id) const noexcept {
+  return layout_->indices.count(id) != 0;
+}
 
-    offset += field->type->size();
+const Type& StructType::MemberType(const std::string& id) const noexcept {
+  if (auto it = layout_->indices.find(id); it != layout_->indices.cend()) {
+    return *fields_->at(it->second)->type;
   }
+  return kUnknownType;
+}
 
+std::size_t StructType::OffsetOf(const std::string& id) const {
+  if (auto it = layout_->indices.find(id); it != layout_->indices.cend()) {
+    return layout_->offsets.at(it->second);
+  }
   throw std::runtime_error{"member not found in struct!"};
 }
 
 std::size_t StructType::OffsetOf(const std::size_t index) const {
-  if (index >= fields_.size()) {
+  if (index >= fields_->size()) {
     throw std::out_of_range{"index out of bound!"};
   }
-
-  auto end = std::next(fields_.cbegin(), (long)index);
-  return std::accumulate(
-      fields_.cbegin(), end, std::size_t{0},
-      [](auto&& size, auto&& field) { return size + field->type->size(); });
+  return layout_->offsets.at(index);
 }
 
 std::size_t StructType::SlotCount() const noexcept {
-  return fields_.size();
+  return fields_->size();
 }
 
 bool StructType::IsEqual(const Type& that) const noexcept {
-  if (const auto* that_struct = dynamic_cast<const StructType*>(&that)) {
-    if (that_struct->size() != size()) {
+  if (const auto* that_struct = DynCast<StructType>(&that)) {
+    if (that_struct->size() != size() ||
+        that_struct->fields_->size() != fields_->size()) {
       return false;
     }
-    for (auto i = std::size_t{0}, e = fields_.size(); i < e; ++i) {
-      if (!that_struct->fields_.at(i)->type->IsEqual(*fields_.at(i)->type)) {
+    for (auto i = std::size_t{0}, e = fields_->size(); i < e; ++i) {
+      if (!that_struct->fields_->at(i)->type->IsEqual(
+              *fields_->at(i)->type)) {
         return false;
       }
     }
@@ -227,12 +345,11 @@ bool StructType::IsEqual(const Type& that) const noexcept {
 }
 
 std::size_t StructType::size() const {
-  // TODO: There may be unnamed padding at the end of a structure or union.
-  auto size = std::size_t{0};
-  for (const auto& field : fields_) {
-    size += field->type->size();
-  }
-  return size;
+  return layout_->size;
+}
+
+std::size_t StructType::alignment() const {
+  return layout_->alignment;
 }
 
 std::string StructType::ToString() const {
@@ -243,13 +360,9 @@ std::string StructType::ToString() const {
 }
 
 std::unique_ptr<Type> StructType::Clone() const {
-  auto cloned_fields = std::vector<std::unique_ptr<Field>>{};
-  for (const auto& field : fields_) {
-    auto cloned_field =
-        std::make_unique<Field>(field->id, field->type->Clone());
-    cloned_fields.push_back(std::move(cloned_field));
-  }
-  return std::make_unique<StructType>(id_, std::move(cloned_fields));
+  // The members are shared rather than copied, since cloning happens on every
+  // access to an object of the type.
+  return std::make_unique<StructType>(id_, fields_, layout_);
 }
 
 std::string UnionType::id() const noexcept {
@@ -257,24 +370,14 @@ std::string UnionType::id() const noexcept {
 }
 
 bool UnionType::IsMember(const std::string& id) const noexcept {
-  for (const auto& field : fields_) {
-    if (field->id == id) {
-      return true;
-    }
-  }
-
-  return false;
+  return layout_->indices.count(id) != 0;
 }
 
-std::unique_ptr<Type> UnionType::MemberType(
-    const std::string& id) const noexcept {
-  for (const auto& field : fields_) {
-    if (field->id == id) {
-      return field->type->Clone();
-    }
+const Type& UnionType::MemberType(const std::string& id) const noexcept {
+  if (auto it = layout_->indices.find(id); it != layout_->indices.cend()) {
+    return *fields_->at(it->second)->type;
   }
-
-  return std::make_unique<PrimType>(PrimitiveType::kUnknown);
+  return kUnknownType;
 }
 
 std::size_t UnionType::OffsetOf(const std::string& id) const {
@@ -286,11 +389,11 @@ std::size_t UnionType::OffsetOf(const std::size_t index) const {
 }
 
 std::size_t UnionType::SlotCount() const noexcept {
-  return fields_.size() > 0 ? 1 : 0;
+  return fields_->empty() ? 0 : 1;
 }
 
 bool UnionType::IsEqual(const Type& that) const noexcept {
-  if (const auto* that_union = dynamic_cast<const UnionType*>(&that)) {
+  if (const auto* that_union = DynCast<UnionType>(&that)) {
     return that_union->size() == size();
   }
   return false;
@@ -298,12 +401,11 @@ bool UnionType::IsEqual(const Type& that) const noexcept {
 
 std::size_t UnionType::size() const {
   // The size of a union is sufficient to contain the largest of its members.
-  // TODO: There may be unnamed padding at the end of a structure or union.
-  auto size = std::size_t{0};
-  for (const auto& field : fields_) {
-    size = std::max(size, field->type->size());
-  }
-  return size;
+  return layout_->size;
+}
+
+std::size_t UnionType::alignment() const {
+  return layout_->alignment;
 }
 
 std::string UnionType::ToString() const {
@@ -314,11 +416,7 @@ std::string UnionType::ToString() const {
 }
 
 std::unique_ptr<Type> UnionType::Clone() const {
-  auto cloned_fields = std::vector<std::unique_ptr<Field>>{};
-  for (const auto& field : fields_) {
-    auto cloned_field =
-        std::make_unique<Field>(field->id, field->type->Clone());
-    cloned_fields.push_back(std::move(cloned_field));
-  }
-  return std::make_unique<UnionType>(id_, std::move(cloned_fields));
+  // The members are shared rather than copied, since cloning happens on every
+  // access to an object of the type.
+  return std::make_unique<UnionType>(id_, fields_, layout_);
 }
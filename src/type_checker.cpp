@@ -4,6 +4,8 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <future>
+#include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -12,9 +14,12 @@
 #include <vector>
 
 #include "ast.hpp"
+#include "casting.hpp"
+#include "incremental_store.hpp"
 #include "operator.hpp"
 #include "scope.hpp"
 #include "symbol.hpp"
+#include "thread_pool.hpp"
 #include "type.hpp"
 
 namespace {
@@ -28,16 +33,6 @@ enum class BodyType : std::uint8_t {
   kSwitch,
 };
 
-/// @note Constructs that enters a body (compound statement) should add their
-/// body type to this list.
-auto body_types  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-    = std::vector<BodyType>{};
-
-bool IsInBodyOf(BodyType type) {
-  return std::any_of(body_types.cbegin(), body_types.cend(),
-                     [type](auto&& t) { return t == type; });
-}
-
 /// @note Struct and union type id should be mangled when adding/looking up from
 /// the type table to avoid same name but different types.
 std::string MangleRecordTypeId(const std::string& id,
@@ -52,17 +47,86 @@ std::string MangleRecordTypeId(const std::string& id,
   }
 }
 
+/// @return The type of the result of `op` on the integer operands of `lhs`
+/// and `rhs`.
+PrimitiveType ArithResultTypeOf(BinaryOperator op, PrimitiveType lhs,
+                                PrimitiveType rhs) {
+  switch (op) {
+    case BinaryOperator::kGt:
+    case BinaryOperator::kGte:
+    case BinaryOperator::kLt:
+    case BinaryOperator::kLte:
+    case BinaryOperator::kEq:
+    case BinaryOperator::kNeq:
+    case BinaryOperator::kLand:
+    case BinaryOperator::kLor:
+      return PrimitiveType::kInt;
+    case BinaryOperator::kShl:
+    case BinaryOperator::kShr:
+      // The type of the result is that of the promoted left operand.
+      return Promote(lhs);
+    default:
+      return CommonTypeOf(lhs, rhs);
+  }
+}
+
 }  // namespace
 
+/// @brief The states that live through the checking of a single function body.
+/// Each body is checked with a context of its own, so that bodies can be
+/// checked in parallel.
+struct TypeChecker::FuncContext {
+  /// @note Constructs that enters a body (compound statement) should add their
+  /// body type to this list.
+  std::vector<BodyType> body_types{};
+  /// @brief Keep track of the use and definition of a label. This is essential
+  /// for forward referencing. Each time a label is used, add it to the map.
+  /// Each time a label is defined, mark its corresponding mapping as true. In
+  /// case a label is defined before used, also add it to the map.
+  std::unordered_map<std::string, bool> label_defined{};
+  /// @brief To convey the presence of a default label in a switch statement.
+  /// @note To allow nested switch statements, the state is stacked.
+  std::vector<bool> switch_already_has_default{};
+
+  bool IsInBodyOf(BodyType type) const {
+    return std::any_of(body_types.cbegin(), body_types.cend(),
+                       [type](auto&& t) { return t == type; });
+  }
+};
+
+TypeChecker::TypeChecker(ScopeStack& env, ThreadPool* thread_pool,
+                         const IncrementalStore* store)
+    : env_{env}, thread_pool_{thread_pool}, store_{store} {}
+
+TypeChecker::~TypeChecker() = default;
+
 void TypeChecker::Visit(DeclStmtNode& decl_stmt) {
   for (auto& decl : decl_stmt.decls) {
-    decl->Accept(*this);
+    Dispatch(*decl);
+  }
+}
+
+void TypeChecker::ResolveRecordType_(std::unique_ptr<Type>& type) const {
+  if (const auto* arr_type = DynCast<ArrType>(type.get())) {
+    auto element_type = arr_type->element_type().Clone();
+    ResolveRecordType_(element_type);
+    type = std::make_unique<ArrType>(std::move(element_type), arr_type->len());
+    return;
+  }
+  const auto* record_type = DynCast<RecordType>(type.get());
+  if (!record_type || !record_type->fields().empty()) {
+    return;
+  }
+  if (auto entry =
+          env_.LookUpType(MangleRecordTypeId(record_type->id(), type))) {
+    type = entry->type->Clone();
   }
 }
 
 void TypeChecker::Visit(VarDeclNode& decl) {
+  ResolveRecordType_(decl.type);
   if (decl.init) {
-    decl.init->Accept(*this);
+    Dispatch(*decl.init);
     if (decl.init->type != decl.type) {
       // TODO: incompatible types when initializing type 'type' using type
       // 'init->type'
@@ -78,6 +142,7 @@ void TypeChecker::Visit(VarDeclNode& decl) {
 }
 
 void TypeChecker::Visit(ArrDeclNode& arr_decl) {
+  ResolveRecordType_(arr_decl.type);
   if (env_.ProbeSymbol(arr_decl.id)) {
     // TODO: redefinition of 'id'
   } else {
@@ -85,7 +150,7 @@ void TypeChecker::Visit(ArrDeclNode& arr_decl) {
         std::make_unique<SymbolEntry>(arr_decl.id, arr_decl.type->Clone());
 
     for (auto& init : arr_decl.init_list) {
-      init->Accept(*this);
+      Dispatch(*init);
       if (!init->type->IsEqual(*symbol->type)) {
         // TODO: element unmatches array element type
       }
@@ -106,6 +171,23 @@ void TypeChecker::Visit(RecordDeclNode& record_decl) {
     // };
     // If no, then it is the redefinition of 'id'.
   } else {
+    // Members of record types are stored by value. The layout is computed
+    // when the type is constructed, so the type is rebuilt with the resolved
+    // members.
+    const auto& record_type = Cast<RecordType>(*record_decl.type);
+    auto fields = std::vector<std::unique_ptr<Field>>{};
+    for (const auto& field : record_type.fields()) {
+      auto type = field->type->Clone();
+      ResolveRecordType_(type);
+      fields.push_back(std::make_unique<Field>(field->id, std::move(type)));
+    }
+    if (record_type.IsStruct()) {
+      record_decl.type =
+          std::make_unique<StructType>(record_type.id(), std::move(fields));
+    } else {
+      record_decl.type =
+          std::make_unique<UnionType>(record_type.id(), std::move(fields));
+    }
     auto type_id = MangleRecordTypeId(record_decl.id, record_decl.type);
     auto decl_type =
         std::make_unique<TypeEntry>(type_id, record_decl.type->Clone());
@@ -130,22 +212,15 @@ void TypeChecker::Visit(RecordVarDeclNode& record_var_decl) {
     //
     // struct birth bd1 { .date = 1 }; // RecordVarDeclNode -> search type entry
     // to update its type.
-    // record_type_id is "struct_birth" in the above example.
-    auto record_type_id =
-        dynamic_cast<RecordType*>(record_var_decl.type.get())->id();
-    auto record_type = env_.LookUpType(
-        MangleRecordTypeId(record_type_id, record_var_decl.type));
-    assert(record_type);
+    ResolveRecordType_(record_var_decl.type);
     auto symbol = std::make_unique<SymbolEntry>(record_var_decl.id,
-                                                record_type->type->Clone());
+                                                record_var_decl.type->Clone());
 
     // TODO: type check between fields and initialized members.
     for (auto& init : record_var_decl.inits) {
-      init->Accept(*this);
+      Dispatch(*init);
     }
     env_.AddSymbol(std::move(symbol), env_.CurrentScopeKind());
-
-    record_var_decl.type = record_type->type->Clone();
   }
 }
 
@@ -153,16 +228,6 @@ void TypeChecker::Visit(ParamNode& parameter) {
   if (env_.ProbeSymbol(parameter.id)) {
     // TODO: redefinition of 'id'
   } else {
-    // NOTE: Any parameter of array or function type is adjusted to the
-    // corresponding pointer type.
-    if (parameter.type->IsArr()) {
-      // Decay to simple pointer type.
-      parameter.type = std::make_unique<PtrType>(
-          dynamic_cast<ArrType*>(parameter.type.get())->element_type().Clone());
-    } else if (parameter.type->IsFunc()) {
-      // Decay to function pointer type.
-      parameter.type = std::make_unique<PtrType>(parameter.type->Clone());
-    }
     auto symbol =
         std::make_unique<SymbolEntry>(parameter.id, parameter.type->Clone());
     // TODO: May be parameter scope once we support function prototypes.
@@ -170,28 +235,31 @@ void TypeChecker::Visit(ParamNode& parameter) {
   }
 }
 
-namespace {
-
-/// @brief Associate with a function scope. Keep track of the use and definition
-/// of a label. This is essential for forward referencing. Each time a label is
-/// used, add it to the map. Each time a label is defined, mark its
-/// corresponding mapping as true. In case a label is defined before used, also
-/// add it to the map.
-std::unordered_map<std::string, bool>
-    label_defined;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-}  // namespace
-
 void TypeChecker::Visit(FuncDefNode& func_def) {
   if (env_.ProbeSymbol(func_def.id)) {
     // TODO: redefinition of function id
   }
+  DeclareFunc_(func_def);
+  // A prototype only declares the function, which is defined elsewhere.
+  if (func_def.body) {
+    CheckFuncBody_(func_def);
+  }
+}
 
-  env_.PushScope(ScopeKind::kFunc);
-  // NOTE: This block scope will be merged with the function body. Don't pop it.
-  env_.PushScope(ScopeKind::kBlock);
-  env_.MergeWithNextScope();
+void TypeChecker::DeclareFunc_(FuncDefNode& func_def) {
+  // NOTE: Any parameter of array or function type is adjusted to the
+  // corresponding pointer type.
   for (auto& parameter : func_def.parameters) {
-    parameter->Accept(*this);
+    // Records are passed by value.
+    ResolveRecordType_(parameter->type);
+    if (parameter->type->IsArr()) {
+      // Decay to simple pointer type.
+      parameter->type = std::make_unique<PtrType>(
+          Cast<ArrType>(*parameter->type).element_type().Clone());
+    } else if (parameter->type->IsFunc()) {
+      // Decay to function pointer type.
+      parameter->type = std::make_unique<PtrType>(parameter->type->Clone());
+    }
   }
   // The type of some parameters may be decayed to pointer type.
   // The type of the function should be updated accordingly.
@@ -199,43 +267,54 @@ void TypeChecker::Visit(FuncDefNode& func_def) {
   for (auto& parameter : func_def.parameters) {
     decayed_param_types.push_back(parameter->type->Clone());
   }
-  auto return_type =
-      dynamic_cast<FuncType*>(func_def.type.get())->return_type().Clone();
+  auto return_type = Cast<FuncType>(*func_def.type).return_type().Clone();
+  ResolveRecordType_(return_type);
   func_def.type = std::make_unique<FuncType>(std::move(return_type),
                                              std::move(decayed_param_types));
   auto symbol =
       std::make_unique<SymbolEntry>(func_def.id, func_def.type->Clone());
   env_.AddSymbol(std::move(symbol), ScopeKind::kFile);
+}
 
-  label_defined.clear();
-  func_def.body->Accept(*this);
-  for (auto& [label, defined] : label_defined) {
+void TypeChecker::CheckFuncBody_(FuncDefNode& func_def) {
+  env_.PushScope(ScopeKind::kFunc);
+  // NOTE: This block scope will be merged with the function body. Don't pop it.
+  env_.PushScope(ScopeKind::kBlock);
+  env_.MergeWithNextScope();
+  for (auto& parameter : func_def.parameters) {
+    Dispatch(*parameter);
+  }
+
+  ctx_ = std::make_unique<FuncContext>();
+  Dispatch(*func_def.body);
+  for (auto& [label, defined] : ctx_->label_defined) {
     if (!defined) {
       // TODO: use of undeclared label 'label'
     }
   }
-  label_defined.clear();
+  ctx_.reset();
   // Pops the function scope.
   env_.PopScope();
   //  TODO: check body return type and function return type
 }
 
 void TypeChecker::Visit(LoopInitNode& loop_init) {
-  std::visit([this](auto&& clause) { clause->Accept(*this); },
-             loop_init.clause);
+  std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
 }
 
 void TypeChecker::Visit(CompoundStmtNode& compound_stmt) {
-  env_.PushScope(ScopeKind::kBlock);
-  for (auto& stmt : compound_stmt.stmts) {
-    stmt->Accept(*this);
-  }
-  env_.PopScope();
+  VisitBlocks_(
+      compound_stmt,
+      [this](CompoundStmtNode&) { env_.PushScope(ScopeKind::kBlock); },
+      [this](CompoundStmtNode&) { env_.PopScope(); });
 }
 
 void TypeChecker::InstallBuiltins_(ScopeStack& env) {
   // The supported builtins are:
   // - int __builtin_print(int)
+  // - int __builtin_flush()
+  // The output of __builtin_print is buffered until __builtin_flush is called
+  // or the program exits.
 
   auto param_types = std::vector<std::unique_ptr<Type>>{};
   param_types.emplace_back(std::make_unique<PrimType>(PrimitiveType::kInt));
@@ -244,49 +323,113 @@ void TypeChecker::InstallBuiltins_(ScopeStack& env) {
                              std::make_unique<PrimType>(PrimitiveType::kInt),
                              std::move(param_types)));
   env.AddSymbol(std::move(symbol), ScopeKind::kFile);
+
+  auto flush_symbol = std::make_unique<SymbolEntry>(
+      "__builtin_flush", std::make_unique<FuncType>(
+                             std::make_unique<PrimType>(PrimitiveType::kInt),
+                             std::vector<std::unique_ptr<Type>>{}));
+  env.AddSymbol(std::move(flush_symbol), ScopeKind::kFile);
 }
 
 void TypeChecker::Visit(ExternDeclNode& extern_decl) {
-  std::visit([this](auto&& extern_decl) { extern_decl->Accept(*this); },
+  std::visit([this](auto&& extern_decl) { Dispatch(*extern_decl); },
              extern_decl.decl);
 }
 
 void TypeChecker::Visit(TransUnitNode& trans_unit) {
+  EnterFileScope();
+  if (thread_pool_) {
+    CheckInParallel_(trans_unit);
+  } else {
+    for (auto i = std::size_t{0}, e = trans_unit.extern_decls.size(); i < e;
+         ++i) {
+      auto& extern_decl = *trans_unit.extern_decls.at(i);
+      if (IsReused_(i)) {
+        DeclareFunc_(*std::get<std::unique_ptr<FuncDefNode>>(extern_decl.decl));
+      } else {
+        Dispatch(extern_decl);
+      }
+    }
+  }
+  ExitFileScope();
+}
+
+void TypeChecker::EnterFileScope() {
   env_.PushScope(ScopeKind::kFile);
   InstallBuiltins_(env_);
-  for (auto& extern_decl : trans_unit.extern_decls) {
-    extern_decl->Accept(*this);
-  }
+}
 
+void TypeChecker::ExitFileScope() {
   env_.PopScope();
 }
 
+void TypeChecker::CheckInParallel_(TransUnitNode& trans_unit) {
+  // Resolves all file-scope declarations first, so that the file scope is
+  // complete and no longer modified when the function bodies are checked. Each
+  // body only sees the declarations up to its function, as when checking in
+  // order.
+  auto func_defs = std::vector<std::pair<FuncDefNode*, ScopeStack::Mark>>{};
+  for (auto i = std::size_t{0}, e = trans_unit.extern_decls.size(); i < e;
+       ++i) {
+    auto& extern_decl = *trans_unit.extern_decls.at(i);
+    if (auto* func_def =
+            std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl.decl)) {
+      DeclareFunc_(**func_def);
+      if ((*func_def)->body && !IsReused_(i)) {
+        func_defs.emplace_back(func_def->get(), env_.MarkOfTopScope());
+      }
+    } else {
+      Dispatch(extern_decl);
+    }
+  }
+
+  auto checks = std::vector<std::future<void>>{};
+  for (const auto& [func_def, mark] : func_defs) {
+    checks.push_back(thread_pool_->Submit([this, func_def = func_def,
+                                           mark = mark] {
+      // Each function has its own block scopes on top of the shared file
+      // scope.
+      auto env = ScopeStack{&env_, mark};
+      TypeChecker type_checker{env};
+      type_checker.SetProfiler(profiler());
+      type_checker.CheckFuncBody_(*func_def);
+    }));
+  }
+  for (auto& check : checks) {
+    check.get();
+  }
+}
+
+bool TypeChecker::IsReused_(std::size_t index) const {
+  return store_ && store_->ReusableIrOf(index);
+}
+
 void TypeChecker::Visit(IfStmtNode& if_stmt) {
-  if_stmt.predicate->Accept(*this);
-  if_stmt.then->Accept(*this);
+  Dispatch(*if_stmt.predicate);
+  Dispatch(*if_stmt.then);
   if (if_stmt.or_else) {
-    if_stmt.or_else->Accept(*this);
+    Dispatch(*if_stmt.or_else);
   }
 }
 
 void TypeChecker::Visit(WhileStmtNode& while_stmt) {
-  while_stmt.predicate->Accept(*this);
-  body_types.push_back(BodyType::kLoop);
-  while_stmt.loop_body->Accept(*this);
-  body_types.pop_back();
+  Dispatch(*while_stmt.predicate);
+  ctx_->body_types.push_back(BodyType::kLoop);
+  Dispatch(*while_stmt.loop_body);
+  ctx_->body_types.pop_back();
 }
 
 void TypeChecker::Visit(ForStmtNode& for_stmt) {
-  for_stmt.loop_init->Accept(*this);
-  for_stmt.predicate->Accept(*this);
-  for_stmt.step->Accept(*this);
-  body_types.push_back(BodyType::kLoop);
-  for_stmt.loop_body->Accept(*this);
-  body_types.pop_back();
+  Dispatch(*for_stmt.loop_init);
+  Dispatch(*for_stmt.predicate);
+  Dispatch(*for_stmt.step);
+  ctx_->body_types.push_back(BodyType::kLoop);
+  Dispatch(*for_stmt.loop_body);
+  ctx_->body_types.pop_back();
 }
 
 void TypeChecker::Visit(ReturnStmtNode& ret_stmt) {
-  ret_stmt.expr->Accept(*this);
+  Dispatch(*ret_stmt.expr);
   if (!ret_stmt.expr->type->IsEqual(PrimitiveType::kInt)) {
     // TODO: return value type does not match the function type
   }
@@ -298,98 +441,91 @@ void TypeChecker::Visit(GotoStmtNode& goto_stmt) {
   // Also the lookup from the environment is not necessary. In fact, labels are
   // not added to the environment.
   const bool is_not_defined =
-      label_defined.find(goto_stmt.label) == label_defined.end() ||
-      !label_defined.at(goto_stmt.label);
+      ctx_->label_defined.find(goto_stmt.label) == ctx_->label_defined.end() ||
+      !ctx_->label_defined.at(goto_stmt.label);
   if (is_not_defined) {
-    label_defined[goto_stmt.label] = false;
+    ctx_->label_defined[goto_stmt.label] = false;
   }
 }
 
 void TypeChecker::Visit(BreakStmtNode& break_stmt) {
-  if (!IsInBodyOf(BodyType::kLoop) && !IsInBodyOf(BodyType::kSwitch)) {
+  if (!ctx_->IsInBodyOf(BodyType::kLoop) &&
+      !ctx_->IsInBodyOf(BodyType::kSwitch)) {
     assert(false);
     // TODO: 'break' statement not in loop or switch statement
   }
 }
 
 void TypeChecker::Visit(ContinueStmtNode& continue_stmt) {
-  if (!IsInBodyOf(BodyType::kLoop)) {
+  if (!ctx_->IsInBodyOf(BodyType::kLoop)) {
     assert(false);
     // TODO: 'continue' statement not in loop statement
   }
 }
 
-namespace {
-/// @brief A shared state to convey the presence of a default label in a switch
-/// statement.
-/// @note To allow nested switch statements, the state is stacked.
-auto
-    switch_already_has_default  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-    = std::vector<bool>{};
-}  // namespace
-
 void TypeChecker::Visit(SwitchStmtNode& switch_stmt) {
-  switch_stmt.ctrl->Accept(*this);
+  Dispatch(*switch_stmt.ctrl);
   if (!switch_stmt.ctrl->type->IsEqual(PrimitiveType::kInt)) {
     // TODO: statement requires expression of integer type
   }
-  body_types.push_back(BodyType::kSwitch);
-  switch_already_has_default.push_back(false);
-  switch_stmt.stmt->Accept(*this);
-  switch_already_has_default.pop_back();
-  body_types.pop_back();
+  ctx_->body_types.push_back(BodyType::kSwitch);
+  ctx_->switch_already_has_default.push_back(false);
+  Dispatch(*switch_stmt.stmt);
+  ctx_->switch_already_has_default.pop_back();
+  ctx_->body_types.pop_back();
   // TODO: No two of the case constant expressions in the same switch statement
   // shall have the same value (we need constant expression support on this).
 }
 
 void TypeChecker::Visit(IdLabeledStmtNode& id_labeled_stmt) {
+  const auto& label_defined = ctx_->label_defined;
   if (label_defined.find(id_labeled_stmt.label) != label_defined.end() &&
       label_defined.at(id_labeled_stmt.label)) {
     // TODO: redefinition of label 'label'
   }
-  label_defined[id_labeled_stmt.label] = true;
-  id_labeled_stmt.stmt->Accept(*this);
+  ctx_->label_defined[id_labeled_stmt.label] = true;
+  Dispatch(*id_labeled_stmt.stmt);
 }
 
 void TypeChecker::Visit(CaseStmtNode& case_stmt) {
-  if (!IsInBodyOf(BodyType::kSwitch)) {
+  if (!ctx_->IsInBodyOf(BodyType::kSwitch)) {
     // TODO: 'case' statement not in switch statement
   }
-  case_stmt.expr->Accept(*this);
+  Dispatch(*case_stmt.expr);
   if (!case_stmt.expr->type->IsEqual(PrimitiveType::kInt)) {
     // TODO: expression is not an integer constant expression
   }
-  case_stmt.stmt->Accept(*this);
+  Dispatch(*case_stmt.stmt);
 }
 
 void TypeChecker::Visit(DefaultStmtNode& default_stmt) {
-  if (!IsInBodyOf(BodyType::kSwitch)) {
+  if (!ctx_->IsInBodyOf(BodyType::kSwitch)) {
     // TODO: 'default' statement not in switch statement
   }
-  assert(!switch_already_has_default.empty());
-  if (switch_already_has_default.back()) {
+  assert(!ctx_->switch_already_has_default.empty());
+  if (ctx_->switch_already_has_default.back()) {
     // TODO: multiple default labels in one switch
   }
-  switch_already_has_default.back() = true;
-  default_stmt.stmt->Accept(*this);
+  ctx_->switch_already_has_default.back() = true;
+  Dispatch(*default_stmt.stmt);
 }
 
 void TypeChecker::Visit(ExprStmtNode& expr_stmt) {
-  expr_stmt.expr->Accept(*this);
+  Dispatch(*expr_stmt.expr);
 }
 
 void TypeChecker::Visit(InitExprNode& init_expr) {
   for (const auto& des : init_expr.des) {
-    des->Accept(*this);
+    Dispatch(*des);
   }
-  init_expr.expr->Accept(*this);
+  Dispatch(*init_expr.expr);
   init_expr.type = init_expr.expr->type->Clone();
 }
 
 void TypeChecker::Visit(ArrDesNode& arr_des) {
   /* ArrDesNode shall have array type and the expression shall be an integer
    * constant expression. */
-  arr_des.index->Accept(*this);
+  Dispatch(*arr_des.index);
 }
 
 void TypeChecker::Visit(IdDesNode& id_des) {
@@ -411,18 +547,27 @@ void TypeChecker::Visit(IdExprNode& id_expr) {
 }
 
 void TypeChecker::Visit(IntConstExprNode& int_expr) {
-  int_expr.type = std::make_unique<PrimType>(PrimitiveType::kInt);
+  // NOTE: The type of an unsuffixed decimal constant is the first of int, long
+  // int and long long int in which its value can be represented. `long long`
+  // isn't supported, and a value beyond `long` is given `unsigned long`, as
+  // C90 did and GCC still does, instead of an extended integer type.
+  const auto prim_type =
+      int_expr.val <= std::numeric_limits<int>::max() ? PrimitiveType::kInt
+      : int_expr.val <= std::numeric_limits<long>::max()
+          ? PrimitiveType::kLong
+          : PrimitiveType::kULong;
+  int_expr.type = std::make_unique<PrimType>(prim_type);
 }
 
 void TypeChecker::Visit(ArgExprNode& arg_expr) {
-  arg_expr.arg->Accept(*this);
+  Dispatch(*arg_expr.arg);
   arg_expr.type = arg_expr.arg->type->Clone();
 }
 
 void TypeChecker::Visit(ArrSubExprNode& arr_sub_expr) {
-  arr_sub_expr.arr->Accept(*this);
-  arr_sub_expr.index->Accept(*this);
-  const auto* arr_type = dynamic_cast<ArrType*>((arr_sub_expr.arr->type).get());
+  Dispatch(*arr_sub_expr.arr);
+  Dispatch(*arr_sub_expr.index);
+  const auto* arr_type = DynCast<ArrType>(arr_sub_expr.arr->type.get());
   assert(arr_type);
   // arr_sub_expr should have the element type of the array.
   arr_sub_expr.type = arr_type->element_type().Clone();
@@ -430,10 +575,17 @@ void TypeChecker::Visit(ArrSubExprNode& arr_sub_expr) {
 
 void TypeChecker::Visit(CondExprNode& cond_expr) {
   // TODO: support operand pointer types
-  cond_expr.predicate->Accept(*this);
-  cond_expr.then->Accept(*this);
-  cond_expr.or_else->Accept(*this);
-  if (!cond_expr.then->type->IsEqual(*cond_expr.or_else->type)) {
+  Dispatch(*cond_expr.predicate);
+  Dispatch(*cond_expr.then);
+  Dispatch(*cond_expr.or_else);
+  const auto* then_prim = DynCast<PrimType>(cond_expr.then->type.get());
+  const auto* or_else_prim =
+      DynCast<PrimType>(cond_expr.or_else->type.get());
+  if (then_prim && or_else_prim && then_prim->IsInteger() &&
+      or_else_prim->IsInteger()) {
+    cond_expr.type = std::make_unique<PrimType>(
+        CommonTypeOf(then_prim->prim_type(), or_else_prim->prim_type()));
+  } else if (!cond_expr.then->type->IsEqual(*cond_expr.or_else->type)) {
     // TODO: unmatched operand types
   } else {
     // If both the second and third operands have arithmetic type, the result
@@ -446,19 +598,19 @@ void TypeChecker::Visit(CondExprNode& cond_expr) {
 }
 
 void TypeChecker::Visit(FuncCallExprNode& call_expr) {
-  call_expr.func_expr->Accept(*this);
+  Dispatch(*call_expr.func_expr);
 
   // The function expression should have a function type or a pointer to a
   // function type.
   // NOTE: Using shared pointer to avoid additional casting on raw pointer.
   auto func_type = std::shared_ptr<FuncType>{};
   if (call_expr.func_expr->type->IsFunc()) {
-    func_type = std::dynamic_pointer_cast<FuncType>(
+    func_type = std::static_pointer_cast<FuncType>(
         std::shared_ptr<Type>{call_expr.func_expr->type->Clone()});
   } else if (const auto* ptr_type =
-                 dynamic_cast<PtrType*>((call_expr.func_expr->type).get());
+                 DynCast<PtrType>(call_expr.func_expr->type.get());
              ptr_type->base_type().IsFunc()) {
-    func_type = std::dynamic_pointer_cast<FuncType>(
+    func_type = std::static_pointer_cast<FuncType>(
         std::shared_ptr<Type>{ptr_type->base_type().Clone()});
   } else {
     // TODO: called object type 'type' is not a function or function pointer
@@ -473,7 +625,7 @@ void TypeChecker::Visit(FuncCallExprNode& call_expr) {
   }
 
   for (auto i = std::size_t{0}; i < args.size(); ++i) {
-    args.at(i)->Accept(*this);
+    Dispatch(*args.at(i));
     if (args.at(i)->type != param_types.at(i)) {
       // TODO: unmatched argument type
     }
@@ -481,11 +633,11 @@ void TypeChecker::Visit(FuncCallExprNode& call_expr) {
 }
 
 void TypeChecker::Visit(PostfixArithExprNode& postfix_expr) {
-  postfix_expr.operand->Accept(*this);
+  Dispatch(*postfix_expr.operand);
   // NOTE: The operand of the postfix increment or decrement operator shall
   // have atomic, qualified, or unqualified real or pointer type, and shall
   // be a modifiable lvalue.
-  const auto* id_expr = dynamic_cast<IdExprNode*>((postfix_expr.operand).get());
+  const auto* id_expr = DynCast<IdExprNode>(postfix_expr.operand.get());
   if (!id_expr || !env_.LookUpSymbol(id_expr->id)) {
     // TODO: lvalue required for postfix increment
   }
@@ -493,11 +645,10 @@ void TypeChecker::Visit(PostfixArithExprNode& postfix_expr) {
 }
 
 void TypeChecker::Visit(RecordMemExprNode& mem_expr) {
-  mem_expr.expr->Accept(*this);
-  if (auto* record_type =
-          dynamic_cast<RecordType*>((mem_expr.expr->type).get())) {
+  Dispatch(*mem_expr.expr);
+  if (auto* record_type = DynCast<RecordType>(mem_expr.expr->type.get())) {
     if (record_type->IsMember(mem_expr.id)) {
-      mem_expr.type = record_type->MemberType(mem_expr.id);
+      mem_expr.type = record_type->MemberType(mem_expr.id).Clone();
     } else {
       assert(false);
       // TODO: Throw error if mem_expr.id is not a symbol's member.
@@ -508,11 +659,10 @@ void TypeChecker::Visit(RecordMemExprNode& mem_expr) {
 }
 
 void TypeChecker::Visit(UnaryExprNode& unary_expr) {
-  unary_expr.operand->Accept(*this);
+  Dispatch(*unary_expr.operand);
   switch (unary_expr.op) {
     case UnaryOperator::kAddr: {
-      const auto* id_expr =
-          dynamic_cast<IdExprNode*>((unary_expr.operand).get());
+      const auto* id_expr = DynCast<IdExprNode>(unary_expr.operand.get());
       // NOTE: The operand of unary '&' must be an lvalue, and the only
       // supported lvalue is an identifier.
       if (!id_expr || !env_.LookUpSymbol(id_expr->id)) {
@@ -525,9 +675,24 @@ void TypeChecker::Visit(UnaryExprNode& unary_expr) {
       if (!unary_expr.operand->type->IsPtr()) {
         // TODO: the operand of unary '*' shall have pointer type
       }
-      unary_expr.type = dynamic_cast<PtrType*>(unary_expr.operand->type.get())
-                            ->base_type()
-                            .Clone();
+      unary_expr.type =
+          Cast<PtrType>(*unary_expr.operand->type).base_type().Clone();
+      break;
+    case UnaryOperator::kPos:
+    case UnaryOperator::kNeg:
+    case UnaryOperator::kBitComp:
+      // The integer promotions are performed on the operand, and the result
+      // has the promoted type.
+      if (const auto* prim =
+              DynCast<PrimType>(unary_expr.operand->type.get())) {
+        unary_expr.type =
+            std::make_unique<PrimType>(Promote(prim->prim_type()));
+      } else {
+        unary_expr.type = unary_expr.operand->type->Clone();
+      }
+      break;
+    case UnaryOperator::kNot:
+      unary_expr.type = std::make_unique<PrimType>(PrimitiveType::kInt);
       break;
     default:
       unary_expr.type = unary_expr.operand->type->Clone();
@@ -537,8 +702,13 @@ void TypeChecker::Visit(UnaryExprNode& unary_expr) {
 }
 
 void TypeChecker::Visit(BinaryExprNode& bin_expr) {
-  bin_expr.lhs->Accept(*this);
-  bin_expr.rhs->Accept(*this);
+  VisitLeftChain_(
+      bin_expr, [](BinaryExprNode&) {},
+      [this](BinaryExprNode& expr) { CheckBinaryExpr_(expr); });
+}
+
+void TypeChecker::CheckBinaryExpr_(BinaryExprNode& bin_expr) {
+  Dispatch(*bin_expr.rhs);
 
   // NOTE: The left operand of a comma operator is evaluated as a void
   // expression; there is a sequence point after its evaluation. Then the right
@@ -548,7 +718,14 @@ void TypeChecker::Visit(BinaryExprNode& bin_expr) {
     return;
   }
 
-  if (!bin_expr.lhs->type->IsEqual(*bin_expr.rhs->type)) {
+  const auto* lhs_prim = DynCast<PrimType>(bin_expr.lhs->type.get());
+  const auto* rhs_prim = DynCast<PrimType>(bin_expr.rhs->type.get());
+  if (lhs_prim && rhs_prim && lhs_prim->IsInteger() &&
+      rhs_prim->IsInteger()) {
+    bin_expr.type = std::make_unique<PrimType>(
+        ArithResultTypeOf(bin_expr.op, lhs_prim->prim_type(),
+                          rhs_prim->prim_type()));
+  } else if (!bin_expr.lhs->type->IsEqual(*bin_expr.rhs->type)) {
     // TODO: invalid operands to binary +
   } else {
     bin_expr.type = bin_expr.lhs->type->Clone();
@@ -556,8 +733,8 @@ void TypeChecker::Visit(BinaryExprNode& bin_expr) {
 }
 
 void TypeChecker::Visit(SimpleAssignmentExprNode& assign_expr) {
-  assign_expr.lhs->Accept(*this);
-  assign_expr.rhs->Accept(*this);
+  Dispatch(*assign_expr.lhs);
+  Dispatch(*assign_expr.rhs);
   if (!assign_expr.rhs->type->IsConvertibleTo(*assign_expr.lhs->type)) {
     // TODO: unmatched assignment type
     assert(false);
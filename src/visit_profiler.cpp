@@ -0,0 +1,215 @@
+#include "visit_profiler.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "ast.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief A visit in progress on the current thread.
+struct Frame {
+  AstNodeKind kind;
+  Clock::time_point start;
+  std::uint64_t start_bytes;
+  /// @brief The time and the bytes of the visits directly nested in this one.
+  std::uint64_t nested_ns;
+  std::uint64_t nested_bytes;
+};
+
+// The visits in progress and the bytes emitted are of each thread.
+
+thread_local auto
+    frames  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::vector<Frame>{};
+
+/// @brief The number of the visits in progress of each kind.
+thread_local auto num_of_open_visits  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::array<std::uint32_t,
+                 static_cast<std::size_t>(AstNodeKind::kTransUnit) + 1>{};
+
+thread_local auto
+    bytes_emitted  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::uint64_t{0};
+
+const char* NameOf(AstNodeKind kind) {
+  switch (kind) {
+    case AstNodeKind::kVarDecl:
+      return "VarDeclNode";
+    case AstNodeKind::kArrDecl:
+      return "ArrDeclNode";
+    case AstNodeKind::kRecordDecl:
+      return "RecordDeclNode";
+    case AstNodeKind::kField:
+      return "FieldNode";
+    case AstNodeKind::kRecordVarDecl:
+      return "RecordVarDeclNode";
+    case AstNodeKind::kParam:
+      return "ParamNode";
+    case AstNodeKind::kFuncDef:
+      return "FuncDefNode";
+    case AstNodeKind::kDeclStmt:
+      return "DeclStmtNode";
+    case AstNodeKind::kCompoundStmt:
+      return "CompoundStmtNode";
+    case AstNodeKind::kIfStmt:
+      return "IfStmtNode";
+    case AstNodeKind::kWhileStmt:
+      return "WhileStmtNode";
+    case AstNodeKind::kForStmt:
+      return "ForStmtNode";
+    case AstNodeKind::kReturnStmt:
+      return "ReturnStmtNode";
+    case AstNodeKind::kGotoStmt:
+      return "GotoStmtNode";
+    case AstNodeKind::kBreakStmt:
+      return "BreakStmtNode";
+    case AstNodeKind::kContinueStmt:
+      return "ContinueStmtNode";
+    case AstNodeKind::kSwitchStmt:
+      return "SwitchStmtNode";
+    case AstNodeKind::kExprStmt:
+      return "ExprStmtNode";
+    case AstNodeKind::kIdLabeledStmt:
+      return "IdLabeledStmtNode";
+    case AstNodeKind::kCaseStmt:
+      return "CaseStmtNode";
+    case AstNodeKind::kDefaultStmt:
+      return "DefaultStmtNode";
+    case AstNodeKind::kInitExpr:
+      return "InitExprNode";
+    case AstNodeKind::kNullExpr:
+      return "NullExprNode";
+    case AstNodeKind::kIdExpr:
+      return "IdExprNode";
+    case AstNodeKind::kIntConstExpr:
+      return "IntConstExprNode";
+    case AstNodeKind::kArgExpr:
+      return "ArgExprNode";
+    case AstNodeKind::kArrSubExpr:
+      return "ArrSubExprNode";
+    case AstNodeKind::kCondExpr:
+      return "CondExprNode";
+    case AstNodeKind::kFuncCallExpr:
+      return "FuncCallExprNode";
+    case AstNodeKind::kPostfixArithExpr:
+      return "PostfixArithExprNode";
+    case AstNodeKind::kRecordMemExpr:
+      return "RecordMemExprNode";
+    case AstNodeKind::kUnaryExpr:
+      return "UnaryExprNode";
+    case AstNodeKind::kBinaryExpr:
+      return "BinaryExprNode";
+    case AstNodeKind::kSimpleAssignmentExpr:
+      return "SimpleAssignmentExprNode";
+    case AstNodeKind::kArrDes:
+      return "ArrDesNode";
+    case AstNodeKind::kIdDes:
+      return "IdDesNode";
+    case AstNodeKind::kLoopInit:
+      return "LoopInitNode";
+    case AstNodeKind::kExternDecl:
+      return "ExternDeclNode";
+    case AstNodeKind::kTransUnit:
+      return "TransUnitNode";
+  }
+  return "Unknown";
+}
+
+void Add(std::atomic<std::uint64_t>& stat, std::uint64_t val) {
+  stat.fetch_add(val, std::memory_order_relaxed);
+}
+
+double ToMs(std::uint64_t ns) {
+  return static_cast<double>(ns) / 1e6;
+}
+
+}  // namespace
+
+void VisitProfiler::Enter(AstNodeKind kind) {
+  ++num_of_open_visits.at(static_cast<std::size_t>(kind));
+  frames.push_back({kind, Clock::now(), bytes_emitted, 0, 0});
+}
+
+void VisitProfiler::Exit() {
+  const auto frame = frames.back();
+  frames.pop_back();
+  const auto ns = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                           frame.start)
+          .count());
+  const auto bytes = bytes_emitted - frame.start_bytes;
+  auto& stats = stats_.at(static_cast<std::size_t>(frame.kind));
+  Add(stats.num_of_visits, 1);
+  Add(stats.exclusive_ns, ns - frame.nested_ns);
+  Add(stats.exclusive_bytes, bytes - frame.nested_bytes);
+  if (--num_of_open_visits.at(static_cast<std::size_t>(frame.kind)) == 0) {
+    Add(stats.inclusive_ns, ns);
+    Add(stats.inclusive_bytes, bytes);
+  }
+  if (!frames.empty()) {
+    frames.back().nested_ns += ns;
+    frames.back().nested_bytes += bytes;
+  }
+}
+
+void VisitProfiler::CountBytes(std::size_t size) noexcept {
+  bytes_emitted += size;
+}
+
+std::vector<VisitProfiler::Row> VisitProfiler::SortedRows_() const {
+  auto rows = std::vector<Row>{};
+  for (auto i = std::size_t{0}; i < kNumOfKinds; ++i) {
+    const auto& stats = stats_.at(i);
+    if (stats.num_of_visits == 0) {
+      continue;
+    }
+    rows.push_back({static_cast<AstNodeKind>(i), stats.num_of_visits,
+                    stats.inclusive_ns, stats.exclusive_ns,
+                    stats.inclusive_bytes, stats.exclusive_bytes});
+  }
+  std::stable_sort(rows.begin(), rows.end(),
+                   [](const Row& lhs, const Row& rhs) {
+                     return lhs.exclusive_ns > rhs.exclusive_ns;
+                   });
+  return rows;
+}
+
+void VisitProfiler::WriteTable(std::ostream& output) const {
+  output << fmt::format("{}:\n", pass_);
+  output << fmt::format("  {:<26} {:>10} {:>10} {:>10} {:>12} {:>12}\n",
+                        "kind", "visits", "incl ms", "excl ms", "incl bytes",
+                        "excl bytes");
+  for (const auto& row : SortedRows_()) {
+    output << fmt::format(
+        "  {:<26} {:>10} {:>10.3f} {:>10.3f} {:>12} {:>12}\n",
+        NameOf(row.kind), row.num_of_visits, ToMs(row.inclusive_ns),
+        ToMs(row.exclusive_ns), row.inclusive_bytes, row.exclusive_bytes);
+  }
+}
+
+void VisitProfiler::WriteJson(std::ostream& output) const {
+  output << fmt::format("{{\"pass\": \"{}\", \"kinds\": [", pass_);
+  const auto rows = SortedRows_();
+  for (auto i = std::size_t{0}; i < rows.size(); ++i) {
+    const auto& row = rows.at(i);
+    output << fmt::format(
+        "{}\n  {{\"kind\": \"{}\", \"visits\": {}, \"inclusive_ns\": {}, "
+        "\"exclusive_ns\": {}, \"inclusive_bytes\": {}, "
+        "\"exclusive_bytes\": {}}}",
+        i == 0 ? "" : ",", NameOf(row.kind), row.num_of_visits,
+        row.inclusive_ns, row.exclusive_ns, row.inclusive_bytes,
+        row.exclusive_bytes);
+  }
+  output << "\n]}";
+}
@@ -0,0 +1,409 @@
+#include "vm/bytecode.hpp"
+
+#include <fmt/core.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "x86/mir.hpp"
+
+namespace vm {
+
+namespace {
+
+constexpr auto kFrameAlignment = std::int64_t{16};
+
+std::int64_t AlignUp(std::int64_t n, std::int64_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+/// @return The operation of the same width as `base`, which is of a word.
+Op WidenedBy(Op base, x86::Width width) {
+  return static_cast<Op>(static_cast<int>(base) +
+                         (width == x86::Width::kLong ? 1 : 0));
+}
+
+Op BinaryOpOf(x86::Opcode op) {
+  switch (op) {
+    case x86::Opcode::kAdd:
+      return Op::kAddW;
+    case x86::Opcode::kSub:
+      return Op::kSubW;
+    case x86::Opcode::kMul:
+      return Op::kMulW;
+    case x86::Opcode::kDiv:
+      return Op::kDivW;
+    case x86::Opcode::kUDiv:
+      return Op::kUDivW;
+    case x86::Opcode::kRem:
+      return Op::kRemW;
+    case x86::Opcode::kURem:
+      return Op::kURemW;
+    case x86::Opcode::kAnd:
+      return Op::kAndW;
+    case x86::Opcode::kOr:
+      return Op::kOrW;
+    case x86::Opcode::kXor:
+      return Op::kXorW;
+    case x86::Opcode::kShl:
+      return Op::kShlW;
+    case x86::Opcode::kSar:
+      return Op::kSarW;
+    default:
+      assert(op == x86::Opcode::kShr);
+      return Op::kShrW;
+  }
+}
+
+Op CmpOpOf(x86::Cond cond) {
+  switch (cond) {
+    case x86::Cond::kEq:
+      return Op::kEqW;
+    case x86::Cond::kNe:
+      return Op::kNeW;
+    case x86::Cond::kLt:
+      return Op::kLtW;
+    case x86::Cond::kLe:
+      return Op::kLeW;
+    case x86::Cond::kGt:
+      return Op::kGtW;
+    case x86::Cond::kGe:
+      return Op::kGeW;
+    case x86::Cond::kBelow:
+      return Op::kBelowW;
+    case x86::Cond::kBelowEq:
+      return Op::kBelowEqW;
+    case x86::Cond::kAbove:
+      return Op::kAboveW;
+    default:
+      return Op::kAboveEqW;
+  }
+}
+
+Op ExtOpOf(x86::Ext ext) {
+  switch (ext) {
+    case x86::Ext::kSignedWord:
+      return Op::kExtSW;
+    case x86::Ext::kUnsignedWord:
+      return Op::kExtUW;
+    case x86::Ext::kSignedHalf:
+      return Op::kExtSH;
+    case x86::Ext::kUnsignedHalf:
+      return Op::kExtUH;
+    case x86::Ext::kSignedByte:
+      return Op::kExtSB;
+    default:
+      return Op::kExtUB;
+  }
+}
+
+Op LoadOpOf(std::size_t size, bool is_signed) {
+  switch (size) {
+    case 1:
+      return is_signed ? Op::kLoadSB : Op::kLoadUB;
+    case 2:
+      return is_signed ? Op::kLoadSH : Op::kLoadUH;
+    case 4:
+      return Op::kLoadW;
+    default:
+      return Op::kLoadL;
+  }
+}
+
+Op StoreOpOf(std::size_t size) {
+  switch (size) {
+    case 1:
+      return Op::kStoreB;
+    case 2:
+      return Op::kStoreH;
+    case 4:
+      return Op::kStoreW;
+    default:
+      return Op::kStoreL;
+  }
+}
+
+/// @brief Assembles the functions one after another into the program, whose
+/// functions are all declared beforehand so that they can be called by index.
+class Assembler {
+ public:
+  Assembler(Program& program,
+            const std::unordered_map<std::string, std::size_t>& func_indices)
+      : program_{program}, func_indices_{func_indices} {}
+
+  void AssembleFunction(const x86::Function& mir, Function& function) {
+    mir_ = &mir;
+    function.entry = program_.code.size();
+    LayOutFrame_(function);
+    // The registers are the frame register, the virtual registers, a scratch
+    // register, and then the immediates.
+    scratch_ = static_cast<Reg>(mir.num_of_vregs) + 1;
+    imm_regs_.clear();
+    imms_ = &function.imms;
+    function.num_of_regs = scratch_ + 1;
+    label_positions_.assign(static_cast<std::size_t>(mir.num_of_labels), 0);
+    jumps_.clear();
+
+    // The instructions that can't be reached, such as the implicit return
+    // after a return statement, are left out.
+    auto is_reachable = true;
+    for (index_ = 0; index_ < mir.instrs.size(); ++index_) {
+      const auto& instr = mir.instrs.at(index_);
+      is_reachable |= instr.op == x86::Opcode::kLabel;
+      if (is_reachable) {
+        AssembleInstr_(instr);
+        is_reachable = !x86::IsTerminator(instr);
+      }
+    }
+    for (const auto& [pos, label, field] : jumps_) {
+      const auto target = label_positions_.at(static_cast<std::size_t>(label));
+      program_.code.at(pos).*field = static_cast<Reg>(target);
+    }
+    function.num_of_regs += static_cast<Reg>(function.imms.size());
+  }
+
+ private:
+  Program& program_;
+  const std::unordered_map<std::string, std::size_t>& func_indices_;
+  const x86::Function* mir_ = nullptr;
+  /// @brief The index of the instruction being assembled.
+  std::size_t index_ = 0;
+  Reg scratch_ = 0;
+  /// @brief The register of each immediate.
+  std::map<std::int64_t, Reg> imm_regs_{};
+  std::vector<std::uint64_t>* imms_ = nullptr;
+  /// @brief The offset of each slot in the frame.
+  std::vector<std::int64_t> slot_offsets_{};
+  /// @brief The position of each label in the code.
+  std::vector<std::size_t> label_positions_{};
+
+  /// @brief A jump whose target is patched once every label is placed.
+  struct Jump {
+    std::size_t pos;
+    x86::Label label;
+    Reg Instr::*field;
+  };
+  std::vector<Jump> jumps_{};
+
+  void LayOutFrame_(Function& function) {
+    const auto& mir = *mir_;
+    slot_offsets_.clear();
+    auto size = std::int64_t{0};
+    for (const auto& slot : mir.slots) {
+      size = AlignUp(size, static_cast<std::int64_t>(slot.alignment));
+      slot_offsets_.push_back(size);
+      size += static_cast<std::int64_t>(slot.size);
+    }
+    function.frame_size =
+        static_cast<std::size_t>(AlignUp(size, kFrameAlignment));
+    for (const auto& param : mir.params) {
+      function.params.push_back(
+          {param.size, param.is_record,
+           slot_offsets_.at(static_cast<std::size_t>(param.slot))});
+    }
+  }
+
+  static Reg RegOf_(x86::VReg vreg) {
+    return static_cast<Reg>(vreg) + 1;
+  }
+
+  /// @return The register of `operand`; an immediate is given a register of
+  /// its own, shared by the same immediates.
+  Reg RegOf_(const x86::Operand& operand) {
+    if (operand.IsVReg()) {
+      return RegOf_(operand.vreg());
+    }
+    // A missing operand, such as the value returned from a function that
+    // falls off its end, is 0.
+    const auto imm = operand.IsImm() ? operand.val : 0;
+    const auto [it, is_new] = imm_regs_.emplace(
+        imm, scratch_ + 1 + static_cast<Reg>(imms_->size()));
+    if (is_new) {
+      imms_->push_back(static_cast<std::uint64_t>(imm));
+    }
+    return it->second;
+  }
+
+  /// @return The base register and the offset of `mem`.
+  std::pair<Reg, std::int64_t> AddrOf_(const x86::Mem& mem) const {
+    if (mem.base == x86::Mem::Base::kSlot) {
+      return {kFrameReg,
+              slot_offsets_.at(static_cast<std::size_t>(mem.id)) + mem.offset};
+    }
+    return {RegOf_(mem.id), mem.offset};
+  }
+
+  /// @return The register of `vreg`; the scratch register if there's none.
+  Reg DstOf_(x86::VReg vreg) const {
+    return vreg == x86::kNoVReg ? scratch_ : RegOf_(vreg);
+  }
+
+  std::size_t FuncIndexOf_(const std::string& symbol) const {
+    const auto func = func_indices_.find(symbol);
+    if (func == func_indices_.cend()) {
+      throw std::runtime_error{
+          fmt::format("undefined reference to function '{}'", symbol)};
+    }
+    return func->second;
+  }
+
+  /// @return Whether the next instruction defines `label`, so that a jump to
+  /// it can fall through instead.
+  bool IsNextLabel_(x86::Label label) const {
+    const auto next = index_ + 1;
+    return next < mir_->instrs.size() &&
+           mir_->instrs.at(next).op == x86::Opcode::kLabel &&
+           mir_->instrs.at(next).label == label;
+  }
+
+  void Emit_(Instr instr) {
+    program_.code.push_back(instr);
+  }
+
+  void EmitJmp_(x86::Label label) {
+    if (IsNextLabel_(label)) {
+      return;
+    }
+    jumps_.push_back({program_.code.size(), label, &Instr::b});
+    Emit_({Op::kJmp});
+  }
+
+  void AssembleInstr_(const x86::Instr& instr) {
+    switch (instr.op) {
+      case x86::Opcode::kCopy:
+        Emit_({WidenedBy(Op::kCopyW, instr.width), RegOf_(instr.dst),
+               RegOf_(instr.lhs)});
+        break;
+      case x86::Opcode::kNeg:
+      case x86::Opcode::kNot:
+        Emit_({WidenedBy(instr.op == x86::Opcode::kNeg ? Op::kNegW : Op::kNotW,
+                         instr.width),
+               RegOf_(instr.dst), RegOf_(instr.lhs)});
+        break;
+      case x86::Opcode::kCmp:
+        Emit_({WidenedBy(CmpOpOf(instr.cond), instr.width), RegOf_(instr.dst),
+               RegOf_(instr.lhs), RegOf_(instr.rhs)});
+        break;
+      case x86::Opcode::kExt:
+        Emit_({ExtOpOf(instr.ext), RegOf_(instr.dst), RegOf_(instr.lhs)});
+        break;
+      case x86::Opcode::kLoad: {
+        const auto [base, offset] = AddrOf_(instr.mem);
+        Emit_({LoadOpOf(instr.size, instr.is_signed), RegOf_(instr.dst), base,
+               0, offset});
+      } break;
+      case x86::Opcode::kStore: {
+        const auto [base, offset] = AddrOf_(instr.mem);
+        Emit_({StoreOpOf(instr.size), RegOf_(instr.lhs), base, 0, offset});
+      } break;
+      case x86::Opcode::kLea: {
+        const auto [base, offset] = AddrOf_(instr.mem);
+        Emit_({Op::kLea, RegOf_(instr.dst), base, 0, offset});
+      } break;
+      case x86::Opcode::kFuncAddr:
+        Emit_({Op::kFuncAddr, RegOf_(instr.dst), 0, 0,
+               static_cast<std::int64_t>(
+                   FuncIndexOf_(mir_->symbols.at(instr.size)))});
+        break;
+      case x86::Opcode::kBlit: {
+        // The source is moved into the scratch register unless it's at its
+        // base.
+        auto [src, src_offset] = AddrOf_(instr.src_mem);
+        if (src_offset != 0) {
+          Emit_({Op::kLea, scratch_, src, 0, src_offset});
+          src = scratch_;
+        }
+        const auto [dst, dst_offset] = AddrOf_(instr.mem);
+        Emit_({Op::kBlit, dst, src, static_cast<Reg>(instr.size), dst_offset});
+      } break;
+      case x86::Opcode::kCall:
+        AssembleCall_(instr);
+        break;
+      case x86::Opcode::kLabel:
+        label_positions_.at(static_cast<std::size_t>(instr.label)) =
+            program_.code.size();
+        break;
+      case x86::Opcode::kJmp:
+        EmitJmp_(instr.label);
+        break;
+      case x86::Opcode::kJnz:
+        if (instr.lhs.IsImm()) {
+          EmitJmp_(instr.lhs.val != 0 ? instr.label : instr.else_label);
+          break;
+        }
+        jumps_.push_back({program_.code.size(), instr.label, &Instr::b});
+        jumps_.push_back({program_.code.size(), instr.else_label, &Instr::c});
+        Emit_({WidenedBy(Op::kJnzW, instr.width), RegOf_(instr.lhs)});
+        break;
+      case x86::Opcode::kRet:
+        Emit_({WidenedBy(Op::kRetW, instr.width), RegOf_(instr.lhs)});
+        break;
+      case x86::Opcode::kRetRecord: {
+        const auto [base, offset] = AddrOf_(instr.mem);
+        Emit_({Op::kRetRecord, 0, base, static_cast<Reg>(instr.size), offset});
+      } break;
+      default:
+        Emit_({WidenedBy(BinaryOpOf(instr.op), instr.width), RegOf_(instr.dst),
+               RegOf_(instr.lhs), RegOf_(instr.rhs)});
+        break;
+    }
+  }
+
+  void AssembleCall_(const x86::Instr& instr) {
+    const auto& mir_call = mir_->calls.at(instr.size);
+    auto call = Call{Call::kIndirect};
+    if (mir_call.symbol.empty()) {
+      call.callee = RegOf_(mir_call.callee);
+    } else {
+      call.func = FuncIndexOf_(mir_call.symbol);
+    }
+    for (const auto& arg : mir_call.args) {
+      call.args.push_back(RegOf_(arg.val));
+    }
+    if (mir_call.ret_record_size != 0) {
+      call.ret_offset =
+          slot_offsets_.at(static_cast<std::size_t>(mir_call.ret_slot));
+    }
+    Emit_({Op::kCall, DstOf_(instr.dst),
+           static_cast<Reg>(program_.calls.size())});
+    program_.calls.push_back(std::move(call));
+  }
+};
+
+}  // namespace
+
+Program Assemble(const std::vector<x86::Function>& functions) {
+  auto program = Program{};
+  auto func_indices = std::unordered_map<std::string, std::size_t>{};
+  for (const auto& function : functions) {
+    func_indices.emplace(function.name, program.functions.size());
+    program.functions.push_back({function.name});
+  }
+  for (const auto& [name, native] :
+       {std::pair{"__vitaminc_print_int", Native::kPrintInt},
+        std::pair{"__vitaminc_flush", Native::kFlush}}) {
+    func_indices.emplace(name, program.functions.size());
+    program.functions.push_back({name, native});
+  }
+  const auto main = func_indices.find("main");
+  if (main == func_indices.cend() ||
+      program.functions.at(main->second).native != Native::kNone) {
+    throw std::runtime_error{"undefined reference to function 'main'"};
+  }
+  program.main = main->second;
+
+  auto assembler = Assembler{program, func_indices};
+  for (auto i = std::size_t{0}, e = functions.size(); i < e; ++i) {
+    assembler.AssembleFunction(functions.at(i), program.functions.at(i));
+  }
+  return program;
+}
+
+}  // namespace vm
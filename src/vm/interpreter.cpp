@@ -0,0 +1,384 @@
+#include "vm/interpreter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "vm/bytecode.hpp"
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic,
+// cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-macro-usage,
+// cppcoreguidelines-avoid-goto):
+// The registers and the memory of the frames are addressed as the compiled
+// program does, and the handlers are labels that are jumped to by address.
+
+namespace vm {
+
+namespace {
+
+/// @brief The number of registers of all frames, besides those of the largest
+/// frame, which always fits.
+constexpr auto kRegStackSize = std::size_t{1} << 20;
+/// @brief The bytes of memory of all frames, which is the default size of the
+/// stack of a native program.
+constexpr auto kMemStackSize = std::size_t{8} << 20;
+/// @brief The size of the output buffer, as in the runtime library.
+constexpr auto kOutputBufferSize = std::size_t{1} << 16;
+
+/// @brief An instruction whose operation is replaced with the address of its
+/// handler.
+struct ThreadedInstr {
+  const void* handler;
+  Reg a;
+  Reg b;
+  Reg c;
+  std::int64_t imm;
+};
+
+struct Frame {
+  const Function* function;
+  /// @brief The instruction to return to.
+  const ThreadedInstr* ret_pc;
+  std::uint64_t* regs;
+  std::byte* mem;
+  /// @brief The register that the returned value is written to.
+  Reg dst;
+  /// @brief The memory that the returned record is copied to.
+  std::byte* ret_record;
+};
+
+/// @return `val` as the result of an operation on words, zero-extended.
+template <typename T>
+std::uint64_t Word(T val) {
+  return static_cast<std::uint32_t>(val);
+}
+
+/// @return `val` as the result of an operation on longs.
+template <typename T>
+std::uint64_t Long(T val) {
+  return static_cast<std::uint64_t>(val);
+}
+
+template <typename T>
+T LoadFrom(std::uint64_t addr, std::int64_t offset) {
+  auto val = T{};
+  std::memcpy(&val, reinterpret_cast<const std::byte*>(addr) + offset,
+              sizeof(T));
+  return val;
+}
+
+template <typename T>
+void StoreTo(std::uint64_t addr, std::int64_t offset, std::uint64_t val) {
+  const auto narrowed = static_cast<T>(val);
+  std::memcpy(reinterpret_cast<std::byte*>(addr) + offset, &narrowed,
+              sizeof(T));
+}
+
+class Interpreter {
+ public:
+  explicit Interpreter(const Program& program)
+      : program_{program},
+        num_of_regs_{kRegStackSize +
+                     std::max_element(program.functions.cbegin(),
+                                      program.functions.cend(),
+                                      [](const auto& lhs, const auto& rhs) {
+                                        return lhs.num_of_regs <
+                                               rhs.num_of_regs;
+                                      })
+                         ->num_of_regs},
+        // The stacks are left uninitialized, as those of a native program.
+        regs_{new std::uint64_t[num_of_regs_]},
+        mem_{new std::byte[kMemStackSize]} {}
+
+  int Run();
+
+ private:
+  const Program& program_;
+  std::size_t num_of_regs_;
+  std::unique_ptr<std::uint64_t[]> regs_;
+  std::unique_ptr<std::byte[]> mem_;
+  std::vector<Frame> frames_{};
+  std::string output_{};
+
+  /// @brief Sets up the registers of `function`, whose frame starts at `regs`
+  /// and `mem`.
+  void Enter_(const Function& function, std::uint64_t* regs,
+              std::byte* mem) const {
+    if (regs + function.num_of_regs > regs_.get() + num_of_regs_ ||
+        mem + function.frame_size > mem_.get() + kMemStackSize) {
+      throw std::runtime_error{"stack overflow"};
+    }
+    std::copy(function.imms.cbegin(), function.imms.cend(),
+              regs + function.num_of_regs - function.imms.size());
+    regs[kFrameReg] = reinterpret_cast<std::uint64_t>(mem);
+  }
+
+  std::uint64_t CallNative_(const Function& function, std::uint64_t* regs,
+                            const Call& call) {
+    if (function.native == Native::kPrintInt) {
+      return Word(PrintInt_(static_cast<std::int32_t>(regs[call.args.at(0)])));
+    }
+    return Word(Flush_());
+  }
+
+  /// @return The number of characters written, same as the runtime library.
+  int PrintInt_(std::int32_t val) {
+    if (output_.size() + sizeof("-2147483648\n") > kOutputBufferSize) {
+      Flush_();
+    }
+    const auto len = output_.size();
+    output_ += std::to_string(val);
+    output_ += '\n';
+    return static_cast<int>(output_.size() - len);
+  }
+
+  int Flush_() {
+    const auto len = std::fwrite(output_.data(), 1, output_.size(), stdout);
+    const auto is_written = len == output_.size() && std::fflush(stdout) == 0;
+    output_.clear();
+    return is_written ? 0 : -1;
+  }
+};
+
+int Interpreter::Run() {
+#define VITAMINC_VM_HANDLER_ADDR(op) &&handler_##op,
+  static const void* const kHandlers[] = {
+      VITAMINC_VM_OPS(VITAMINC_VM_HANDLER_ADDR)};
+#undef VITAMINC_VM_HANDLER_ADDR
+  static_assert(sizeof(kHandlers) / sizeof(kHandlers[0]) ==
+                static_cast<std::size_t>(Op::kNumOfOps));
+
+  auto code = std::vector<ThreadedInstr>{};
+  code.reserve(program_.code.size());
+  for (const auto& instr : program_.code) {
+    code.push_back({kHandlers[static_cast<std::size_t>(instr.op)], instr.a,
+                    instr.b, instr.c, instr.imm});
+  }
+  const auto* functions = program_.functions.data();
+
+  const auto* function = &program_.functions.at(program_.main);
+  auto* regs = regs_.get();
+  auto* mem = mem_.get();
+  Enter_(*function, regs, mem);
+  const auto* pc = code.data() + function->entry;
+
+#define VITAMINC_VM_DISPATCH() goto* pc->handler
+#define VITAMINC_VM_NEXT() \
+  ++pc;                    \
+  VITAMINC_VM_DISPATCH()
+#define VITAMINC_VM_BINARY(op, type, widen, expr)    \
+  handler_##op: {                                    \
+    const auto lhs = static_cast<type>(regs[pc->b]); \
+    const auto rhs = static_cast<type>(regs[pc->c]); \
+    regs[pc->a] = widen(expr);                       \
+  }                                                  \
+  VITAMINC_VM_NEXT();
+#define VITAMINC_VM_UNARY(op, type, widen, expr)     \
+  handler_##op: {                                    \
+    const auto lhs = static_cast<type>(regs[pc->b]); \
+    regs[pc->a] = widen(expr);                       \
+  }                                                  \
+  VITAMINC_VM_NEXT();
+#define VITAMINC_VM_LOAD(op, type, widen)                             \
+  handler_##op:                                                       \
+  regs[pc->a] = widen(LoadFrom<type>(regs[pc->b], pc->imm));          \
+  VITAMINC_VM_NEXT();
+#define VITAMINC_VM_STORE(op, type)                                   \
+  handler_##op:                                                       \
+  StoreTo<type>(regs[pc->b], pc->imm, regs[pc->a]);                   \
+  VITAMINC_VM_NEXT();
+
+  VITAMINC_VM_DISPATCH();
+
+  VITAMINC_VM_UNARY(CopyW, std::uint32_t, Word, lhs)
+  VITAMINC_VM_UNARY(CopyL, std::uint64_t, Long, lhs)
+
+  VITAMINC_VM_BINARY(AddW, std::uint32_t, Word, lhs + rhs)
+  VITAMINC_VM_BINARY(AddL, std::uint64_t, Long, lhs + rhs)
+  VITAMINC_VM_BINARY(SubW, std::uint32_t, Word, lhs - rhs)
+  VITAMINC_VM_BINARY(SubL, std::uint64_t, Long, lhs - rhs)
+  VITAMINC_VM_BINARY(MulW, std::uint32_t, Word, lhs * rhs)
+  VITAMINC_VM_BINARY(MulL, std::uint64_t, Long, lhs * rhs)
+  // NOTE: A division by zero traps, as it does in a native program.
+  VITAMINC_VM_BINARY(DivW, std::int32_t, Word, lhs / rhs)
+  VITAMINC_VM_BINARY(DivL, std::int64_t, Long, lhs / rhs)
+  VITAMINC_VM_BINARY(UDivW, std::uint32_t, Word, lhs / rhs)
+  VITAMINC_VM_BINARY(UDivL, std::uint64_t, Long, lhs / rhs)
+  VITAMINC_VM_BINARY(RemW, std::int32_t, Word, lhs % rhs)
+  VITAMINC_VM_BINARY(RemL, std::int64_t, Long, lhs % rhs)
+  VITAMINC_VM_BINARY(URemW, std::uint32_t, Word, lhs % rhs)
+  VITAMINC_VM_BINARY(URemL, std::uint64_t, Long, lhs % rhs)
+  VITAMINC_VM_BINARY(AndW, std::uint32_t, Word, lhs & rhs)
+  VITAMINC_VM_BINARY(AndL, std::uint64_t, Long, lhs & rhs)
+  VITAMINC_VM_BINARY(OrW, std::uint32_t, Word, lhs | rhs)
+  VITAMINC_VM_BINARY(OrL, std::uint64_t, Long, lhs | rhs)
+  VITAMINC_VM_BINARY(XorW, std::uint32_t, Word, lhs ^ rhs)
+  VITAMINC_VM_BINARY(XorL, std::uint64_t, Long, lhs ^ rhs)
+  // The amount of a shift is masked, as x86-64 does.
+  VITAMINC_VM_BINARY(ShlW, std::uint32_t, Word, lhs << (rhs & 31U))
+  VITAMINC_VM_BINARY(ShlL, std::uint64_t, Long, lhs << (rhs & 63U))
+  VITAMINC_VM_BINARY(SarW, std::int32_t, Word, lhs >> (rhs & 31))
+  VITAMINC_VM_BINARY(SarL, std::int64_t, Long, lhs >> (rhs & 63))
+  VITAMINC_VM_BINARY(ShrW, std::uint32_t, Word, lhs >> (rhs & 31U))
+  VITAMINC_VM_BINARY(ShrL, std::uint64_t, Long, lhs >> (rhs & 63U))
+
+  VITAMINC_VM_UNARY(NegW, std::uint32_t, Word, 0U - lhs)
+  VITAMINC_VM_UNARY(NegL, std::uint64_t, Long, 0U - lhs)
+  VITAMINC_VM_UNARY(NotW, std::uint32_t, Word, ~lhs)
+  VITAMINC_VM_UNARY(NotL, std::uint64_t, Long, ~lhs)
+
+  VITAMINC_VM_BINARY(EqW, std::uint32_t, Long, lhs == rhs)
+  VITAMINC_VM_BINARY(EqL, std::uint64_t, Long, lhs == rhs)
+  VITAMINC_VM_BINARY(NeW, std::uint32_t, Long, lhs != rhs)
+  VITAMINC_VM_BINARY(NeL, std::uint64_t, Long, lhs != rhs)
+  VITAMINC_VM_BINARY(LtW, std::int32_t, Long, lhs < rhs)
+  VITAMINC_VM_BINARY(LtL, std::int64_t, Long, lhs < rhs)
+  VITAMINC_VM_BINARY(LeW, std::int32_t, Long, lhs <= rhs)
+  VITAMINC_VM_BINARY(LeL, std::int64_t, Long, lhs <= rhs)
+  VITAMINC_VM_BINARY(GtW, std::int32_t, Long, lhs > rhs)
+  VITAMINC_VM_BINARY(GtL, std::int64_t, Long, lhs > rhs)
+  VITAMINC_VM_BINARY(GeW, std::int32_t, Long, lhs >= rhs)
+  VITAMINC_VM_BINARY(GeL, std::int64_t, Long, lhs >= rhs)
+  VITAMINC_VM_BINARY(BelowW, std::uint32_t, Long, lhs < rhs)
+  VITAMINC_VM_BINARY(BelowL, std::uint64_t, Long, lhs < rhs)
+  VITAMINC_VM_BINARY(BelowEqW, std::uint32_t, Long, lhs <= rhs)
+  VITAMINC_VM_BINARY(BelowEqL, std::uint64_t, Long, lhs <= rhs)
+  VITAMINC_VM_BINARY(AboveW, std::uint32_t, Long, lhs > rhs)
+  VITAMINC_VM_BINARY(AboveL, std::uint64_t, Long, lhs > rhs)
+  VITAMINC_VM_BINARY(AboveEqW, std::uint32_t, Long, lhs >= rhs)
+  VITAMINC_VM_BINARY(AboveEqL, std::uint64_t, Long, lhs >= rhs)
+
+  VITAMINC_VM_UNARY(ExtSW, std::int32_t, Long, std::int64_t{lhs})
+  VITAMINC_VM_UNARY(ExtUW, std::uint32_t, Long, lhs)
+  VITAMINC_VM_UNARY(ExtSH, std::int16_t, Word, std::int32_t{lhs})
+  VITAMINC_VM_UNARY(ExtUH, std::uint16_t, Word, lhs)
+  VITAMINC_VM_UNARY(ExtSB, std::int8_t, Word, std::int32_t{lhs})
+  VITAMINC_VM_UNARY(ExtUB, std::uint8_t, Word, lhs)
+
+  VITAMINC_VM_LOAD(LoadSB, std::int8_t, Word)
+  VITAMINC_VM_LOAD(LoadUB, std::uint8_t, Word)
+  VITAMINC_VM_LOAD(LoadSH, std::int16_t, Word)
+  VITAMINC_VM_LOAD(LoadUH, std::uint16_t, Word)
+  VITAMINC_VM_LOAD(LoadW, std::uint32_t, Word)
+  VITAMINC_VM_LOAD(LoadL, std::uint64_t, Long)
+
+  VITAMINC_VM_STORE(StoreB, std::uint8_t)
+  VITAMINC_VM_STORE(StoreH, std::uint16_t)
+  VITAMINC_VM_STORE(StoreW, std::uint32_t)
+  VITAMINC_VM_STORE(StoreL, std::uint64_t)
+
+handler_Lea:
+  regs[pc->a] = regs[pc->b] + static_cast<std::uint64_t>(pc->imm);
+  VITAMINC_VM_NEXT();
+
+handler_FuncAddr:
+  regs[pc->a] = reinterpret_cast<std::uint64_t>(functions + pc->imm);
+  VITAMINC_VM_NEXT();
+
+handler_Blit:
+  // The source and the destination may be the same record.
+  std::memmove(reinterpret_cast<std::byte*>(regs[pc->a]) + pc->imm,
+               reinterpret_cast<const std::byte*>(regs[pc->b]), pc->c);
+  VITAMINC_VM_NEXT();
+
+handler_Call: {
+  const auto& call = program_.calls[pc->b];
+  const auto* callee =
+      call.func == Call::kIndirect
+          ? reinterpret_cast<const Function*>(regs[call.callee])
+          : functions + call.func;
+  if (callee->native != Native::kNone) {
+    regs[pc->a] = CallNative_(*callee, regs, call);
+    VITAMINC_VM_NEXT();
+  }
+  // The frame of the callee follows that of the caller.
+  auto* callee_regs = regs + function->num_of_regs;
+  auto* callee_mem = mem + function->frame_size;
+  Enter_(*callee, callee_regs, callee_mem);
+  for (auto i = std::size_t{0}, e = callee->params.size(); i < e; ++i) {
+    const auto& param = callee->params[i];
+    const auto arg = regs[call.args[i]];
+    if (param.is_record) {
+      std::memcpy(callee_mem + param.offset,
+                  reinterpret_cast<const std::byte*>(arg), param.size);
+    } else {
+      // The lower bytes of the argument, which is in little endian.
+      std::memcpy(callee_mem + param.offset, &arg, param.size);
+    }
+  }
+  frames_.push_back(
+      {function, pc + 1, regs, mem, pc->a, mem + call.ret_offset});
+  function = callee;
+  regs = callee_regs;
+  mem = callee_mem;
+  pc = code.data() + callee->entry;
+}
+  VITAMINC_VM_DISPATCH();
+
+handler_Jmp:
+  pc = code.data() + pc->b;
+  VITAMINC_VM_DISPATCH();
+
+handler_JnzW:
+  pc = code.data() + (static_cast<std::uint32_t>(regs[pc->a]) ? pc->b : pc->c);
+  VITAMINC_VM_DISPATCH();
+
+handler_JnzL:
+  pc = code.data() + (regs[pc->a] ? pc->b : pc->c);
+  VITAMINC_VM_DISPATCH();
+
+  // The value of a word is truncated from what it's computed as; see `Word`.
+  std::uint64_t ret_val;
+handler_RetW:
+  ret_val = Word(regs[pc->a]);
+  goto ret;
+handler_RetL:
+  ret_val = regs[pc->a];
+  goto ret;
+handler_RetRecord:
+  if (!frames_.empty()) {
+    std::memcpy(frames_.back().ret_record,
+                reinterpret_cast<const std::byte*>(regs[pc->b]) + pc->imm,
+                pc->c);
+  }
+  ret_val = 0;
+ret: {
+  if (frames_.empty()) {
+    Flush_();
+    return static_cast<int>(ret_val);
+  }
+  const auto& frame = frames_.back();
+  function = frame.function;
+  pc = frame.ret_pc;
+  regs = frame.regs;
+  mem = frame.mem;
+  regs[frame.dst] = ret_val;
+  frames_.pop_back();
+}
+  VITAMINC_VM_DISPATCH();
+
+#undef VITAMINC_VM_DISPATCH
+#undef VITAMINC_VM_NEXT
+#undef VITAMINC_VM_BINARY
+#undef VITAMINC_VM_UNARY
+#undef VITAMINC_VM_LOAD
+#undef VITAMINC_VM_STORE
+}
+
+}  // namespace
+
+int Execute(const Program& program) {
+  return Interpreter{program}.Run();
+}
+
+}  // namespace vm
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic,
+// cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-macro-usage,
+// cppcoreguidelines-avoid-goto)
@@ -0,0 +1,491 @@
+#include "whole_program.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+#include "call_graph.hpp"
+#include "casting.hpp"
+#include "expr_slot_visitor.hpp"
+#include "operator.hpp"
+#include "stack_segment.hpp"
+#include "type.hpp"
+
+namespace {
+
+/// @return The variable that `expr` modifies or exposes the address of;
+/// `nullptr` if it's none of them.
+const std::string* VarWrittenBy(const ExprNode& expr) {
+  const ExprNode* operand = nullptr;
+  if (const auto* assign_expr = DynCast<SimpleAssignmentExprNode>(&expr)) {
+    operand = assign_expr->lhs.get();
+  } else if (const auto* unary_expr = DynCast<UnaryExprNode>(&expr)) {
+    if (unary_expr->op == UnaryOperator::kIncr ||
+        unary_expr->op == UnaryOperator::kDecr ||
+        unary_expr->op == UnaryOperator::kAddr) {
+      operand = unary_expr->operand.get();
+    }
+  } else if (const auto* postfix_expr = DynCast<PostfixArithExprNode>(&expr)) {
+    operand = postfix_expr->operand.get();
+  }
+  const auto* id_expr = DynCast<IdExprNode>(operand);
+  return id_expr ? &id_expr->id : nullptr;
+}
+
+/// @return Whether `expr` is a variable or a constant, which can be evaluated
+/// any number of times.
+bool IsTrivial(const ExprNode& expr) {
+  return Isa<IntConstExprNode>(expr) ||
+         (Isa<IdExprNode>(expr) && !expr.type->IsFunc());
+}
+
+/// @return Whether the evaluation of `expr` has no side effects.
+bool IsPure(const ExprNode& expr) {
+  // The operands may be nested arbitrarily deep.
+  if (!HasSufficientStack()) {
+    return WithSufficientStack([&expr] { return IsPure(expr); });
+  }
+  if (Isa<IdExprNode>(expr) || Isa<IntConstExprNode>(expr)) {
+    return true;
+  }
+  if (const auto* unary_expr = DynCast<UnaryExprNode>(&expr)) {
+    return unary_expr->op != UnaryOperator::kIncr &&
+           unary_expr->op != UnaryOperator::kDecr &&
+           IsPure(*unary_expr->operand);
+  }
+  if (const auto* bin_expr = DynCast<BinaryExprNode>(&expr)) {
+    return IsPure(*bin_expr->lhs) && IsPure(*bin_expr->rhs);
+  }
+  if (const auto* cond_expr = DynCast<CondExprNode>(&expr)) {
+    return IsPure(*cond_expr->predicate) && IsPure(*cond_expr->then) &&
+           IsPure(*cond_expr->or_else);
+  }
+  if (const auto* arr_sub_expr = DynCast<ArrSubExprNode>(&expr)) {
+    return IsPure(*arr_sub_expr->arr) && IsPure(*arr_sub_expr->index);
+  }
+  if (const auto* mem_expr = DynCast<RecordMemExprNode>(&expr)) {
+    return IsPure(*mem_expr->expr);
+  }
+  return false;
+}
+
+/// @brief A function whose calls can be replaced with the expression that it
+/// returns.
+struct InlineCandidate {
+  const FuncDefNode* func_def;
+  /// @brief The times each parameter is used by the expression.
+  std::vector<int> uses;
+  /// @brief Whether some part of the expression may be left unevaluated, in
+  /// which case an argument may not be evaluated either.
+  bool is_conditional = false;
+};
+
+/// @brief Counts the uses of the parameters in `expr`.
+/// @return Whether `expr` only consists of the parameters, constants and
+/// operators that neither modify nor take the address of their operands.
+bool AnalyzeReturnedExpr(
+    const ExprNode& expr,
+    const std::unordered_map<std::string, std::size_t>& param_indices,
+    InlineCandidate& candidate) {
+  if (!HasSufficientStack()) {
+    return WithSufficientStack([&] {
+      return AnalyzeReturnedExpr(expr, param_indices, candidate);
+    });
+  }
+  if (Isa<IntConstExprNode>(expr)) {
+    return true;
+  }
+  if (const auto* id_expr = DynCast<IdExprNode>(&expr)) {
+    const auto param = param_indices.find(id_expr->id);
+    if (param == param_indices.cend()) {
+      return false;
+    }
+    ++candidate.uses.at(param->second);
+    return true;
+  }
+  if (const auto* unary_expr = DynCast<UnaryExprNode>(&expr)) {
+    return unary_expr->op != UnaryOperator::kIncr &&
+           unary_expr->op != UnaryOperator::kDecr &&
+           unary_expr->op != UnaryOperator::kAddr &&
+           AnalyzeReturnedExpr(*unary_expr->operand, param_indices, candidate);
+  }
+  if (const auto* bin_expr = DynCast<BinaryExprNode>(&expr)) {
+    if (bin_expr->op == BinaryOperator::kLand ||
+        bin_expr->op == BinaryOperator::kLor) {
+      candidate.is_conditional = true;
+    }
+    return AnalyzeReturnedExpr(*bin_expr->lhs, param_indices, candidate) &&
+           AnalyzeReturnedExpr(*bin_expr->rhs, param_indices, candidate);
+  }
+  if (const auto* cond_expr = DynCast<CondExprNode>(&expr)) {
+    candidate.is_conditional = true;
+    return AnalyzeReturnedExpr(*cond_expr->predicate, param_indices,
+                               candidate) &&
+           AnalyzeReturnedExpr(*cond_expr->then, param_indices, candidate) &&
+           AnalyzeReturnedExpr(*cond_expr->or_else, param_indices, candidate);
+  }
+  return false;
+}
+
+/// @return The function as a candidate for inlining; `std::nullopt` if its
+/// body is more than a single return statement of its parameters.
+std::optional<InlineCandidate> InlineCandidateOf(const FuncDefNode& func_def) {
+  if (!func_def.body || func_def.body->stmts.size() != 1) {
+    return std::nullopt;
+  }
+  const auto* ret_stmt =
+      DynCast<ReturnStmtNode>(func_def.body->stmts.front().get());
+  // Records are copied in and out of functions, which an expression doesn't
+  // do.
+  const auto& return_type = Cast<FuncType>(*func_def.type).return_type();
+  if (!ret_stmt || Isa<RecordType>(return_type) ||
+      !ret_stmt->expr->type->IsEqual(return_type)) {
+    return std::nullopt;
+  }
+  auto param_indices = std::unordered_map<std::string, std::size_t>{};
+  for (auto i = std::size_t{0}, e = func_def.parameters.size(); i < e; ++i) {
+    const auto& parameter = *func_def.parameters.at(i);
+    if (Isa<RecordType>(*parameter.type)) {
+      return std::nullopt;
+    }
+    param_indices.emplace(parameter.id, i);
+  }
+  auto candidate = InlineCandidate{&func_def};
+  candidate.uses.resize(func_def.parameters.size());
+  if (!AnalyzeReturnedExpr(*ret_stmt->expr, param_indices, candidate)) {
+    return std::nullopt;
+  }
+  return candidate;
+}
+
+/// @return Whether the arguments of `call_expr` can take the places of the
+/// parameters of `candidate`: each of them has the type of its parameter, and
+/// is evaluated as many times as it is by the call.
+bool CanInline(const FuncCallExprNode& call_expr,
+               const InlineCandidate& candidate) {
+  const auto& parameters = candidate.func_def->parameters;
+  if (call_expr.args.size() != parameters.size()) {
+    return false;
+  }
+  for (auto i = std::size_t{0}, e = parameters.size(); i < e; ++i) {
+    const auto& arg = *call_expr.args.at(i)->arg;
+    if (!arg.type->IsEqual(*parameters.at(i)->type)) {
+      return false;
+    }
+    const auto uses = candidate.uses.at(i);
+    const auto is_evaluated_once = uses == 1 && !candidate.is_conditional;
+    if (!is_evaluated_once && !IsTrivial(arg) && !(uses <= 1 && IsPure(arg))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Node>
+std::unique_ptr<ExprNode> WithTypeOf(const ExprNode& expr,
+                                     std::unique_ptr<Node> clone) {
+  clone->type = expr.type->Clone();
+  return clone;
+}
+
+/// @return A copy of the expression `expr` that a function returns, with the
+/// arguments in `args` in place of the parameters; each copied node is located
+/// at `loc`, the call.
+std::unique_ptr<ExprNode> Substitute(
+    const ExprNode& expr, Location loc,
+    const std::unordered_map<std::string, std::size_t>& param_indices,
+    const InlineCandidate& candidate,
+    std::vector<std::unique_ptr<ArgExprNode>>& args) {
+  if (!HasSufficientStack()) {
+    return WithSufficientStack([&] {
+      return Substitute(expr, loc, param_indices, candidate, args);
+    });
+  }
+  const auto substitute = [&](const ExprNode& operand) {
+    return Substitute(operand, loc, param_indices, candidate, args);
+  };
+  if (const auto* int_expr = DynCast<IntConstExprNode>(&expr)) {
+    return WithTypeOf(expr, std::make_unique<IntConstExprNode>(loc,
+                                                               int_expr->val));
+  }
+  if (const auto* id_expr = DynCast<IdExprNode>(&expr)) {
+    const auto i = param_indices.at(id_expr->id);
+    auto& arg = args.at(i)->arg;
+    if (candidate.uses.at(i) == 1) {
+      return std::move(arg);
+    }
+    // Only a trivial argument is used more than once.
+    if (const auto* arg_int = DynCast<IntConstExprNode>(arg.get())) {
+      return WithTypeOf(*arg, std::make_unique<IntConstExprNode>(
+                                  arg->loc, arg_int->val));
+    }
+    return WithTypeOf(*arg, std::make_unique<IdExprNode>(
+                                arg->loc, Cast<IdExprNode>(*arg).id));
+  }
+  if (const auto* unary_expr = DynCast<UnaryExprNode>(&expr)) {
+    return WithTypeOf(expr, std::make_unique<UnaryExprNode>(
+                                loc, unary_expr->op,
+                                substitute(*unary_expr->operand)));
+  }
+  if (const auto* bin_expr = DynCast<BinaryExprNode>(&expr)) {
+    auto lhs = substitute(*bin_expr->lhs);
+    auto rhs = substitute(*bin_expr->rhs);
+    return WithTypeOf(expr, std::make_unique<BinaryExprNode>(
+                                loc, bin_expr->op, std::move(lhs),
+                                std::move(rhs)));
+  }
+  const auto& cond_expr = Cast<CondExprNode>(expr);
+  auto predicate = substitute(*cond_expr.predicate);
+  auto then = substitute(*cond_expr.then);
+  auto or_else = substitute(*cond_expr.or_else);
+  return WithTypeOf(expr, std::make_unique<CondExprNode>(
+                              loc, std::move(predicate), std::move(then),
+                              std::move(or_else)));
+}
+
+}  // namespace
+
+std::unique_ptr<TransUnitNode> LinkTransUnits(
+    std::vector<std::unique_ptr<AstNode>> trans_units,
+    const std::vector<std::filesystem::path>& paths) {
+  assert(!trans_units.empty() && trans_units.size() == paths.size());
+  // The declarations keep their order, so each prototype still precedes the
+  // calls in its own file.
+  auto extern_decls = std::vector<std::unique_ptr<ExternDeclNode>>{};
+  auto file_of_func = std::unordered_map<std::string, std::size_t>{};
+  for (auto i = std::size_t{0}, e = trans_units.size(); i < e; ++i) {
+    for (auto& extern_decl :
+         Cast<TransUnitNode>(*trans_units.at(i)).extern_decls) {
+      if (const auto* func_def =
+              std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl)) {
+        const auto [defined, is_new] =
+            file_of_func.emplace((*func_def)->id, i);
+        if (!is_new) {
+          throw std::runtime_error{fmt::format(
+              "{}: redefinition of function '{}', which is defined in {}",
+              paths.at(i).string(), (*func_def)->id,
+              paths.at(defined->second).string())};
+        }
+      }
+      extern_decls.push_back(std::move(extern_decl));
+    }
+  }
+  return std::make_unique<TransUnitNode>(trans_units.front()->loc,
+                                         std::move(extern_decls));
+}
+
+void InterproceduralOptimizer::Optimize(TransUnitNode& trans_unit) {
+  funcs_.clear();
+  for (auto& extern_decl : trans_unit.extern_decls) {
+    if (auto* func_def =
+            std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl)) {
+      funcs_.emplace((*func_def)->id, func_def->get());
+    }
+  }
+  PropagateConstArgs_(trans_unit);
+  InlineCalls_(trans_unit);
+  RemoveDeadFuncs_(trans_unit);
+}
+
+void InterproceduralOptimizer::PropagateConstArgs_(TransUnitNode& trans_unit) {
+  // A function that is referred to other than by its calls may be called
+  // through a pointer, with any arguments.
+  const auto call_graph = CallGraph{trans_unit};
+  auto calls =
+      std::unordered_map<std::string, std::vector<FuncCallExprNode*>>{};
+  ExprSlotVisitor{[&calls](std::unique_ptr<ExprNode>& expr) {
+    auto* call_expr = DynCast<FuncCallExprNode>(expr.get());
+    if (const auto* callee = call_expr ? CalleeOf(*call_expr) : nullptr) {
+      calls[*callee].push_back(call_expr);
+    }
+  }}.Dispatch(trans_unit);
+  // The prototypes have their parameters removed as well.
+  auto prototypes =
+      std::unordered_map<std::string, std::vector<FuncDefNode*>>{};
+  for (auto& extern_decl : trans_unit.extern_decls) {
+    if (auto* decl_stmt =
+            std::get_if<std::unique_ptr<DeclStmtNode>>(&extern_decl->decl)) {
+      for (auto& decl : (*decl_stmt)->decls) {
+        if (auto* prototype = DynCast<FuncDefNode>(decl.get())) {
+          prototypes[prototype->id].push_back(prototype);
+        }
+      }
+    }
+  }
+
+  // A parameter that is passed on as the argument of another call makes the
+  // argument a constant once it is replaced; so the functions are visited
+  // again until nothing changes.
+  for (auto is_any_changed = true; is_any_changed;) {
+    is_any_changed = false;
+    for (auto& extern_decl : trans_unit.extern_decls) {
+      auto* func =
+          std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl);
+      if (!func || (*func)->id == "main" || calls.count((*func)->id) == 0) {
+        continue;
+      }
+      auto& func_def = **func;
+      const auto& id = func_def.id;
+      const auto& func_calls = calls.at(id);
+      if (call_graph.IsAddressTaken(id)) {
+        continue;
+      }
+      // A parameter that is modified or shadowed doesn't hold the constant
+      // throughout the body.
+      auto unsafe_ids = std::unordered_set<std::string>{};
+      ExprSlotVisitor{[&](std::unique_ptr<ExprNode>& expr) {
+                        if (const auto* var = VarWrittenBy(*expr)) {
+                          unsafe_ids.insert(*var);
+                        }
+                      },
+                      [&](const DeclNode& decl) { unsafe_ids.insert(decl.id); }}
+          .Dispatch(*func_def.body);
+
+      auto is_changed = false;
+      // Backwards, so that the indices of the remaining parameters stay valid.
+      for (auto i = func_def.parameters.size(); i-- > 0;) {
+        const auto& parameter = *func_def.parameters.at(i);
+        if (!parameter.type->IsEqual(PrimitiveType::kInt) ||
+            unsafe_ids.count(parameter.id)) {
+          continue;
+        }
+        const auto* first_arg = DynCast<IntConstExprNode>(
+            func_calls.front()->args.at(i)->arg.get());
+        // A constant of another type than the parameter would have to be
+        // converted to it.
+        const auto is_const =
+            first_arg && first_arg->type->IsEqual(PrimitiveType::kInt) &&
+            std::all_of(func_calls.cbegin(), func_calls.cend(),
+                        [i, first_arg](const FuncCallExprNode* call_expr) {
+                          const auto* arg = DynCast<IntConstExprNode>(
+                              call_expr->args.at(i)->arg.get());
+                          return arg && arg->val == first_arg->val;
+                        });
+        if (!is_const) {
+          continue;
+        }
+        const auto val = first_arg->val;
+        ExprSlotVisitor{[&](std::unique_ptr<ExprNode>& expr) {
+          const auto* id_expr = DynCast<IdExprNode>(expr.get());
+          if (id_expr && id_expr->id == parameter.id) {
+            expr = WithTypeOf(
+                *expr, std::make_unique<IntConstExprNode>(expr->loc, val));
+          }
+        }}.Dispatch(*func_def.body);
+        // The arguments are constants, which have no side effects to keep.
+        for (auto* call_expr : func_calls) {
+          call_expr->args.erase(call_expr->args.begin() +
+                                static_cast<std::ptrdiff_t>(i));
+        }
+        for (auto* prototype : prototypes[id]) {
+          if (prototype->parameters.size() > i) {
+            prototype->parameters.erase(prototype->parameters.begin() +
+                                        static_cast<std::ptrdiff_t>(i));
+          }
+        }
+        func_def.parameters.erase(func_def.parameters.begin() +
+                                  static_cast<std::ptrdiff_t>(i));
+        is_changed = true;
+        is_any_changed = true;
+      }
+      if (!is_changed) {
+        continue;
+      }
+
+      auto param_types = std::vector<std::unique_ptr<Type>>{};
+      for (const auto& parameter : func_def.parameters) {
+        param_types.push_back(parameter->type->Clone());
+      }
+      func_def.type = std::make_unique<FuncType>(
+          Cast<FuncType>(*func_def.type).return_type().Clone(),
+          std::move(param_types));
+      for (auto* call_expr : func_calls) {
+        call_expr->func_expr->type = func_def.type->Clone();
+      }
+      for (auto* prototype : prototypes[id]) {
+        prototype->type = func_def.type->Clone();
+      }
+    }
+  }
+}
+
+void InterproceduralOptimizer::InlineCalls_(TransUnitNode& trans_unit) {
+  auto candidates = std::unordered_map<std::string, InlineCandidate>{};
+  for (const auto& [id, func_def] : funcs_) {
+    if (id == "main") {
+      continue;
+    }
+    if (auto candidate = InlineCandidateOf(*func_def)) {
+      candidates.emplace(id, std::move(*candidate));
+    }
+  }
+  if (candidates.empty()) {
+    return;
+  }
+  // The arguments are inlined before the calls that they are passed to.
+  auto inliner = ExprSlotVisitor{[&](std::unique_ptr<ExprNode>& expr) {
+    auto* call_expr = DynCast<FuncCallExprNode>(expr.get());
+    const auto* callee = call_expr ? CalleeOf(*call_expr) : nullptr;
+    const auto candidate =
+        callee ? candidates.find(*callee) : candidates.end();
+    if (candidate == candidates.end() ||
+        !CanInline(*call_expr, candidate->second)) {
+      return;
+    }
+    const auto& func_def = *candidate->second.func_def;
+    auto param_indices = std::unordered_map<std::string, std::size_t>{};
+    for (auto i = std::size_t{0}, e = func_def.parameters.size(); i < e; ++i) {
+      param_indices.emplace(func_def.parameters.at(i)->id, i);
+    }
+    const auto& ret_stmt =
+        Cast<ReturnStmtNode>(*func_def.body->stmts.front());
+    // The call, along with the arguments that are moved out of it, is
+    // destroyed by the replacement.
+    expr = Substitute(*ret_stmt.expr, call_expr->loc, param_indices,
+                      candidate->second, call_expr->args);
+  }};
+  for (auto& extern_decl : trans_unit.extern_decls) {
+    const auto* func_def =
+        std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl->decl);
+    if (!func_def || !profile_ ||
+        profile_->EntryCountOf((*func_def)->id) != 0) {
+      inliner.Dispatch(*extern_decl);
+    }
+  }
+}
+
+void InterproceduralOptimizer::RemoveDeadFuncs_(TransUnitNode& trans_unit) {
+  // Without `main`, the functions may be called from outside the program.
+  if (funcs_.count("main") == 0) {
+    return;
+  }
+  const auto reachable = CallGraph{trans_unit}.ReachableFrom({"main"});
+
+  auto& extern_decls = trans_unit.extern_decls;
+  extern_decls.erase(
+      std::remove_if(extern_decls.begin(), extern_decls.end(),
+                     [&reachable](const auto& extern_decl) {
+                       const auto* func_def =
+                           std::get_if<std::unique_ptr<FuncDefNode>>(
+                               &extern_decl->decl);
+                       return func_def && reachable.count((*func_def)->id) == 0;
+                     }),
+      extern_decls.end());
+  for (auto it = funcs_.begin(); it != funcs_.end();) {
+    it = reachable.count(it->first) ? std::next(it) : funcs_.erase(it);
+  }
+}
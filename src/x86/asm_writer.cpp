@@ -0,0 +1,905 @@
+#include "x86/asm_writer.hpp"
+
+#include <fmt/core.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "x86/linear_scan.hpp"
+#include "x86/mir.hpp"
+#include "x86/register.hpp"
+
+namespace x86 {
+
+namespace {
+
+constexpr auto kNumOfRecordRegs = std::size_t{2};
+constexpr auto kEightBytes = std::size_t{8};
+
+std::int64_t AlignUp(std::int64_t n, std::int64_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+std::size_t SizeOf(Width width) {
+  return width == Width::kLong ? kEightBytes : 4;
+}
+
+char SuffixOf(std::size_t size) {
+  switch (size) {
+    case 1:
+      return 'b';
+    case 2:
+      return 'w';
+    case 4:
+      return 'l';
+    default:
+      return 'q';
+  }
+}
+
+char SuffixOf(Width width) {
+  return SuffixOf(SizeOf(width));
+}
+
+std::string_view CondCodeOf(Cond cond) {
+  switch (cond) {
+    case Cond::kEq:
+      return "e";
+    case Cond::kNe:
+      return "ne";
+    case Cond::kLt:
+      return "l";
+    case Cond::kLe:
+      return "le";
+    case Cond::kGt:
+      return "g";
+    case Cond::kGe:
+      return "ge";
+    case Cond::kBelow:
+      return "b";
+    case Cond::kBelowEq:
+      return "be";
+    case Cond::kAbove:
+      return "a";
+    default:
+      return "ae";
+  }
+}
+
+bool FitsInImm32(std::int64_t val) {
+  return val >= std::numeric_limits<std::int32_t>::min() &&
+         val <= std::numeric_limits<std::int32_t>::max();
+}
+
+/// @brief How an argument or a parameter is passed: in `num_of_regs` registers
+/// from the `reg_index`-th argument register, or in memory at `stack_offset`
+/// of the argument area.
+struct Passing {
+  std::size_t reg_index = 0;
+  std::size_t num_of_regs = 0;
+  std::int64_t stack_offset = 0;
+};
+
+/// @brief Classifies the integers, pointers and records of `sizes` by the
+/// System V ABI. Every member of a record is an integer or a pointer, so a
+/// record of up to 16 bytes is passed in as many registers as its eightbytes.
+class ArgClassifier {
+ public:
+  explicit ArgClassifier(bool has_hidden_ret_ptr)
+      : num_of_used_regs_{has_hidden_ret_ptr ? std::size_t{1} : 0} {}
+
+  Passing Classify(bool is_record, std::size_t size) {
+    const auto num_of_regs =
+        is_record ? (size + kEightBytes - 1) / kEightBytes : 1;
+    if (num_of_regs <= kNumOfRecordRegs &&
+        num_of_used_regs_ + num_of_regs <= kArgRegs.size()) {
+      const auto passing = Passing{num_of_used_regs_, num_of_regs};
+      num_of_used_regs_ += num_of_regs;
+      return passing;
+    }
+    const auto passing = Passing{0, 0, stack_size_};
+    stack_size_ += AlignUp(static_cast<std::int64_t>(size), kEightBytes);
+    return passing;
+  }
+
+  /// @return The size of the arguments passed in memory.
+  std::int64_t stack_size() const noexcept {  // NOLINT(readability-identifier-naming)
+    return stack_size_;
+  }
+
+ private:
+  std::size_t num_of_used_regs_;
+  std::int64_t stack_size_ = 0;
+};
+
+/// @brief A memory operand, `offset(base)`.
+struct Addr {
+  Reg base;
+  std::int64_t offset = 0;
+
+  Addr Plus(std::int64_t more) const {
+    return {base, offset + more};
+  }
+};
+
+}  // namespace
+
+}  // namespace x86
+
+template <>
+struct fmt::formatter<x86::Addr> : formatter<std::string_view> {
+  template <typename FormatContext>
+  auto format(const x86::Addr& addr, FormatContext& ctx) const {
+    const auto base = x86::NameOf(addr.base, x86::kEightBytes);
+    if (addr.offset == 0) {
+      return fmt::format_to(ctx.out(), "({})", base);
+    }
+    return fmt::format_to(ctx.out(), "{}({})", addr.offset, base);
+  }
+};
+
+namespace x86 {
+
+namespace {
+
+class AsmWriter {
+ public:
+  AsmWriter(const Function& function, const Allocation& allocation,
+            std::ostream& output)
+      : function_{function}, allocation_{allocation}, output_{output} {}
+
+  void Write() {
+    LayOutFrame_();
+    WritePrologue_();
+    // The instructions that can't be reached, such as the implicit return
+    // after a return statement, are left out.
+    auto is_reachable = true;
+    for (index_ = 0; index_ < function_.instrs.size(); ++index_) {
+      const auto& instr = function_.instrs.at(index_);
+      is_reachable |= instr.op == Opcode::kLabel;
+      if (is_reachable) {
+        WriteInstr_(instr);
+        is_reachable = !IsTerminator(instr);
+      }
+    }
+    WriteEpilogue_();
+  }
+
+ private:
+  const Function& function_;
+  const Allocation& allocation_;
+  std::ostream& output_;
+  /// @brief The offset of each slot from %rbp.
+  std::vector<std::int64_t> slot_offsets_{};
+  /// @brief The offset of each saved callee-saved register from %rbp.
+  std::vector<std::int64_t> saved_reg_offsets_{};
+  /// @brief The offset of the saved pointer to the returned record, if any.
+  std::int64_t ret_ptr_offset_ = 0;
+  std::int64_t frame_size_ = 0;
+  /// @brief How each parameter is passed.
+  std::vector<Passing> param_passings_{};
+  /// @brief The index of the instruction being written.
+  std::size_t index_ = 0;
+
+  static constexpr auto kIndentStr = "\t";
+
+  template <typename... T>
+  void Write_(fmt::format_string<T...> format, T&&... args) {
+    fmt::print(output_, format, std::forward<T>(args)...);
+  }
+
+  template <typename... T>
+  void WriteLine_(fmt::format_string<T...> format, T&&... args) {
+    Write_(kIndentStr);
+    Write_(format, std::forward<T>(args)...);
+    Write_("\n");
+  }
+
+  bool HasHiddenRetPtr_() const {
+    return function_.ret_record_size > kNumOfRecordRegs * kEightBytes;
+  }
+
+  void LayOutFrame_() {
+    slot_offsets_.resize(function_.slots.size());
+    auto size = std::int64_t{0};
+    for (auto i = std::size_t{0};
+         i < allocation_.used_callee_saved_regs.size(); ++i) {
+      size += kEightBytes;
+      saved_reg_offsets_.push_back(-size);
+    }
+    if (HasHiddenRetPtr_()) {
+      size += kEightBytes;
+      ret_ptr_offset_ = -size;
+    }
+    // The parameters passed in memory are used in place; they are above the
+    // return address and the saved %rbp.
+    constexpr auto kArgAreaOffset = std::int64_t{16};
+    auto classifier = ArgClassifier{HasHiddenRetPtr_()};
+    auto is_placed = std::vector<bool>(function_.slots.size());
+    for (const auto& param : function_.params) {
+      const auto passing = classifier.Classify(param.is_record, param.size);
+      param_passings_.push_back(passing);
+      if (passing.num_of_regs == 0) {
+        const auto slot = static_cast<std::size_t>(param.slot);
+        slot_offsets_.at(slot) = kArgAreaOffset + passing.stack_offset;
+        is_placed.at(slot) = true;
+      }
+    }
+    for (auto i = std::size_t{0}, e = function_.slots.size(); i < e; ++i) {
+      if (is_placed.at(i)) {
+        continue;
+      }
+      const auto& slot = function_.slots.at(i);
+      size = AlignUp(size + static_cast<std::int64_t>(slot.size),
+                     static_cast<std::int64_t>(slot.alignment));
+      slot_offsets_.at(i) = -size;
+    }
+    constexpr auto kStackAlignment = std::int64_t{16};
+    frame_size_ = AlignUp(size, kStackAlignment);
+  }
+
+  void WritePrologue_() {
+    Write_("{}.text\n", kIndentStr);
+    Write_("{}.globl {}\n", kIndentStr, function_.name);
+    Write_("{}:\n", function_.name);
+    WriteLine_("pushq %rbp");
+    WriteLine_("movq %rsp, %rbp");
+    if (frame_size_ != 0) {
+      WriteLine_("subq ${}, %rsp", frame_size_);
+    }
+    for (auto i = std::size_t{0};
+         i < allocation_.used_callee_saved_regs.size(); ++i) {
+      WriteLine_("movq {}, {}",
+                 NameOf(allocation_.used_callee_saved_regs.at(i), kEightBytes),
+                 Addr{Reg::kRbp, saved_reg_offsets_.at(i)});
+    }
+    if (HasHiddenRetPtr_()) {
+      WriteLine_("movq %rdi, {}", Addr{Reg::kRbp, ret_ptr_offset_});
+    }
+    for (auto i = std::size_t{0}, e = function_.params.size(); i < e; ++i) {
+      const auto& param = function_.params.at(i);
+      const auto& passing = param_passings_.at(i);
+      const auto addr = SlotAddr_(param.slot);
+      if (passing.num_of_regs == 0) {
+        continue;
+      }
+      if (!param.is_record) {
+        const auto reg = kArgRegs.at(passing.reg_index);
+        WriteLine_("mov{} {}, {}", SuffixOf(param.size),
+                   NameOf(reg, param.size), addr);
+        continue;
+      }
+      for (auto k = std::size_t{0}; k < passing.num_of_regs; ++k) {
+        StorePartial_(kArgRegs.at(passing.reg_index + k),
+                      addr.Plus(static_cast<std::int64_t>(k * kEightBytes)),
+                      std::min(kEightBytes, param.size - k * kEightBytes));
+      }
+    }
+  }
+
+  void WriteEpilogue_() {
+    Write_("{}:\n", RetLabel_());
+    for (auto i = std::size_t{0};
+         i < allocation_.used_callee_saved_regs.size(); ++i) {
+      WriteLine_("movq {}, {}", Addr{Reg::kRbp, saved_reg_offsets_.at(i)},
+                 NameOf(allocation_.used_callee_saved_regs.at(i), kEightBytes));
+    }
+    WriteLine_("leave");
+    WriteLine_("ret");
+    // The stack isn't executable.
+    Write_("{}.section .note.GNU-stack,\"\",@progbits\n", kIndentStr);
+  }
+
+  std::string LabelName_(Label label) const {
+    return fmt::format(".L{}.{}", function_.name, label);
+  }
+
+  std::string RetLabel_() const {
+    return fmt::format(".L{}.ret", function_.name);
+  }
+
+  /// @return Whether the next instruction defines `label`, so that a jump to
+  /// it can fall through instead.
+  bool IsNextLabel_(Label label) const {
+    const auto next = index_ + 1;
+    return next < function_.instrs.size() &&
+           function_.instrs.at(next).op == Opcode::kLabel &&
+           function_.instrs.at(next).label == label;
+  }
+
+  const Location& LocationOf_(VReg vreg) const {
+    return allocation_.locations.at(static_cast<std::size_t>(vreg));
+  }
+
+  Addr SlotAddr_(int slot) const {
+    return {Reg::kRbp, slot_offsets_.at(static_cast<std::size_t>(slot))};
+  }
+
+  /// @return The lower `size` bytes of the register or the spill slot of
+  /// `vreg`.
+  std::string Loc_(VReg vreg, std::size_t size) const {
+    const auto& location = LocationOf_(vreg);
+    if (location.is_spilled) {
+      return fmt::format("{}", SlotAddr_(location.slot));
+    }
+    return std::string{NameOf(location.reg, size)};
+  }
+
+  /// @return The register of `vreg` if it's not spilled.
+  std::optional<Reg> RegOf_(VReg vreg) const {
+    const auto& location = LocationOf_(vreg);
+    if (location.is_spilled) {
+      return std::nullopt;
+    }
+    return location.reg;
+  }
+
+  /// @return The register that a result to `dst` is computed in: the register
+  /// of `dst`, or %rax if it's spilled.
+  Reg TargetOf_(VReg dst) const {
+    return RegOf_(dst).value_or(Reg::kRax);
+  }
+
+  /// @return The address of `mem`; a spilled base is loaded to `scratch`.
+  Addr AddrOf_(const Mem& mem, Reg scratch) {
+    if (mem.base == Mem::Base::kSlot) {
+      return SlotAddr_(mem.id).Plus(mem.offset);
+    }
+    if (auto reg = RegOf_(mem.id)) {
+      return {*reg, mem.offset};
+    }
+    WriteLine_("movq {}, {}", Loc_(mem.id, kEightBytes),
+               NameOf(scratch, kEightBytes));
+    return {scratch, mem.offset};
+  }
+
+  /// @return The source operand of `operand`; a long immediate that doesn't
+  /// fit in 32 bits is loaded to `scratch`.
+  std::string Src_(const Operand& operand, Width width, Reg scratch) {
+    const auto size = SizeOf(width);
+    if (operand.IsVReg()) {
+      return Loc_(operand.vreg(), size);
+    }
+    if (width == Width::kWord) {
+      return fmt::format("${}", static_cast<std::int32_t>(operand.val));
+    }
+    if (FitsInImm32(operand.val)) {
+      return fmt::format("${}", operand.val);
+    }
+    WriteLine_("movabsq ${}, {}", operand.val, NameOf(scratch, kEightBytes));
+    return std::string{NameOf(scratch, kEightBytes)};
+  }
+
+  /// @brief Loads `operand` to `reg`.
+  void LoadReg_(Reg reg, const Operand& operand, Width width) {
+    const auto size = SizeOf(width);
+    if (operand.IsVReg() && RegOf_(operand.vreg()) == reg) {
+      return;
+    }
+    if (operand.IsImm() && operand.val == 0) {
+      WriteLine_("xorl {0}, {0}", NameOf(reg, 4));
+      return;
+    }
+    if (operand.IsImm() && width == Width::kLong &&
+        !FitsInImm32(operand.val)) {
+      WriteLine_("movabsq ${}, {}", operand.val, NameOf(reg, kEightBytes));
+      return;
+    }
+    WriteLine_("mov{} {}, {}", SuffixOf(width), Src_(operand, width, reg),
+               NameOf(reg, size));
+  }
+
+  /// @brief Moves the result in `reg` to `dst`.
+  void StoreDst_(VReg dst, Reg reg, Width width) {
+    if (RegOf_(dst) == reg) {
+      return;
+    }
+    const auto size = SizeOf(width);
+    WriteLine_("mov{} {}, {}", SuffixOf(width), NameOf(reg, size),
+               Loc_(dst, size));
+  }
+
+  /// @brief Copies `size` bytes from `src` to `dst` through `data`.
+  void CopyBytes_(Addr src, Addr dst, std::size_t size, Reg data) {
+    for (auto offset = std::size_t{0}; offset < size;) {
+      auto chunk = kEightBytes;
+      while (chunk > size - offset) {
+        chunk /= 2;
+      }
+      const auto delta = static_cast<std::int64_t>(offset);
+      WriteLine_("mov{} {}, {}", SuffixOf(chunk), src.Plus(delta),
+                 NameOf(data, chunk));
+      WriteLine_("mov{} {}, {}", SuffixOf(chunk), NameOf(data, chunk),
+                 dst.Plus(delta));
+      offset += chunk;
+    }
+  }
+
+  /// @brief Loads the `size` bytes at `src`, which is at most 8, to `reg`
+  /// without reading past them; the bytes that can't be loaded at once are
+  /// loaded through `tmp` and combined.
+  void LoadPartial_(Reg reg, Addr src, std::size_t size, Reg tmp) {
+    // The pieces are loaded from the last one, shifting the loaded ones up.
+    auto pieces = std::vector<std::pair<std::size_t, std::size_t>>{};
+    for (auto offset = std::size_t{0}; offset < size;) {
+      auto piece = kEightBytes;
+      while (piece > size - offset) {
+        piece /= 2;
+      }
+      pieces.emplace_back(offset, piece);
+      offset += piece;
+    }
+    const auto load = [this, src](Reg to, std::size_t offset,
+                                  std::size_t piece) {
+      const auto addr = src.Plus(static_cast<std::int64_t>(offset));
+      switch (piece) {
+        case 1:
+          WriteLine_("movzbl {}, {}", addr, NameOf(to, 4));
+          break;
+        case 2:
+          WriteLine_("movzwl {}, {}", addr, NameOf(to, 4));
+          break;
+        case 4:
+          WriteLine_("movl {}, {}", addr, NameOf(to, 4));
+          break;
+        default:
+          WriteLine_("movq {}, {}", addr, NameOf(to, kEightBytes));
+          break;
+      }
+    };
+    load(reg, pieces.back().first, pieces.back().second);
+    for (auto it = std::next(pieces.rbegin()); it != pieces.rend(); ++it) {
+      WriteLine_("shlq ${}, {}", it->second * 8, NameOf(reg, kEightBytes));
+      load(tmp, it->first, it->second);
+      WriteLine_("orq {}, {}", NameOf(tmp, kEightBytes),
+                 NameOf(reg, kEightBytes));
+    }
+  }
+
+  /// @brief Stores the lower `size` bytes of `reg`, which is at most 8, to
+  /// `dst` without writing past them.
+  /// @note `reg` is shifted in place.
+  void StorePartial_(Reg reg, Addr dst, std::size_t size) {
+    auto shifted = std::size_t{0};
+    for (auto offset = std::size_t{0}; offset < size;) {
+      auto piece = kEightBytes;
+      while (piece > size - offset) {
+        piece /= 2;
+      }
+      if (offset != shifted) {
+        WriteLine_("shrq ${}, {}", (offset - shifted) * 8,
+                   NameOf(reg, kEightBytes));
+        shifted = offset;
+      }
+      WriteLine_("mov{} {}, {}", SuffixOf(piece), NameOf(reg, piece),
+                 dst.Plus(static_cast<std::int64_t>(offset)));
+      offset += piece;
+    }
+  }
+
+  void WriteInstr_(const Instr& instr) {
+    switch (instr.op) {
+      case Opcode::kCopy:
+        WriteCopy_(instr);
+        break;
+      case Opcode::kAdd:
+      case Opcode::kSub:
+      case Opcode::kMul:
+      case Opcode::kAnd:
+      case Opcode::kOr:
+      case Opcode::kXor:
+        WriteArith_(instr);
+        break;
+      case Opcode::kShl:
+      case Opcode::kSar:
+      case Opcode::kShr:
+        WriteShift_(instr);
+        break;
+      case Opcode::kDiv:
+      case Opcode::kUDiv:
+      case Opcode::kRem:
+      case Opcode::kURem:
+        WriteDivision_(instr);
+        break;
+      case Opcode::kNeg:
+      case Opcode::kNot: {
+        const auto target = TargetOf_(instr.dst);
+        LoadReg_(target, instr.lhs, instr.width);
+        WriteLine_("{}{} {}", instr.op == Opcode::kNeg ? "neg" : "not",
+                   SuffixOf(instr.width), NameOf(target, SizeOf(instr.width)));
+        StoreDst_(instr.dst, target, instr.width);
+      } break;
+      case Opcode::kCmp: {
+        LoadReg_(Reg::kRax, instr.lhs, instr.width);
+        WriteLine_("cmp{} {}, {}", SuffixOf(instr.width),
+                   Src_(instr.rhs, instr.width, Reg::kR11),
+                   NameOf(Reg::kRax, SizeOf(instr.width)));
+        const auto target = TargetOf_(instr.dst);
+        WriteLine_("set{} %al", CondCodeOf(instr.cond));
+        WriteLine_("movzbl %al, {}", NameOf(target, 4));
+        StoreDst_(instr.dst, target, Width::kWord);
+      } break;
+      case Opcode::kExt:
+        WriteExt_(instr);
+        break;
+      case Opcode::kLoad:
+        WriteLoad_(instr);
+        break;
+      case Opcode::kStore:
+        WriteStore_(instr);
+        break;
+      case Opcode::kLea: {
+        const auto addr = AddrOf_(instr.mem, Reg::kR11);
+        const auto target = TargetOf_(instr.dst);
+        WriteLine_("leaq {}, {}", addr, NameOf(target, kEightBytes));
+        StoreDst_(instr.dst, target, Width::kLong);
+      } break;
+      case Opcode::kFuncAddr: {
+        const auto target = TargetOf_(instr.dst);
+        WriteLine_("leaq {}(%rip), {}", function_.symbols.at(instr.size),
+                   NameOf(target, kEightBytes));
+        StoreDst_(instr.dst, target, Width::kLong);
+      } break;
+      case Opcode::kBlit:
+        CopyBytes_(AddrOf_(instr.src_mem, Reg::kRcx),
+                   AddrOf_(instr.mem, Reg::kR11), instr.size, Reg::kRax);
+        break;
+      case Opcode::kCall:
+        WriteCall_(instr);
+        break;
+      case Opcode::kLabel:
+        Write_("{}:\n", LabelName_(instr.label));
+        break;
+      case Opcode::kJmp:
+        if (!IsNextLabel_(instr.label)) {
+          WriteLine_("jmp {}", LabelName_(instr.label));
+        }
+        break;
+      case Opcode::kJnz:
+        WriteJnz_(instr);
+        break;
+      case Opcode::kRet:
+        if (instr.lhs.kind != Operand::Kind::kNone) {
+          LoadReg_(Reg::kRax, instr.lhs, instr.width);
+        }
+        WriteJmpToRet_();
+        break;
+      case Opcode::kRetRecord:
+        WriteRetRecord_(instr);
+        break;
+    }
+  }
+
+  void WriteCopy_(const Instr& instr) {
+    if (auto reg = RegOf_(instr.dst)) {
+      LoadReg_(*reg, instr.lhs, instr.width);
+      return;
+    }
+    if (instr.lhs.IsVReg() && !RegOf_(instr.lhs.vreg())) {
+      LoadReg_(Reg::kRax, instr.lhs, instr.width);
+      StoreDst_(instr.dst, Reg::kRax, instr.width);
+      return;
+    }
+    WriteLine_("mov{} {}, {}", SuffixOf(instr.width),
+               Src_(instr.lhs, instr.width, Reg::kRax),
+               Loc_(instr.dst, SizeOf(instr.width)));
+  }
+
+  void WriteArith_(const Instr& instr) {
+    const auto* mnemonic = "";
+    switch (instr.op) {
+      case Opcode::kAdd:
+        mnemonic = "add";
+        break;
+      case Opcode::kSub:
+        mnemonic = "sub";
+        break;
+      case Opcode::kMul:
+        mnemonic = "imul";
+        break;
+      case Opcode::kAnd:
+        mnemonic = "and";
+        break;
+      case Opcode::kOr:
+        mnemonic = "or";
+        break;
+      default:
+        mnemonic = "xor";
+        break;
+    }
+    // NOTE: The result never shares a register with an operand, since they are
+    // all live at the instruction.
+    const auto target = TargetOf_(instr.dst);
+    LoadReg_(target, instr.lhs, instr.width);
+    WriteLine_("{}{} {}, {}", mnemonic, SuffixOf(instr.width),
+               Src_(instr.rhs, instr.width, Reg::kR11),
+               NameOf(target, SizeOf(instr.width)));
+    StoreDst_(instr.dst, target, instr.width);
+  }
+
+  void WriteShift_(const Instr& instr) {
+    const auto* mnemonic = instr.op == Opcode::kShl   ? "shl"
+                           : instr.op == Opcode::kSar ? "sar"
+                                                      : "shr";
+    const auto target = TargetOf_(instr.dst);
+    const auto size = SizeOf(instr.width);
+    if (instr.rhs.IsImm()) {
+      LoadReg_(target, instr.lhs, instr.width);
+      WriteLine_("{}{} ${}, {}", mnemonic, SuffixOf(instr.width),
+                 instr.rhs.val & static_cast<std::int64_t>(size * 8 - 1),
+                 NameOf(target, size));
+    } else {
+      // The amount is taken from %cl.
+      LoadReg_(Reg::kRcx, instr.rhs, Width::kWord);
+      LoadReg_(target, instr.lhs, instr.width);
+      WriteLine_("{}{} %cl, {}", mnemonic, SuffixOf(instr.width),
+                 NameOf(target, size));
+    }
+    StoreDst_(instr.dst, target, instr.width);
+  }
+
+  void WriteDivision_(const Instr& instr) {
+    const auto is_signed =
+        instr.op == Opcode::kDiv || instr.op == Opcode::kRem;
+    // The dividend is %rdx:%rax, which is sign- or zero-extended from %rax.
+    LoadReg_(Reg::kRax, instr.lhs, instr.width);
+    if (is_signed) {
+      WriteLine_(instr.width == Width::kLong ? "cqto" : "cltd");
+    } else {
+      WriteLine_("xorl %edx, %edx");
+    }
+    auto divisor = std::string{};
+    if (instr.rhs.IsImm()) {
+      LoadReg_(Reg::kR11, instr.rhs, instr.width);
+      divisor = NameOf(Reg::kR11, SizeOf(instr.width));
+    } else {
+      divisor = Loc_(instr.rhs.vreg(), SizeOf(instr.width));
+    }
+    WriteLine_("{}{} {}", is_signed ? "idiv" : "div", SuffixOf(instr.width),
+               divisor);
+    const auto is_rem = instr.op == Opcode::kRem || instr.op == Opcode::kURem;
+    StoreDst_(instr.dst, is_rem ? Reg::kRdx : Reg::kRax, instr.width);
+  }
+
+  void WriteExt_(const Instr& instr) {
+    const auto target = TargetOf_(instr.dst);
+    const auto width =
+        instr.ext == Ext::kSignedWord || instr.ext == Ext::kUnsignedWord
+            ? Width::kLong
+            : Width::kWord;
+    if (instr.lhs.IsImm()) {
+      LoadReg_(target, instr.lhs, width);
+      StoreDst_(instr.dst, target, width);
+      return;
+    }
+    const auto vreg = instr.lhs.vreg();
+    switch (instr.ext) {
+      case Ext::kSignedWord:
+        WriteLine_("movslq {}, {}", Loc_(vreg, 4), NameOf(target, kEightBytes));
+        break;
+      case Ext::kUnsignedWord:
+        WriteLine_("movl {}, {}", Loc_(vreg, 4), NameOf(target, 4));
+        break;
+      case Ext::kSignedHalf:
+        WriteLine_("movswl {}, {}", Loc_(vreg, 2), NameOf(target, 4));
+        break;
+      case Ext::kUnsignedHalf:
+        WriteLine_("movzwl {}, {}", Loc_(vreg, 2), NameOf(target, 4));
+        break;
+      case Ext::kSignedByte:
+        WriteLine_("movsbl {}, {}", Loc_(vreg, 1), NameOf(target, 4));
+        break;
+      case Ext::kUnsignedByte:
+        WriteLine_("movzbl {}, {}", Loc_(vreg, 1), NameOf(target, 4));
+        break;
+    }
+    StoreDst_(instr.dst, target, width);
+  }
+
+  void WriteLoad_(const Instr& instr) {
+    const auto addr = AddrOf_(instr.mem, Reg::kR11);
+    const auto target = TargetOf_(instr.dst);
+    switch (instr.size) {
+      case 1:
+        WriteLine_("mov{}bl {}, {}", instr.is_signed ? 's' : 'z', addr,
+                   NameOf(target, 4));
+        break;
+      case 2:
+        WriteLine_("mov{}wl {}, {}", instr.is_signed ? 's' : 'z', addr,
+                   NameOf(target, 4));
+        break;
+      default:
+        WriteLine_("mov{} {}, {}", SuffixOf(instr.size), addr,
+                   NameOf(target, instr.size));
+        break;
+    }
+    StoreDst_(instr.dst, target, instr.width);
+  }
+
+  void WriteStore_(const Instr& instr) {
+    const auto addr = AddrOf_(instr.mem, Reg::kR11);
+    const auto size = instr.size;
+    if (instr.lhs.IsImm() &&
+        (size != kEightBytes || FitsInImm32(instr.lhs.val))) {
+      auto val = instr.lhs.val;
+      switch (size) {
+        case 1:
+          val = static_cast<std::int8_t>(val);
+          break;
+        case 2:
+          val = static_cast<std::int16_t>(val);
+          break;
+        case 4:
+          val = static_cast<std::int32_t>(val);
+          break;
+        default:
+          break;
+      }
+      WriteLine_("mov{} ${}, {}", SuffixOf(size), val, addr);
+      return;
+    }
+    auto reg = instr.lhs.IsVReg() ? RegOf_(instr.lhs.vreg()) : std::nullopt;
+    if (!reg) {
+      LoadReg_(Reg::kRax, instr.lhs,
+               size == kEightBytes ? Width::kLong : Width::kWord);
+      reg = Reg::kRax;
+    }
+    WriteLine_("mov{} {}, {}", SuffixOf(size), NameOf(*reg, size), addr);
+  }
+
+  void WriteJnz_(const Instr& instr) {
+    if (instr.lhs.IsImm()) {
+      const auto label = instr.lhs.val != 0 ? instr.label : instr.else_label;
+      if (!IsNextLabel_(label)) {
+        WriteLine_("jmp {}", LabelName_(label));
+      }
+      return;
+    }
+    const auto vreg = instr.lhs.vreg();
+    const auto size = SizeOf(instr.width);
+    if (auto reg = RegOf_(vreg)) {
+      WriteLine_("test{0} {1}, {1}", SuffixOf(instr.width), NameOf(*reg, size));
+    } else {
+      WriteLine_("cmp{} $0, {}", SuffixOf(instr.width), Loc_(vreg, size));
+    }
+    if (IsNextLabel_(instr.label)) {
+      WriteLine_("je {}", LabelName_(instr.else_label));
+      return;
+    }
+    WriteLine_("jne {}", LabelName_(instr.label));
+    if (!IsNextLabel_(instr.else_label)) {
+      WriteLine_("jmp {}", LabelName_(instr.else_label));
+    }
+  }
+
+  /// @brief Jumps to the epilogue, unless no label follows, in which case
+  /// the rest of the instructions are left out and the epilogue comes next.
+  void WriteJmpToRet_() {
+    const auto& instrs = function_.instrs;
+    if (std::any_of(std::next(instrs.cbegin(),
+                              static_cast<std::ptrdiff_t>(index_ + 1)),
+                    instrs.cend(), [](const Instr& instr) {
+                      return instr.op == Opcode::kLabel;
+                    })) {
+      WriteLine_("jmp {}", RetLabel_());
+    }
+  }
+
+  void WriteRetRecord_(const Instr& instr) {
+    const auto addr = AddrOf_(instr.mem, Reg::kR11);
+    const auto size = instr.size;
+    if (HasHiddenRetPtr_()) {
+      // The record is copied to the memory of the caller, whose address is
+      // also returned.
+      WriteLine_("movq {}, %rax", Addr{Reg::kRbp, ret_ptr_offset_});
+      CopyBytes_(addr, Addr{Reg::kRax}, size, Reg::kRcx);
+    } else {
+      LoadPartial_(Reg::kRax, addr, std::min(kEightBytes, size), Reg::kRcx);
+      if (size > kEightBytes) {
+        LoadPartial_(Reg::kRdx, addr.Plus(kEightBytes), size - kEightBytes,
+                     Reg::kRcx);
+      }
+    }
+    WriteJmpToRet_();
+  }
+
+  void WriteCall_(const Instr& instr) {
+    const auto& call = function_.calls.at(instr.size);
+    const auto has_hidden_ret_ptr =
+        call.ret_record_size > kNumOfRecordRegs * kEightBytes;
+    auto classifier = ArgClassifier{has_hidden_ret_ptr};
+    auto passings = std::vector<Passing>{};
+    for (const auto& arg : call.args) {
+      passings.push_back(classifier.Classify(
+          arg.is_record, arg.is_record ? arg.size : SizeOf(arg.width)));
+    }
+
+    // NOTE: No value that the allocator assigns to a caller-saved register
+    // lives at a call, so the argument and scratch registers are free to use.
+    constexpr auto kStackAlignment = std::int64_t{16};
+    const auto stack_size = AlignUp(classifier.stack_size(), kStackAlignment);
+    if (stack_size != 0) {
+      WriteLine_("subq ${}, %rsp", stack_size);
+    }
+    // The arguments in memory are written first, since copying them uses the
+    // scratch registers, some of which are argument registers.
+    for (auto i = std::size_t{0}, e = call.args.size(); i < e; ++i) {
+      const auto& arg = call.args.at(i);
+      const auto& passing = passings.at(i);
+      if (passing.num_of_regs != 0) {
+        continue;
+      }
+      const auto dst = Addr{Reg::kRsp, passing.stack_offset};
+      if (arg.is_record) {
+        CopyBytes_(AddrOf_(Mem::OfVReg(arg.val.vreg()), Reg::kR11), dst,
+                   arg.size, Reg::kRax);
+      } else {
+        LoadReg_(Reg::kRax, arg.val, arg.width);
+        WriteLine_("movq %rax, {}", dst);
+      }
+    }
+    for (auto i = std::size_t{0}, e = call.args.size(); i < e; ++i) {
+      const auto& arg = call.args.at(i);
+      const auto& passing = passings.at(i);
+      if (passing.num_of_regs == 0) {
+        continue;
+      }
+      if (!arg.is_record) {
+        LoadReg_(kArgRegs.at(passing.reg_index), arg.val, arg.width);
+        continue;
+      }
+      const auto src = AddrOf_(Mem::OfVReg(arg.val.vreg()), Reg::kR11);
+      for (auto k = std::size_t{0}; k < passing.num_of_regs; ++k) {
+        LoadPartial_(kArgRegs.at(passing.reg_index + k),
+                     src.Plus(static_cast<std::int64_t>(k * kEightBytes)),
+                     std::min(kEightBytes, arg.size - k * kEightBytes),
+                     Reg::kRax);
+      }
+    }
+    if (has_hidden_ret_ptr) {
+      WriteLine_("leaq {}, %rdi", SlotAddr_(call.ret_slot));
+    }
+
+    if (!call.symbol.empty()) {
+      WriteLine_("call {}", call.symbol);
+    } else if (call.callee.IsVReg()) {
+      WriteLine_("call *{}", Loc_(call.callee.vreg(), kEightBytes));
+    } else {
+      LoadReg_(Reg::kRax, call.callee, Width::kLong);
+      WriteLine_("call *%rax");
+    }
+    if (stack_size != 0) {
+      WriteLine_("addq ${}, %rsp", stack_size);
+    }
+
+    if (call.ret_record_size != 0 && !has_hidden_ret_ptr) {
+      const auto dst = SlotAddr_(call.ret_slot);
+      StorePartial_(Reg::kRax, dst,
+                    std::min(kEightBytes, call.ret_record_size));
+      if (call.ret_record_size > kEightBytes) {
+        StorePartial_(Reg::kRdx, dst.Plus(kEightBytes),
+                      call.ret_record_size - kEightBytes);
+      }
+    } else if (instr.dst != kNoVReg) {
+      StoreDst_(instr.dst, Reg::kRax, call.ret_width);
+    }
+  }
+};
+
+}  // namespace
+
+void WriteAsm(const Function& function, const Allocation& allocation,
+              std::ostream& output) {
+  AsmWriter{function, allocation, output}.Write();
+}
+
+}  // namespace x86
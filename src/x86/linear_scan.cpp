@@ -0,0 +1,350 @@
+#include "x86/linear_scan.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "x86/mir.hpp"
+#include "x86/register.hpp"
+
+namespace x86 {
+
+namespace {
+
+/// @brief A maximal run of instructions that is only entered at its first
+/// instruction and only left at its last.
+struct Block {
+  /// @brief The instructions in [begin, end).
+  std::size_t begin;
+  std::size_t end;
+  std::vector<std::size_t> succs{};
+};
+
+std::vector<Block> SplitIntoBlocks(const Function& function) {
+  auto blocks = std::vector<Block>{};
+  auto block_of_label = std::vector<std::size_t>(
+      static_cast<std::size_t>(function.num_of_labels));
+  const auto& instrs = function.instrs;
+  for (auto i = std::size_t{0}, e = instrs.size(); i < e; ++i) {
+    if (i == 0 || instrs.at(i).op == Opcode::kLabel ||
+        IsTerminator(instrs.at(i - 1))) {
+      blocks.push_back({i, i});
+    }
+    blocks.back().end = i + 1;
+    if (instrs.at(i).op == Opcode::kLabel) {
+      block_of_label.at(static_cast<std::size_t>(instrs.at(i).label)) =
+          blocks.size() - 1;
+    }
+  }
+  for (auto b = std::size_t{0}, e = blocks.size(); b < e; ++b) {
+    auto& block = blocks.at(b);
+    const auto& last = instrs.at(block.end - 1);
+    switch (last.op) {
+      case Opcode::kJmp:
+        block.succs.push_back(
+            block_of_label.at(static_cast<std::size_t>(last.label)));
+        break;
+      case Opcode::kJnz:
+        block.succs.push_back(
+            block_of_label.at(static_cast<std::size_t>(last.label)));
+        block.succs.push_back(
+            block_of_label.at(static_cast<std::size_t>(last.else_label)));
+        break;
+      case Opcode::kRet:
+      case Opcode::kRetRecord:
+        break;
+      default:
+        if (b + 1 < e) {
+          block.succs.push_back(b + 1);
+        }
+        break;
+    }
+  }
+  return blocks;
+}
+
+/// @brief A set of the virtual registers that live across blocks, by their
+/// compact indices.
+class BitSet {
+ public:
+  explicit BitSet(std::size_t size) : words_((size + kBits - 1) / kBits) {}
+
+  bool Test(std::size_t i) const {
+    return (words_.at(i / kBits) >> (i % kBits)) & 1U;
+  }
+  void Set(std::size_t i) {
+    words_.at(i / kBits) |= std::uint64_t{1} << (i % kBits);
+  }
+
+  /// @brief `this |= that`
+  /// @return Whether any bit is set.
+  bool Merge(const BitSet& that) {
+    auto is_changed = false;
+    for (auto i = std::size_t{0}, e = words_.size(); i < e; ++i) {
+      const auto merged = words_.at(i) | that.words_.at(i);
+      is_changed |= merged != words_.at(i);
+      words_.at(i) = merged;
+    }
+    return is_changed;
+  }
+
+  /// @brief `this |= that & ~mask`
+  /// @return Whether any bit is set.
+  bool MergeExcept(const BitSet& that, const BitSet& mask) {
+    auto is_changed = false;
+    for (auto i = std::size_t{0}, e = words_.size(); i < e; ++i) {
+      const auto merged =
+          words_.at(i) | (that.words_.at(i) & ~mask.words_.at(i));
+      is_changed |= merged != words_.at(i);
+      words_.at(i) = merged;
+    }
+    return is_changed;
+  }
+
+  /// @brief Calls `func` with the index of each bit that is set.
+  template <typename Func>
+  void ForEach(Func&& func) const {
+    for (auto i = std::size_t{0}, e = words_.size(); i < e; ++i) {
+      for (auto word = words_.at(i); word != 0; word &= word - 1) {
+        func(i * kBits +
+             static_cast<std::size_t>(__builtin_ctzll(word)));
+      }
+    }
+  }
+
+ private:
+  static constexpr auto kBits = std::size_t{64};
+  std::vector<std::uint64_t> words_;
+};
+
+constexpr auto kNoPos = std::numeric_limits<std::size_t>::max();
+
+/// @brief The positions of the instructions that a virtual register is live
+/// in, which are [start, end].
+struct Interval {
+  std::size_t start = kNoPos;
+  std::size_t end = 0;
+};
+
+/// @brief Computes the interval of each virtual register. The occurrences of a
+/// virtual register are extended by the blocks that it's live into or out of,
+/// so that the interval also covers the loops that it lives through.
+std::vector<Interval> ComputeIntervals(const Function& function) {
+  const auto num_of_vregs = static_cast<std::size_t>(function.num_of_vregs);
+  auto intervals = std::vector<Interval>(num_of_vregs);
+  const auto blocks = SplitIntoBlocks(function);
+
+  // Only the virtual registers that occur in more than one block take part in
+  // the data flow; most of them are temporaries of a single expression.
+  constexpr auto kNoIndex = std::numeric_limits<std::size_t>::max();
+  auto block_of_vreg = std::vector<std::size_t>(num_of_vregs, kNoIndex);
+  auto index_of_vreg = std::vector<std::size_t>(num_of_vregs, kNoIndex);
+  auto global_vregs = std::vector<VReg>{};
+  for (auto b = std::size_t{0}, e = blocks.size(); b < e; ++b) {
+    const auto occur = [&](VReg vreg) {
+      const auto v = static_cast<std::size_t>(vreg);
+      auto& block = block_of_vreg.at(v);
+      if (block == kNoIndex) {
+        block = b;
+      } else if (block != b && index_of_vreg.at(v) == kNoIndex) {
+        index_of_vreg.at(v) = global_vregs.size();
+        global_vregs.push_back(vreg);
+      }
+    };
+    for (auto i = blocks.at(b).begin; i < blocks.at(b).end; ++i) {
+      const auto& instr = function.instrs.at(i);
+      const auto extend = [&intervals, i](VReg vreg) {
+        auto& interval = intervals.at(static_cast<std::size_t>(vreg));
+        interval.start = std::min(interval.start, i);
+        interval.end = std::max(interval.end, i);
+      };
+      ForEachUse(function, instr, [&](VReg vreg) {
+        occur(vreg);
+        extend(vreg);
+      });
+      if (instr.dst != kNoVReg) {
+        occur(instr.dst);
+        extend(instr.dst);
+      }
+    }
+  }
+
+  const auto num_of_globals = global_vregs.size();
+  auto uses = std::vector<BitSet>(blocks.size(), BitSet{num_of_globals});
+  auto defs = uses;
+  for (auto b = std::size_t{0}, e = blocks.size(); b < e; ++b) {
+    for (auto i = blocks.at(b).begin; i < blocks.at(b).end; ++i) {
+      const auto& instr = function.instrs.at(i);
+      ForEachUse(function, instr, [&](VReg vreg) {
+        const auto index = index_of_vreg.at(static_cast<std::size_t>(vreg));
+        if (index != kNoIndex && !defs.at(b).Test(index)) {
+          uses.at(b).Set(index);
+        }
+      });
+      if (instr.dst != kNoVReg) {
+        if (const auto index =
+                index_of_vreg.at(static_cast<std::size_t>(instr.dst));
+            index != kNoIndex) {
+          defs.at(b).Set(index);
+        }
+      }
+    }
+  }
+
+  // live_in = uses | (live_out & ~defs); live_out = the union of the live_in of
+  // the successors.
+  auto live_ins = uses;
+  auto live_outs = std::vector<BitSet>(blocks.size(), BitSet{num_of_globals});
+  for (auto is_changed = num_of_globals != 0; is_changed;) {
+    is_changed = false;
+    for (auto b = blocks.size(); b-- > 0;) {
+      for (const auto succ : blocks.at(b).succs) {
+        live_outs.at(b).Merge(live_ins.at(succ));
+      }
+      is_changed |= live_ins.at(b).MergeExcept(live_outs.at(b), defs.at(b));
+    }
+  }
+
+  for (auto b = std::size_t{0}, e = blocks.size(); b < e; ++b) {
+    live_ins.at(b).ForEach([&](std::size_t index) {
+      auto& interval =
+          intervals.at(static_cast<std::size_t>(global_vregs.at(index)));
+      interval.start = std::min(interval.start, blocks.at(b).begin);
+    });
+    live_outs.at(b).ForEach([&](std::size_t index) {
+      auto& interval =
+          intervals.at(static_cast<std::size_t>(global_vregs.at(index)));
+      interval.end = std::max(interval.end, blocks.at(b).end - 1);
+    });
+  }
+  return intervals;
+}
+
+template <std::size_t N>
+bool Contains(const std::array<Reg, N>& regs, Reg reg) {
+  return std::find(regs.cbegin(), regs.cend(), reg) != regs.cend();
+}
+
+}  // namespace
+
+Allocation AllocateRegisters(Function& function) {
+  const auto intervals = ComputeIntervals(function);
+  auto call_positions = std::vector<std::size_t>{};
+  for (auto i = std::size_t{0}, e = function.instrs.size(); i < e; ++i) {
+    if (function.instrs.at(i).op == Opcode::kCall) {
+      call_positions.push_back(i);
+    }
+  }
+  const auto crosses_call = [&call_positions](const Interval& interval) {
+    const auto it = std::lower_bound(call_positions.cbegin(),
+                                     call_positions.cend(), interval.start);
+    return it != call_positions.cend() && *it <= interval.end;
+  };
+
+  auto order = std::vector<VReg>{};
+  for (auto v = VReg{0}; v < function.num_of_vregs; ++v) {
+    if (intervals.at(static_cast<std::size_t>(v)).start != kNoPos) {
+      order.push_back(v);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&intervals](VReg a, VReg b) {
+    return intervals.at(static_cast<std::size_t>(a)).start <
+           intervals.at(static_cast<std::size_t>(b)).start;
+  });
+
+  auto allocation = Allocation{};
+  allocation.locations.resize(static_cast<std::size_t>(function.num_of_vregs));
+  auto is_free = std::array<bool, kNumOfRegs>{};
+  for (const auto reg : kCallerSavedRegs) {
+    is_free.at(static_cast<std::size_t>(reg)) = true;
+  }
+  for (const auto reg : kCalleeSavedRegs) {
+    is_free.at(static_cast<std::size_t>(reg)) = true;
+  }
+  auto is_used = std::array<bool, kNumOfRegs>{};
+  const auto spill = [&](VReg vreg) {
+    auto& location = allocation.locations.at(static_cast<std::size_t>(vreg));
+    location.is_spilled = true;
+    location.slot = function.NewSlot(8, 8);
+  };
+  const auto assign = [&](VReg vreg, Reg reg) {
+    allocation.locations.at(static_cast<std::size_t>(vreg)).reg = reg;
+    is_free.at(static_cast<std::size_t>(reg)) = false;
+    is_used.at(static_cast<std::size_t>(reg)) = true;
+  };
+
+  /// @brief The intervals that hold registers, by their ends.
+  auto active = std::set<std::pair<std::size_t, VReg>>{};
+  for (const auto vreg : order) {
+    const auto& interval = intervals.at(static_cast<std::size_t>(vreg));
+    while (!active.empty() && active.begin()->first < interval.start) {
+      const auto expired = active.begin()->second;
+      is_free.at(static_cast<std::size_t>(
+          allocation.locations.at(static_cast<std::size_t>(expired)).reg)) =
+          true;
+      active.erase(active.begin());
+    }
+
+    const auto is_across_call = crosses_call(interval);
+    auto free_reg = std::optional<Reg>{};
+    if (!is_across_call) {
+      for (const auto reg : kCallerSavedRegs) {
+        if (is_free.at(static_cast<std::size_t>(reg))) {
+          free_reg = reg;
+          break;
+        }
+      }
+    }
+    if (!free_reg) {
+      for (const auto reg : kCalleeSavedRegs) {
+        if (is_free.at(static_cast<std::size_t>(reg))) {
+          free_reg = reg;
+          break;
+        }
+      }
+    }
+    if (free_reg) {
+      assign(vreg, *free_reg);
+      active.emplace(interval.end, vreg);
+      continue;
+    }
+
+    // Spills the interval that ends last, which is this one unless an active
+    // interval with a register that this one may take ends later.
+    auto victim = active.end();
+    for (auto it = active.rbegin(); it != active.rend(); ++it) {
+      const auto reg =
+          allocation.locations.at(static_cast<std::size_t>(it->second)).reg;
+      if (!is_across_call || Contains(kCalleeSavedRegs, reg)) {
+        victim = std::prev(it.base());
+        break;
+      }
+    }
+    if (victim == active.end() || victim->first <= interval.end) {
+      spill(vreg);
+      continue;
+    }
+    const auto reg =
+        allocation.locations.at(static_cast<std::size_t>(victim->second)).reg;
+    spill(victim->second);
+    active.erase(victim);
+    assign(vreg, reg);
+    active.emplace(interval.end, vreg);
+  }
+
+  for (const auto reg : kCalleeSavedRegs) {
+    if (is_used.at(static_cast<std::size_t>(reg))) {
+      allocation.used_callee_saved_regs.push_back(reg);
+    }
+  }
+  return allocation;
+}
+
+}  // namespace x86
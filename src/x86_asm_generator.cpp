@@ -0,0 +1,1141 @@
+#include "x86_asm_generator.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <ios>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ast.hpp"
+#include "casting.hpp"
+#include "operator.hpp"
+#include "thread_pool.hpp"
+#include "type.hpp"
+#include "visit_profiler.hpp"
+#include "x86/asm_writer.hpp"
+#include "x86/linear_scan.hpp"
+#include "x86/mir.hpp"
+
+using x86::Label;
+using x86::Mem;
+using x86::Opcode;
+using x86::Operand;
+using x86::VReg;
+using x86::Width;
+
+namespace {
+
+//
+// The states below only live through the generation of a single top-level
+// declaration. They are thread-local, so that the functions can be generated
+// in parallel.
+//
+
+/// @brief The function that is being lowered.
+thread_local auto
+    function  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = x86::Function{};
+
+/// @brief The return type of the function that is being generated.
+thread_local auto
+    return_type_of_func  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = static_cast<const Type*>(nullptr);
+
+/// @brief The slot of each object, by its id.
+thread_local auto
+    id_to_slot  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::map<std::string, int>{};
+
+/// @brief The label of each user-defined label, which may be jumped to before
+/// it's defined.
+thread_local auto
+    user_labels  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::map<std::string, Label>{};
+
+/// @brief The value of an expression. An lvalue also has the object it's
+/// loaded from, which is stored to by the upper level nodes.
+struct Value {
+  /// @brief Nothing for an aggregate, whose value is the address of `obj`.
+  Operand val{};
+  std::optional<Mem> obj{};
+};
+
+/// @brief Every expression has a value, which is propagated to its upper level
+/// node.
+class PrevExprValueRecorder {
+ public:
+  void Record(Value value) {
+    value_ = std::move(value);
+  }
+
+  /// @note The value can only be gotten once. This is to reduce the
+  /// possibility of getting an obsolete value.
+  Value ValueOfPrevExpr() {
+    assert(value_);
+    auto value = std::move(*value_);
+    value_.reset();
+    return value;
+  }
+
+ private:
+  std::optional<Value> value_{};
+};
+
+thread_local auto
+    value_recorder  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = PrevExprValueRecorder{};
+
+struct LabelPair {
+  Label entry;
+  Label exit;
+};
+
+/// @note Blocks that allows jumping within or out of it should add its labels
+/// to this list.
+thread_local auto
+    labels_of_jumpable_blocks  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::vector<LabelPair>{};
+
+struct CaseInfo {
+  /// @note This is a non-owning pointer that points to the expression of the
+  /// case.
+  const ExprNode* expr = nullptr;
+  Label label;
+};
+
+struct SwitchInfo {
+  std::vector<CaseInfo> case_infos{};
+  std::optional<Label> default_label{};
+  Label exit_label;
+};
+
+/// @note To allow nested switch statements, the information is stacked.
+thread_local auto
+    switch_infos  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = std::vector<SwitchInfo>{};
+
+/// @return The width of the values of `type`. The value of an aggregate, such
+/// as a record, is its address.
+Width WidthOf(const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  return !prim_type || prim_type->size() == 8 ? Width::kLong : Width::kWord;
+}
+
+/// @return Whether the value of `type` is the address of its object, which is
+/// never loaded as a whole.
+bool IsAggregate(const Type& type) {
+  return Isa<RecordType>(type) || type.IsArr();
+}
+
+/// @return The number of bytes that an object of `type` is loaded or stored
+/// with.
+std::size_t MemSizeOf(const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  return prim_type ? prim_type->size() : 8;
+}
+
+/// @brief The type of the integers narrower than `int` after the integer
+/// promotions.
+const auto
+    kPromotedType  // NOLINT(cert-err58-cpp): PrimType doesn't throw.
+    = PrimType{PrimitiveType::kInt};
+
+/// @return The type that the operands of `bin_expr` are converted to before
+/// the operation.
+std::unique_ptr<Type> OperandTypeOf(const BinaryExprNode& bin_expr) {
+  const auto* lhs_prim = DynCast<PrimType>(bin_expr.lhs->type.get());
+  const auto* rhs_prim = DynCast<PrimType>(bin_expr.rhs->type.get());
+  if (!lhs_prim || !rhs_prim || !lhs_prim->IsInteger() ||
+      !rhs_prim->IsInteger()) {
+    return bin_expr.lhs->type->Clone();
+  }
+  if (bin_expr.op == BinaryOperator::kShl ||
+      bin_expr.op == BinaryOperator::kShr) {
+    return std::make_unique<PrimType>(Promote(lhs_prim->prim_type()));
+  }
+  return std::make_unique<PrimType>(
+      CommonTypeOf(lhs_prim->prim_type(), rhs_prim->prim_type()));
+}
+
+/// @param type The type of the operands, which are converted to the same type
+/// beforehand.
+/// @return The instruction of `op` and, for a comparison, its condition.
+std::pair<Opcode, x86::Cond> InstrOf(BinaryOperator op, const Type& type) {
+  const auto* prim_type = DynCast<PrimType>(&type);
+  // Pointers are compared as unsigned integers.
+  const auto is_unsigned = !prim_type || prim_type->IsUnsigned();
+  const auto cmp = [](x86::Cond cond) {
+    return std::pair{Opcode::kCmp, cond};
+  };
+  switch (op) {
+    case BinaryOperator::kAdd:
+      return {Opcode::kAdd, {}};
+    case BinaryOperator::kSub:
+      return {Opcode::kSub, {}};
+    case BinaryOperator::kMul:
+      return {Opcode::kMul, {}};
+    case BinaryOperator::kDiv:
+      return {is_unsigned ? Opcode::kUDiv : Opcode::kDiv, {}};
+    case BinaryOperator::kMod:
+      return {is_unsigned ? Opcode::kURem : Opcode::kRem, {}};
+    case BinaryOperator::kGt:
+      return cmp(is_unsigned ? x86::Cond::kAbove : x86::Cond::kGt);
+    case BinaryOperator::kGte:
+      return cmp(is_unsigned ? x86::Cond::kAboveEq : x86::Cond::kGe);
+    case BinaryOperator::kLt:
+      return cmp(is_unsigned ? x86::Cond::kBelow : x86::Cond::kLt);
+    case BinaryOperator::kLte:
+      return cmp(is_unsigned ? x86::Cond::kBelowEq : x86::Cond::kLe);
+    case BinaryOperator::kEq:
+      return cmp(x86::Cond::kEq);
+    case BinaryOperator::kNeq:
+      return cmp(x86::Cond::kNe);
+    case BinaryOperator::kAnd:
+      return {Opcode::kAnd, {}};
+    case BinaryOperator::kXor:
+      return {Opcode::kXor, {}};
+    case BinaryOperator::kOr:
+      return {Opcode::kOr, {}};
+    case BinaryOperator::kShl:
+      return {Opcode::kShl, {}};
+    // NOTE: Signed integers are shifted arithmetically, as QbeIrGenerator
+    // does; unsigned integers are shifted logically.
+    default:
+      return {is_unsigned ? Opcode::kShr : Opcode::kSar, {}};
+  }
+}
+
+/// @return The function of the runtime library that the builtin `id` is
+/// lowered to; empty if `id` isn't a builtin.
+/// @note The runtime library is linked by the driver; see runtime/runtime.h.
+std::string_view RuntimeFuncOf(std::string_view id) {
+  if (id == "__builtin_print") {
+    return "__vitaminc_print_int";
+  }
+  if (id == "__builtin_flush") {
+    return "__vitaminc_flush";
+  }
+  return {};
+}
+
+/// @return The result of `op` on `lhs` and `rhs`, in a new virtual register.
+Operand WriteOp(Opcode op, Width width, const Operand& lhs,
+                const Operand& rhs = {}) {
+  auto instr = x86::Instr{op, width};
+  instr.dst = function.NewVReg();
+  instr.lhs = lhs;
+  instr.rhs = rhs;
+  function.Append(instr);
+  return Operand::OfVReg(instr.dst);
+}
+
+Operand WriteCmp(x86::Cond cond, Width width, const Operand& lhs,
+                 const Operand& rhs) {
+  auto instr = x86::Instr{Opcode::kCmp, width, cond};
+  instr.dst = function.NewVReg();
+  instr.lhs = lhs;
+  instr.rhs = rhs;
+  function.Append(instr);
+  return Operand::OfVReg(instr.dst);
+}
+
+void WriteCopy(VReg dst, Width width, const Operand& val) {
+  auto instr = x86::Instr{Opcode::kCopy, width};
+  instr.dst = dst;
+  instr.lhs = val;
+  function.Append(instr);
+}
+
+Operand WriteLoad(const Type& type, const Mem& mem) {
+  auto instr = x86::Instr{Opcode::kLoad, WidthOf(type)};
+  const auto* prim_type = DynCast<PrimType>(&type);
+  instr.is_signed = prim_type && !prim_type->IsUnsigned();
+  instr.dst = function.NewVReg();
+  instr.mem = mem;
+  instr.size = MemSizeOf(type);
+  function.Append(instr);
+  return Operand::OfVReg(instr.dst);
+}
+
+void WriteStore(const Type& type, const Operand& val, const Mem& mem) {
+  auto instr = x86::Instr{Opcode::kStore, WidthOf(type)};
+  instr.lhs = val;
+  instr.mem = mem;
+  instr.size = MemSizeOf(type);
+  function.Append(instr);
+}
+
+void WriteBlit(const Mem& src, const Mem& dst, std::size_t size) {
+  auto instr = x86::Instr{Opcode::kBlit};
+  instr.src_mem = src;
+  instr.mem = dst;
+  instr.size = size;
+  function.Append(instr);
+}
+
+void WriteLabel(Label label) {
+  auto instr = x86::Instr{Opcode::kLabel};
+  instr.label = label;
+  function.Append(instr);
+}
+
+void WriteJmp(Label label) {
+  auto instr = x86::Instr{Opcode::kJmp};
+  instr.label = label;
+  function.Append(instr);
+}
+
+/// @brief Jumps to `label` if `val` of `type` is non-zero; to `else_label`
+/// otherwise.
+void WriteJnz(const Operand& val, const Type& type, Label label,
+              Label else_label) {
+  auto instr = x86::Instr{Opcode::kJnz, WidthOf(type)};
+  instr.lhs = val;
+  instr.label = label;
+  instr.else_label = else_label;
+  function.Append(instr);
+}
+
+/// @return The address of `mem` in a virtual register.
+Operand AddressOf(const Mem& mem) {
+  if (mem.base == Mem::Base::kVReg && mem.offset == 0) {
+    return Operand::OfVReg(mem.id);
+  }
+  auto instr = x86::Instr{Opcode::kLea, Width::kLong};
+  instr.dst = function.NewVReg();
+  instr.mem = mem;
+  function.Append(instr);
+  return Operand::OfVReg(instr.dst);
+}
+
+/// @return The value of `value` in a virtual register or an immediate; the
+/// address of an aggregate.
+Operand OperandOf(const Value& value) {
+  if (value.val.kind == Operand::Kind::kNone) {
+    assert(value.obj);
+    return AddressOf(*value.obj);
+  }
+  return value.val;
+}
+
+/// @return The memory that the pointer `addr` points to.
+Mem MemOf(const Operand& addr) {
+  if (addr.IsVReg()) {
+    return Mem::OfVReg(addr.vreg());
+  }
+  const auto vreg = function.NewVReg();
+  WriteCopy(vreg, Width::kLong, addr);
+  return Mem::OfVReg(vreg);
+}
+
+/// @return The value of the object of `type` at `obj`: its address if it's an
+/// aggregate; loaded from it otherwise.
+Value ValueOfObject(const Type& type, const Mem& obj) {
+  if (IsAggregate(type)) {
+    return {Operand{}, obj};
+  }
+  return {WriteLoad(type, obj), obj};
+}
+
+Label UserLabelOf(const std::string& label) {
+  if (auto it = user_labels.find(label); it != user_labels.end()) {
+    return it->second;
+  }
+  return user_labels[label] = function.NewLabel();
+}
+
+}  // namespace
+
+void X86AsmGenerator::Visit(const DeclStmtNode& decl_stmt) {
+  for (const auto& decl : decl_stmt.decls) {
+    Dispatch(*decl);
+  }
+}
+
+void X86AsmGenerator::Visit(const VarDeclNode& decl) {
+  const auto slot =
+      function.NewSlot(decl.type->size(), decl.type->alignment());
+  if (decl.init) {
+    Dispatch(*decl.init);
+    const auto init = value_recorder.ValueOfPrevExpr();
+    WriteStoreOf_(OperandOf(init), *decl.init->type, *decl.type,
+                  Mem::OfSlot(slot));
+  }
+  id_to_slot[decl.id] = slot;
+}
+
+void X86AsmGenerator::Visit(const ArrDeclNode& arr_decl) {
+  const auto* arr_type = DynCast<ArrType>(arr_decl.type.get());
+  assert(arr_type);
+  const auto slot =
+      function.NewSlot(arr_decl.type->size(), arr_decl.type->alignment());
+  id_to_slot[arr_decl.id] = slot;
+
+  const auto& element_type = arr_type->element_type();
+  const auto element_size = static_cast<std::int64_t>(element_type.size());
+  for (auto i = std::size_t{0}, e = arr_type->len(); i < e; ++i) {
+    const auto mem = Mem::OfSlot(slot, static_cast<std::int64_t>(i) *
+                                           element_size);
+    if (i < arr_decl.init_list.size()) {
+      const auto& init = arr_decl.init_list.at(i);
+      Dispatch(*init);
+      WriteStoreOf_(OperandOf(value_recorder.ValueOfPrevExpr()), *init->type,
+                    element_type, mem);
+    } else if (!IsAggregate(element_type)) {
+      // set remaining elements as 0
+      WriteStore(element_type, Operand::OfImm(0), mem);
+    }
+  }
+}
+
+void X86AsmGenerator::Visit(const RecordDeclNode& record_decl) {
+  /* Do nothing because this node only declares a type. */
+}
+
+void X86AsmGenerator::Visit(const FieldNode& field) {
+  /* Do nothing because this node only declares a member type in a record. */
+}
+
+void X86AsmGenerator::Visit(const RecordVarDeclNode& record_var_decl) {
+  const auto slot = function.NewSlot(record_var_decl.type->size(),
+                                     record_var_decl.type->alignment());
+  id_to_slot[record_var_decl.id] = slot;
+
+  const auto* record_type = DynCast<RecordType>(record_var_decl.type.get());
+  assert(record_type);
+  for (auto i = std::size_t{0}, e = record_var_decl.inits.size(),
+            slot_count = record_type->SlotCount();
+       i < slot_count && i < e; ++i) {
+    const auto& init = record_var_decl.inits.at(i);
+    Dispatch(*init);
+    const auto offset = static_cast<std::int64_t>(record_type->OffsetOf(i));
+    WriteStoreOf_(OperandOf(value_recorder.ValueOfPrevExpr()), *init->type,
+                  *record_type->fields().at(i)->type,
+                  Mem::OfSlot(slot, offset));
+  }
+}
+
+void X86AsmGenerator::Visit(const ParamNode& parameter) {
+  // The value of a parameter is stored to its slot on entry; a record is the
+  // copy that the function owns, which is used in place.
+  const auto& type = *parameter.type;
+  const auto slot = function.NewSlot(type.size(), type.alignment());
+  function.params.push_back({type.size(), Isa<RecordType>(type), slot});
+  id_to_slot[parameter.id] = slot;
+}
+
+void X86AsmGenerator::Visit(const FuncDefNode& func_def) {
+  function = x86::Function{};
+  function.name = func_def.id;
+  const auto& return_type = Cast<FuncType>(*func_def.type).return_type();
+  return_type_of_func = &return_type;
+  if (Isa<RecordType>(return_type)) {
+    function.ret_record_size = return_type.size();
+  }
+  for (const auto& parameter : func_def.parameters) {
+    Dispatch(*parameter);
+  }
+  Dispatch(*func_def.body);
+  // Falling off the end of a function returns 0, which is what `main` has to
+  // return.
+  auto ret = x86::Instr{Opcode::kRet, WidthOf(return_type)};
+  if (!Isa<RecordType>(return_type)) {
+    ret.lhs = Operand::OfImm(0);
+  }
+  function.Append(ret);
+  WriteFunction_(function);
+}
+
+void X86AsmGenerator::WriteFunction_(x86::Function& function) {
+  if (lowered_) {
+    lowered_->push_back(std::move(function));
+    return;
+  }
+  const auto allocation = x86::AllocateRegisters(function);
+  auto output = std::ostringstream{};
+  x86::WriteAsm(function, allocation, output);
+  const auto assembly = output.str();
+  output_->write(assembly.data(),
+                 static_cast<std::streamsize>(assembly.size()));
+  if (profiler()) {
+    VisitProfiler::CountBytes(assembly.size());
+  }
+}
+
+void X86AsmGenerator::Visit(const LoopInitNode& loop_init) {
+  std::visit([this](auto&& clause) { Dispatch(*clause); }, loop_init.clause);
+}
+
+void X86AsmGenerator::Visit(const CompoundStmtNode& compound_stmt) {
+  VisitBlocks_(
+      compound_stmt, [](const CompoundStmtNode&) {},
+      [](const CompoundStmtNode&) {});
+}
+
+void X86AsmGenerator::Visit(const ExternDeclNode& extern_decl) {
+  if (const auto* func_def =
+          std::get_if<std::unique_ptr<FuncDefNode>>(&extern_decl.decl)) {
+    Dispatch(**func_def);
+  }
+}
+
+void X86AsmGenerator::Visit(const TransUnitNode& trans_unit) {
+  if (thread_pool_) {
+    GenerateInParallel_(trans_unit);
+    return;
+  }
+  for (const auto& extern_decl : trans_unit.extern_decls) {
+    GenerateExternDecl(*extern_decl);
+  }
+}
+
+void X86AsmGenerator::GenerateExternDecl(const ExternDeclNode& extern_decl) {
+  ResetStates_();
+  Dispatch(extern_decl);
+}
+
+void X86AsmGenerator::GenerateInParallel_(const TransUnitNode& trans_unit) {
+  // Each function is generated into its own buffer, which are then
+  // concatenated in order; the output is the same as the serial one.
+  auto outputs =
+      std::vector<std::ostringstream>(trans_unit.extern_decls.size());
+  auto generations = std::vector<std::future<void>>{};
+  for (auto i = std::size_t{0}, e = outputs.size(); i < e; ++i) {
+    generations.push_back(thread_pool_->Submit(
+        [&output = outputs.at(i),
+         &extern_decl = *trans_unit.extern_decls.at(i),
+         profiler = profiler()] {
+          X86AsmGenerator asm_generator{output};
+          asm_generator.SetProfiler(profiler);
+          asm_generator.GenerateExternDecl(extern_decl);
+        }));
+  }
+  for (auto& generation : generations) {
+    generation.get();
+  }
+  for (const auto& output : outputs) {
+    *output_ << output.str();
+  }
+}
+
+void X86AsmGenerator::Visit(const IfStmtNode& if_stmt) {
+  Dispatch(*if_stmt.predicate);
+  const auto predicate = value_recorder.ValueOfPrevExpr();
+  const auto then_label = function.NewLabel();
+  const auto end_label = function.NewLabel();
+  const auto else_label = if_stmt.or_else ? function.NewLabel() : end_label;
+
+  WriteJnz(predicate.val, *if_stmt.predicate->type, then_label, else_label);
+  WriteLabel(then_label);
+  Dispatch(*if_stmt.then);
+  if (if_stmt.or_else) {
+    // Skip the "else" part after executing "then".
+    WriteJmp(end_label);
+    WriteLabel(else_label);
+    Dispatch(*if_stmt.or_else);
+  }
+  WriteLabel(end_label);
+}
+
+void X86AsmGenerator::Visit(const WhileStmtNode& while_stmt) {
+  const auto body_label = function.NewLabel();
+  const auto pred_label = function.NewLabel();
+  const auto end_label = function.NewLabel();
+  const auto write_test = [&] {
+    Dispatch(*while_stmt.predicate);
+    WriteJnz(value_recorder.ValueOfPrevExpr().val,
+             *while_stmt.predicate->type, body_label, end_label);
+  };
+
+  // The predicate is tested after the body, so that each iteration takes a
+  // single conditional jump back to the body; a while statement additionally
+  // tests it once before entering the body.
+  if (!while_stmt.is_do_while) {
+    write_test();
+  }
+  WriteLabel(body_label);
+  labels_of_jumpable_blocks.push_back({pred_label, end_label});
+  Dispatch(*while_stmt.loop_body);
+  labels_of_jumpable_blocks.pop_back();
+  WriteLabel(pred_label);
+  write_test();
+  WriteLabel(end_label);
+}
+
+void X86AsmGenerator::Visit(const ForStmtNode& for_stmt) {
+  const auto body_label = function.NewLabel();
+  const auto step_label = function.NewLabel();
+  const auto end_label = function.NewLabel();
+  const auto has_predicate = !Isa<NullExprNode>(*for_stmt.predicate);
+  const auto write_test = [&] {
+    Dispatch(*for_stmt.predicate);
+    WriteJnz(value_recorder.ValueOfPrevExpr().val, *for_stmt.predicate->type,
+             body_label, end_label);
+  };
+
+  // As a while statement, the predicate is tested once before the body and
+  // then after each step.
+  Dispatch(*for_stmt.loop_init);
+  if (has_predicate) {
+    write_test();
+  }
+  WriteLabel(body_label);
+  labels_of_jumpable_blocks.push_back({step_label, end_label});
+  Dispatch(*for_stmt.loop_body);
+  labels_of_jumpable_blocks.pop_back();
+  WriteLabel(step_label);
+  Dispatch(*for_stmt.step);
+  if (has_predicate) {
+    write_test();
+  } else {
+    WriteJmp(body_label);
+  }
+  WriteLabel(end_label);
+}
+
+void X86AsmGenerator::Visit(const ReturnStmtNode& ret_stmt) {
+  Dispatch(*ret_stmt.expr);
+  assert(return_type_of_func);
+  if (Isa<NullExprNode>(*ret_stmt.expr)) {
+    function.Append(x86::Instr{Opcode::kRet});
+    return;
+  }
+  const auto ret = value_recorder.ValueOfPrevExpr();
+  if (Isa<RecordType>(*return_type_of_func)) {
+    auto instr = x86::Instr{Opcode::kRetRecord};
+    instr.mem = *ret.obj;
+    instr.size = return_type_of_func->size();
+    function.Append(instr);
+    return;
+  }
+  auto instr = x86::Instr{Opcode::kRet, WidthOf(*return_type_of_func)};
+  instr.lhs = ConvertTo_(ret.val, *ret_stmt.expr->type, *return_type_of_func);
+  function.Append(instr);
+}
+
+void X86AsmGenerator::Visit(const GotoStmtNode& goto_stmt) {
+  WriteJmp(UserLabelOf(goto_stmt.label));
+}
+
+void X86AsmGenerator::Visit(const BreakStmtNode& break_stmt) {
+  assert(!labels_of_jumpable_blocks.empty());
+  WriteJmp(labels_of_jumpable_blocks.back().exit);
+}
+
+void X86AsmGenerator::Visit(const ContinueStmtNode& continue_stmt) {
+  assert(!labels_of_jumpable_blocks.empty());
+  WriteJmp(labels_of_jumpable_blocks.back().entry);
+}
+
+void X86AsmGenerator::Visit(const SwitchStmtNode& switch_stmt) {
+  // As in QbeIrGenerator, the cases are generated first, followed by the
+  // conditions that match the controlling expression against them.
+  Dispatch(*switch_stmt.ctrl);
+  const auto ctrl = value_recorder.ValueOfPrevExpr().val;
+  const auto cond_label = function.NewLabel();
+  WriteJmp(cond_label);
+
+  const auto exit_label = function.NewLabel();
+  switch_infos.push_back({{}, std::nullopt, exit_label});
+  labels_of_jumpable_blocks.push_back({exit_label, exit_label});
+  Dispatch(*switch_stmt.stmt);
+  labels_of_jumpable_blocks.pop_back();
+  WriteJmp(exit_label);
+  GenerateConditions_(switch_stmt, cond_label, ctrl);
+  WriteLabel(exit_label);
+  switch_infos.pop_back();
+}
+
+void X86AsmGenerator::GenerateConditions_(const SwitchStmtNode& switch_stmt,
+                                          Label first_cond_label,
+                                          const Operand& ctrl) {
+  const auto& switch_info = switch_infos.back();
+  WriteLabel(first_cond_label);
+  // The case expressions are converted to the promoted type of the
+  // controlling expression, whose value is already extended to it.
+  const auto& ctrl_type = *switch_stmt.ctrl->type;
+  const auto& promoted_type = ctrl_type.size() < 4 ? kPromotedType : ctrl_type;
+  for (auto i = std::size_t{0}, e = switch_info.case_infos.size(); i < e;
+       ++i) {
+    const auto& case_info = switch_info.case_infos.at(i);
+    Dispatch(*case_info.expr);
+    const auto expr = ConvertTo_(value_recorder.ValueOfPrevExpr().val,
+                                 *case_info.expr->type, promoted_type);
+    const auto match =
+        WriteCmp(x86::Cond::kEq, WidthOf(promoted_type), ctrl, expr);
+    const auto is_last_cond = i == e - 1;
+    // If no case matches, jump to the default case; to the exit if no default
+    // case exists.
+    const auto next_label =
+        !is_last_cond                ? function.NewLabel()
+        : switch_info.default_label ? *switch_info.default_label
+                                     : switch_info.exit_label;
+    WriteJnz(match, kPromotedType, case_info.label, next_label);
+    if (!is_last_cond) {
+      WriteLabel(next_label);
+    }
+  }
+  if (switch_info.case_infos.empty()) {
+    WriteJmp(switch_info.default_label.value_or(switch_info.exit_label));
+  }
+}
+
+void X86AsmGenerator::Visit(const IdLabeledStmtNode& id_labeled_stmt) {
+  WriteLabel(UserLabelOf(id_labeled_stmt.label));
+  Dispatch(*id_labeled_stmt.stmt);
+}
+
+void X86AsmGenerator::Visit(const CaseStmtNode& case_stmt) {
+  assert(!switch_infos.empty());
+  // The evaluation of the case expression is done in the condition part.
+  const auto case_label = function.NewLabel();
+  switch_infos.back().case_infos.push_back({case_stmt.expr.get(), case_label});
+  WriteLabel(case_label);
+  Dispatch(*case_stmt.stmt);
+}
+
+void X86AsmGenerator::Visit(const DefaultStmtNode& default_stmt) {
+  assert(!switch_infos.empty());
+  const auto default_label = function.NewLabel();
+  switch_infos.back().default_label = default_label;
+  WriteLabel(default_label);
+  Dispatch(*default_stmt.stmt);
+}
+
+void X86AsmGenerator::Visit(const ExprStmtNode& expr_stmt) {
+  Dispatch(*expr_stmt.expr);
+}
+
+void X86AsmGenerator::Visit(const InitExprNode& init_expr) {
+  Dispatch(*init_expr.expr);
+}
+
+void X86AsmGenerator::Visit(const ArrDesNode& arr_des) {}
+
+void X86AsmGenerator::Visit(const IdDesNode& id_des) {}
+
+void X86AsmGenerator::Visit(const NullExprNode& null_expr) {
+  /* do nothing */
+}
+
+void X86AsmGenerator::Visit(const IdExprNode& id_expr) {
+  // If the id is a function, the result is the address of the function.
+  if (id_expr.type->IsFunc()) {
+    function.symbols.push_back(id_expr.id);
+    auto instr = x86::Instr{Opcode::kFuncAddr, Width::kLong};
+    instr.dst = function.NewVReg();
+    instr.size = function.symbols.size() - 1;
+    function.Append(instr);
+    value_recorder.Record({Operand::OfVReg(instr.dst)});
+    return;
+  }
+  assert(id_to_slot.count(id_expr.id) != 0);
+  value_recorder.Record(
+      ValueOfObject(*id_expr.type, Mem::OfSlot(id_to_slot.at(id_expr.id))));
+}
+
+void X86AsmGenerator::Visit(const IntConstExprNode& int_expr) {
+  value_recorder.Record(
+      {Operand::OfImm(static_cast<std::int64_t>(int_expr.val))});
+}
+
+void X86AsmGenerator::Visit(const ArgExprNode& arg_expr) {
+  Dispatch(*arg_expr.arg);
+}
+
+void X86AsmGenerator::Visit(const ArrSubExprNode& arr_sub_expr) {
+  Dispatch(*arr_sub_expr.arr);
+  const auto arr = value_recorder.ValueOfPrevExpr();
+  Dispatch(*arr_sub_expr.index);
+  const auto index =
+      ConvertTo_(value_recorder.ValueOfPrevExpr().val,
+                 *arr_sub_expr.index->type, PrimType{PrimitiveType::kLong});
+
+  const auto* arr_type = DynCast<ArrType>(arr_sub_expr.arr->type.get());
+  assert(arr_type);
+  const auto& element_type = arr_type->element_type();
+  const auto element_size = static_cast<std::int64_t>(element_type.size());
+  assert(arr.obj);
+  auto mem = *arr.obj;
+  if (index.IsImm()) {
+    // A constant index is folded into the displacement.
+    mem.offset += index.val * element_size;
+  } else {
+    const auto offset = WriteOp(Opcode::kMul, Width::kLong, index,
+                                Operand::OfImm(element_size));
+    mem = Mem::OfVReg(
+        WriteOp(Opcode::kAdd, Width::kLong, AddressOf(mem), offset).vreg());
+  }
+  value_recorder.Record(ValueOfObject(element_type, mem));
+}
+
+void X86AsmGenerator::Visit(const CondExprNode& cond_expr) {
+  Dispatch(*cond_expr.predicate);
+  const auto predicate = value_recorder.ValueOfPrevExpr();
+  // The second operand is evaluated only if the first compares unequal to 0;
+  // the third operand is evaluated only if the first compares equal to 0; the
+  // result is the value of the second or third operand (whichever is
+  // evaluated).
+  const auto second_label = function.NewLabel();
+  const auto third_label = function.NewLabel();
+  const auto end_label = function.NewLabel();
+  WriteJnz(predicate.val, *cond_expr.predicate->type, second_label,
+           third_label);
+  const auto& res_type = *cond_expr.type;
+  const auto res = function.NewVReg();
+  WriteLabel(second_label);
+  Dispatch(*cond_expr.then);
+  WriteCopy(res, WidthOf(res_type),
+            ConvertTo_(OperandOf(value_recorder.ValueOfPrevExpr()),
+                       *cond_expr.then->type, res_type));
+  WriteJmp(end_label);
+  WriteLabel(third_label);
+  Dispatch(*cond_expr.or_else);
+  WriteCopy(res, WidthOf(res_type),
+            ConvertTo_(OperandOf(value_recorder.ValueOfPrevExpr()),
+                       *cond_expr.or_else->type, res_type));
+  WriteLabel(end_label);
+  if (IsAggregate(res_type)) {
+    value_recorder.Record({Operand{}, Mem::OfVReg(res)});
+  } else {
+    value_recorder.Record({Operand::OfVReg(res)});
+  }
+}
+
+void X86AsmGenerator::Visit(const FuncCallExprNode& call_expr) {
+  const auto* func_type = DynCast<FuncType>(call_expr.func_expr->type.get());
+  if (const auto* ptr_type =
+          DynCast<PtrType>(call_expr.func_expr->type.get())) {
+    func_type = DynCast<FuncType>(&ptr_type->base_type());
+  }
+  assert(func_type);
+
+  auto call = x86::Call{};
+  // A function that is named is called directly; others through their
+  // addresses.
+  const auto* id_expr = DynCast<IdExprNode>(call_expr.func_expr.get());
+  if (id_expr && id_expr->type->IsFunc()) {
+    const auto runtime_func = RuntimeFuncOf(id_expr->id);
+    call.symbol = runtime_func.empty() ? id_expr->id : runtime_func;
+  } else {
+    Dispatch(*call_expr.func_expr);
+    call.callee = value_recorder.ValueOfPrevExpr().val;
+  }
+
+  /// @return The type that the `i`-th argument is passed as.
+  const auto param_type_of = [&](std::size_t i) -> const Type& {
+    const auto& param_types = func_type->param_types();
+    return i < param_types.size() ? *param_types.at(i)
+                                  : *call_expr.args.at(i)->type;
+  };
+  // Evaluate the arguments, which are converted to the types of the
+  // parameters.
+  for (auto i = std::size_t{0}, e = call_expr.args.size(); i < e; ++i) {
+    const auto& arg = call_expr.args.at(i);
+    Dispatch(*arg);
+    const auto& param_type = param_type_of(i);
+    const auto val = OperandOf(value_recorder.ValueOfPrevExpr());
+    if (Isa<RecordType>(param_type)) {
+      call.args.push_back({val, Width::kLong, true, param_type.size()});
+    } else {
+      call.args.push_back(
+          {ConvertTo_(val, *arg->type, param_type), WidthOf(param_type)});
+    }
+  }
+
+  const auto& ret_type = *call_expr.type;
+  auto instr = x86::Instr{Opcode::kCall};
+  instr.size = function.calls.size();
+  auto res = Value{};
+  if (Isa<RecordType>(ret_type)) {
+    // A returned record is copied to the caller, and the result is its
+    // address.
+    call.ret_record_size = ret_type.size();
+    call.ret_slot = function.NewSlot(
+        (ret_type.size() + 7) / 8 * 8, std::max(ret_type.alignment(),
+                                                std::size_t{8}));
+    res.obj = Mem::OfSlot(call.ret_slot);
+  } else {
+    call.ret_width = WidthOf(ret_type);
+    instr.dst = function.NewVReg();
+    res.val = Operand::OfVReg(instr.dst);
+  }
+  function.calls.push_back(std::move(call));
+  function.Append(instr);
+  value_recorder.Record(std::move(res));
+}
+
+void X86AsmGenerator::Visit(const PostfixArithExprNode& postfix_expr) {
+  // The result of the postfix ++ operator is the value of the operand. As a
+  // side effect, the value of the operand object is incremented; the postfix
+  // -- operator is analogous.
+  Dispatch(*postfix_expr.operand);
+  const auto operand = value_recorder.ValueOfPrevExpr();
+  assert(operand.obj);
+  const auto arith_op = postfix_expr.op == PostfixOperator::kIncr
+                            ? BinaryOperator::kAdd
+                            : BinaryOperator::kSub;
+  const auto& type = *postfix_expr.operand->type;
+  WriteStore(type, WriteIncrOrDecr_(arith_op, operand.val, type),
+             *operand.obj);
+  value_recorder.Record({operand.val});
+}
+
+void X86AsmGenerator::Visit(const RecordMemExprNode& mem_expr) {
+  Dispatch(*mem_expr.expr);
+  const auto record = value_recorder.ValueOfPrevExpr();
+  const auto* record_type = DynCast<RecordType>(mem_expr.expr->type.get());
+  assert(record_type && record.obj);
+  auto mem = *record.obj;
+  mem.offset += static_cast<std::int64_t>(record_type->OffsetOf(mem_expr.id));
+  value_recorder.Record(ValueOfObject(*mem_expr.type, mem));
+}
+
+void X86AsmGenerator::Visit(const UnaryExprNode& unary_expr) {
+  Dispatch(*unary_expr.operand);
+  auto operand = value_recorder.ValueOfPrevExpr();
+  const auto& operand_type = *unary_expr.operand->type;
+  switch (unary_expr.op) {
+    case UnaryOperator::kIncr:
+    case UnaryOperator::kDecr: {
+      // Equivalent to i += 1 or i -= 1.
+      assert(operand.obj);
+      const auto arith_op = unary_expr.op == UnaryOperator::kIncr
+                                ? BinaryOperator::kAdd
+                                : BinaryOperator::kSub;
+      const auto res = WriteIncrOrDecr_(arith_op, operand.val, operand_type);
+      WriteStore(operand_type, res, *operand.obj);
+      value_recorder.Record({res});
+    } break;
+    case UnaryOperator::kNeg:
+    case UnaryOperator::kBitComp: {
+      const auto& type = *unary_expr.type;
+      const auto val = ConvertTo_(operand.val, operand_type, type);
+      value_recorder.Record({WriteOp(unary_expr.op == UnaryOperator::kNeg
+                                         ? Opcode::kNeg
+                                         : Opcode::kNot,
+                                     WidthOf(type), val)});
+    } break;
+    case UnaryOperator::kNot:
+      // The expression !E is equivalent to (0 == E).
+      value_recorder.Record({WriteCmp(x86::Cond::kEq, WidthOf(operand_type),
+                                      operand.val, Operand::OfImm(0))});
+      break;
+    case UnaryOperator::kAddr:
+      if (operand_type.IsFunc()) {
+        // No-op; the function itself already evaluates to the address.
+        value_recorder.Record(std::move(operand));
+        break;
+      }
+      assert(operand.obj);
+      value_recorder.Record({AddressOf(*operand.obj)});
+      break;
+    case UnaryOperator::kDeref:
+      if (operand_type.IsPtr() &&
+          Cast<PtrType>(operand_type).base_type().IsFunc()) {
+        // No-op; the function itself also evaluates to the address.
+        value_recorder.Record(std::move(operand));
+        break;
+      }
+      // The result might yet be another pointer if the operand is a pointer to
+      // a pointer.
+      value_recorder.Record(
+          ValueOfObject(*unary_expr.type, MemOf(operand.val)));
+      break;
+    default:
+      // The unary plus does nothing.
+      value_recorder.Record(std::move(operand));
+      break;
+  }
+}
+
+void X86AsmGenerator::Visit(const BinaryExprNode& bin_expr) {
+  VisitLeftChain_(
+      bin_expr, [](const BinaryExprNode&) {},
+      [this](const BinaryExprNode& expr) { GenerateBinaryExpr_(expr); });
+}
+
+void X86AsmGenerator::GenerateBinaryExpr_(const BinaryExprNode& bin_expr) {
+  const auto lhs = value_recorder.ValueOfPrevExpr();
+  if (bin_expr.op == BinaryOperator::kComma) {
+    // The value of the left operand is discarded.
+    Dispatch(*bin_expr.rhs);
+    return;
+  }
+
+  if (bin_expr.op == BinaryOperator::kLand ||
+      bin_expr.op == BinaryOperator::kLor) {
+    // (&& operator) If the first operand compares equal to 0, the second
+    // operand is not evaluated. (|| operator) If the first operand compares
+    // unequal to 0, the second operand is not evaluated.
+    const auto rhs_label = function.NewLabel();
+    const auto short_circuit_label = function.NewLabel();
+    const auto end_label = function.NewLabel();
+    const auto is_land = bin_expr.op == BinaryOperator::kLand;
+    WriteJnz(lhs.val, *bin_expr.lhs->type,
+             is_land ? rhs_label : short_circuit_label,
+             is_land ? short_circuit_label : rhs_label);
+    const auto res = function.NewVReg();
+    WriteLabel(rhs_label);
+    Dispatch(*bin_expr.rhs);
+    WriteCopy(res, Width::kWord,
+              WriteCmp(x86::Cond::kNe, WidthOf(*bin_expr.rhs->type),
+                       value_recorder.ValueOfPrevExpr().val,
+                       Operand::OfImm(0)));
+    WriteJmp(end_label);
+    WriteLabel(short_circuit_label);
+    WriteCopy(res, Width::kWord, Operand::OfImm(is_land ? 0 : 1));
+    WriteLabel(end_label);
+    value_recorder.Record({Operand::OfVReg(res)});
+    return;
+  }
+
+  Dispatch(*bin_expr.rhs);
+  const auto rhs = value_recorder.ValueOfPrevExpr();
+  // The operands are converted to a common type, except that the shift amount
+  // is always a word.
+  const auto operand_type = OperandTypeOf(bin_expr);
+  const auto is_shift = bin_expr.op == BinaryOperator::kShl ||
+                        bin_expr.op == BinaryOperator::kShr;
+  const auto lhs_val = ConvertTo_(lhs.val, *bin_expr.lhs->type, *operand_type);
+  const auto rhs_val =
+      ConvertTo_(rhs.val, *bin_expr.rhs->type,
+                 is_shift ? static_cast<const Type&>(kPromotedType)
+                          : *operand_type);
+  const auto [op, cond] = InstrOf(bin_expr.op, *operand_type);
+  if (op == Opcode::kCmp) {
+    value_recorder.Record(
+        {WriteCmp(cond, WidthOf(*operand_type), lhs_val, rhs_val)});
+  } else {
+    value_recorder.Record(
+        {WriteOp(op, WidthOf(*bin_expr.type), lhs_val, rhs_val)});
+  }
+}
+
+void X86AsmGenerator::Visit(const SimpleAssignmentExprNode& assign_expr) {
+  Dispatch(*assign_expr.lhs);
+  const auto lhs = value_recorder.ValueOfPrevExpr();
+  Dispatch(*assign_expr.rhs);
+  const auto rhs = value_recorder.ValueOfPrevExpr();
+  assert(lhs.obj);
+  const auto& lhs_type = *assign_expr.lhs->type;
+  if (Isa<RecordType>(lhs_type)) {
+    // The value of the assignment is the assigned record.
+    WriteStoreOf_(OperandOf(rhs), *assign_expr.rhs->type, lhs_type, *lhs.obj);
+    value_recorder.Record({Operand{}, *lhs.obj});
+    return;
+  }
+  // The value of the assignment is that of the left operand after the
+  // assignment, i.e., converted to its type.
+  const auto val = ConvertTo_(rhs.val, *assign_expr.rhs->type, lhs_type);
+  WriteStore(lhs_type, val, *lhs.obj);
+  value_recorder.Record({val});
+}
+
+void X86AsmGenerator::ResetStates_() {
+  function = x86::Function{};
+  return_type_of_func = nullptr;
+  id_to_slot.clear();
+  user_labels.clear();
+  value_recorder = PrevExprValueRecorder{};
+  labels_of_jumpable_blocks.clear();
+  switch_infos.clear();
+}
+
+Operand X86AsmGenerator::ConvertTo_(const Operand& val, const Type& from,
+                                    const Type& to) {
+  const auto* from_prim = DynCast<PrimType>(&from);
+  if (!from_prim || !from_prim->IsInteger()) {
+    // Pointers are truncated implicitly when used as words.
+    return val;
+  }
+  const auto* to_prim = DynCast<PrimType>(&to);
+  if (!to.IsPtr() && (!to_prim || !to_prim->IsInteger())) {
+    return val;
+  }
+  auto ext = std::optional<x86::Ext>{};
+  if (WidthOf(from) == Width::kWord && WidthOf(to) == Width::kLong) {
+    ext = from_prim->IsUnsigned() ? x86::Ext::kUnsignedWord
+                                  : x86::Ext::kSignedWord;
+  } else if (to_prim && to_prim->size() < 4) {
+    // A long is truncated implicitly when used as a word, so only the integers
+    // narrower than a word are to be extended again.
+    const auto is_to_unsigned = to_prim->IsUnsigned();
+    const auto is_value_preserved =
+        from_prim->size() < to_prim->size()
+            ? from_prim->IsUnsigned() || !is_to_unsigned
+            : from_prim->size() == to_prim->size() &&
+                  from_prim->IsUnsigned() == is_to_unsigned;
+    if (!is_value_preserved) {
+      if (to_prim->size() == 1) {
+        ext = is_to_unsigned ? x86::Ext::kUnsignedByte
+                             : x86::Ext::kSignedByte;
+      } else {
+        ext = is_to_unsigned ? x86::Ext::kUnsignedHalf
+                             : x86::Ext::kSignedHalf;
+      }
+    }
+  }
+  if (!ext) {
+    return val;
+  }
+  if (val.IsImm()) {
+    // Constants are converted in place.
+    switch (*ext) {
+      case x86::Ext::kSignedWord:
+        return Operand::OfImm(static_cast<std::int32_t>(val.val));
+      case x86::Ext::kUnsignedWord:
+        return Operand::OfImm(static_cast<std::uint32_t>(val.val));
+      case x86::Ext::kSignedHalf:
+        return Operand::OfImm(static_cast<std::int16_t>(val.val));
+      case x86::Ext::kUnsignedHalf:
+        return Operand::OfImm(static_cast<std::uint16_t>(val.val));
+      case x86::Ext::kSignedByte:
+        return Operand::OfImm(static_cast<std::int8_t>(val.val));
+      case x86::Ext::kUnsignedByte:
+        return Operand::OfImm(static_cast<std::uint8_t>(val.val));
+    }
+  }
+  auto instr = x86::Instr{Opcode::kExt, WidthOf(to)};
+  instr.ext = *ext;
+  instr.dst = function.NewVReg();
+  instr.lhs = val;
+  function.Append(instr);
+  return Operand::OfVReg(instr.dst);
+}
+
+Operand X86AsmGenerator::ConvertForStore_(const Operand& val, const Type& from,
+                                          const Type& to) {
+  return WidthOf(to) == Width::kLong ? ConvertTo_(val, from, to) : val;
+}
+
+Operand X86AsmGenerator::WriteIncrOrDecr_(BinaryOperator op,
+                                          const Operand& val,
+                                          const Type& type) {
+  const auto res =
+      WriteOp(InstrOf(op, type).first, WidthOf(type), val, Operand::OfImm(1));
+  // The narrower integers are promoted, and wrap around to their own type.
+  return type.size() < 4 ? ConvertTo_(res, kPromotedType, type) : res;
+}
+
+void X86AsmGenerator::WriteStoreOf_(const Operand& val, const Type& from,
+                                    const Type& to, const Mem& mem) {
+  if (Isa<RecordType>(to)) {
+    // Initialized from another record, which is copied as a whole.
+    WriteBlit(MemOf(val), mem, to.size());
+    return;
+  }
+  WriteStore(to, ConvertForStore_(val, from, to), mem);
+}
@@ -0,0 +1,234 @@
+// Defines `yylex`, which the parser calls for each token. The tokens come
+// from the flex scanner, a `TokenBuffer` or a `Preprocessor`.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "lexer.hpp"
+#include "preprocessor.hpp"
+#include "y.tab.hpp"
+
+/// @note Defined in the flex generated code.
+extern yy::parser::symbol_type FlexLex();
+
+namespace {
+
+using Token = yy::parser::token;
+
+Token::token_kind_type ParserTokenOf(TokenKind kind) {
+  switch (kind) {
+    case TokenKind::kEof:
+      return Token::TOK_EOF;
+    case TokenKind::kBreak:
+      return Token::TOK_BREAK;
+    case TokenKind::kCase:
+      return Token::TOK_CASE;
+    case TokenKind::kChar:
+      return Token::TOK_CHAR;
+    case TokenKind::kContinue:
+      return Token::TOK_CONTINUE;
+    case TokenKind::kDefault:
+      return Token::TOK_DEFAULT;
+    case TokenKind::kDo:
+      return Token::TOK_DO;
+    case TokenKind::kElse:
+      return Token::TOK_ELSE;
+    case TokenKind::kFor:
+      return Token::TOK_FOR;
+    case TokenKind::kGoto:
+      return Token::TOK_GOTO;
+    case TokenKind::kIf:
+      return Token::TOK_IF;
+    case TokenKind::kInt:
+      return Token::TOK_INT;
+    case TokenKind::kLong:
+      return Token::TOK_LONG;
+    case TokenKind::kReturn:
+      return Token::TOK_RETURN;
+    case TokenKind::kShort:
+      return Token::TOK_SHORT;
+    case TokenKind::kSigned:
+      return Token::TOK_SIGNED;
+    case TokenKind::kStruct:
+      return Token::TOK_STRUCT;
+    case TokenKind::kSwitch:
+      return Token::TOK_SWITCH;
+    case TokenKind::kUnion:
+      return Token::TOK_UNION;
+    case TokenKind::kUnsigned:
+      return Token::TOK_UNSIGNED;
+    case TokenKind::kWhile:
+      return Token::TOK_WHILE;
+    case TokenKind::kSemicolon:
+      return Token::TOK_SEMICOLON;
+    case TokenKind::kColon:
+      return Token::TOK_COLON;
+    case TokenKind::kComma:
+      return Token::TOK_COMMA;
+    case TokenKind::kDot:
+      return Token::TOK_DOT;
+    case TokenKind::kArrow:
+      return Token::TOK_ARROW;
+    case TokenKind::kMinus:
+      return Token::TOK_MINUS;
+    case TokenKind::kPlus:
+      return Token::TOK_PLUS;
+    case TokenKind::kStar:
+      return Token::TOK_STAR;
+    case TokenKind::kDiv:
+      return Token::TOK_DIV;
+    case TokenKind::kMod:
+      return Token::TOK_MOD;
+    case TokenKind::kAmpersand:
+      return Token::TOK_AMPERSAND;
+    case TokenKind::kExclamation:
+      return Token::TOK_EXCLAMATION;
+    case TokenKind::kQuestion:
+      return Token::TOK_QUESTION;
+    case TokenKind::kXor:
+      return Token::TOK_XOR;
+    case TokenKind::kOr:
+      return Token::TOK_OR;
+    case TokenKind::kLogicOr:
+      return Token::TOK_LOGIC_OR;
+    case TokenKind::kLogicAnd:
+      return Token::TOK_LOGIC_AND;
+    case TokenKind::kTilde:
+      return Token::TOK_TILDE;
+    case TokenKind::kAssign:
+      return Token::TOK_ASSIGN;
+    case TokenKind::kShiftLeft:
+      return Token::TOK_SHIFT_LEFT;
+    case TokenKind::kShiftRight:
+      return Token::TOK_SHIFT_RIGHT;
+    case TokenKind::kLt:
+      return Token::TOK_LT;
+    case TokenKind::kGt:
+      return Token::TOK_GT;
+    case TokenKind::kDecr:
+      return Token::TOK_DECR;
+    case TokenKind::kIncr:
+      return Token::TOK_INCR;
+    case TokenKind::kEq:
+      return Token::TOK_EQ;
+    case TokenKind::kNe:
+      return Token::TOK_NE;
+    case TokenKind::kLe:
+      return Token::TOK_LE;
+    case TokenKind::kGe:
+      return Token::TOK_GE;
+    case TokenKind::kLeftParen:
+      return Token::TOK_LEFT_PAREN;
+    case TokenKind::kRightParen:
+      return Token::TOK_RIGHT_PAREN;
+    case TokenKind::kLeftCurly:
+      return Token::TOK_LEFT_CURLY;
+    case TokenKind::kRightCurly:
+      return Token::TOK_RIGHT_CURLY;
+    case TokenKind::kLeftSquare:
+      return Token::TOK_LEFT_SQUARE;
+    case TokenKind::kRightSquare:
+      return Token::TOK_RIGHT_SQUARE;
+    default:
+      // Tokens with values or invalid tokens are handled separately.
+      return Token::TOK_YYUNDEF;
+  }
+}
+
+yy::parser::symbol_type SymbolOf(TokenKind kind, std::string_view text,
+                                 const SourceRange& loc) {
+  switch (kind) {
+    case TokenKind::kId:
+      return yy::parser::make_ID(std::string{text}, loc);
+    case TokenKind::kNum:
+      return yy::parser::make_NUM(DecimalValueOf(text), loc);
+    case TokenKind::kInvalid:
+      std::cerr << "Invalid input: " << text << std::endl;
+      std::exit(-1);
+    default:
+      return yy::parser::symbol_type{ParserTokenOf(kind), loc};
+  }
+}
+
+/// @brief Hands the tokens of a buffer to the parser one at a time.
+class TokenBufferReader {
+ public:
+  explicit TokenBufferReader(const TokenBuffer& tokens) : tokens_{tokens} {}
+
+  yy::parser::symbol_type Next() {
+    // The EOF token is the last one and is returned repeatedly.
+    const auto i = next_;
+    if (i + 1 < tokens_.size()) {
+      ++next_;
+    }
+    return SymbolOf(tokens_.kinds().at(i), tokens_.TextOf(i), LocationOf_(i));
+  }
+
+ private:
+  const TokenBuffer& tokens_;
+  std::size_t next_{0};
+
+  SourceRange LocationOf_(std::size_t i) const {
+    const auto offset = tokens_.offsets().at(i);
+    return SourceRange{Location{offset},
+                       Location{offset + tokens_.lengths().at(i)}};
+  }
+};
+
+const TokenBuffer*
+    parser_tokens  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables):
+                   // `yylex` takes no arguments.
+    = nullptr;
+std::unique_ptr<TokenBufferReader>
+    reader;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+Preprocessor*
+    parser_preprocessor  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    = nullptr;
+Location
+    parser_file_base  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    {0};
+
+/// @return `symbol` located in the file that starts at `parser_file_base`.
+yy::parser::symbol_type InParserFile(yy::parser::symbol_type symbol) {
+  symbol.location.begin.offset += parser_file_base.offset;
+  symbol.location.end.offset += parser_file_base.offset;
+  return symbol;
+}
+
+}  // namespace
+
+void SetParserTokens(const TokenBuffer* tokens) {
+  parser_tokens = tokens;
+  reader.reset();
+}
+
+void SetParserPreprocessor(Preprocessor* preprocessor) {
+  parser_preprocessor = preprocessor;
+}
+
+void SetParserFileBase(Location base) {
+  parser_file_base = base;
+}
+
+yy::parser::symbol_type yylex() {
+  if (parser_preprocessor) {
+    const auto token = parser_preprocessor->Next();
+    return SymbolOf(
+        token.kind, token.text,
+        SourceRange{token.loc,
+                    Location{static_cast<std::uint32_t>(token.loc.offset +
+                                                        token.text.size())}});
+  }
+  if (!parser_tokens) {
+    return InParserFile(FlexLex());
+  }
+  if (!reader) {
+    reader = std::make_unique<TokenBufferReader>(*parser_tokens);
+  }
+  return InParserFile(reader->Next());
+}
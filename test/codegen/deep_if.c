@@ -0,0 +1,58 @@
+// 2^15 nested if statements with braces and an else, and 2^15 more without
+// braces, are expanded from the macros.
+
+#define L1 if (a < 2) {
+#define R1 } else a = 0;
+#define U1 if (a)
+#define L2 L1 L1
+#define R2 R1 R1
+#define U2 U1 U1
+#define L3 L2 L2
+#define R3 R2 R2
+#define U3 U2 U2
+#define L4 L3 L3
+#define R4 R3 R3
+#define U4 U3 U3
+#define L5 L4 L4
+#define R5 R4 R4
+#define U5 U4 U4
+#define L6 L5 L5
+#define R6 R5 R5
+#define U6 U5 U5
+#define L7 L6 L6
+#define R7 R6 R6
+#define U7 U6 U6
+#define L8 L7 L7
+#define R8 R7 R7
+#define U8 U7 U7
+#define L9 L8 L8
+#define R9 R8 R8
+#define U9 U8 U8
+#define L10 L9 L9
+#define R10 R9 R9
+#define U10 U9 U9
+#define L11 L10 L10
+#define R11 R10 R10
+#define U11 U10 U10
+#define L12 L11 L11
+#define R12 R11 R11
+#define U12 U11 U11
+#define L13 L12 L12
+#define R13 R12 R12
+#define U13 U12 U12
+#define L14 L13 L13
+#define R14 R13 R13
+#define U14 U13 U13
+#define L15 L14 L14
+#define R15 R14 R14
+#define U15 U14 U14
+#define L16 L15 L15
+#define R16 R15 R15
+#define U16 U15 U15
+
+int main() {
+  int a = 1;
+  L16 U16 a = a + 1; R16
+  __builtin_print(a);
+  return 0;
+}
@@ -0,0 +1,13 @@
+// A decimal constant that doesn't fit in int has the type long, or
+// unsigned long if it doesn't fit in long either.
+int main() {
+  long a = 2147483648;
+  long b = 9223372036854775807;
+  unsigned long c = 18446744073709551615;
+  __builtin_print(a / 1024 == 2097152);
+  __builtin_print(b / 4294967296 == 2147483647);
+  __builtin_print(c / 4294967296 == 4294967295);
+  __builtin_print(2147483648 > 0);
+  __builtin_print(18446744073709551615 > 0);
+  return 0;
+}